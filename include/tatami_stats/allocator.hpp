@@ -0,0 +1,225 @@
+#ifndef TATAMI_STATS_ALLOCATOR_HPP
+#define TATAMI_STATS_ALLOCATOR_HPP
+
+#include <new>
+#include <memory>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+/**
+ * @file allocator.hpp
+ *
+ * @brief Allocate large per-thread buffers.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @brief Interface for allocating large internal buffers.
+ *
+ * The per-thread partial results in the running calculations (e.g., in `sum()` or `group_rss()`) can be very large,
+ * as they have one entry for each element of the target dimension (for each group, if applicable).
+ * These are allocated via an `Allocator`, which can be supplied by applications through the `allocator` field of each options structure.
+ * This allows applications to control the alignment and paging of these buffers, e.g., to use huge pages or to enable NUMA-aware placement.
+ *
+ * Each buffer is allocated and then zero-initialized by the thread that uses it.
+ * With the default first-touch policy of most operating systems, this means that the pages are placed on the NUMA node of that thread.
+ */
+class Allocator {
+public:
+    /**
+     * @cond
+     */
+    Allocator() = default;
+    Allocator(const Allocator&) = delete;
+    Allocator& operator=(const Allocator&) = delete;
+    virtual ~Allocator() = default;
+    /**
+     * @endcond
+     */
+
+    /**
+     * Allocate memory.
+     * This may be called concurrently from different threads.
+     *
+     * @param bytes Number of bytes to allocate.
+     * This is guaranteed to be positive.
+     *
+     * @return Pointer to the allocated memory, which should be aligned to at least `alignof(std::max_align_t)`.
+     * The contents of this memory do not need to be initialized.
+     */
+    virtual void* allocate(std::size_t bytes) = 0;
+
+    /**
+     * Release memory that was previously allocated by `allocate()`.
+     * This may be called concurrently from different threads.
+     *
+     * @param ptr Pointer returned by `allocate()`.
+     * @param bytes Number of bytes that was passed to `allocate()`.
+     */
+    virtual void deallocate(void* ptr, std::size_t bytes) = 0;
+};
+
+/**
+ * @brief Allocate aligned buffers, possibly with huge pages.
+ *
+ * This aligns each buffer to `alignment`, which defaults to 64 bytes to match the cache line size and the width of AVX-512 registers.
+ * If `huge_pages = true`, buffers that are larger than a huge page are aligned to the huge page size and the operating system is advised to back them with transparent huge pages.
+ * This reduces TLB misses when accessing large buffers, at the cost of some memory overhead from the greater alignment.
+ * Huge pages are currently only supported on Linux, and are otherwise ignored.
+ *
+ * This is the default allocator if no `Allocator` is supplied in the options.
+ */
+class AlignedAllocator final : public Allocator {
+public:
+    /**
+     * @param alignment Alignment of each buffer in bytes.
+     * This should be a power of two.
+     * @param huge_pages Whether to use transparent huge pages for large buffers.
+     */
+    AlignedAllocator(const std::size_t alignment = 64, const bool huge_pages = false) : my_alignment(alignment), my_huge_pages(huge_pages) {
+        if (my_alignment < alignof(std::max_align_t)) {
+            my_alignment = alignof(std::max_align_t);
+        }
+    }
+
+    /**
+     * Size of a huge page in bytes.
+     * This is the default size for transparent huge pages on x86-64 Linux.
+     */
+    static constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+    /**
+     * @cond
+     */
+    void* allocate(const std::size_t bytes) override {
+        void* ptr = ::operator new(bytes, std::align_val_t(choose_alignment(bytes)));
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (use_huge_pages(bytes)) {
+            madvise(ptr, bytes, MADV_HUGEPAGE); // failure is harmless, we just don't get huge pages.
+        }
+#endif
+        return ptr;
+    }
+
+    void deallocate(void* const ptr, const std::size_t bytes) override {
+        ::operator delete(ptr, std::align_val_t(choose_alignment(bytes)));
+    }
+    /**
+     * @endcond
+     */
+
+    /**
+     * @return Alignment of each buffer in bytes.
+     */
+    std::size_t alignment() const {
+        return my_alignment;
+    }
+
+    /**
+     * @return Whether transparent huge pages are used.
+     */
+    bool huge_pages() const {
+        return my_huge_pages;
+    }
+
+private:
+    std::size_t my_alignment;
+    bool my_huge_pages;
+
+    bool use_huge_pages(const std::size_t bytes) const {
+        return my_huge_pages && bytes >= huge_page_size;
+    }
+
+    std::size_t choose_alignment(const std::size_t bytes) const {
+        if (use_huge_pages(bytes) && my_alignment < huge_page_size) {
+            return huge_page_size;
+        } else {
+            return my_alignment;
+        }
+    }
+};
+
+/**
+ * @cond
+ */
+inline Allocator& get_allocator(Allocator* const allocator) {
+    if (allocator) {
+        return *allocator;
+    }
+    static AlignedAllocator default_allocator;
+    return default_allocator;
+}
+
+// Owning array of trivial values, allocated by an Allocator.
+// Contents are left uninitialized so that they can be first touched by the thread that uses them.
+template<typename Type_>
+class AllocatedArray {
+    static_assert(std::is_trivially_default_constructible<Type_>::value && std::is_trivially_destructible<Type_>::value);
+
+public:
+    AllocatedArray() = default;
+
+    AllocatedArray(Allocator* const allocator, const std::size_t size) : my_allocator(&get_allocator(allocator)), my_size(size) {
+        if (my_size) {
+            if (my_size > std::numeric_limits<std::size_t>::max() / sizeof(Type_)) {
+                throw std::bad_array_new_length(); // same behavior as 'new Type_[size]'.
+            }
+            auto raw = my_allocator->allocate(sizeof(Type_) * my_size);
+            my_data = static_cast<Type_*>(raw);
+            std::uninitialized_default_construct_n(my_data, my_size);
+        }
+    }
+
+    AllocatedArray(AllocatedArray&& other) noexcept {
+        swap(other);
+    }
+
+    AllocatedArray& operator=(AllocatedArray&& other) noexcept {
+        AllocatedArray tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    AllocatedArray(const AllocatedArray&) = delete;
+    AllocatedArray& operator=(const AllocatedArray&) = delete;
+
+    ~AllocatedArray() {
+        if (my_data) {
+            my_allocator->deallocate(my_data, sizeof(Type_) * my_size);
+        }
+    }
+
+public:
+    Type_* data() const {
+        return my_data;
+    }
+
+    std::size_t size() const {
+        return my_size;
+    }
+
+private:
+    Allocator* my_allocator = NULL;
+    Type_* my_data = NULL;
+    std::size_t my_size = 0;
+
+    void swap(AllocatedArray& other) noexcept {
+        std::swap(my_allocator, other.my_allocator);
+        std::swap(my_data, other.my_data);
+        std::swap(my_size, other.my_size);
+    }
+};
+/**
+ * @endcond
+ */
+
+}
+
+#endif
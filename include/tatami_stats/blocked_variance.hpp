@@ -0,0 +1,675 @@
+#ifndef TATAMI_STATS_BLOCKED_VARIANCE_HPP
+#define TATAMI_STATS_BLOCKED_VARIANCE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <memory>
+
+#include "tatami/tatami.hpp"
+#include "sanisizer/sanisizer.hpp"
+#include "quickstats/quickstats.hpp"
+#include "auveh/auveh.hpp"
+
+#include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+#include "deterministic.hpp"
+
+/**
+ * @file blocked_variance.hpp
+ *
+ * @brief Compute variances within blocks and average them across blocks.
+ */
+
+namespace tatami_stats {
+
+/**
+ * Policy for weighting each block when averaging statistics across blocks in `blocked_variance()`.
+ */
+enum class BlockWeightPolicy : char {
+    /**
+     * Each block is given equal weight, regardless of its size.
+     */
+    EQUAL,
+
+    /**
+     * Each block is weighted by its size, i.e., the number of columns (if `row = true`) or rows (otherwise) that it contains.
+     */
+    SIZE,
+
+    /**
+     * Each block is weighted by the minimum of its size and `BlockedVarianceOptions::size_cap`.
+     * Small blocks are downweighted in proportion to their size, while all blocks larger than the cap are given equal weight.
+     * This avoids dominance of the average by the largest blocks while reducing the influence of imprecise statistics from small blocks.
+     */
+    CAPPED_SIZE
+};
+
+/**
+ * @brief Options for `blocked_variance()`.
+ * @tparam Output_ Floating-point type of the output data.
+ */
+template<typename Output_ = double>
+struct BlockedVarianceOptions {
+    /**
+     * Policy for weighting each block when averaging the per-block means and variances.
+     */
+    BlockWeightPolicy weight_policy = BlockWeightPolicy::EQUAL;
+
+    /**
+     * Cap on the size of each block when computing its weight, only used if `weight_policy = BlockWeightPolicy::CAPPED_SIZE`.
+     */
+    double size_cap = 1000;
+
+    /**
+     * Number of threads to use when computing variances across a `tatami::Matrix`.
+     * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     */
+    int num_threads = 1;
+
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+
+    /**
+     * Placeholder value to use for the mean when all blocks are empty.
+     * This is NaN if supported by `Output_`, otherwise zero.
+     */
+    Output_ mean_placeholder = quickstats::nan_if_available_else_zero<Output_>();
+
+    /**
+     * Placeholder value to use for the variance when no block contains at least two observations.
+     * This is NaN if supported by `Output_`, otherwise zero.
+     */
+    Output_ variance_placeholder = quickstats::nan_if_available_else_zero<Output_>();
+};
+
+/**
+ * @brief Result buffers for `blocked_variance()`.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ */
+template<typename Output_>
+struct BlockedVarianceBuffers {
+    /**
+     * Pointer to an array of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise).
+     * After `blocked_variance()`, this is filled with the weighted average of the per-block means of each row/column.
+     */
+    Output_* mean;
+
+    /**
+     * Pointer to an array of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise).
+     * After `blocked_variance()`, this is filled with the weighted average of the per-block variances of each row/column.
+     */
+    Output_* variance;
+};
+
+/**
+ * @cond
+ */
+// Normalized weights for averaging the per-block means (over blocks with at least one observation)
+// and the per-block variances (over blocks with at least two observations).
+template<typename Output_>
+struct BlockWeights {
+    std::vector<Output_> mean;
+    std::vector<Output_> variance;
+    bool any_mean = false;
+    bool any_variance = false;
+};
+
+template<typename Output_, typename Index_>
+BlockWeights<Output_> compute_block_weights(const std::size_t num_blocks, const Index_* const block_size, const BlockedVarianceOptions<Output_>& opt) {
+    BlockWeights<Output_> output;
+    output.mean = sanisizer::create<std::vector<Output_> >(num_blocks);
+    output.variance = sanisizer::create<std::vector<Output_> >(num_blocks);
+
+    Output_ mean_total = 0, variance_total = 0;
+    for (std::size_t b = 0; b < num_blocks; ++b) {
+        const auto bsize = block_size[b];
+        if (bsize == 0) {
+            continue;
+        }
+
+        Output_ weight = 1;
+        if (opt.weight_policy == BlockWeightPolicy::SIZE) {
+            weight = bsize;
+        } else if (opt.weight_policy == BlockWeightPolicy::CAPPED_SIZE) {
+            weight = std::min(static_cast<double>(bsize), opt.size_cap);
+        }
+
+        output.mean[b] = weight;
+        mean_total += weight;
+        if (bsize > 1) {
+            output.variance[b] = weight;
+            variance_total += weight;
+        }
+    }
+
+    output.any_mean = (mean_total > 0);
+    if (output.any_mean) {
+        for (auto& w : output.mean) {
+            w /= mean_total;
+        }
+    }
+    output.any_variance = (variance_total > 0);
+    if (output.any_variance) {
+        for (auto& w : output.variance) {
+            w /= variance_total;
+        }
+    }
+
+    return output;
+}
+
+template<typename Value_, typename Index_, typename Block_, typename Output_>
+void blocked_variance_direct(
+    const bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Block_* const block,
+    const std::size_t num_blocks,
+    const Index_* const block_size,
+    const BlockWeights<Output_>& weights,
+    BlockedVarianceBuffers<Output_>& output,
+    const BlockedVarianceOptions<Output_>& opt
+) {
+    const auto otherdim = (row ? mat.ncol() : mat.nrow());
+
+    // Reducing the per-block statistics to the weighted averages for a single vector.
+    const auto combine = [&](const std::vector<Output_>& cur_means, const std::vector<Output_>& cur_rss, const Index_ i) -> void {
+        Output_ mean = 0, variance = 0;
+        for (std::size_t b = 0; b < num_blocks; ++b) {
+            mean += weights.mean[b] * cur_means[b];
+            if (weights.variance[b]) {
+                variance += weights.variance[b] * cur_rss[b] / static_cast<Output_>(block_size[b] - 1);
+            }
+        }
+        output.mean[i] = (weights.any_mean ? mean : opt.mean_placeholder);
+        output.variance[i] = (weights.any_variance ? variance : opt.variance_placeholder);
+    };
+
+    if (mat.sparse()) {
+        tatami::Options topt;
+        topt.sparse_ordered_index = false;
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "blocked_variance", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor, topt);
+            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
+            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(otherdim);
+            auto cur_means = sanisizer::create<std::vector<Output_> >(num_blocks);
+            auto cur_rss = sanisizer::create<std::vector<Output_> >(num_blocks);
+            auto cur_non_zeros = sanisizer::create<std::vector<Index_> >(num_blocks);
+
+            for (Index_ x = 0; x < l; ++x) {
+                auto range = tscope.fetch([&]() { return ext->fetch(vbuffer.data(), ibuffer.data()); });
+                std::fill(cur_means.begin(), cur_means.end(), 0);
+                std::fill(cur_rss.begin(), cur_rss.end(), 0);
+                std::fill(cur_non_zeros.begin(), cur_non_zeros.end(), 0);
+
+                for (Index_ i = 0; i < range.number; ++i) {
+                    const auto b = block[range.index[i]];
+                    cur_means[b] += range.value[i];
+                    ++cur_non_zeros[b];
+                }
+                for (std::size_t b = 0; b < num_blocks; ++b) {
+                    if (block_size[b]) {
+                        cur_means[b] /= block_size[b];
+                    }
+                }
+
+                for (Index_ i = 0; i < range.number; ++i) {
+                    const auto b = block[range.index[i]];
+                    const auto delta = range.value[i] - cur_means[b];
+                    cur_rss[b] += delta * delta;
+                }
+                for (std::size_t b = 0; b < num_blocks; ++b) {
+                    cur_rss[b] += cur_means[b] * cur_means[b] * (block_size[b] - cur_non_zeros[b]);
+                }
+
+                combine(cur_means, cur_rss, s + x);
+            }
+        }, mat, row, opt);
+
+    } else {
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "blocked_variance", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
+            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
+            auto cur_means = sanisizer::create<std::vector<Output_> >(num_blocks);
+            auto cur_rss = sanisizer::create<std::vector<Output_> >(num_blocks);
+
+            for (Index_ x = 0; x < l; ++x) {
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer.data()); });
+                std::fill(cur_means.begin(), cur_means.end(), 0);
+                std::fill(cur_rss.begin(), cur_rss.end(), 0);
+
+                for (Index_ j = 0; j < otherdim; ++j) {
+                    cur_means[block[j]] += ptr[j];
+                }
+                for (std::size_t b = 0; b < num_blocks; ++b) {
+                    if (block_size[b]) {
+                        cur_means[b] /= block_size[b];
+                    }
+                }
+
+                for (Index_ j = 0; j < otherdim; ++j) {
+                    const auto b = block[j];
+                    const auto delta = ptr[j] - cur_means[b];
+                    cur_rss[b] += delta * delta;
+                }
+
+                combine(cur_means, cur_rss, s + x);
+            }
+        }, mat, row, opt);
+    }
+}
+
+template<typename Value_, typename Index_, typename Block_, typename Output_>
+void blocked_variance_running(
+    const bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Block_* const block,
+    const std::size_t num_blocks,
+    const Index_* const block_size,
+    const BlockWeights<Output_>& weights,
+    BlockedVarianceBuffers<Output_>& output,
+    const BlockedVarianceOptions<Output_>& opt
+) {
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    const Index_ otherdim = (row ? mat.ncol() : mat.nrow());
+
+    // Ordering the vectors by block so that each block can be extracted and reduced in turn.
+    // This means that we only need to hold the statistics for one block at a time, regardless of the number of blocks.
+    auto block_starts = sanisizer::create<std::vector<Index_> >(sanisizer::sum<std::size_t>(num_blocks, 1));
+    for (std::size_t b = 0; b < num_blocks; ++b) {
+        block_starts[b + 1] = block_starts[b] + block_size[b];
+    }
+    auto ordered = tatami::create_container_of_Index_size<std::vector<Index_> >(otherdim);
+    {
+        auto offsets = block_starts;
+        for (Index_ o = 0; o < otherdim; ++o) {
+            ordered[offsets[block[o]]++] = o;
+        }
+    }
+
+    std::fill_n(output.mean, dim, 0);
+    std::fill_n(output.variance, dim, 0);
+    const bool is_sparse = mat.is_sparse();
+
+    // Per-thread buffers for extracting and reducing a contiguous run of vectors in 'ordered'.
+    struct Reducer {
+        std::vector<Value_> vbuffer;
+        std::vector<Index_> ibuffer, nonzeros;
+    };
+    const auto create_reducer = [&]() -> Reducer {
+        Reducer output;
+        tatami::resize_container_to_Index_size(output.vbuffer, dim);
+        if (is_sparse) {
+            tatami::resize_container_to_Index_size(output.ibuffer, dim);
+            tatami::resize_container_to_Index_size(output.nonzeros, dim);
+        }
+        return output;
+    };
+
+    // Computing the mean and RSS of the vectors in '[start, start + length)' of 'ordered', storing them in the zero-initialized 'cur_mean' and 'cur_rss'.
+    const auto reduce = [&](TraceScope& tscope, Reducer& work, const Index_ start, const Index_ length, Output_* const cur_mean, Output_* const cur_rss) -> void {
+        std::shared_ptr<const tatami::Oracle<Index_> > oracle = std::make_shared<tatami::FixedViewOracle<Index_> >(ordered.data() + start, static_cast<std::size_t>(length));
+
+        if (is_sparse) {
+            std::fill(work.nonzeros.begin(), work.nonzeros.end(), 0);
+            tatami::Options topt;
+            topt.sparse_ordered_index = false;
+            auto ext = prefetch_oracular_extractor<true>(mat, !row, std::move(oracle), opt.prefetch, opt.executor, topt);
+            for (Index_ x = 0; x < length; ++x) {
+                auto out = tscope.fetch([&]() { return ext->fetch(work.vbuffer.data(), work.ibuffer.data()); });
+                AUVEH_NODEP
+                for (Index_ i = 0; i < out.number; ++i) {
+                    const auto d = out.index[i];
+                    quickstats::update_rss(cur_mean[d], cur_rss[d], out.value[i], ++work.nonzeros[d]);
+                }
+            }
+            AUVEH_NODEP
+            for (Index_ d = 0; d < dim; ++d) {
+                quickstats::update_rss_with_zeros_unsafe(cur_mean[d], cur_rss[d], static_cast<Index_>(length - work.nonzeros[d]), length);
+            }
+
+        } else {
+            auto ext = prefetch_oracular_extractor<false>(mat, !row, std::move(oracle), opt.prefetch, opt.executor);
+            for (Index_ x = 0; x < length; ++x) {
+                auto ptr = tscope.fetch([&]() { return ext->fetch(work.vbuffer.data()); });
+                AUVEH_NODEP
+                for (Index_ d = 0; d < dim; ++d) {
+                    quickstats::update_rss(cur_mean[d], cur_rss[d], ptr[d], x + 1);
+                }
+            }
+        }
+    };
+
+    std::size_t num_nonempty = 0;
+    for (std::size_t b = 0; b < num_blocks; ++b) {
+        num_nonempty += (block_size[b] > 0);
+    }
+
+    // If there are fewer non-empty blocks than threads, whole blocks cannot occupy all threads.
+    // Instead, we process one block at a time and split its vectors across all threads.
+    // The per-thread means and RSS values are then merged with Chan's method, in thread order for consistent results.
+    if (opt.num_threads > 1 && num_nonempty < static_cast<std::size_t>(opt.num_threads)) {
+        PartialBuffers<Output_> all_partial(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL, opt.num_threads, opt.allocator, 2);
+
+        for (std::size_t b = 0; b < num_blocks; ++b) {
+            const Index_ bsize = block_size[b];
+            if (bsize == 0) {
+                continue;
+            }
+
+            const auto chunk_boundaries = equal_boundaries(bsize, opt.num_threads);
+            const int nused = parallelize_by_boundaries([&](int thread, Index_ start, Index_ length) -> void {
+                TraceScope tscope(opt.tracer, "blocked_variance", "compute", thread);
+                const auto partial = all_partial.acquire(thread, dim);
+                tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim) * 2);
+                auto work = create_reducer();
+                reduce(tscope, work, block_starts[b] + start, length, partial[0], partial[1]);
+            }, chunk_boundaries, opt.executor);
+
+            const auto mweight = weights.mean[b];
+            const auto vweight = weights.variance[b];
+            parallelize_merge([&](Index_ start, Index_ length) -> void {
+                const Index_ end = start + length;
+                const auto first = all_partial.get(0);
+                const auto first_mean = first[0];
+                const auto first_rss = first[1];
+                Output_ count = chunk_boundaries[1];
+                for (int u = 1; u < nused; ++u) {
+                    const auto partial = all_partial.get(u);
+                    const auto cur_mean = partial[0];
+                    const auto cur_rss = partial[1];
+                    const Output_ cur_count = chunk_boundaries[u + 1] - chunk_boundaries[u];
+                    for (Index_ d = start; d < end; ++d) {
+                        deterministic_merge_rss(first_mean[d], first_rss[d], count, cur_mean[d], cur_rss[d], cur_count);
+                    }
+                    count += cur_count;
+                }
+                AUVEH_NODEP
+                for (Index_ d = start; d < end; ++d) {
+                    output.mean[d] += mweight * first_mean[d];
+                }
+                if (vweight) {
+                    const Output_ vmult = vweight / static_cast<Output_>(bsize - 1);
+                    AUVEH_NODEP
+                    for (Index_ d = start; d < end; ++d) {
+                        output.variance[d] += vmult * first_rss[d];
+                    }
+                }
+            }, dim, opt, "blocked_variance");
+        }
+
+    } else {
+        // Each worker handles a contiguous run of blocks, balanced by the block sizes.
+        const bool do_parallel = opt.num_threads > 1;
+        std::optional<PartialBuffers<Output_> > all_partial;
+        if (do_parallel) {
+            all_partial.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL, opt.num_threads, opt.allocator, 2);
+        }
+        const auto boundaries = partition_by_cost(num_blocks, block_size, opt.num_threads);
+
+        const int nused = parallelize_by_boundaries([&](int thread, std::size_t bs, std::size_t bl) -> void {
+            TraceScope tscope(opt.tracer, "blocked_variance", "compute", thread);
+            Output_* out_mean;
+            Output_* out_variance;
+            if (!do_parallel || thread == 0) {
+                out_mean = output.mean;
+                out_variance = output.variance;
+            } else {
+                const auto partial = all_partial->acquire(thread, dim);
+                tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim) * 2);
+                out_mean = partial[0];
+                out_variance = partial[1];
+            }
+
+            auto block_mean = tatami::create_container_of_Index_size<std::vector<Output_> >(dim);
+            auto block_rss = tatami::create_container_of_Index_size<std::vector<Output_> >(dim);
+            auto work = create_reducer();
+
+            for (std::size_t b = bs, bend = bs + bl; b < bend; ++b) {
+                const Index_ bsize = block_size[b];
+                if (bsize == 0) {
+                    continue;
+                }
+
+                std::fill(block_mean.begin(), block_mean.end(), 0);
+                std::fill(block_rss.begin(), block_rss.end(), 0);
+                reduce(tscope, work, block_starts[b], bsize, block_mean.data(), block_rss.data());
+
+                // Folding this block's statistics into the weighted averages.
+                const auto mweight = weights.mean[b];
+                AUVEH_NODEP
+                for (Index_ d = 0; d < dim; ++d) {
+                    out_mean[d] += mweight * block_mean[d];
+                }
+                const auto vweight = weights.variance[b];
+                if (vweight) {
+                    const Output_ vmult = vweight / static_cast<Output_>(bsize - 1);
+                    AUVEH_NODEP
+                    for (Index_ d = 0; d < dim; ++d) {
+                        out_variance[d] += vmult * block_rss[d];
+                    }
+                }
+            }
+        }, boundaries, opt.executor);
+
+        if (do_parallel) {
+            parallelize_merge([&](Index_ start, Index_ length) -> void {
+                const Index_ end = start + length;
+                for (int u = 1; u < nused; ++u) {
+                    const auto partial = all_partial->get(u);
+                    const auto cur_mean = partial[0];
+                    const auto cur_variance = partial[1];
+                    AUVEH_NODEP
+                    for (Index_ d = start; d < end; ++d) {
+                        output.mean[d] += cur_mean[d];
+                        output.variance[d] += cur_variance[d];
+                    }
+                }
+            }, dim, opt, "blocked_variance");
+        }
+    }
+
+    if (!weights.any_mean) {
+        std::fill_n(output.mean, dim, opt.mean_placeholder);
+    }
+    if (!weights.any_variance) {
+        std::fill_n(output.variance, dim, opt.variance_placeholder);
+    }
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Plan the computation of `blocked_variance()`, see `Plan` for details.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute variances for the rows.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param num_blocks Number of blocks.
+ * @param opt Options for `blocked_variance()`.
+ *
+ * @return Plan for `blocked_variance()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `BlockedVarianceOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Output_, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const std::size_t num_blocks, const BlockedVarianceOptions<Output_>& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = saturating_add(otherdim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0)), saturating_multiply(num_blocks, 2 * sizeof(Output_) + sizeof(Index_)));
+    model.running_buffer = dim * (sizeof(Value_) + 2 * sizeof(Output_) + (sparse ? 2 * sizeof(Index_) : 0));
+    model.running_partial_rest = dim * 2 * sizeof(Output_); // when splitting blocks across threads, the per-thread results replace the per-block buffers in 'running_buffer'.
+    return choose_plan(model, row, mat, opt);
+}
+
+/**
+ * Compute the mean and variance within each block for each element of a chosen dimension of a `tatami::Matrix`,
+ * and average them across blocks to obtain a single mean and variance per row/column.
+ * This is equivalent to calling `group_variance()` and computing a weighted average of the per-group statistics,
+ * but the per-block statistics are reduced on the fly so that no per-block output arrays are allocated.
+ *
+ * The running path (see `plan()`) processes one block at a time, so its memory usage is independent of the number of blocks.
+ * Each thread processes whole blocks if there are at least as many non-empty blocks as threads.
+ * Otherwise, the vectors of each block are split across all threads and the per-thread statistics are merged with Chan's method,
+ * so the results may differ slightly from those with a single thread due to round-off.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Block_ Integer type of the block assignments for each row/column.
+ * @tparam Output_ Floating-point type of the output value.
+ *
+ * @param row Whether to compute variances for the rows.
+ * If false, variances are computed for the columns instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] block Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the block assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique blocks.
+ * @param num_blocks Number of blocks, i.e., \f$N\f$.
+ * @param[out] output Buffers in which to store the results.
+ * Only blocks with at least one observation contribute to the average of the means,
+ * and only blocks with at least two observations contribute to the average of the variances.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Block_, typename Output_>
+void blocked_variance(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Block_* const block,
+    const std::size_t num_blocks,
+    BlockedVarianceBuffers<Output_>& output,
+    const BlockedVarianceOptions<Output_>& opt
+) {
+    auto block_size = sanisizer::create<std::vector<Index_> >(num_blocks);
+    const auto otherdim = (row ? mat.ncol() : mat.nrow());
+    for (Index_ o = 0; o < otherdim; ++o) {
+        block_size[block[o]] += 1;
+    }
+    const auto weights = compute_block_weights(num_blocks, block_size.data(), opt);
+
+    const auto cur_plan = plan(row, mat, num_blocks, opt);
+    trace_path(opt.tracer, "blocked_variance", cur_plan.running, mat.is_sparse(), false);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    if (!cur_plan.running) {
+        blocked_variance_direct(row, mat, block, num_blocks, block_size.data(), weights, output, planned_opt);
+    } else {
+        blocked_variance_running(row, mat, block, num_blocks, block_size.data(), weights, output, planned_opt);
+    }
+}
+
+/**
+ * @brief Results of `blocked_variance()`.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ */
+template<typename Output_>
+struct BlockedVarianceResult {
+    /**
+     * Vector of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise),
+     * containing the weighted average of the per-block means of each row/column.
+     */
+    std::vector<Output_> mean;
+
+    /**
+     * Vector of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise),
+     * containing the weighted average of the per-block variances of each row/column.
+     */
+    std::vector<Output_> variance;
+};
+
+/**
+ * Overload of `blocked_variance()` that allocates memory for the results.
+ *
+ * @tparam Output_ Floating-point type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Block_ Integer type of the block assignments for each row/column.
+ *
+ * @param row Whether to compute variances for the rows.
+ * If false, variances are computed for the columns instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] block Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the block assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique blocks.
+ * @param num_blocks Number of blocks, i.e., \f$N\f$.
+ * @param opt Further options.
+ *
+ * @return Averaged mean and variance for each row/column.
+ */
+template<typename Output_ = double, typename Value_, typename Index_, typename Block_>
+BlockedVarianceResult<Output_> blocked_variance(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Block_* const block,
+    const std::size_t num_blocks,
+    const BlockedVarianceOptions<Output_>& opt
+) {
+    BlockedVarianceResult<Output_> output;
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    tatami::resize_container_to_Index_size(output.mean, dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    tatami::resize_container_to_Index_size(output.variance, dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+
+    BlockedVarianceBuffers<Output_> buffers;
+    buffers.mean = output.mean.data();
+    buffers.variance = output.variance.data();
+    blocked_variance(row, mat, block, num_blocks, buffers, opt);
+    return output;
+}
+
+}
+
+#endif
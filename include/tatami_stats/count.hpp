@@ -11,6 +11,8 @@
 #include "auveh/auveh.hpp"
 
 #include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
 
 /**
  * @file count.hpp
@@ -27,8 +29,46 @@ struct CountOptions {
     /**
      * Number of threads to use when counting across a `tatami::Matrix`.
      * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     * On the direct path, if there are fewer rows/columns than threads, the other dimension is also split across threads and the partial counts are combined.
      */
     int num_threads = 1;
+
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
 };
 
 /**
@@ -36,7 +76,6 @@ struct CountOptions {
  */
 template<typename Value_, typename Index_, typename Output_, class Condition_>
 void count_direct(const bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* const output, Condition_ condition, const CountOptions& opt) {
-    const Index_ dim = (row ? mat.nrow() : mat.ncol());
     const Index_ otherdim = (row ? mat.ncol() : mat.nrow());
 
     if (mat.sparse()) {
@@ -44,13 +83,14 @@ void count_direct(const bool row, const tatami::Matrix<Value_, Index_>& mat, Out
         topt.sparse_ordered_index = false;
         const bool count_zero = condition(0);
 
-        tatami::parallelize([&](int, Index_ start, Index_ len) -> void {
-            auto ext = tatami::consecutive_extractor<true>(mat, row, start, len, topt);
+        parallelize_vectors([&](int thread, Index_ start, Index_ len) -> void {
+            TraceScope tscope(opt.tracer, "count", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, start, len, opt.prefetch, opt.executor, topt);
             auto xbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
             auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(otherdim);
 
             for (Index_ x = 0; x < len; ++x) {
-                auto range = ext->fetch(xbuffer.data(), ibuffer.data());
+                auto range = tscope.fetch([&]() { return ext->fetch(xbuffer.data(), ibuffer.data()); });
                 Output_ target = 0;
                 for (Index_ j = 0; j < range.number; ++j) {
                     target += condition(range.value[j]);
@@ -60,34 +100,34 @@ void count_direct(const bool row, const tatami::Matrix<Value_, Index_>& mat, Out
                 }
                 output[x + start] = target;
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
 
     } else {
-        tatami::parallelize([&](int, Index_ start, Index_ len) -> void {
+        parallelize_vectors([&](int thread, Index_ start, Index_ len) -> void {
+            TraceScope tscope(opt.tracer, "count", "compute", thread);
             auto xbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            auto ext = tatami::consecutive_extractor<false>(mat, row, start, len);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, start, len, opt.prefetch, opt.executor);
 
             for (Index_ x = 0; x < len; ++x) {
-                auto ptr = ext->fetch(xbuffer.data());
+                auto ptr = tscope.fetch([&]() { return ext->fetch(xbuffer.data()); });
                 Output_ target = 0;
                 for (Index_ j = 0; j < otherdim; ++j) {
                     target += condition(ptr[j]);
                 }
                 output[x + start] = target;
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
     }
 }
 
 template<typename Value_, typename Index_, typename Output_, class Condition_>
 void count_running(const bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* const output, Condition_ condition, const CountOptions& opt) {
     const Index_ dim = (row ? mat.nrow() : mat.ncol());
-    const Index_ otherdim = (row ? mat.ncol() : mat.nrow());
 
     const bool do_parallel = opt.num_threads > 1;
-    std::optional<std::vector<std::optional<std::vector<Output_> > > > all_partial_count;
+    std::optional<PartialBuffers<Output_> > all_partial_count;
     if (do_parallel) {
-        all_partial_count.emplace(sanisizer::cast<I<decltype(all_partial_count->size())> >(opt.num_threads - 1));
+        all_partial_count.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL, opt.num_threads, opt.allocator);
     }
 
     // Checking if we should count zeros in the sparse case.
@@ -96,9 +136,9 @@ void count_running(const bool row, const tatami::Matrix<Value_, Index_>& mat, Ou
 
     std::fill_n(output, dim, 0);
 
-    const int num_used = tatami::parallelize([&](int thread, Index_ start, Index_ len) -> void {
+    const int num_used = parallelize_vectors([&](int thread, Index_ start, Index_ len) -> void {
+        TraceScope tscope(opt.tracer, "count", "compute", thread);
         Output_* out_ptr; 
-        std::optional<std::vector<Output_> > cur_count;
         if (!do_parallel) {
             out_ptr = output;
         } else {
@@ -107,21 +147,21 @@ void count_running(const bool row, const tatami::Matrix<Value_, Index_>& mat, Ou
             if (thread == 0) {
                 out_ptr = output;
             } else {
-                cur_count.emplace(tatami::cast_Index_to_container_size<std::vector<Output_> >(dim));
-                out_ptr = cur_count->data();
+                out_ptr = all_partial_count->acquire(thread, dim)[0];
+                tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim));
             }
         }
 
         if (is_sparse) {
             tatami::Options topt;
             topt.sparse_ordered_index = false;
-            auto ext = tatami::consecutive_extractor<true>(mat, !row, start, len, topt);
+            auto ext = prefetch_consecutive_extractor<true>(mat, !row, start, len, opt.prefetch, opt.executor, topt);
             auto xbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
             auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
             auto nonzeros = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
 
             for (Index_ x = 0; x < len; ++x) {
-                auto range = ext->fetch(xbuffer.data(), ibuffer.data());
+                auto range = tscope.fetch([&]() { return ext->fetch(xbuffer.data(), ibuffer.data()); });
                 AUVEH_NODEP
                 for (Index_ j = 0; j < range.number; ++j) {
                     auto idx = range.index[j];
@@ -139,30 +179,51 @@ void count_running(const bool row, const tatami::Matrix<Value_, Index_>& mat, Ou
 
         } else {
             auto xbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
-            auto ext = tatami::consecutive_extractor<false>(mat, !row, start, len);
+            auto ext = prefetch_consecutive_extractor<false>(mat, !row, start, len, opt.prefetch, opt.executor);
 
             for (Index_ x = 0; x < len; ++x) {
-                auto ptr = ext->fetch(xbuffer.data());
+                auto ptr = tscope.fetch([&]() { return ext->fetch(xbuffer.data()); });
                 AUVEH_NODEP
                 for (Index_ d = 0; d < dim; ++d) {
                     out_ptr[d] += condition(ptr[d]);
                 }
             }
         }
-
-        if (thread) {
-            (*all_partial_count)[thread - 1] = std::move(cur_count);
-        }
-    }, otherdim, opt.num_threads);
+    }, mat, !row, opt);
 
     if (do_parallel) {
-        // Skip the first thread as we already put its counts in 'output'.
-        for (int u = 1; u < num_used; ++u) {
-            const auto& curout = *((*all_partial_count)[u - 1]);
-            AUVEH_NODEP
-            for (Index_ d = 0; d < dim; ++d) {
-                output[d] += curout[d];
+        parallelize_merge([&](Index_ start, Index_ length) -> void {
+            const Index_ end = start + length;
+            // Skip the first thread as we already put its counts in 'output'.
+            for (int u = 1; u < num_used; ++u) {
+                const auto curout = all_partial_count->get(u)[0];
+                AUVEH_NODEP
+                for (Index_ d = start; d < end; ++d) {
+                    output[d] += curout[d];
+                }
             }
+        }, dim, opt, "count");
+    }
+}
+
+// Splitting the other dimension across threads when 'dim' is too small to occupy them, see split_boundaries().
+template<typename Value_, typename Index_, typename Output_, class Condition_>
+void count_split(const bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* const output, const Condition_& condition, const std::vector<Index_>& boundaries, const CountOptions& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t num_blocks = boundaries.size() - 1;
+    auto partials = sanisizer::create<std::vector<Output_> >(sanisizer::product<typename std::vector<Output_>::size_type>(num_blocks, dim));
+
+    const auto block_opt = split_options(opt);
+    parallelize_split([&](int b, const tatami::Matrix<Value_, Index_>& block) -> void {
+        count_direct(row, block, partials.data() + static_cast<std::size_t>(b) * dim, condition, block_opt);
+    }, mat, row, boundaries, opt.executor);
+
+    std::copy_n(partials.begin(), dim, output);
+    for (std::size_t b = 1; b < num_blocks; ++b) {
+        const auto current = partials.data() + b * dim;
+        AUVEH_NODEP
+        for (std::size_t d = 0; d < dim; ++d) {
+            output[d] += current[d];
         }
     }
 }
@@ -170,6 +231,35 @@ void count_running(const bool row, const tatami::Matrix<Value_, Index_>& mat, Ou
  * @endcond
  */
 
+/**
+ * Plan the computation of `count()`, see `Plan` for details.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to obtain a count for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param opt Options for `count()`.
+ *
+ * @return Plan for `count()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `CountOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Output_, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const CountOptions& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = otherdim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0));
+    model.running_buffer = dim * (sizeof(Value_) + (sparse ? 2 * sizeof(Index_) : 0));
+    model.running_partial_rest = dim * sizeof(Output_);
+    model.direct_split_partial = dim * sizeof(Output_);
+    return choose_plan(model, row, mat, opt);
+}
+
 /**
  * Count the number of values that satisfy the `condition` in each element of a chosen dimension.
  *
@@ -191,10 +281,19 @@ void count_running(const bool row, const tatami::Matrix<Value_, Index_>& mat, Ou
  */
 template<typename Value_, typename Index_, typename Output_, class Condition_>
 void count(const bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* const output, Condition_ condition, const CountOptions& opt) {
-    if (mat.prefer_rows() == row) {
-        count_direct(row, mat, output, std::move(condition), opt);
+    const auto cur_plan = plan<Output_>(row, mat, opt);
+    trace_path(opt.tracer, "count", cur_plan.running, mat.is_sparse(), false);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    if (!cur_plan.running) {
+        const auto splits = split_boundaries(row ? mat.nrow() : mat.ncol(), row ? mat.ncol() : mat.nrow(), planned_opt.num_threads);
+        if (splits.empty()) {
+            count_direct(row, mat, output, std::move(condition), planned_opt);
+        } else {
+            count_split(row, mat, output, condition, splits, planned_opt);
+        }
     } else {
-        count_running(row, mat, output, std::move(condition), opt);
+        count_running(row, mat, output, std::move(condition), planned_opt);
     }
 }
 
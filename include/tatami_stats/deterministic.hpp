@@ -0,0 +1,280 @@
+#ifndef TATAMI_STATS_DETERMINISTIC_HPP
+#define TATAMI_STATS_DETERMINISTIC_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+#include "tatami/tatami.hpp"
+#include "sanisizer/sanisizer.hpp"
+
+#include "utils.hpp"
+#include "allocator.hpp"
+#include "partition.hpp"
+#include "plan.hpp"
+
+/**
+ * @file deterministic.hpp
+ *
+ * @brief Thread-count-independent reductions for the running kernels.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @cond
+ */
+// In the deterministic mode, the vectors along the iteration dimension are split into fixed blocks ('leaves') that do not depend on the number of threads.
+// Each leaf is reduced into its own partial result, and the partial results are merged along a fixed binary tree over the leaves.
+// Specifically, the node at level 'k' covers leaves '[i * 2^k, (i + 1) * 2^k)', and is formed by merging its right child into its left child.
+// Leftover nodes for a number of leaves that isn't a power of two are merged from the right.
+// Threads process contiguous runs of leaves and merge within their runs wherever both children are available,
+// so the results are bitwise identical for any number of threads; only the number of partial results that need to be stored changes.
+
+// Each leaf should involve enough passes over the output arrays to amortize the cost of zeroing and merging its partial result,
+// but there should be enough leaves to keep all threads busy.
+// The partial result for each leaf has 'num_arrays' arrays of length 'dim' (e.g., two per group for group_rss()), while each dense vector only involves 'dim' elements,
+// so the number of vectors per leaf is scaled by 'num_arrays' to keep the cost of each leaf proportional to the size of its partial result.
+constexpr std::size_t DETERMINISTIC_PASSES_PER_LEAF = 64;
+constexpr std::size_t DETERMINISTIC_MIN_LEAVES = 64;
+
+template<typename Value_, typename Index_, class Options_>
+std::vector<Index_> deterministic_leaves(const tatami::Matrix<Value_, Index_>& mat, const bool row, const Index_ dim, const std::size_t num_arrays, const Options_& opt) {
+    const Index_ num = (row ? mat.nrow() : mat.ncol());
+    std::vector<Index_> boundaries(1);
+    if (num == 0) {
+        return boundaries;
+    }
+    const std::size_t passes = saturating_multiply(DETERMINISTIC_PASSES_PER_LEAF, std::max(num_arrays, static_cast<std::size_t>(1)));
+
+    if (!mat.is_sparse()) {
+        std::size_t leaf_size = std::min(passes, static_cast<std::size_t>(num) / DETERMINISTIC_MIN_LEAVES);
+        leaf_size = std::max(leaf_size, static_cast<std::size_t>(1));
+        return fixed_size_boundaries(num, static_cast<Index_>(leaf_size)); // cast is safe as leaf_size <= num.
+    }
+
+    // For sparse matrices, we define leaves by the number of structural non-zeros, plus one for the overhead of each vector.
+    // This ensures that the cost of each leaf is comparable to the cost of zeroing and merging its partial result.
+    const auto nnz = count_structural_nonzeros(row, mat, opt.num_threads, opt.executor);
+    std::size_t total = 0;
+    for (const auto n : nnz) {
+        total = saturating_add(total, static_cast<std::size_t>(n) + 1);
+    }
+    std::size_t target = std::min(saturating_multiply(passes, dim), total / DETERMINISTIC_MIN_LEAVES);
+    target = std::max(target, static_cast<std::size_t>(1));
+
+    std::size_t current = 0;
+    for (Index_ v = 0; v < num; ++v) {
+        current += static_cast<std::size_t>(nnz[v]) + 1; // can't overflow as 'current' is reset before exceeding 'target + nnz[v] + 1'.
+        if (current >= target) {
+            boundaries.push_back(v + 1);
+            current = 0;
+        }
+    }
+    if (boundaries.back() != num) {
+        boundaries.push_back(num);
+    }
+    return boundaries;
+}
+
+// Merging the means and RSS of two disjoint sets of observations with Chan's method.
+// The left set is updated in place to contain the statistics for the union.
+template<typename Output_>
+void deterministic_merge_rss(Output_& left_mean, Output_& left_rss, const Output_ left_count, const Output_ right_mean, const Output_ right_rss, const Output_ right_count) {
+    if (right_count == 0) {
+        return;
+    }
+    if (left_count == 0) {
+        left_mean = right_mean;
+        left_rss = right_rss;
+        return;
+    }
+    const Output_ total = left_count + right_count;
+    const Output_ delta = right_mean - left_mean;
+    left_mean += delta * (right_count / total);
+    left_rss += right_rss + delta * delta * (left_count * right_count / total);
+}
+
+template<typename Type_, typename Index_>
+struct DeterministicNode {
+    std::size_t leaf = 0;
+    std::size_t level = 0;
+    std::vector<Type_*> arrays;
+    std::vector<Index_> counts;
+    AllocatedArray<Type_> store;
+};
+
+// Compute a deterministic reduction over all leaves.
+//
+// - 'create_worker(thread, start, length)' is called once per thread for its range of vectors.
+//   It should return a functor that accepts '(tscope, number, arrays, counts)', which will be called for each consecutive leaf in that range.
+//   This should reduce the next 'number' vectors into 'arrays' (a pointer to 'num_arrays' arrays of length 'dim') and 'counts' (an array of length 'num_counts'),
+//   both of which are zero-initialized.
+// - 'merge(left_arrays, left_counts, right_arrays, right_counts, start, end)' should merge the right partial result into the left for array elements in '[start, end)'.
+//   The counts are automatically summed after the merge.
+//
+// On return, 'output' and 'output_counts' contain the reduction over all leaves.
+// The partial results are always contiguous, but the element 'd' of each output array is stored at 'output[a][d * step]', e.g., for interleaved layouts.
+template<typename Type_, typename Index_, class Options_, class CreateWorker_, class Merge_>
+void deterministic_running(
+    const std::vector<Index_>& leaves,
+    const std::size_t num_arrays,
+    const Index_ dim,
+    const std::size_t num_counts,
+    CreateWorker_ create_worker,
+    Merge_ merge,
+    Type_* const* const output,
+    Index_* const output_counts,
+    const Options_& opt,
+    const char* const kernel,
+    const std::size_t step = 1
+) {
+    typedef DeterministicNode<Type_, Index_> Node;
+    const std::size_t num_leaves = leaves.size() - 1;
+    const int num_threads = std::max(opt.num_threads, 1);
+    auto thread_nodes = sanisizer::create<std::vector<std::vector<Node> > >(num_threads);
+
+    // Padding each array to a multiple of 64 bytes, as in PartialBuffers.
+    std::size_t stride = dim;
+    constexpr std::size_t line = 64;
+    if (num_arrays > 1 && line % sizeof(Type_) == 0) {
+        constexpr std::size_t per_line = line / sizeof(Type_);
+        stride = sanisizer::sum<std::size_t>(stride, per_line - 1) / per_line * per_line;
+    }
+    const auto total = sanisizer::product<std::size_t>(stride, num_arrays);
+
+    const auto sum_counts = [&](Node& left, const Node& right) -> void {
+        for (std::size_t c = 0; c < num_counts; ++c) {
+            left.counts[c] += right.counts[c];
+        }
+    };
+
+    const auto nused = parallelize_by_boundaries([&](int thread, std::size_t leaf_start, std::size_t leaf_length) -> void {
+        TraceScope tscope(opt.tracer, kernel, "compute", thread);
+        const Index_ vstart = leaves[leaf_start];
+        auto worker = create_worker(thread, vstart, static_cast<Index_>(leaves[leaf_start + leaf_length] - vstart));
+
+        auto& stack = thread_nodes[thread];
+        std::vector<Node> spare;
+        const auto acquire = [&]() -> Node {
+            Node node;
+            if (spare.empty()) {
+                node.store = AllocatedArray<Type_>(opt.allocator, total);
+                tscope.add_bytes(sizeof(Type_) * total);
+                node.arrays.resize(num_arrays);
+                for (std::size_t a = 0; a < num_arrays; ++a) {
+                    node.arrays[a] = node.store.data() + a * stride;
+                }
+                node.counts.resize(num_counts);
+            } else {
+                node = std::move(spare.back());
+                spare.pop_back();
+                std::fill(node.counts.begin(), node.counts.end(), 0);
+            }
+            std::fill_n(node.store.data(), total, 0);
+            return node;
+        };
+
+        for (std::size_t l = leaf_start, lend = leaf_start + leaf_length; l < lend; ++l) {
+            auto node = acquire();
+            node.leaf = l;
+            node.level = 0;
+            worker(tscope, static_cast<Index_>(leaves[l + 1] - leaves[l]), node.arrays.data(), node.counts.data());
+
+            // Merging with the previous node if it is the left sibling in the tree.
+            while (!stack.empty()) {
+                auto& top = stack.back();
+                if (top.level != node.level || top.leaf % (static_cast<std::size_t>(2) << top.level) != 0) {
+                    break;
+                }
+                merge(top.arrays.data(), top.counts.data(), node.arrays.data(), node.counts.data(), static_cast<Index_>(0), dim);
+                sum_counts(top, node);
+                ++(top.level);
+                spare.push_back(std::move(node));
+                node = std::move(top);
+                stack.pop_back();
+            }
+            stack.push_back(std::move(node));
+        }
+    }, equal_boundaries(num_leaves, num_threads), opt.executor);
+
+    // Replaying the same sibling rule on the remaining nodes of all threads, in order of their leaves.
+    // Each thread's nodes are already in order, and threads process increasing runs of leaves.
+    std::vector<Node*> all_nodes;
+    for (int t = 0; t < nused; ++t) {
+        for (auto& node : thread_nodes[t]) {
+            all_nodes.push_back(&node);
+        }
+    }
+
+    struct Operation {
+        Node* left;
+        Node* right;
+        std::vector<Index_> left_counts, right_counts;
+    };
+    std::vector<Operation> operations;
+    std::vector<Node*> stack;
+    const auto add_operation = [&](Node* left, Node* right) -> void {
+        operations.push_back(Operation{ left, right, left->counts, right->counts });
+        sum_counts(*left, *right);
+    };
+
+    for (auto node : all_nodes) {
+        while (!stack.empty()) {
+            auto top = stack.back();
+            if (top->level != node->level || top->leaf % (static_cast<std::size_t>(2) << top->level) != 0) {
+                break;
+            }
+            add_operation(top, node);
+            ++(top->level);
+            node = top;
+            stack.pop_back();
+        }
+        stack.push_back(node);
+    }
+    while (stack.size() > 1) {
+        auto right = stack.back();
+        stack.pop_back();
+        add_operation(stack.back(), right);
+    }
+
+    if (stack.empty()) {
+        for (std::size_t a = 0; a < num_arrays; ++a) {
+            fill_strided(output[a], dim, step, static_cast<Type_>(0));
+        }
+        if (output_counts) {
+            std::fill_n(output_counts, num_counts, 0);
+        }
+        return;
+    }
+
+    const auto root = stack.front();
+    if (output_counts) {
+        std::copy_n(root->counts.begin(), num_counts, output_counts);
+    }
+    parallelize_merge([&](Index_ start, Index_ length) -> void {
+        const Index_ end = start + length;
+        for (const auto& op : operations) {
+            merge(op.left->arrays.data(), op.left_counts.data(), op.right->arrays.data(), op.right_counts.data(), start, end);
+        }
+        for (std::size_t a = 0; a < num_arrays; ++a) {
+            const auto source = root->arrays[a];
+            const auto destination = output[a];
+            if (step == 1) {
+                std::copy(source + start, source + end, destination + start);
+            } else {
+                for (Index_ d = start; d < end; ++d) {
+                    destination[static_cast<std::size_t>(d) * step] = source[d];
+                }
+            }
+        }
+    }, dim, opt, kernel);
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
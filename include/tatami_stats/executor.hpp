@@ -0,0 +1,258 @@
+#ifndef TATAMI_STATS_EXECUTOR_HPP
+#define TATAMI_STATS_EXECUTOR_HPP
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <exception>
+
+/**
+ * @file executor.hpp
+ *
+ * @brief Run parallel work on a user-controlled pool of threads.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @brief Interface for executing parallel work.
+ *
+ * By default, **tatami_stats** functions use `tatami::parallelize()` to run their workers, which typically creates new threads on each call.
+ * Applications that already own a thread pool can instead supply an `Executor` via the `executor` field of each options structure,
+ * to avoid oversubscribing cores and paying the thread creation cost for every call.
+ */
+class Executor {
+public:
+    /**
+     * @cond
+     */
+    Executor() = default;
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+    virtual ~Executor() = default;
+    /**
+     * @endcond
+     */
+
+    /**
+     * Execute a function for each worker, blocking until all workers are finished.
+     * If any invocation of `fun` throws an exception, the first such exception is rethrown in the calling thread once all workers are finished.
+     *
+     * @param num_workers Number of workers.
+     * @param fun Function to execute for each worker.
+     * This accepts the worker index in \f$[0, W)\f$ where \f$W\f$ is `num_workers`, and may be called concurrently from different threads.
+     * Each worker index is passed to `fun` exactly once.
+     */
+    virtual void run(int num_workers, const std::function<void(int)>& fun) = 0;
+
+    /**
+     * Submit a task for asynchronous execution, e.g., for the I/O tasks of `PrefetchExtractor`.
+     * The task may be executed at any time, including after `submit()` returns or (for executors with no spare threads) within `submit()` itself.
+     * The task should not throw.
+     *
+     * @param task Task to execute.
+     * @return Whether the task was accepted.
+     * If false, the caller is responsible for doing the work itself.
+     * The default implementation always returns false.
+     */
+    virtual bool submit(std::function<void()> task) {
+        (void)task;
+        return false;
+    }
+};
+
+/**
+ * @cond
+ */
+// Workers are claimed dynamically by the calling thread and by all submitted tasks.
+// As the calling thread also claims workers, progress is guaranteed even if the submitted tasks are never started,
+// e.g., because the pool is saturated or because run() was called from one of the pool's own threads.
+template<class Submit_>
+void run_with_submit(const int num_workers, const std::function<void(int)>& fun, Submit_ submit) {
+    if (num_workers <= 0) {
+        return;
+    }
+
+    struct State {
+        std::mutex lock;
+        std::condition_variable cv;
+        int next = 0;
+        int finished = 0;
+        std::exception_ptr error;
+        const std::function<void(int)>* fun;
+    };
+
+    // Shared ownership so that tasks starting after run_with_submit() returns do not touch freed memory.
+    // Such tasks will not be able to claim a worker, so they never dereference the (now dangling) 'fun'.
+    auto state = std::make_shared<State>();
+    state->fun = &fun;
+
+    auto work = [num_workers](const std::shared_ptr<State>& st) -> void {
+        while (true) {
+            int worker;
+            {
+                std::lock_guard<std::mutex> guard(st->lock);
+                if (st->next >= num_workers) {
+                    return;
+                }
+                worker = st->next;
+                ++(st->next);
+            }
+
+            std::exception_ptr err;
+            try {
+                (*(st->fun))(worker);
+            } catch (...) {
+                err = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> guard(st->lock);
+            if (err && !st->error) {
+                st->error = err;
+            }
+            ++(st->finished);
+            st->cv.notify_all();
+        }
+    };
+
+    for (int w = 1; w < num_workers; ++w) {
+        submit([state, work]() -> void { work(state); });
+    }
+    work(state);
+
+    std::unique_lock<std::mutex> lck(state->lock);
+    state->cv.wait(lck, [&]() -> bool { return state->finished == num_workers; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Adapter for an application-provided thread pool.
+ *
+ * This wraps a submission function that enqueues a task in the application's thread pool.
+ * The calling thread also participates in the work, so `run()` will not deadlock if the pool is saturated or if it is called from one of the pool's own threads.
+ */
+class CallbackExecutor final : public Executor {
+public:
+    /**
+     * Type of the submission function.
+     * This should accept a task and arrange for it to be executed by the thread pool at some point in the future.
+     * Tasks may be executed in any order and may start after `run()` has returned, in which case they return immediately.
+     */
+    typedef std::function<void(std::function<void()>)> Submit;
+
+    /**
+     * @param submit Submission function for the application's thread pool.
+     */
+    CallbackExecutor(Submit submit) : my_submit(std::move(submit)) {}
+
+    /**
+     * @cond
+     */
+    void run(const int num_workers, const std::function<void(int)>& fun) override {
+        run_with_submit(num_workers, fun, my_submit);
+    }
+
+    bool submit(std::function<void()> task) override {
+        my_submit(std::move(task));
+        return true;
+    }
+    /**
+     * @endcond
+     */
+
+private:
+    Submit my_submit;
+};
+
+/**
+ * @brief Persistent pool of threads.
+ *
+ * The threads are created once on construction and reused across all calls to `run()`, until the pool is destroyed.
+ * This avoids the cost of creating new threads in each **tatami_stats** function call.
+ * The same pool can be safely used from multiple threads at once.
+ */
+class ThreadPoolExecutor final : public Executor {
+public:
+    /**
+     * @param num_threads Number of threads in the pool.
+     * As the calling thread also participates in `run()`, this is typically one less than the desired number of concurrent workers.
+     */
+    ThreadPoolExecutor(const int num_threads) {
+        for (int t = 0; t < num_threads; ++t) {
+            my_threads.emplace_back([this]() -> void {
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lck(my_lock);
+                        my_cv.wait(lck, [&]() -> bool { return my_shutdown || !my_tasks.empty(); });
+                        if (my_tasks.empty()) { // i.e., we're shutting down and there's nothing left to do.
+                            return;
+                        }
+                        task = std::move(my_tasks.front());
+                        my_tasks.pop_front();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    /**
+     * @cond
+     */
+    ~ThreadPoolExecutor() {
+        {
+            std::lock_guard<std::mutex> guard(my_lock);
+            my_shutdown = true;
+        }
+        my_cv.notify_all();
+        for (auto& t : my_threads) {
+            t.join();
+        }
+    }
+
+    void run(const int num_workers, const std::function<void(int)>& fun) override {
+        run_with_submit(num_workers, fun, [&](std::function<void()> task) -> void {
+            submit(std::move(task));
+        });
+    }
+
+    bool submit(std::function<void()> task) override {
+        {
+            std::lock_guard<std::mutex> guard(my_lock);
+            my_tasks.push_back(std::move(task));
+        }
+        my_cv.notify_one();
+        return true;
+    }
+    /**
+     * @endcond
+     */
+
+    /**
+     * @return Number of threads in the pool.
+     */
+    int num_threads() const {
+        return static_cast<int>(my_threads.size());
+    }
+
+private:
+    std::vector<std::thread> my_threads;
+    std::deque<std::function<void()> > my_tasks;
+    std::mutex my_lock;
+    std::condition_variable my_cv;
+    bool my_shutdown = false;
+};
+
+}
+
+#endif
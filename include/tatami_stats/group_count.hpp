@@ -0,0 +1,515 @@
+#ifndef TATAMI_STATS_GROUP_COUNT_HPP
+#define TATAMI_STATS_GROUP_COUNT_HPP
+
+#include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+#include "tatami/tatami.hpp"
+#include "sanisizer/sanisizer.hpp"
+#include "auveh/auveh.hpp"
+
+/**
+ * @file group_count.hpp
+ *
+ * @brief Compute group-wise counts from a `tatami::Matrix`.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @brief Options for `group_count()`.
+ */
+struct GroupCountOptions {
+    /**
+     * Number of threads to use when counting across a `tatami::Matrix`.
+     * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     */
+    int num_threads = 1;
+
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+};
+
+/**
+ * @cond
+ */
+// If 'index_only_ = true', every structural non-zero is counted and the values are never extracted from sparse matrices.
+// Otherwise, 'condition' is applied to each value; if 'condition(0)' is true, the implicit zeros are counted via the group sizes,
+// by subtracting the structural non-zeros that fail the condition.
+template<bool index_only_, typename Value_, typename Index_, typename Group_, typename Output_, class Condition_>
+void group_count_direct(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    std::vector<Output_*>& output,
+    Condition_ condition,
+    const GroupCountOptions& opt
+) {
+    const Index_ otherdim = (row ? mat.ncol() : mat.nrow());
+
+    if (mat.sparse()) {
+        tatami::Options topt;
+        topt.sparse_ordered_index = false;
+        topt.sparse_extract_value = !index_only_;
+        const bool count_zero = !index_only_ && condition(0);
+
+        std::vector<Output_> group_sizes;
+        if (count_zero) {
+            group_sizes = sanisizer::create<std::vector<Output_> >(num_groups);
+            for (Index_ j = 0; j < otherdim; ++j) {
+                ++(group_sizes[group[j]]);
+            }
+        }
+
+        parallelize_vectors([&](int thread, Index_ start, Index_ len) -> void {
+            TraceScope tscope(opt.tracer, "group_count", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, start, len, opt.prefetch, opt.executor, topt);
+            std::vector<Value_> xbuffer;
+            if constexpr(!index_only_) {
+                tatami::resize_container_to_Index_size(xbuffer, otherdim);
+            }
+            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(otherdim);
+            auto tmp = sanisizer::create<std::vector<Output_> >(num_groups);
+
+            for (Index_ x = 0; x < len; ++x) {
+                auto range = tscope.fetch([&]() { return ext->fetch(xbuffer.data(), ibuffer.data()); });
+
+                if constexpr(index_only_) {
+                    std::fill(tmp.begin(), tmp.end(), static_cast<Output_>(0));
+                    for (Index_ j = 0; j < range.number; ++j) {
+                        ++(tmp[group[range.index[j]]]);
+                    }
+                } else {
+                    if (count_zero) {
+                        std::copy(group_sizes.begin(), group_sizes.end(), tmp.begin());
+                        for (Index_ j = 0; j < range.number; ++j) {
+                            tmp[group[range.index[j]]] -= !condition(range.value[j]);
+                        }
+                    } else {
+                        std::fill(tmp.begin(), tmp.end(), static_cast<Output_>(0));
+                        for (Index_ j = 0; j < range.number; ++j) {
+                            tmp[group[range.index[j]]] += condition(range.value[j]);
+                        }
+                    }
+                }
+
+                for (I<decltype(num_groups)> g = 0; g < num_groups; ++g) {
+                    output[g][start + x] = tmp[g];
+                }
+            }
+        }, mat, row, opt);
+
+    } else {
+        parallelize_vectors([&](int thread, Index_ start, Index_ len) -> void {
+            TraceScope tscope(opt.tracer, "group_count", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, start, len, opt.prefetch, opt.executor);
+            auto xbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
+            auto tmp = sanisizer::create<std::vector<Output_> >(num_groups);
+
+            for (Index_ x = 0; x < len; ++x) {
+                auto ptr = tscope.fetch([&]() { return ext->fetch(xbuffer.data()); });
+                std::fill(tmp.begin(), tmp.end(), static_cast<Output_>(0));
+                for (Index_ j = 0; j < otherdim; ++j) {
+                    tmp[group[j]] += condition(ptr[j]);
+                }
+                for (I<decltype(num_groups)> g = 0; g < num_groups; ++g) {
+                    output[g][start + x] = tmp[g];
+                }
+            }
+        }, mat, row, opt);
+    }
+}
+
+template<bool index_only_, typename Value_, typename Index_, typename Group_, typename Output_, class Condition_>
+void group_count_running(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    std::vector<Output_*>& output,
+    Condition_ condition,
+    const GroupCountOptions& opt
+) {
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    const bool is_sparse = mat.is_sparse();
+    const bool count_zero = is_sparse && !index_only_ && condition(0);
+
+    const auto do_parallel = opt.num_threads > 1;
+    std::optional<PartialBuffers<Output_> > all_partial_counts;
+    if (do_parallel) {
+        all_partial_counts.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL, opt.num_threads, opt.allocator, num_groups);
+    }
+
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        std::fill_n(output[g], dim, 0);
+    }
+
+    const auto nused = parallelize_vectors([&](int thread, Index_ start, Index_ len) -> void {
+        TraceScope tscope(opt.tracer, "group_count", "compute", thread);
+        Output_** count_ptrs;
+        if (!do_parallel) {
+            count_ptrs = output.data();
+        } else {
+            if (thread == 0) {
+                count_ptrs = output.data();
+            } else {
+                count_ptrs = all_partial_counts->acquire(thread, dim);
+                tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim) * num_groups);
+            }
+        }
+
+        if (is_sparse) {
+            tatami::Options topt;
+            topt.sparse_ordered_index = false;
+            topt.sparse_extract_value = !index_only_;
+            auto ext = prefetch_consecutive_extractor<true>(mat, !row, start, len, opt.prefetch, opt.executor, topt);
+            std::vector<Value_> xbuffer;
+            if constexpr(!index_only_) {
+                tatami::resize_container_to_Index_size(xbuffer, dim);
+            }
+            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
+
+            // When zeros are counted, we tally the number of vectors in each group and subtract the structural non-zeros that fail the condition.
+            // This avoids a per-group array of non-zero counts, which would double the memory usage.
+            std::vector<Output_> group_sizes;
+            if (count_zero) {
+                group_sizes = sanisizer::create<std::vector<Output_> >(num_groups);
+            }
+
+            for (Index_ x = 0; x < len; ++x) {
+                auto range = tscope.fetch([&]() { return ext->fetch(xbuffer.data(), ibuffer.data()); });
+                const auto cur_group = group[start + x];
+                const auto count_ptr = count_ptrs[cur_group];
+
+                if constexpr(index_only_) {
+                    AUVEH_NODEP
+                    for (Index_ i = 0; i < range.number; ++i) {
+                        ++(count_ptr[range.index[i]]);
+                    }
+                } else {
+                    if (count_zero) {
+                        ++(group_sizes[cur_group]);
+                        AUVEH_NODEP
+                        for (Index_ i = 0; i < range.number; ++i) {
+                            count_ptr[range.index[i]] -= !condition(range.value[i]);
+                        }
+                    } else {
+                        AUVEH_NODEP
+                        for (Index_ i = 0; i < range.number; ++i) {
+                            count_ptr[range.index[i]] += condition(range.value[i]);
+                        }
+                    }
+                }
+            }
+
+            if (count_zero) {
+                for (std::size_t g = 0; g < num_groups; ++g) {
+                    const auto gsize = group_sizes[g];
+                    if (gsize) {
+                        const auto count_ptr = count_ptrs[g];
+                        AUVEH_NODEP
+                        for (Index_ d = 0; d < dim; ++d) {
+                            count_ptr[d] += gsize;
+                        }
+                    }
+                }
+            }
+
+        } else {
+            auto ext = prefetch_consecutive_extractor<false>(mat, !row, start, len, opt.prefetch, opt.executor);
+            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
+
+            for (Index_ x = 0; x < len; ++x) {
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer.data()); });
+                const auto count_ptr = count_ptrs[group[start + x]];
+                AUVEH_NODEP
+                for (Index_ d = 0; d < dim; ++d) {
+                    count_ptr[d] += condition(ptr[d]);
+                }
+            }
+        }
+    }, mat, !row, opt);
+
+    if (do_parallel) {
+        parallelize_merge([&](Index_ start, Index_ length) -> void {
+            const Index_ end = start + length;
+            for (std::size_t g = 0; g < num_groups; ++g) {
+                const auto cur_out = output[g];
+                for (int u = 1; u < nused; ++u) {
+                    const auto cur_count = all_partial_counts->get(u)[g];
+                    AUVEH_NODEP
+                    for (Index_ d = start; d < end; ++d) {
+                        cur_out[d] += cur_count[d];
+                    }
+                }
+            }
+        }, dim, opt, "group_count");
+    }
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Plan the computation of `group_count()` or `group_count_nonzero()`, see `Plan` for details.
+ *
+ * @tparam Output_ Numeric type of the output count.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute the group-wise counts for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param num_groups Number of groups.
+ * @param opt Options for `group_count()`.
+ *
+ * @return Plan for `group_count()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `GroupCountOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Output_, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const std::size_t num_groups, const GroupCountOptions& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = saturating_add(otherdim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0)), saturating_multiply(num_groups, sizeof(Output_)));
+    model.running_buffer = saturating_add(dim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0)), saturating_multiply(num_groups, sizeof(Output_)));
+    model.running_partial_rest = saturating_multiply(num_groups, dim * sizeof(Output_));
+    return choose_plan(model, row, mat, opt);
+}
+
+/**
+ * @cond
+ */
+template<bool index_only_, typename Value_, typename Index_, typename Group_, typename Output_, class Condition_>
+void group_count_internal(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    std::vector<Output_*>& output,
+    Condition_ condition,
+    const GroupCountOptions& opt
+) {
+    const auto cur_plan = plan<Output_>(row, mat, num_groups, opt);
+    trace_path(opt.tracer, "group_count", cur_plan.running, mat.is_sparse(), false);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    if (!cur_plan.running) {
+        group_count_direct<index_only_>(row, mat, group, num_groups, output, std::move(condition), planned_opt);
+    } else {
+        group_count_running<index_only_>(row, mat, group, num_groups, output, std::move(condition), planned_opt);
+    }
+}
+
+template<typename Output_, typename Index_>
+std::vector<std::vector<Output_> > allocate_group_count(const Index_ dim, const std::size_t num_groups, std::vector<Output_*>& ptrs) {
+    auto output = sanisizer::create<std::vector<std::vector<Output_> > >(num_groups);
+    ptrs.resize(num_groups);
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        tatami::resize_container_to_Index_size(output[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        ptrs[g] = output[g].data();
+    }
+    return output;
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Count the number of values that satisfy the `condition` in each group, for each element of a chosen dimension of a `tatami::Matrix`.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row.
+ * @tparam Output_ Numeric type of the output count.
+ * To avoid overflow, we recommend using a type that is large enough to hold the dimension extents of `mat`.
+ * @tparam Condition_ Function that accepts a single `Value_` and returns a `bool`.
+ *
+ * @param row Whether to compute group-wise counts within each row.
+ * If false, counts are computed within the column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param[out] output Vector of length equal to the number of groups.
+ * Each element is a pointer to an array of length equal to the number of rows (if `row = true`) or columns (otherwise).
+ * On output, each array will contain the row/column counts for the corresponding group.
+ * @param condition Function to indicate whether a value should be counted, as described for `count()`.
+ * For sparse matrices, this is only called on the structural non-zeros and once on zero to decide whether the implicit zeros should be counted.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_, class Condition_>
+void group_count(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    std::vector<Output_*>& output,
+    Condition_ condition,
+    const GroupCountOptions& opt
+) {
+    group_count_internal<false>(row, mat, group, num_groups, output, std::move(condition), opt);
+}
+
+/**
+ * Overload of `group_count()` that allocates memory for the output counts.
+ *
+ * @tparam Output_ Numeric type of the output count.
+ * To avoid overflow, we recommend using a type that is large enough to hold the dimension extents of `mat`.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row.
+ * @tparam Condition_ Function that accepts a single `Value_` and returns a `bool`.
+ *
+ * @param row Whether to compute group-wise counts within each row.
+ * If false, counts are computed within the column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param condition Function to indicate whether a value should be counted, as described for `count()`.
+ * @param opt Further options.
+ *
+ * @return Vector of length equal to the number of groups.
+ * Each element is a vector of length equal to the number of rows (if `row = true`) or columns (otherwise),
+ * containing the row/column counts for the corresponding group.
+ */
+template<typename Output_, typename Value_, typename Index_, typename Group_, class Condition_>
+std::vector<std::vector<Output_> > group_count(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    Condition_ condition,
+    const GroupCountOptions& opt
+) {
+    std::vector<Output_*> ptrs;
+    auto output = allocate_group_count<Output_>(row ? mat.nrow() : mat.ncol(), num_groups, ptrs);
+    group_count(row, mat, group, num_groups, ptrs, std::move(condition), opt);
+    return output;
+}
+
+/**
+ * Count the number of non-zero values in each group, for each element of a chosen dimension of a `tatami::Matrix`.
+ * For sparse matrices, only the indices of the structural non-zeros are extracted, which avoids the cost of extracting and testing the values.
+ * This assumes that all structural non-zeros are truly non-zero;
+ * if explicit zeros might be stored, users should call `group_count()` with a condition like `x != 0` instead.
+ * Note that NaNs are considered to be non-zero.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row.
+ * @tparam Output_ Numeric type of the output count.
+ * To avoid overflow, we recommend using a type that is large enough to hold the dimension extents of `mat`.
+ *
+ * @param row Whether to compute group-wise counts within each row.
+ * If false, counts are computed within the column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param[out] output Vector of length equal to the number of groups.
+ * Each element is a pointer to an array of length equal to the number of rows (if `row = true`) or columns (otherwise).
+ * On output, each array will contain the number of non-zero values in each row/column for the corresponding group.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_>
+void group_count_nonzero(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    std::vector<Output_*>& output,
+    const GroupCountOptions& opt
+) {
+    group_count_internal<true>(row, mat, group, num_groups, output, [](Value_ x) -> bool { return x != 0; }, opt);
+}
+
+/**
+ * Overload of `group_count_nonzero()` that allocates memory for the output counts.
+ *
+ * @tparam Output_ Numeric type of the output count.
+ * To avoid overflow, we recommend using a type that is large enough to hold the dimension extents of `mat`.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row.
+ *
+ * @param row Whether to compute group-wise counts within each row.
+ * If false, counts are computed within the column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param opt Further options.
+ *
+ * @return Vector of length equal to the number of groups.
+ * Each element is a vector of length equal to the number of rows (if `row = true`) or columns (otherwise),
+ * containing the number of non-zero values in each row/column for the corresponding group.
+ */
+template<typename Output_, typename Value_, typename Index_, typename Group_>
+std::vector<std::vector<Output_> > group_count_nonzero(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    const GroupCountOptions& opt
+) {
+    std::vector<Output_*> ptrs;
+    auto output = allocate_group_count<Output_>(row ? mat.nrow() : mat.ncol(), num_groups, ptrs);
+    group_count_nonzero(row, mat, group, num_groups, ptrs, opt);
+    return output;
+}
+
+}
+
+#endif
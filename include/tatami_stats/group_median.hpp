@@ -2,10 +2,13 @@
 #define TATAMI_STATS_GROUP_MEDIAN_HPP
 
 #include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
 #include "median.hpp"
 
 #include <vector>
 #include <algorithm>
+#include <cstddef>
 
 #include "tatami/tatami.hpp"
 #include "sanisizer/sanisizer.hpp"
@@ -33,6 +36,42 @@ struct GroupMedianOptions {
      * See `tatami::parallelize()` for more details on the parallelization mechanism.
      */
     int num_threads = 1;
+
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Whether to distribute work across threads by work stealing, see `WorkStealingQueue` for details.
+     * This is useful when the cost of computing each statistic is highly variable, e.g., for sparse matrices with a skewed distribution of non-zero elements.
+     * Only used if `num_threads > 1`, in which case `balance_nonzeros` is ignored.
+     */
+    bool work_stealing = false;
+
+    /**
+     * Number of rows/columns in each chunk when `work_stealing = true`.
+     * Smaller chunks improve load balancing at the cost of more scheduling overhead.
+     * If zero, this is automatically chosen to yield several chunks per thread.
+     */
+    std::size_t work_stealing_chunk_size = 0;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
 };
 
 /**
@@ -65,7 +104,7 @@ void group_median(
     std::vector<Output_*>& output,
     const GroupMedianOptions& opt
 ) {
-    const auto dim = (row ? mat.nrow() : mat.ncol());
+    trace_path(opt.tracer, "group_median", false, mat.sparse(), opt.skip_nan);
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
 
     auto group_sizes = sanisizer::create<std::vector<Index_> >(num_groups);
@@ -73,7 +112,8 @@ void group_median(
         group_sizes[group[i]] += 1;
     }
 
-    tatami::parallelize([&](int, Index_ start, Index_ len) -> void {
+    parallelize_chunks([&](int thread, WorkStealingQueue<Index_>& queue) -> void {
+        TraceScope tscope(opt.tracer, "group_median", "compute", thread);
         auto xbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
         auto workspace = sanisizer::create<std::vector<std::vector<Value_> > >(num_groups);
         for (I<decltype(num_groups)> g = 0; g < num_groups; ++g) {
@@ -83,38 +123,48 @@ void group_median(
         if (mat.sparse()) {
             tatami::Options topt;
             topt.sparse_ordered_index = false;
-            auto ext = tatami::consecutive_extractor<true>(mat, row, start, len, topt);
             auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(otherdim);
-
-            for (Index_ i = 0; i < len; ++i) {
-                auto range = ext->fetch(xbuffer.data(), ibuffer.data());
-                for (Index_ j = 0; j < range.number; ++j) {
-                    workspace[group[range.index[j]]].push_back(range.value[j]);
+            Index_ start, len;
+            while (queue.next(thread, start, len)) {
+                auto ext = prefetch_consecutive_extractor<true>(mat, row, start, len, opt.prefetch, opt.executor, topt);
+                for (Index_ i = 0; i < len; ++i) {
+                    auto range = tscope.fetch([&]() { return ext->fetch(xbuffer.data(), ibuffer.data()); });
+                    for (Index_ j = 0; j < range.number; ++j) {
+                        workspace[group[range.index[j]]].push_back(range.value[j]);
+                    }
+
+                    for (I<decltype(num_groups)> g = 0; g < num_groups; ++g) {
+                        auto& w = workspace[g];
+                        const Index_ num_nonzero = w.size();
+                        if (sparse_quantile_is_zero(w.data(), num_nonzero, group_sizes[g], 0.5, opt.skip_nan)) { // skip the selection if the median is among the zeros.
+                            output[g][i + start] = 0;
+                        } else {
+                            output[g][i + start] = median_direct<Output_, Value_, Index_>(w.data(), num_nonzero, group_sizes[g], opt.skip_nan);
+                        }
+                        w.clear();
+                    }
                 }
 
-                for (I<decltype(num_groups)> g = 0; g < num_groups; ++g) {
-                    auto& w = workspace[g];
-                    output[g][i + start] = median_direct<Output_, Value_, Index_>(w.data(), w.size(), group_sizes[g], opt.skip_nan);
-                    w.clear();
-                }
             }
-
         } else {
-            auto ext = tatami::consecutive_extractor<false>(mat, row, start, len);
-            for (Index_ i = 0; i < len; ++i) {
-                auto ptr = ext->fetch(xbuffer.data());
-                for (Index_ j = 0; j < otherdim; ++j) {
-                    workspace[group[j]].push_back(ptr[j]);
-                }
-
-                for (I<decltype(num_groups)> g = 0; g < num_groups; ++g) {
-                    auto& w = workspace[g];
-                    output[g][i + start] = median_direct<Output_, Value_, Index_>(w.data(), w.size(), opt.skip_nan);
-                    w.clear();
+            Index_ start, len;
+            while (queue.next(thread, start, len)) {
+                auto ext = prefetch_consecutive_extractor<false>(mat, row, start, len, opt.prefetch, opt.executor);
+                for (Index_ i = 0; i < len; ++i) {
+                    auto ptr = tscope.fetch([&]() { return ext->fetch(xbuffer.data()); });
+                    for (Index_ j = 0; j < otherdim; ++j) {
+                        workspace[group[j]].push_back(ptr[j]);
+                    }
+
+                    for (I<decltype(num_groups)> g = 0; g < num_groups; ++g) {
+                        auto& w = workspace[g];
+                        output[g][i + start] = median_direct<Output_, Value_, Index_>(w.data(), w.size(), opt.skip_nan);
+                        w.clear();
+                    }
                 }
             }
         }
-    }, dim, opt.num_threads);
+    }, mat, row, opt);
 }
 
 /**
@@ -0,0 +1,555 @@
+#ifndef TATAMI_STATS_GROUP_RANGE_HPP
+#define TATAMI_STATS_GROUP_RANGE_HPP
+
+#include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+#include "range.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <cassert>
+
+#include "tatami/tatami.hpp"
+#include "sanisizer/sanisizer.hpp"
+#include "auveh/auveh.hpp"
+
+/**
+ * @file group_range.hpp
+ *
+ * @brief Compute group-wise ranges from a `tatami::Matrix`.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @brief Options for `group_range()`.
+ * @tparam Output_ Numeric type of the output data.
+ */
+template<typename Output_ = double>
+struct GroupRangeOptions {
+    /**
+     * Number of threads to use when computing ranges across a `tatami::Matrix`.
+     * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     */
+    int num_threads = 1;
+
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+
+    /**
+     * Placeholder for the minimum value in `GroupRangeBuffers::minimum` or `GroupRangeResult::minimum`, for empty groups.
+     */
+    Output_ minimum_placeholder = default_minimum_placeholder<Output_>();
+
+    /**
+     * Placeholder for the maximum value in `GroupRangeBuffers::maximum` or `GroupRangeResult::maximum`, for empty groups.
+     */
+    Output_ maximum_placeholder = default_maximum_placeholder<Output_>();
+};
+
+/**
+ * @brief Result buffers for `group_range()`.
+ *
+ * @tparam Output_ Numeric type of the output data.
+ */
+template<typename Output_>
+struct GroupRangeBuffers {
+    /**
+     * Vector of length equal to the number of groups.
+     * Each element is a pointer to an array of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise).
+     * After `group_range()`, this is filled with the minimum value of each row/column for the corresponding group.
+     */
+    std::vector<Output_*> minimum;
+
+    /**
+     * Vector of length equal to the number of groups.
+     * Each element is a pointer to an array of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise).
+     * After `group_range()`, this is filled with the maximum value of each row/column for the corresponding group.
+     */
+    std::vector<Output_*> maximum;
+};
+
+/**
+ * @cond
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_>
+void group_range_direct(
+    const bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Index_* const group_size,
+    GroupRangeBuffers<Output_>& output,
+    const GroupRangeOptions<Output_>& opt
+) {
+    const auto otherdim = (row ? mat.ncol() : mat.nrow());
+
+    if (mat.sparse()) {
+        tatami::Options topt;
+        topt.sparse_ordered_index = false;
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "group_range", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor, topt);
+            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
+            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(otherdim);
+            auto cur_min = sanisizer::create<std::vector<Output_> >(num_groups);
+            auto cur_max = sanisizer::create<std::vector<Output_> >(num_groups);
+            auto cur_observed = sanisizer::create<std::vector<Index_> >(num_groups); // number of structural non-zeros in each group, to decide whether to initialize the min/max.
+
+            for (Index_ x = 0; x < l; ++x) {
+                auto range = tscope.fetch([&]() { return ext->fetch(vbuffer.data(), ibuffer.data()); });
+                std::fill(cur_observed.begin(), cur_observed.end(), 0);
+
+                for (Index_ i = 0; i < range.number; ++i) {
+                    const Output_ val = range.value[i];
+                    const auto g = group[range.index[i]];
+                    if (cur_observed[g] == 0) {
+                        cur_min[g] = val;
+                        cur_max[g] = val;
+                    } else {
+                        cur_min[g] = std::min(cur_min[g], val);
+                        cur_max[g] = std::max(cur_max[g], val);
+                    }
+                    ++cur_observed[g];
+                }
+
+                for (std::size_t g = 0; g < num_groups; ++g) {
+                    Output_ gmin, gmax;
+                    if (cur_observed[g] == 0) {
+                        if (group_size[g]) {
+                            gmin = 0;
+                            gmax = 0;
+                        } else {
+                            gmin = opt.minimum_placeholder;
+                            gmax = opt.maximum_placeholder;
+                        }
+                    } else {
+                        gmin = cur_min[g];
+                        gmax = cur_max[g];
+                        if (cur_observed[g] < group_size[g]) {
+                            gmin = std::min(gmin, static_cast<Output_>(0));
+                            gmax = std::max(gmax, static_cast<Output_>(0));
+                        }
+                    }
+                    output.minimum[g][s + x] = gmin;
+                    output.maximum[g][s + x] = gmax;
+                }
+            }
+        }, mat, row, opt);
+
+    } else {
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "group_range", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
+            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
+            auto cur_min = sanisizer::create<std::vector<Output_> >(num_groups);
+            auto cur_max = sanisizer::create<std::vector<Output_> >(num_groups);
+
+            for (Index_ x = 0; x < l; ++x) {
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer.data()); });
+
+                // The defaults are the identities for min/max, so every non-empty group will be overwritten by its values.
+                std::fill(cur_min.begin(), cur_min.end(), default_minimum_placeholder<Output_>());
+                std::fill(cur_max.begin(), cur_max.end(), default_maximum_placeholder<Output_>());
+
+                for (Index_ j = 0; j < otherdim; ++j) {
+                    const Output_ val = ptr[j];
+                    const auto g = group[j];
+                    cur_min[g] = std::min(cur_min[g], val);
+                    cur_max[g] = std::max(cur_max[g], val);
+                }
+
+                for (std::size_t g = 0; g < num_groups; ++g) {
+                    if (group_size[g]) {
+                        output.minimum[g][s + x] = cur_min[g];
+                        output.maximum[g][s + x] = cur_max[g];
+                    } else {
+                        output.minimum[g][s + x] = opt.minimum_placeholder;
+                        output.maximum[g][s + x] = opt.maximum_placeholder;
+                    }
+                }
+            }
+        }, mat, row, opt);
+    }
+}
+
+template<typename Value_, typename Index_, typename Group_, typename Output_>
+void group_range_running(
+    const bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Index_* const group_size,
+    GroupRangeBuffers<Output_>& output,
+    const GroupRangeOptions<Output_>& opt
+) {
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+
+    const bool do_parallel = opt.num_threads > 1;
+    std::optional<PartialBuffers<Output_> > all_partial_min, all_partial_max;
+    std::optional<std::vector<std::optional<std::vector<Index_> > > > all_partial_observed;
+    if (do_parallel) {
+        all_partial_min.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL, opt.num_threads, opt.allocator, num_groups);
+        all_partial_max.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL + 1, opt.num_threads, opt.allocator, num_groups);
+        all_partial_observed.emplace(sanisizer::cast<I<decltype(all_partial_observed->size())> >(opt.num_threads));
+    }
+
+    const bool is_sparse = mat.is_sparse();
+    const int nused = parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+        TraceScope tscope(opt.tracer, "group_range", "compute", thread);
+        Output_** min_ptrs;
+        Output_** max_ptrs;
+        if (!do_parallel || thread == 0) {
+            min_ptrs = output.minimum.data();
+            max_ptrs = output.maximum.data();
+        } else {
+            min_ptrs = all_partial_min->acquire(thread, dim);
+            tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim) * num_groups);
+            max_ptrs = all_partial_max->acquire(thread, dim);
+            tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim) * num_groups);
+        }
+
+        // Number of observed vectors from each group in this thread.
+        auto cur_observed = sanisizer::create<std::vector<Index_> >(num_groups);
+
+        if (is_sparse) {
+            tatami::Options topt;
+            topt.sparse_ordered_index = false;
+            auto ext = prefetch_consecutive_extractor<true>(mat, !row, s, l, opt.prefetch, opt.executor, topt);
+            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
+            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
+            auto nonzeros = sanisizer::create<std::vector<std::vector<Index_> > >(num_groups);
+            for (std::size_t g = 0; g < num_groups; ++g) {
+                tatami::resize_container_to_Index_size(nonzeros[g], dim);
+            }
+
+            for (Index_ x = 0; x < l; ++x) {
+                auto out = tscope.fetch([&]() { return ext->fetch(vbuffer.data(), ibuffer.data()); });
+                const auto grp = group[s + x];
+                const auto min_ptr = min_ptrs[grp];
+                const auto max_ptr = max_ptrs[grp];
+                auto& nnz = nonzeros[grp];
+
+                if (cur_observed[grp] == 0) {
+                    // We treat the first vector of each group as a dense vector, expanding it with all of the zeros.
+                    // So we pretend that every dimension element starts with one structural non-zero, as in range_running().
+                    std::fill_n(min_ptr, dim, 0);
+                    std::fill_n(max_ptr, dim, 0);
+                    std::fill_n(nnz.begin(), dim, 1);
+                    AUVEH_NODEP
+                    for (Index_ i = 0; i < out.number; ++i) {
+                        const Output_ val = out.value[i];
+                        const auto idx = out.index[i];
+                        min_ptr[idx] = val;
+                        max_ptr[idx] = val;
+                    }
+                } else {
+                    AUVEH_NODEP
+                    for (Index_ i = 0; i < out.number; ++i) {
+                        const Output_ val = out.value[i];
+                        const auto idx = out.index[i];
+                        auto& min_current = min_ptr[idx];
+                        min_current = std::min(min_current, val);
+                        auto& max_current = max_ptr[idx];
+                        max_current = std::max(max_current, val);
+                        ++nnz[idx];
+                    }
+                }
+                ++cur_observed[grp];
+            }
+
+            for (std::size_t g = 0; g < num_groups; ++g) {
+                const auto curtotal = cur_observed[g];
+                if (curtotal) {
+                    const auto min_ptr = min_ptrs[g];
+                    const auto max_ptr = max_ptrs[g];
+                    const auto& nnz = nonzeros[g];
+                    AUVEH_NODEP
+                    for (Index_ d = 0; d < dim; ++d) {
+                        if (curtotal > nnz[d]) {
+                            auto& min_current = min_ptr[d];
+                            min_current = std::min(min_current, static_cast<Output_>(0));
+                            auto& max_current = max_ptr[d];
+                            max_current = std::max(max_current, static_cast<Output_>(0));
+                        }
+                    }
+                }
+            }
+
+        } else {
+            auto ext = prefetch_consecutive_extractor<false>(mat, !row, s, l, opt.prefetch, opt.executor);
+            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
+
+            for (Index_ x = 0; x < l; ++x) {
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer.data()); });
+                const auto grp = group[s + x];
+                const auto min_ptr = min_ptrs[grp];
+                const auto max_ptr = max_ptrs[grp];
+
+                // For the first observed vector of each group, we don't need to read the existing min/max.
+                if (cur_observed[grp] == 0) {
+                    std::copy_n(ptr, dim, min_ptr);
+                    std::copy_n(ptr, dim, max_ptr);
+                } else {
+                    AUVEH_NODEP
+                    for (Index_ d = 0; d < dim; ++d) {
+                        const Output_ val = ptr[d];
+                        auto& min_current = min_ptr[d];
+                        min_current = std::min(min_current, val);
+                        auto& max_current = max_ptr[d];
+                        max_current = std::max(max_current, val);
+                    }
+                }
+                ++cur_observed[grp];
+            }
+        }
+
+        if (do_parallel) {
+            (*all_partial_observed)[thread] = std::move(cur_observed);
+        }
+    }, mat, !row, opt);
+
+    if (do_parallel) {
+        parallelize_merge([&](Index_ start, Index_ length) -> void {
+            const Index_ end = start + length;
+            for (std::size_t g = 0; g < num_groups; ++g) {
+                if (group_size[g] == 0) {
+                    continue;
+                }
+
+                const auto out_min = output.minimum[g];
+                const auto out_max = output.maximum[g];
+                bool initialized = (*((*all_partial_observed)[0]))[g] > 0;
+
+                for (int u = 1; u < nused; ++u) {
+                    if ((*((*all_partial_observed)[u]))[g] == 0) {
+                        continue;
+                    }
+
+                    const auto cur_min = all_partial_min->get(u)[g];
+                    const auto cur_max = all_partial_max->get(u)[g];
+                    if (!initialized) { // The first thread might not have observed this group, in which case the output buffers are not yet set.
+                        std::copy(cur_min + start, cur_min + end, out_min + start);
+                        std::copy(cur_max + start, cur_max + end, out_max + start);
+                        initialized = true;
+                    } else {
+                        AUVEH_NODEP
+                        for (Index_ d = start; d < end; ++d) {
+                            out_min[d] = std::min(out_min[d], cur_min[d]);
+                            out_max[d] = std::max(out_max[d], cur_max[d]);
+                        }
+                    }
+                }
+
+                assert(initialized);
+            }
+        }, dim, opt, "group_range");
+    }
+
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        if (group_size[g] == 0) {
+            std::fill_n(output.minimum[g], dim, opt.minimum_placeholder);
+            std::fill_n(output.maximum[g], dim, opt.maximum_placeholder);
+        }
+    }
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Plan the computation of `group_range()`, see `Plan` for details.
+ *
+ * @tparam Output_ Numeric type of the output data.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute ranges for the rows.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param num_groups Number of groups.
+ * @param opt Options for `group_range()`.
+ *
+ * @return Plan for `group_range()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `GroupRangeOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Output_, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const std::size_t num_groups, const GroupRangeOptions<Output_>& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = saturating_add(otherdim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0)), saturating_multiply(num_groups, 2 * sizeof(Output_) + sizeof(Index_)));
+    model.running_buffer = saturating_add(dim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0)), (sparse ? saturating_multiply(num_groups, dim * sizeof(Index_)) : 0));
+    model.running_partial_rest = saturating_multiply(num_groups, dim * 2 * sizeof(Output_));
+    return choose_plan(model, row, mat, opt);
+}
+
+/**
+ * Compute per-group ranges for each element of a chosen dimension of a `tatami::Matrix`.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Output_ Numeric type of the output data.
+ * It is assumed that this is large enough to store the maxima/minima.
+ *
+ * @param row Whether to compute ranges for the rows.
+ * If false, ranges are computed for the columns instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param[out] output Buffers in which to store the results.
+ * On output, each array stores the minima and maxima of the corresponding group.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_>
+void group_range(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    GroupRangeBuffers<Output_>& output,
+    const GroupRangeOptions<Output_>& opt
+) {
+    assert(sanisizer::is_equal(num_groups, output.minimum.size()));
+    assert(sanisizer::is_equal(num_groups, output.maximum.size()));
+
+    auto group_size = sanisizer::create<std::vector<Index_> >(num_groups);
+    const auto otherdim = (row ? mat.ncol() : mat.nrow());
+    for (Index_ o = 0; o < otherdim; ++o) {
+        group_size[group[o]] += 1;
+    }
+
+    const auto cur_plan = plan(row, mat, num_groups, opt);
+    trace_path(opt.tracer, "group_range", cur_plan.running, mat.is_sparse(), false);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    if (!cur_plan.running) {
+        group_range_direct(row, mat, group, num_groups, group_size.data(), output, planned_opt);
+    } else {
+        group_range_running(row, mat, group, num_groups, group_size.data(), output, planned_opt);
+    }
+}
+
+/**
+ * @brief Results of `group_range()`.
+ *
+ * @tparam Output_ Numeric type of the output data.
+ */
+template<typename Output_>
+struct GroupRangeResult {
+    /**
+     * Vector of length equal to the number of groups.
+     * Each element is a vector of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise),
+     * containing the minimum value of each row/column for the corresponding group.
+     */
+    std::vector<std::vector<Output_> > minimum;
+
+    /**
+     * Vector of length equal to the number of groups.
+     * Each element is a vector of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise),
+     * containing the maximum value of each row/column for the corresponding group.
+     */
+    std::vector<std::vector<Output_> > maximum;
+};
+
+/**
+ * Overload of `group_range()` that allocates memory for the results.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Output_ Numeric type of the output data.
+ * It is assumed that this is large enough to store the maxima/minima.
+ *
+ * @param row Whether to compute ranges for the rows.
+ * If false, ranges are computed for the columns instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param opt Further options.
+ *
+ * @return Minimum and maximum of each group for each row/column.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_ = Value_>
+GroupRangeResult<Output_> group_range(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const GroupRangeOptions<Output_>& opt
+) {
+    GroupRangeResult<Output_> output;
+    sanisizer::resize(output.minimum, num_groups);
+    sanisizer::resize(output.maximum, num_groups);
+
+    GroupRangeBuffers<Output_> buffers;
+    sanisizer::resize(buffers.minimum, num_groups);
+    sanisizer::resize(buffers.maximum, num_groups);
+
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        tatami::resize_container_to_Index_size(output.minimum[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        buffers.minimum[g] = output.minimum[g].data();
+        tatami::resize_container_to_Index_size(output.maximum[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        buffers.maximum[g] = output.maximum[g].data();
+    }
+
+    group_range(row, mat, group, num_groups, buffers, opt);
+    return output;
+}
+
+}
+
+#endif
@@ -2,20 +2,29 @@
 #define TATAMI_STATS_GROUP_RSS_HPP
 
 #include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+#include "deterministic.hpp"
+#include "shifted_rss.hpp"
+#include "group_sink.hpp"
+#include "small_groups.hpp"
+#include "transform.hpp"
 
 #include <vector>
+#include <array>
 #include <algorithm>
 #include <cstddef>
 #include <optional>
+#include <memory>
 #include <cassert>
 #include <limits>
 #include <cmath>
+#include <type_traits>
 
 #include "tatami/tatami.hpp"
 #include "sanisizer/sanisizer.hpp"
 #include "quickstats/quickstats.hpp"
 #include "auveh/auveh.hpp"
-#include "jiwoo/jiwoo.hpp"
 
 /**
  * @file group_rss.hpp
@@ -37,6 +46,81 @@ struct GroupRssOptions {
      */
     int num_threads = 1;
 
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Whether the running path should give the same results for any `num_threads`.
+     * If true, the rows/columns are processed in fixed blocks that do not depend on the number of threads,
+     * and the partial means and RSS of each group are combined across blocks in a fixed order, so the results are bitwise identical for any `num_threads`.
+     * This is slightly slower and stores a few more partial results per thread.
+     * The direct path is always deterministic, but note that `plan()` may choose a different path for different `num_threads` if `strategy = PlanStrategy::COST` or `max_memory_bytes` is set.
+     */
+    bool deterministic = false;
+
+    /**
+     * Whether the running path should accumulate shifted sums instead of using Welford's algorithm, see `shifted_rss.hpp` for details.
+     * This avoids a division for each element, at the cost of two more arrays per group of length equal to the number of rows/columns in each thread.
+     */
+    bool shifted_sums = false;
+
+    /**
+     * Whether the running path should visit the other dimension in group order.
+     * If true, the rows/columns of the other dimension are sorted by group and extracted with an oracle, so that all rows/columns of one group are processed consecutively.
+     * The mean and RSS of each group then stay in cache and are finalized before moving to the next group.
+     * Each thread processes a contiguous run of groups and writes directly to the output buffers, so no per-thread partial results are required,
+     * and any other per-thread storage (e.g., for counting non-zero elements or for `shifted_sums`) is only needed for one group at a time.
+     * However, if there are fewer groups than threads, some threads will be idle.
+     * This is most effective when the groups are interleaved along the other dimension and the matrix supports efficient access to arbitrary rows/columns.
+     * The results are the same for any `num_threads`, so `deterministic` is ignored.
+     */
+    bool group_ordered = false;
+
+    /**
+     * Number of rows/columns of the target dimension in each tile, for the `group_rss()` overload that writes to `GroupRssSinks`.
+     * If zero, this is chosen automatically, see `choose_tile_size()` for details.
+     */
+    std::size_t tile_size = 0;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Workspace to reuse buffers across calls, see @ref common_options_workspace.
+     */
+    Workspace* workspace = NULL;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+
     /**
      * Placeholder value to use for the mean of empty groups.
      * This is NaN if supported by `Output_`, otherwise it is zero.
@@ -66,17 +150,39 @@ struct GroupRssBuffers {
     std::vector<Output_*> rss;
 };
 
+/**
+ * @brief Destinations for the results of `group_rss()`.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Index_ Integer type of the row/column indices.
+ */
+template<typename Output_, typename Index_>
+struct GroupRssSinks {
+    /**
+     * Destination for the sample mean of each row/column in each group.
+     * If NULL, the means are not reported.
+     */
+    GroupSink<Output_, Index_>* mean = NULL;
+
+    /**
+     * Destination for the residual sum of squares of each row/column in each group.
+     * If NULL, the RSS values are not reported.
+     */
+    GroupSink<Output_, Index_>* rss = NULL;
+};
+
 /**
  * @cond
  */
-template<typename Output_, typename Count_, typename Index_>
+template<typename Output_, typename Count_, typename Index_, class Means_>
 void group_rss_finish_means(
     const std::size_t num_groups,
     const Count_* const group_size,
-    std::vector<Output_>& means,
+    Means_& means,
     const Index_ i,
     std::vector<Output_*>& output_means,
-    const Output_ placeholder
+    const Output_ placeholder,
+    const std::size_t step = 1
 ) {
     for (std::size_t b = 0; b < num_groups; ++b) {
         if (group_size[b]) {
@@ -84,316 +190,830 @@ void group_rss_finish_means(
         } else {
             means[b] = placeholder;
         }
-        output_means[b][i] = means[b];
+        output_means[b][static_cast<std::size_t>(i) * step] = means[b];
     }
 }
 
-template<typename Value_, typename Index_, typename Group_, typename Count_, typename Output_>
+// Specialization of group_rss_direct() for small numbers of groups, see small_groups.hpp.
+template<std::size_t num_groups_, typename Value_, typename Index_, typename Group_, typename Count_, typename Output_, class Transform_>
+void group_rss_direct_small(
+    const bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const Count_* const group_size,
+    GroupRssBuffers<Output_>& output,
+    const Transform_& transform,
+    const GroupRssOptions<Output_>& opt,
+    const std::size_t step
+) {
+    const auto otherdim = (row ? mat.ncol() : mat.nrow());
+
+    if (mat.sparse()) {
+        const auto zero = transformed_zero<Output_, Value_>(transform); // for shifting sparse values, see group_rss_unshift_means().
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "group_rss", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor);
+            std::vector<Value_> vholder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, vholder);
+            std::vector<Index_> iholder;
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, otherdim, iholder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+
+            for (Index_ x = 0; x < l; ++x) {
+                auto range = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                const auto vals = transform_values(transform, range.value, range.number, tbuffer, zero);
+                const auto get_group = [&](Index_ i) -> std::size_t { return group[range.index[i]]; };
+
+                std::array<Output_, num_groups_> cur_means{};
+                std::array<Index_, num_groups_> cur_non_zeros{};
+                small_group_sums(cur_means, vals, range.number, get_group, false);
+                small_group_counts(cur_non_zeros, range.number, get_group);
+                group_rss_finish_means(num_groups_, group_size, cur_means, static_cast<Index_>(s + x), output.mean, opt.mean_placeholder, step);
+
+                std::array<Output_, num_groups_> cur_rss{};
+                small_group_squared_deviations(cur_rss, cur_means, vals, range.number, get_group);
+                const std::size_t offset = static_cast<std::size_t>(s + x) * step;
+                for (std::size_t g = 0; g < num_groups_; ++g) {
+                    if (group_size[g] > 0) { // see group_rss_direct() for why the RSS is preserved for empty groups.
+                        output.rss[g][offset] = cur_rss[g] + cur_means[g] * cur_means[g] * (group_size[g] - cur_non_zeros[g]);
+                    } else {
+                        output.rss[g][offset] = 0;
+                    }
+                }
+            }
+        }, mat, row, opt);
+
+    } else {
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "group_rss", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, holder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            const auto get_group = [&](Index_ j) -> std::size_t { return group[j]; };
+
+            for (Index_ x = 0; x < l; ++x) {
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer); });
+                const auto vals = transform_values(transform, ptr, otherdim, tbuffer, static_cast<Output_>(0));
+
+                std::array<Output_, num_groups_> cur_means{};
+                small_group_sums(cur_means, vals, otherdim, get_group, false);
+                group_rss_finish_means(num_groups_, group_size, cur_means, static_cast<Index_>(s + x), output.mean, opt.mean_placeholder, step);
+
+                std::array<Output_, num_groups_> cur_rss{};
+                small_group_squared_deviations(cur_rss, cur_means, vals, otherdim, get_group);
+                const std::size_t offset = static_cast<std::size_t>(s + x) * step;
+                for (std::size_t g = 0; g < num_groups_; ++g) {
+                    output.rss[g][offset] = cur_rss[g];
+                }
+            }
+        }, mat, row, opt);
+    }
+}
+
+template<typename Value_, typename Index_, typename Group_, typename Count_, typename Output_, class Transform_>
 void group_rss_direct(
     const bool row,
-    const tatami::Matrix<Value_, Index_>& mat, 
-    const Group_* const group, 
-    const std::size_t num_groups, 
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
     const Count_* const group_size,
     GroupRssBuffers<Output_>& output,
-    const GroupRssOptions<Output_>& opt
+    const Transform_& transform,
+    const GroupRssOptions<Output_>& opt,
+    const std::size_t step = 1 // for the interleaved layout, see group_sum_direct().
 ) {
-    const auto dim = (row ? mat.nrow() : mat.ncol());
+    const bool small = dispatch_small_groups(num_groups, [&](auto ngroups) -> void {
+        group_rss_direct_small<decltype(ngroups)::value>(row, mat, group, group_size, output, transform, opt, step);
+    });
+    if (small) {
+        return;
+    }
+
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
 
     if (mat.sparse()) {
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<true>(mat, row, s, l);
-            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(otherdim);
-            auto cur_means = sanisizer::create<std::vector<Output_> >(num_groups);
-            auto cur_rss = sanisizer::create<std::vector<Output_> >(num_groups);
-            auto cur_non_zeros = sanisizer::create<std::vector<Index_> >(num_groups);
+        const auto zero = transformed_zero<Output_, Value_>(transform); // for shifting sparse values, see group_rss_unshift_means().
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "group_rss", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor);
+            std::vector<Value_> vholder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, vholder);
+            std::vector<Index_> iholder;
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, otherdim, iholder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            std::vector<Output_> mholder, rholder;
+            const auto cur_means = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS, num_groups, mholder);
+            const auto cur_rss = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS + 1, num_groups, rholder);
+            std::vector<Index_> nholder;
+            const auto cur_non_zeros = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS + 2, num_groups, nholder);
+            std::fill_n(cur_means, num_groups, 0);
+            std::fill_n(cur_rss, num_groups, 0);
+            std::fill_n(cur_non_zeros, num_groups, 0);
 
             for (Index_ x = 0; x < l; ++x) {
-                auto range = ext->fetch(vbuffer.data(), ibuffer.data());
+                auto range = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                const auto vals = transform_values(transform, range.value, range.number, tbuffer, zero);
 
                 // Computing the mean first.
                 for (Index_ i = 0; i < range.number; ++i) {
                     const auto g = group[range.index[i]];
-                    cur_means[g] += range.value[i];
+                    cur_means[g] += vals[i];
                     ++cur_non_zeros[g];
                 }
-                group_rss_finish_means(num_groups, group_size, cur_means, static_cast<Index_>(s + x), output.mean, opt.mean_placeholder);
+                group_rss_finish_means(num_groups, group_size, cur_means, static_cast<Index_>(s + x), output.mean, opt.mean_placeholder, step);
 
                 // Now computing the RSS.
                 for (Index_ i = 0; i < range.number; ++i) {
                     const auto g = group[range.index[i]];
-                    const auto delta = range.value[i] - cur_means[g];
+                    const auto delta = vals[i] - cur_means[g];
                     cur_rss[g] += delta * delta;
                 }
+                const std::size_t offset = static_cast<std::size_t>(s + x) * step;
                 for (std::size_t g = 0; g < num_groups; ++g) {
                     if (group_size[g] > 0) { // preserve RSS = 0 if the group is empty, otherwise the placeholder mean might be a NaN that causes problems.
                         const Output_ my_rss = cur_rss[g] + cur_means[g] * cur_means[g] * (group_size[g] - cur_non_zeros[g]);
-                        output.rss[g][s + x] = my_rss;
+                        output.rss[g][offset] = my_rss;
                     } else {
-                        output.rss[g][s + x] = 0;
+                        output.rss[g][offset] = 0;
                     }
                 }
 
-                std::fill(cur_means.begin(), cur_means.end(), 0);
-                std::fill(cur_rss.begin(), cur_rss.end(), 0);
-                std::fill(cur_non_zeros.begin(), cur_non_zeros.end(), 0);
+                std::fill_n(cur_means, num_groups, 0);
+                std::fill_n(cur_rss, num_groups, 0);
+                std::fill_n(cur_non_zeros, num_groups, 0);
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
 
     } else {
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<false>(mat, row, s, l);
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            auto cur_means = sanisizer::create<std::vector<Output_> >(num_groups);
-            auto cur_rss = sanisizer::create<std::vector<Output_> >(num_groups);
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "group_rss", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, holder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            std::vector<Output_> mholder, rholder;
+            const auto cur_means = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS, num_groups, mholder);
+            const auto cur_rss = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS + 1, num_groups, rholder);
+            std::fill_n(cur_means, num_groups, 0);
+            std::fill_n(cur_rss, num_groups, 0);
 
             for (Index_ x = 0; x < l; ++x) {
-                auto ptr = ext->fetch(buffer.data());
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer); });
+                const auto vals = transform_values(transform, ptr, otherdim, tbuffer, static_cast<Output_>(0));
 
                 // Computing the mean first.
                 for (Index_ j = 0; j < otherdim; ++j) {
-                    cur_means[group[j]] += ptr[j];
+                    cur_means[group[j]] += vals[j];
                 }
-                group_rss_finish_means(num_groups, group_size, cur_means, static_cast<Index_>(s + x), output.mean, opt.mean_placeholder);
+                group_rss_finish_means(num_groups, group_size, cur_means, static_cast<Index_>(s + x), output.mean, opt.mean_placeholder, step);
 
                 // Now computing the RSS.
                 for (Index_ j = 0; j < otherdim; ++j) {
                     const auto g = group[j];
-                    const auto delta = ptr[j] - cur_means[g];
+                    const auto delta = vals[j] - cur_means[g];
                     cur_rss[g] += delta * delta;
                 }
+                const std::size_t offset = static_cast<std::size_t>(s + x) * step;
                 for (std::size_t g = 0; g < num_groups; ++g) {
-                    output.rss[g][s + x] = cur_rss[g];
+                    output.rss[g][offset] = cur_rss[g];
                 }
 
-                std::fill(cur_means.begin(), cur_means.end(), 0);
-                std::fill(cur_rss.begin(), cur_rss.end(), 0);
+                std::fill_n(cur_means, num_groups, 0);
+                std::fill_n(cur_rss, num_groups, 0);
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
     }
 }
 
-template<typename Value_, typename Index_, typename Group_, typename Count_, typename Output_>
+// For the interleaved layout, each output pointer refers to the first entry of its group in a [dim][stride] array,
+// where 'stride' is the total number of groups including the empty groups that were stripped by group_rss_running().
+// The per-thread partial results use the same layout so that each worker accumulates directly with a fixed stride.
+template<bool interleaved_, typename Value_, typename Index_, typename Group_, typename Count_, typename Output_, class Transform_>
 void group_rss_running_nonempty(
     const bool row,
     const Index_ dim,
-    const Index_ otherdim,
     const tatami::Matrix<Value_, Index_>& mat,
     const Group_* const group, 
     const std::size_t num_groups, 
     const Count_* const group_size,
     GroupRssBuffers<Output_>& output,
-    const GroupRssOptions<Output_>& opt
+    const Transform_& transform,
+    const GroupRssOptions<Output_>& opt,
+    const std::size_t stride
 ) {
-    const bool do_parallel = opt.num_threads > 1;
-    std::optional<std::vector<std::optional<std::vector<Output_*> > > > all_partial_mean, all_partial_rss;
-    std::optional<std::vector<std::optional<std::vector<Count_> > > > all_partial_count;
-    if (do_parallel) {
-        // -1, as we'll repurpose the RSS output buffer to store the partial RSS of the first thread.
-        all_partial_rss.emplace(sanisizer::cast<I<decltype(all_partial_rss->size())> >(opt.num_threads - 1));
-        all_partial_mean.emplace(sanisizer::cast<I<decltype(all_partial_mean->size())> >(opt.num_threads));
-        all_partial_count.emplace(sanisizer::cast<I<decltype(all_partial_count->size())> >(opt.num_threads));
-    }
-    jiwoo::Scope lib_all_mean(all_partial_mean), lib_all_rss(all_partial_rss); // RAII freeing of every thread's allocated memory.
-
     // All groups are assumed to be non-empty at this point,
     // which allows us to skip some allocations.
     for (std::size_t g = 0; g < num_groups; ++g) {
         assert(group_size[g] > 0);
     }
 
-    // We overwrite any existing value in the array in the do_parallel=true situation.
-    // So, the initial value doesn't need to be zero.
-    if (!do_parallel) {
-        for (std::size_t g = 0; g < num_groups; ++g) {
-            std::fill_n(output.mean[g], dim, 0);
-        }
-    }
-    for (std::size_t g = 0; g < num_groups; ++g) {
-        std::fill_n(output.rss[g], dim, 0);
-    }
-
-    const bool is_sparse = mat.is_sparse();
-    const int nused = tatami::parallelize([&](int thread, Index_ s, Index_ l) -> void {
-        std::optional<std::vector<Output_*> > cur_mean, cur_rss;
-        jiwoo::Scope libmean(cur_mean), librss(cur_rss); // RAII freeing of this thread's allocated memory. 
+    const auto zero = transformed_zero<Output_, Value_>(transform); // for shifting sparse values, see group_rss_unshift_means().
 
-        Output_** mean_ptrs;
-        Output_** rss_ptrs;
-        if (!do_parallel) {
-            // Storing mean and RSS directly in the output vector to cut down two allocations if we're not working in parallel.
-            mean_ptrs = output.mean.data();
-            rss_ptrs = output.rss.data();
+    // Each worker computes the mean and RSS of each group for the next 'number' vectors from its range,
+    // storing them in 'partial[g]' and 'partial[num_groups + g]', respectively, along with the number of vectors from each group in 'counts'.
+    // 'interleaved' is a std::integral_constant specifying whether the partial results use the interleaved layout,
+    // so that the stride is a known constant for the group-major layout.
+    // With shifted sums, each worker also holds the shifted sums for each group, see shifted_rss.hpp.
+    // Per-group arrays of length 'dim' (i.e., the non-zero counts and the shifted sums) are stored contiguously in a single buffer.
+    const auto grouped_dim = sanisizer::product<std::size_t>(num_groups, dim);
+    const auto initialize_shifted_sums = [&](const int thread, std::vector<Output_>& sholder, std::vector<Output_>& ssholder) -> std::pair<Output_*, Output_*> {
+        const auto sums = workspace_buffer(opt.workspace, thread, WORKSPACE_SHIFTED, grouped_dim, sholder);
+        const auto sum_squares = workspace_buffer(opt.workspace, thread, WORKSPACE_SHIFTED + 1, grouped_dim, ssholder);
+        std::fill_n(sums, grouped_dim, 0);
+        std::fill_n(sum_squares, grouped_dim, 0);
+        return std::make_pair(sums, sum_squares);
+    };
 
-        } else {
-            // Storing the partial RSS directly in the output vectors to save ourselves an allocation if we're in the first thread.
-            if (thread == 0) {
-                rss_ptrs = output.rss.data();
-            } else {
-                cur_rss.emplace(sanisizer::cast<I<decltype(cur_rss->size())> >(num_groups));
-                for (std::size_t g = 0; g < num_groups; ++g) {
-                    auto ptr = new Output_ [dim]; // dim can be cast to size_t, based on the tatami contract.
-                    (*cur_rss)[g] = ptr;
-                    std::fill_n(ptr, dim, 0);
-                }
-                rss_ptrs = cur_rss->data();
-            }
+    const auto create_sparse_worker = [&](int thread, Index_ s, Index_ l, auto interleaved) {
+        auto ext = prefetch_consecutive_extractor<true>(mat, !row, s, l, opt.prefetch, opt.executor);
+        return [
+            &,
+            thread,
+            position = s,
+            ext = std::move(ext),
+            vholder = std::vector<Value_>(),
+            iholder = std::vector<Index_>(),
+            nholder = std::vector<Index_>(),
+            sholder = std::vector<Output_>(),
+            ssholder = std::vector<Output_>()
+        ](
+            TraceScope& tscope,
+            Index_ number,
+            Output_* const* partial,
+            auto* counts
+        ) mutable -> void {
+            const std::size_t step = (decltype(interleaved)::value ? stride : 1);
+            const auto mean_ptrs = partial;
+            const auto rss_ptrs = partial + num_groups;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, vholder);
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, dim, iholder);
+            const auto nonzeros = workspace_buffer(opt.workspace, thread, WORKSPACE_NONZEROS, grouped_dim, nholder);
+            std::fill_n(nonzeros, grouped_dim, 0);
 
-            // We can't do the same for the mean, though, as we need to keep the partial mean and the global mean separate for the reduction.
-            cur_mean.emplace(sanisizer::cast<I<decltype(cur_mean->size())> >(num_groups));
-            for (std::size_t g = 0; g < num_groups; ++g) {
-                auto ptr = new Output_ [dim]; // dim can be cast to size_t, based on the tatami contract.
-                (*cur_mean)[g] = ptr;
-                std::fill_n(ptr, dim, 0);
-            }
-            mean_ptrs = cur_mean->data();
-        }
+            if (opt.shifted_sums) {
+                const auto [ sums, sum_squares ] = initialize_shifted_sums(thread, sholder, ssholder);
+                for (Index_ x = 0; x < number; ++x) {
+                    auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                    const auto grp = group[position];
+                    ++position;
+                    const auto mptr = mean_ptrs[grp];
+                    ++counts[grp]; // increment is safe as 'counts[grp] + 1 <= number' fits in an Index_.
 
-        auto cur_count = sanisizer::create<std::vector<Count_> >(num_groups); 
+                    const std::size_t goffset = static_cast<std::size_t>(grp) * dim;
+                    const auto sptr = sums + goffset;
+                    const auto ssptr = sum_squares + goffset;
+                    const auto nnz = nonzeros + goffset;
+                    AUVEH_NODEP
+                    for (Index_ i = 0; i < out.number; ++i) {
+                        const auto d = out.index[i];
+                        const Output_ val = transform_value(transform, out.value[i], zero);
+                        // Using the first non-zero value of each element in each group as its shift, see shifted_rss.hpp.
+                        auto& shift = mptr[static_cast<std::size_t>(d) * step];
+                        shift = (nnz[d] == 0 ? val : shift);
+                        const Output_ delta = val - shift;
+                        sptr[d] += delta;
+                        ssptr[d] += delta * delta;
+                        ++nnz[d];
+                    }
+                }
 
-        if (is_sparse) {
-            auto ext = tatami::consecutive_extractor<true>(mat, !row, s, l);
-            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
-            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
-            auto nonzeros = sanisizer::create<std::vector<std::vector<Index_> > >(num_groups);
-            for (std::size_t g = 0; g < num_groups; ++g) {
-                tatami::resize_container_to_Index_size(nonzeros[g], dim);
+                for (std::size_t g = 0; g < num_groups; ++g) {
+                    const Output_ curtotal = counts[g];
+                    const auto mptr = mean_ptrs[g];
+                    const auto rptr = rss_ptrs[g];
+                    const std::size_t goffset = g * static_cast<std::size_t>(dim);
+                    const auto sptr = sums + goffset;
+                    const auto ssptr = sum_squares + goffset;
+                    const auto nnz = nonzeros + goffset;
+                    AUVEH_NODEP
+                    for (Index_ d = 0; d < dim; ++d) {
+                        const std::size_t o = static_cast<std::size_t>(d) * step;
+                        shifted_rss_fold_with_zeros<Output_>(mptr[o], rptr[o], sptr[d], ssptr[d], 0, curtotal, nnz[d]);
+                    }
+                }
+                return;
             }
 
-            for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(vbuffer.data(), ibuffer.data());
-                const auto grp = group[s + x];
-                ++cur_count[grp]; // increment is safe as 'cur_count[grp] + 1 <= l' fits in an Index_.
+            for (Index_ x = 0; x < number; ++x) {
+                auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                const auto grp = group[position];
+                ++position;
+                ++counts[grp]; // increment is safe as 'counts[grp] + 1 <= number' fits in an Index_.
                 const auto mptr = mean_ptrs[grp];
                 const auto rptr = rss_ptrs[grp];
-                auto& nnz = nonzeros[grp];
+                const auto nnz = nonzeros + static_cast<std::size_t>(grp) * dim;
                 AUVEH_NODEP
                 for (Index_ i = 0; i < out.number; ++i) {
                     const auto d = out.index[i];
-                    quickstats::update_rss(mptr[d], rptr[d], out.value[i], ++nnz[d]); // increment is safe as 'nnz + 1 <= l' fits in an Index_.
+                    const std::size_t o = static_cast<std::size_t>(d) * step;
+                    quickstats::update_rss(mptr[o], rptr[o], transform_value(transform, out.value[i], zero), ++nnz[d]); // increment is safe as 'nnz + 1 <= number' fits in an Index_.
                 }
             }
 
             for (std::size_t g = 0; g < num_groups; ++g) {
-                const auto curtotal = cur_count[g];
+                const Count_ curtotal = counts[g];
                 if (curtotal) {
                     const auto mptr = mean_ptrs[g];
                     const auto rptr = rss_ptrs[g];
-                    const auto& nnz = nonzeros[g];
+                    const auto nnz = nonzeros + g * static_cast<std::size_t>(dim);
                     AUVEH_NODEP
                     for (Index_ d = 0; d < dim; ++d) {
                         // unsafe call is possible as we check for curtotal > 0.
-                        quickstats::update_rss_with_zeros_unsafe(mptr[d], rptr[d], static_cast<Count_>(curtotal - nnz[d]), curtotal);
+                        const std::size_t o = static_cast<std::size_t>(d) * step;
+                        quickstats::update_rss_with_zeros_unsafe(mptr[o], rptr[o], static_cast<Count_>(curtotal - nnz[d]), curtotal);
                     }
                 }
             }
+        };
+    };
 
-        } else {
-            auto ext = tatami::consecutive_extractor<false>(mat, !row, s, l);
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
+    const auto create_dense_worker = [&](int thread, Index_ s, Index_ l, auto interleaved) {
+        auto ext = prefetch_consecutive_extractor<false>(mat, !row, s, l, opt.prefetch, opt.executor);
+        return [
+            &,
+            thread,
+            position = s,
+            ext = std::move(ext),
+            holder = std::vector<Value_>(),
+            sholder = std::vector<Output_>(),
+            ssholder = std::vector<Output_>(),
+            uholder = std::vector<Index_>()
+        ](
+            TraceScope& tscope,
+            Index_ number,
+            Output_* const* partial,
+            auto* counts
+        ) mutable -> void {
+            const std::size_t step = (decltype(interleaved)::value ? stride : 1);
+            const auto mean_ptrs = partial;
+            const auto rss_ptrs = partial + num_groups;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, holder);
 
-            for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(buffer.data());
-                const auto grp = group[s + x];
-                ++cur_count[grp]; // increment is safe as 'cur_count[grp] + 1 <= l' fits in an Index_.
+            if (opt.shifted_sums) {
+                const auto [ sums, sum_squares ] = initialize_shifted_sums(thread, sholder, ssholder);
+                const auto unfolded = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS, num_groups, uholder);
+                std::fill_n(unfolded, num_groups, 0);
+
+                const auto fold = [&](const std::size_t g) -> void {
+                    const auto mptr = mean_ptrs[g];
+                    const auto rptr = rss_ptrs[g];
+                    const std::size_t goffset = g * static_cast<std::size_t>(dim);
+                    const auto sptr = sums + goffset;
+                    const auto ssptr = sum_squares + goffset;
+                    const Output_ block_count = unfolded[g];
+                    const Output_ previous = counts[g] - unfolded[g];
+                    AUVEH_NODEP
+                    for (Index_ d = 0; d < dim; ++d) {
+                        const std::size_t o = static_cast<std::size_t>(d) * step;
+                        shifted_rss_fold<Output_>(mptr[o], rptr[o], sptr[d], ssptr[d], previous, block_count);
+                    }
+                    unfolded[g] = 0;
+                };
+
+                for (Index_ x = 0; x < number; ++x) {
+                    auto out = tscope.fetch([&]() { return ext->fetch(buffer); });
+                    const auto grp = group[position];
+                    ++position;
+                    const auto mptr = mean_ptrs[grp];
+                    if (counts[grp] == 0) {
+                        // Using the first observation in each group as the shift.
+                        for (Index_ d = 0; d < dim; ++d) {
+                            mptr[static_cast<std::size_t>(d) * step] = transform_value(transform, out[d], static_cast<Output_>(0));
+                        }
+                    }
+                    ++counts[grp]; // increment is safe as 'counts[grp] + 1 <= number' fits in an Index_.
+
+                    const std::size_t goffset = static_cast<std::size_t>(grp) * dim;
+                    const auto sptr = sums + goffset;
+                    const auto ssptr = sum_squares + goffset;
+                    AUVEH_NODEP
+                    for (Index_ d = 0; d < dim; ++d) {
+                        const Output_ delta = transform_value(transform, out[d], static_cast<Output_>(0)) - mptr[static_cast<std::size_t>(d) * step];
+                        sptr[d] += delta;
+                        ssptr[d] += delta * delta;
+                    }
+
+                    ++unfolded[grp];
+                    if (static_cast<std::size_t>(unfolded[grp]) == SHIFTED_RSS_BLOCK_SIZE) {
+                        fold(grp);
+                    }
+                }
+
+                for (std::size_t g = 0; g < num_groups; ++g) {
+                    if (unfolded[g]) {
+                        fold(g);
+                    }
+                }
+                return;
+            }
+
+            for (Index_ x = 0; x < number; ++x) {
+                auto out = tscope.fetch([&]() { return ext->fetch(buffer); });
+                const auto grp = group[position];
+                ++position;
+                ++counts[grp]; // increment is safe as 'counts[grp] + 1 <= number' fits in an Index_.
                 const auto mptr = mean_ptrs[grp];
                 const auto rptr = rss_ptrs[grp];
                 AUVEH_NODEP
                 for (Index_ d = 0; d < dim; ++d) {
-                    quickstats::update_rss(mptr[d], rptr[d], out[d], cur_count[grp]);
+                    const std::size_t o = static_cast<std::size_t>(d) * step;
+                    quickstats::update_rss(mptr[o], rptr[o], transform_value(transform, out[d], static_cast<Output_>(0)), counts[grp]);
                 }
             }
+        };
+    };
+
+    const auto run = [&](const auto& create_worker) -> void {
+        if (opt.deterministic) {
+            // The partial results for each leaf are always group-major, and only the final copy into the output uses the interleaved layout.
+            auto outputs = output.mean;
+            outputs.insert(outputs.end(), output.rss.begin(), output.rss.end());
+            deterministic_running<Output_>(
+                deterministic_leaves(mat, !row, dim, sanisizer::product<std::size_t>(num_groups, 2), opt),
+                sanisizer::product<std::size_t>(num_groups, 2),
+                dim,
+                num_groups,
+                [&](int thread, Index_ s, Index_ l) {
+                    return create_worker(thread, s, l, std::false_type());
+                },
+                [&](Output_* const* left, const Index_* left_count, Output_* const* right, const Index_* right_count, Index_ start, Index_ end) -> void {
+                    for (std::size_t g = 0; g < num_groups; ++g) {
+                        const auto lmean = left[g], lrss = left[num_groups + g], rmean = right[g], rrss = right[num_groups + g];
+                        const Output_ lcount = left_count[g], rcount = right_count[g];
+                        AUVEH_NODEP
+                        for (Index_ d = start; d < end; ++d) {
+                            deterministic_merge_rss(lmean[d], lrss[d], lcount, rmean[d], rrss[d], rcount);
+                        }
+                    }
+                },
+                outputs.data(),
+                static_cast<Index_*>(NULL),
+                opt,
+                "group_rss",
+                (interleaved_ ? stride : 1)
+            );
+            return;
         }
 
+        const std::size_t step = (interleaved_ ? stride : 1); // defined here so that it is a known constant for the group-major layout.
+        const bool do_parallel = opt.num_threads > 1;
+        std::optional<PartialBuffers<Output_> > all_partial_mean, all_partial_rss;
+        std::optional<PartialBuffers<Count_> > all_partial_count;
         if (do_parallel) {
-            (*all_partial_count)[thread] = std::move(cur_count);
-            jiwoo::transfer(cur_mean, (*all_partial_mean)[thread]);
-            if (thread > 0) {
-                jiwoo::transfer(cur_rss, (*all_partial_rss)[thread - 1]);
-            }
+            // The first thread's partial RSS is stored in the RSS output buffers, so its entry in all_partial_rss is unused.
+            // For the interleaved layout, each thread's partial results for all groups are stored in a single [dim][stride] array.
+            const std::size_t num_arrays = (interleaved_ ? 1 : num_groups);
+            all_partial_rss.emplace(opt.workspace, WORKSPACE_PARTIAL, opt.num_threads, opt.allocator, num_arrays);
+            all_partial_mean.emplace(opt.workspace, WORKSPACE_PARTIAL + 1, opt.num_threads, opt.allocator, num_arrays);
+            all_partial_count.emplace(opt.workspace, WORKSPACE_PARTIAL + 2, opt.num_threads, opt.allocator);
         }
-    }, otherdim, opt.num_threads);
-    assert(nused > 0);
 
-    if (do_parallel) {
-        const auto& ap_mean = *all_partial_mean;
-        const auto& ap_rss = *all_partial_rss;
+        const auto acquire_partial = [&](PartialBuffers<Output_>& buffers, const int thread, TraceScope& tscope) -> std::vector<Output_*> {
+            if constexpr(interleaved_) {
+                const auto size = sanisizer::product<std::size_t>(dim, stride);
+                tscope.add_bytes(sizeof(Output_) * size);
+                return interleaved_pointers(buffers.acquire(thread, size)[0], num_groups);
+            } else {
+                tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim) * num_groups);
+                const auto ptrs = buffers.acquire(thread, dim);
+                return std::vector<Output_*>(ptrs, ptrs + num_groups);
+            }
+        };
+
+        const auto get_partial = [&](const PartialBuffers<Output_>& buffers, const int thread, const std::size_t g) -> const Output_* {
+            if constexpr(interleaved_) {
+                return buffers.get(thread)[0] + g;
+            } else {
+                return buffers.get(thread)[g];
+            }
+        };
 
+        // We overwrite any existing value in the array in the do_parallel=true situation.
+        // So, the initial value doesn't need to be zero.
+        if (!do_parallel) {
+            for (std::size_t g = 0; g < num_groups; ++g) {
+                fill_strided(output.mean[g], dim, step, static_cast<Output_>(0));
+            }
+        }
         for (std::size_t g = 0; g < num_groups; ++g) {
-            const auto cur_output = output.mean[g];
-            const auto cur_global_count = group_size[g];
-            assert(cur_global_count > 0);
-            bool initialized = false;
-
-            for (int u = 0; u < nused; ++u) {
-                const auto cur_count = (*((*all_partial_count)[u]))[g];
-                if (cur_count == 0) {
-                    continue;
+            fill_strided(output.rss[g], dim, step, static_cast<Output_>(0));
+        }
+
+        const int nused = parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "group_rss", "compute", thread);
+            std::vector<Output_*> partial;
+            if (!do_parallel) {
+                // Storing mean and RSS directly in the output vector to cut down two allocations if we're not working in parallel.
+                partial = output.mean;
+                partial.insert(partial.end(), output.rss.begin(), output.rss.end());
+
+            } else {
+                // We can't store the partial mean in the output vectors, as we need to keep the partial mean and the global mean separate for the reduction.
+                partial = acquire_partial(*all_partial_mean, thread, tscope);
+
+                // Storing the partial RSS directly in the output vectors to save ourselves an allocation if we're in the first thread.
+                if (thread == 0) {
+                    partial.insert(partial.end(), output.rss.begin(), output.rss.end());
+                } else {
+                    const auto rss_ptrs = acquire_partial(*all_partial_rss, thread, tscope);
+                    partial.insert(partial.end(), rss_ptrs.begin(), rss_ptrs.end());
                 }
+            }
 
-                const auto& cur_mean = (*(ap_mean[u]))[g];
-                const Output_ mult = static_cast<Output_>(cur_count) / static_cast<Output_>(cur_global_count);
-                if (!initialized) { // Don't use u == 0, as the first non-empty 'g' might not occur in the first thread.
-                    AUVEH_NODEP
-                    for (Index_ d = 0; d < dim; ++d) {
-                        cur_output[d] = cur_mean[d] * mult;
+            // The per-group counts are zeroed by acquire() for the partial buffers, and are retained until the merge if do_parallel = true.
+            std::vector<Count_> cholder;
+            Count_* cur_count;
+            if (do_parallel) {
+                cur_count = all_partial_count->acquire(thread, num_groups)[0];
+            } else {
+                cur_count = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS + 1, num_groups, cholder);
+                std::fill_n(cur_count, num_groups, 0);
+            }
+            auto worker = create_worker(thread, s, l, std::integral_constant<bool, interleaved_>());
+            worker(tscope, l, partial.data(), cur_count);
+        }, mat, !row, opt);
+        assert(nused > 0);
+
+        if (do_parallel) {
+            parallelize_merge([&](Index_ start, Index_ length) -> void {
+                const Index_ end = start + length;
+                const auto& ap_mean = *all_partial_mean;
+                const auto& ap_rss = *all_partial_rss;
+
+                for (std::size_t g = 0; g < num_groups; ++g) {
+                    const auto cur_output = output.mean[g];
+                    const auto cur_global_count = group_size[g];
+                    assert(cur_global_count > 0);
+                    bool initialized = false;
+
+                    for (int u = 0; u < nused; ++u) {
+                        const auto cur_count = all_partial_count->get(u)[0][g];
+                        if (cur_count == 0) {
+                            continue;
+                        }
+
+                        const auto cur_mean = get_partial(ap_mean, u, g);
+                        const Output_ mult = static_cast<Output_>(cur_count) / static_cast<Output_>(cur_global_count);
+                        if (!initialized) { // Don't use u == 0, as the first non-empty 'g' might not occur in the first thread.
+                            AUVEH_NODEP
+                            for (Index_ d = start; d < end; ++d) {
+                                const std::size_t o = static_cast<std::size_t>(d) * step;
+                                cur_output[o] = cur_mean[o] * mult;
+                            }
+                            initialized = true;
+                        } else {
+                            AUVEH_NODEP
+                            for (Index_ d = start; d < end; ++d) {
+                                const std::size_t o = static_cast<std::size_t>(d) * step;
+                                cur_output[o] += cur_mean[o] * mult;
+                            }
+                        }
                     }
-                    initialized = true;
-                } else {
-                    AUVEH_NODEP
-                    for (Index_ d = 0; d < dim; ++d) {
-                        cur_output[d] += cur_mean[d] * mult;
+
+                    assert(initialized);
+                }
+
+                // Combining the RSS. 
+                for (std::size_t g = 0; g < num_groups; ++g) {
+                    const auto cur_global = output.mean[g];
+                    const auto cur_output = output.rss[g];
+                    bool initialized = false;
+
+                    for (int u = 0; u < nused; ++u) {
+                        const auto cur_count = all_partial_count->get(u)[0][g];
+                        if (cur_count == 0) { // This check allows us to use the unsafe RSS centering below.
+                            continue;
+                        }
+
+                        const auto cur_mean = get_partial(ap_mean, u, g);
+                        if (u == 0) { // Special case to avoid trying to access u - 1.
+                            AUVEH_NODEP
+                            for (Index_ d = start; d < end; ++d) {
+                                const std::size_t o = static_cast<std::size_t>(d) * step;
+                                cur_output[o] = quickstats::recenter_rss_unsafe(cur_count, cur_output[o], cur_mean[o], cur_global[o]); 
+                            }
+                            initialized = true;
+                        } else {
+                            const auto cur_rss = get_partial(ap_rss, u, g);
+                            if (!initialized) { // Don't use u == 0, as the first non-empty 'g' might not occur in the first thread.
+                                AUVEH_NODEP
+                                for (Index_ d = start; d < end; ++d) {
+                                    const std::size_t o = static_cast<std::size_t>(d) * step;
+                                    cur_output[o] = quickstats::recenter_rss_unsafe(cur_count, cur_rss[o], cur_mean[o], cur_global[o]); 
+                                }
+                                initialized = true;
+                            } else {
+                                AUVEH_NODEP
+                                for (Index_ d = start; d < end; ++d) {
+                                    const std::size_t o = static_cast<std::size_t>(d) * step;
+                                    cur_output[o] += quickstats::recenter_rss_unsafe(cur_count, cur_rss[o], cur_mean[o], cur_global[o]); 
+                                }
+                            }
+                        }
                     }
+
+                    assert(initialized);
                 }
-            }
+            }, dim, opt, "group_rss");
+        }
+    };
+
+    if (mat.is_sparse()) {
+        run(create_sparse_worker);
+    } else {
+        run(create_dense_worker);
+    }
+}
+
+// Visits the other dimension in group order, see GroupRssOptions::group_ordered.
+// Each worker handles a contiguous run of groups, balanced by the group sizes, and computes the statistics for each group directly in the output arrays.
+// For the interleaved layout, neighboring entries of the output arrays belong to groups that may be processed by different threads,
+// so each thread accumulates into contiguous per-thread buffers and scatters the results into the output once each group is finished.
+// This avoids false sharing of the output cache lines for every extracted row/column.
+template<bool interleaved_, typename Value_, typename Index_, typename Group_, typename Count_, typename Output_, class Transform_>
+void group_rss_ordered(
+    const bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group, 
+    const std::size_t num_groups, 
+    const Count_* const group_size,
+    GroupRssBuffers<Output_>& output,
+    const Transform_& transform,
+    const GroupRssOptions<Output_>& opt
+) {
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    const Index_ otherdim = (row ? mat.ncol() : mat.nrow());
 
-            assert(initialized);
+    auto group_starts = sanisizer::create<std::vector<Index_> >(sanisizer::sum<std::size_t>(num_groups, 1));
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        group_starts[g + 1] = group_starts[g] + group_size[g];
+    }
+    auto ordered = tatami::create_container_of_Index_size<std::vector<Index_> >(otherdim);
+    {
+        auto offsets = group_starts;
+        for (Index_ o = 0; o < otherdim; ++o) {
+            ordered[offsets[group[o]]++] = o;
         }
+    }
 
-        // Combining the RSS. 
-        for (std::size_t g = 0; g < num_groups; ++g) {
-            const auto& cur_global = output.mean[g];
-            const auto cur_output = output.rss[g];
-            bool initialized = false;
-
-            for (int u = 0; u < nused; ++u) {
-                const auto cur_count = (*((*all_partial_count)[u]))[g];
-                if (cur_count == 0) { // This check allows us to use the unsafe RSS centering below.
-                    continue;
-                }
+    const auto boundaries = partition_by_cost(num_groups, group_size, opt.num_threads);
+    const bool is_sparse = mat.is_sparse();
+    const auto zero = transformed_zero<Output_, Value_>(transform); // for shifting sparse values, see group_rss_unshift_means().
+    parallelize_by_boundaries([&](int thread, std::size_t gs, std::size_t gl) -> void {
+        TraceScope tscope(opt.tracer, "group_rss", "compute", thread);
+        const std::size_t step = (interleaved_ ? num_groups : 1); // defined here so that it is a known constant for the group-major layout.
+        std::vector<Output_> mholder, rholder;
+        Output_* mean_buffer = NULL;
+        Output_* rss_buffer = NULL;
+        if constexpr(interleaved_) {
+            mean_buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS, dim, mholder);
+            rss_buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS + 1, dim, rholder);
+        }
+        std::vector<Value_> vholder;
+        const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, vholder);
+        std::vector<Index_> iholder, nholder;
+        Index_* ibuffer = NULL;
+        Index_* nonzeros = NULL;
+        if (is_sparse) {
+            ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, dim, iholder);
+            nonzeros = workspace_buffer(opt.workspace, thread, WORKSPACE_NONZEROS, dim, nholder);
+        }
+        std::vector<Output_> sholder, ssholder;
+        Output_* sptr = NULL;
+        Output_* ssptr = NULL;
+        if (opt.shifted_sums) {
+            sptr = workspace_buffer(opt.workspace, thread, WORKSPACE_SHIFTED, dim, sholder);
+            ssptr = workspace_buffer(opt.workspace, thread, WORKSPACE_SHIFTED + 1, dim, ssholder);
+        }
+
+        for (std::size_t g = gs, gend = gs + gl; g < gend; ++g) {
+            const Index_ gsize = group_size[g];
+            if (gsize == 0) {
+                fill_strided(output.mean[g], dim, step, opt.mean_placeholder);
+                fill_strided(output.rss[g], dim, step, static_cast<Output_>(0));
+                continue;
+            }
 
-                const auto& cur_mean = (*(ap_mean[u]))[g];
-                if (u == 0) { // Special case to avoid trying to access u - 1.
+            const auto mptr = (interleaved_ ? mean_buffer : output.mean[g]);
+            const auto rptr = (interleaved_ ? rss_buffer : output.rss[g]);
+            std::fill_n(mptr, dim, static_cast<Output_>(0));
+            std::fill_n(rptr, dim, static_cast<Output_>(0));
+            if (opt.shifted_sums) {
+                std::fill_n(sptr, dim, 0);
+                std::fill_n(ssptr, dim, 0);
+            }
+            std::shared_ptr<const tatami::Oracle<Index_> > oracle = std::make_shared<tatami::FixedViewOracle<Index_> >(ordered.data() + group_starts[g], static_cast<std::size_t>(gsize));
+
+            if (is_sparse) {
+                std::fill_n(nonzeros, dim, 0);
+                tatami::Options topt;
+                topt.sparse_ordered_index = false;
+                auto ext = prefetch_oracular_extractor<true>(mat, !row, std::move(oracle), opt.prefetch, opt.executor, topt);
+
+                if (opt.shifted_sums) {
+                    for (Index_ x = 0; x < gsize; ++x) {
+                        auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                        AUVEH_NODEP
+                        for (Index_ i = 0; i < out.number; ++i) {
+                            const auto d = out.index[i];
+                            const Output_ val = transform_value(transform, out.value[i], zero);
+                            // Using the first non-zero value as the shift, as in group_rss_running_nonempty().
+                            auto& shift = mptr[d];
+                            shift = (nonzeros[d] == 0 ? val : shift);
+                            const Output_ delta = val - shift;
+                            sptr[d] += delta;
+                            ssptr[d] += delta * delta;
+                            ++nonzeros[d];
+                        }
+                    }
+                    const Output_ curtotal = gsize;
                     AUVEH_NODEP
                     for (Index_ d = 0; d < dim; ++d) {
-                        cur_output[d] = quickstats::recenter_rss_unsafe(cur_count, cur_output[d], cur_mean[d], cur_global[d]); 
+                        shifted_rss_fold_with_zeros<Output_>(mptr[d], rptr[d], sptr[d], ssptr[d], 0, curtotal, nonzeros[d]);
                     }
-                    initialized = true;
+
                 } else {
-                    const auto& cur_rss = (*(ap_rss[u - 1]))[g];
-                    if (!initialized) { // Don't use u == 0, as the first non-empty 'g' might not occur in the first thread.
+                    for (Index_ x = 0; x < gsize; ++x) {
+                        auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                        AUVEH_NODEP
+                        for (Index_ i = 0; i < out.number; ++i) {
+                            const auto d = out.index[i];
+                            quickstats::update_rss(mptr[d], rptr[d], transform_value(transform, out.value[i], zero), ++nonzeros[d]);
+                        }
+                    }
+                    AUVEH_NODEP
+                    for (Index_ d = 0; d < dim; ++d) {
+                        quickstats::update_rss_with_zeros_unsafe(mptr[d], rptr[d], static_cast<Count_>(gsize - nonzeros[d]), static_cast<Count_>(gsize));
+                    }
+                }
+
+            } else {
+                auto ext = prefetch_oracular_extractor<false>(mat, !row, std::move(oracle), opt.prefetch, opt.executor);
+
+                if (opt.shifted_sums) {
+                    Index_ unfolded = 0;
+                    const auto fold = [&](const Index_ processed) -> void {
+                        const Output_ block_count = unfolded;
+                        const Output_ previous = processed - unfolded;
                         AUVEH_NODEP
                         for (Index_ d = 0; d < dim; ++d) {
-                            cur_output[d] = quickstats::recenter_rss_unsafe(cur_count, cur_rss[d], cur_mean[d], cur_global[d]); 
+                            shifted_rss_fold<Output_>(mptr[d], rptr[d], sptr[d], ssptr[d], previous, block_count);
                         }
-                        initialized = true;
-                    } else {
+                        unfolded = 0;
+                    };
+
+                    for (Index_ x = 0; x < gsize; ++x) {
+                        auto ptr = tscope.fetch([&]() { return ext->fetch(vbuffer); });
+                        if (x == 0) {
+                            // Using the first observation as the shift.
+                            for (Index_ d = 0; d < dim; ++d) {
+                                mptr[d] = transform_value(transform, ptr[d], static_cast<Output_>(0));
+                            }
+                        }
+                        AUVEH_NODEP
+                        for (Index_ d = 0; d < dim; ++d) {
+                            const Output_ delta = transform_value(transform, ptr[d], static_cast<Output_>(0)) - mptr[d];
+                            sptr[d] += delta;
+                            ssptr[d] += delta * delta;
+                        }
+                        ++unfolded;
+                        if (static_cast<std::size_t>(unfolded) == SHIFTED_RSS_BLOCK_SIZE) {
+                            fold(x + 1);
+                        }
+                    }
+                    if (unfolded) {
+                        fold(gsize);
+                    }
+
+                } else {
+                    for (Index_ x = 0; x < gsize; ++x) {
+                        auto ptr = tscope.fetch([&]() { return ext->fetch(vbuffer); });
                         AUVEH_NODEP
                         for (Index_ d = 0; d < dim; ++d) {
-                            cur_output[d] += quickstats::recenter_rss_unsafe(cur_count, cur_rss[d], cur_mean[d], cur_global[d]); 
+                            quickstats::update_rss(mptr[d], rptr[d], transform_value(transform, ptr[d], static_cast<Output_>(0)), x + 1);
                         }
                     }
                 }
             }
 
-            assert(initialized);
+            if constexpr(interleaved_) {
+                for (Index_ d = 0; d < dim; ++d) {
+                    const std::size_t o = static_cast<std::size_t>(d) * step;
+                    output.mean[g][o] = mptr[d];
+                    output.rss[g][o] = rptr[d];
+                }
+            }
         }
-    }
+    }, boundaries, opt.executor);
 }
 
-template<typename Value_, typename Index_, typename Group_, typename Count_, typename Output_>
+// For the interleaved layout, each pointer in 'output' refers to the first entry of its group in a [dim][num_groups] array.
+template<bool interleaved_, typename Value_, typename Index_, typename Group_, typename Count_, typename Output_, class Transform_>
 void group_rss_running(
     const bool row,
     const tatami::Matrix<Value_, Index_>& mat,
@@ -401,14 +1021,21 @@ void group_rss_running(
     const std::size_t num_groups, 
     const Count_* const group_size,
     GroupRssBuffers<Output_>& output,
+    const Transform_& transform,
     const GroupRssOptions<Output_>& opt
 ) {
+    if (opt.group_ordered) {
+        group_rss_ordered<interleaved_>(row, mat, group, num_groups, group_size, output, transform, opt);
+        return;
+    }
+
     const auto dim = (row ? mat.nrow() : mat.ncol());
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
+    const std::size_t step = (interleaved_ ? num_groups : 1);
     if (otherdim == 0) {
         for (std::size_t g = 0; g < num_groups; ++g) {
-            std::fill_n(output.mean[g], dim, opt.mean_placeholder);
-            std::fill_n(output.rss[g], dim, 0);
+            fill_strided(output.mean[g], dim, step, opt.mean_placeholder);
+            fill_strided(output.rss[g], dim, step, static_cast<Output_>(0));
         }
         return; 
     }
@@ -443,8 +1070,8 @@ void group_rss_running(
                 new_output_store->mean.push_back(output.mean[g]);
                 new_output_store->rss.push_back(output.rss[g]);
             } else {
-                std::fill_n(output.mean[g], dim, opt.mean_placeholder);
-                std::fill_n(output.rss[g], dim, 0);
+                fill_strided(output.mean[g], dim, step, opt.mean_placeholder);
+                fill_strided(output.rss[g], dim, step, static_cast<Output_>(0));
             }
         }
 
@@ -464,24 +1091,119 @@ void group_rss_running(
         new_group = group;
     }
 
-    group_rss_running_nonempty(
+    group_rss_running_nonempty<interleaved_>(
         row,
         dim,
-        otherdim,
         mat,
         new_group,
         num_non_empty,
         new_group_size,
         *new_output,
-        opt
+        transform,
+        opt,
+        step
     );
 }
-/**
- * @endcond
- */
 
-/**
- * Compute per-group residual sums of squares (RSS) for each element of a chosen dimension of a `tatami::Matrix`.
+// For sparse matrices, the kernels subtract the transformed zero from each transformed non-zero value so that the structural zeros are still zero.
+// This does not affect the RSS, so we only need to add the transformed zero back to the means of the non-empty groups.
+template<typename Value_, typename Index_, typename Count_, typename Output_, class Transform_>
+void group_rss_unshift_means(
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Index_ dim,
+    const Count_* const group_size,
+    std::vector<Output_*>& means,
+    const Transform_& transform,
+    const std::size_t step = 1
+) {
+    if constexpr(!transform_preserves_zero<Transform_>) {
+        if (!mat.is_sparse()) {
+            return;
+        }
+        const auto zero = transformed_zero<Output_, Value_>(transform);
+        const std::size_t num_groups = means.size();
+        for (std::size_t g = 0; g < num_groups; ++g) {
+            if (group_size[g] > 0) {
+                const auto mptr = means[g];
+                for (Index_ d = 0; d < dim; ++d) {
+                    mptr[static_cast<std::size_t>(d) * step] += zero;
+                }
+            }
+        }
+    }
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Plan the computation of `group_rss()`, see `Plan` for details.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute RSS values for the rows.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param num_groups Number of groups.
+ * @param opt Options for `group_rss()`.
+ *
+ * @return Plan for `group_rss()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `GroupRssOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Output_, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const std::size_t num_groups, const GroupRssOptions<Output_>& opt) {
+    return plan(row, mat, num_groups, IdentityTransform(), opt);
+}
+
+/**
+ * Plan the computation of `group_rss()` with a transformation, see `Plan` for details.
+ * This is the same as the other `plan()` overload, except that the estimated memory usage includes the buffers for the transformed values.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute RSS values for the rows.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param num_groups Number of groups.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Options for `group_rss()`.
+ *
+ * @return Plan for `group_rss()` with the supplied arguments.
+ */
+template<typename Output_, typename Value_, typename Index_, class Transform_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const std::size_t num_groups, const Transform_& transform, const GroupRssOptions<Output_>& opt) {
+    (void)transform;
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = saturating_add(
+        otherdim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0) + (is_identity_transform<Transform_> ? 0 : sizeof(Output_))),
+        saturating_multiply(num_groups, 2 * sizeof(Output_) + sizeof(Index_))
+    );
+    if (opt.group_ordered) { // each thread only holds the non-zero counts, shifted sums and (for group_rss_interleaved()) the results for one group at a time.
+        model.running_buffer = dim * (sizeof(Value_) + (sparse ? 2 * sizeof(Index_) : 0) + (opt.shifted_sums ? 4 : 2) * sizeof(Output_));
+    } else {
+        const std::size_t per_group = (sparse ? sizeof(Index_) : 0) + (opt.shifted_sums ? 2 * sizeof(Output_) : 0);
+        model.running_buffer = saturating_add(dim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0)), saturating_multiply(num_groups, dim * per_group));
+        if (opt.deterministic) {
+            model.running_deterministic_node = deterministic_node_memory<Output_>(saturating_multiply(num_groups, 2), dim);
+        } else {
+            model.running_partial_all = saturating_multiply(num_groups, dim * sizeof(Output_));
+            model.running_partial_rest = saturating_multiply(num_groups, dim * sizeof(Output_));
+        }
+    }
+    return choose_plan(model, row, mat, opt);
+}
+
+/**
+ * Compute per-group residual sums of squares (RSS) for each element of a chosen dimension of a `tatami::Matrix`.
  *
  * @tparam Value_ Numeric type of the matrix value.
  * @tparam Index_ Integer type of the row/column indices.
@@ -509,14 +1231,58 @@ void group_rss(
     const Count_* const group_size,
     GroupRssBuffers<Output_>& output,
     const GroupRssOptions<Output_>& opt
+) {
+    group_rss(row, mat, group, num_groups, group_size, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute per-group residual sums of squares (RSS) of transformed values for each element of a chosen dimension of a `tatami::Matrix`.
+ * This is equivalent to calling the other `group_rss()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformation is performed inside the kernels to avoid a separate pass over each extracted row/column.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Count_ Numeric type of the group sizes, typically integer.
+ * @tparam Output_ Floating-point type of the output value.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute RSS values for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should be non-negative and less than `num_groups`.
+ * @param num_groups Number of groups in `group`.
+ * @param[in] group_size Pointer to an array of length equal to `num_groups`, containing the size of each group.
+ * @param[out] output Buffers in which to store the results.
+ * On output, each array stores the means and RSS values of the transformed values in the corresponding group.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Count_, typename Output_, class Transform_>
+void group_rss(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Count_* const group_size,
+    GroupRssBuffers<Output_>& output,
+    const Transform_& transform,
+    const GroupRssOptions<Output_>& opt
 ) {
     assert(sanisizer::is_equal(num_groups, output.mean.size()));
     assert(sanisizer::is_equal(num_groups, output.rss.size()));
-    if (mat.prefer_rows() == row) {
-        group_rss_direct(row, mat, group, num_groups, group_size, output, opt);
+    const auto cur_plan = plan(row, mat, num_groups, transform, opt);
+    trace_path(opt.tracer, "group_rss", cur_plan.running, mat.is_sparse(), false);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    reserve_workspace(opt.workspace, planned_opt.num_threads);
+    if (!cur_plan.running) {
+        group_rss_direct(row, mat, group, num_groups, group_size, output, transform, planned_opt);
     } else {
-        group_rss_running(row, mat, group, num_groups, group_size, output, opt);
+        group_rss_running<false>(row, mat, group, num_groups, group_size, output, transform, planned_opt);
     }
+    group_rss_unshift_means(mat, static_cast<Index_>(row ? mat.nrow() : mat.ncol()), group_size, output.mean, transform);
 }
 
 /**
@@ -546,13 +1312,119 @@ void group_rss(
     const std::size_t num_groups,
     GroupRssBuffers<Output_>& output,
     const GroupRssOptions<Output_>& opt
+) {
+    group_rss(row, mat, group, num_groups, output, IdentityTransform(), opt);
+}
+
+/**
+ * Overload that computes the group sizes before calling `group_rss()` with a transformation.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Output_ Floating-point type of the output value.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute RSS values for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should be non-negative and less than `num_groups`.
+ * @param num_groups Number of groups in `group`.
+ * @param[out] output Buffers in which to store the results.
+ * On output, each array stores the means and RSS values of the transformed values in the corresponding group.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_, class Transform_>
+void group_rss(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    GroupRssBuffers<Output_>& output,
+    const Transform_& transform,
+    const GroupRssOptions<Output_>& opt
 ) {
     auto group_size = sanisizer::create<std::vector<Index_> >(num_groups);
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
     for (Index_ o = 0; o < otherdim; ++o) {
         group_size[group[o]] += 1;
     }
-    group_rss(row, mat, group, num_groups, group_size.data(), output, opt);
+    group_rss(row, mat, group, num_groups, group_size.data(), output, transform, opt);
+}
+
+/**
+ * @cond
+ */
+// Computes the per-group means and RSS values for each tile of the target dimension, see stream_group_tiles().
+// 'finalize(start, length, means, rss)' is then called with 'num_groups' pointers to the means and RSS values for the tile, which it may modify in place.
+template<typename Value_, typename Index_, typename Group_, typename Count_, typename Output_, class Finalize_>
+void stream_group_rss(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Count_* const group_size,
+    const GroupRssOptions<Output_>& opt,
+    Finalize_ finalize
+) {
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    const auto tile_size = choose_tile_size<Output_>(dim, num_groups, 2, opt.tile_size, opt.max_memory_bytes);
+    auto tile_opt = opt;
+    tile_opt.max_memory_bytes = remaining_memory_bytes(opt.max_memory_bytes, saturating_multiply(num_groups, static_cast<std::size_t>(tile_size) * 2 * sizeof(Output_)));
+
+    stream_group_tiles<Output_>(row, mat, num_groups, 2, tile_size, [&](const tatami::Matrix<Value_, Index_>& tile, Index_ start, Index_ length, std::vector<std::vector<Output_*> >& buffers) -> void {
+        GroupRssBuffers<Output_> tile_buffers;
+        tile_buffers.mean = buffers[0];
+        tile_buffers.rss = buffers[1];
+        group_rss(row, tile, group, num_groups, group_size, tile_buffers, tile_opt);
+        finalize(start, length, buffers[0], buffers[1]);
+    });
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Overload of `group_rss()` that writes the per-group means and RSS values to `GroupSink`s.
+ * The target dimension is processed in tiles of `GroupRssOptions::tile_size` rows/columns, see `choose_tile_size()` for details.
+ * Each tile is computed by calling `group_rss()` on a `tatami::DelayedSubsetBlock` of `mat`.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Count_ Numeric type of the group sizes, typically integer.
+ * @tparam Output_ Floating-point type of the output value.
+ *
+ * @param row Whether to compute RSS values for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should be non-negative and less than `num_groups`.
+ * @param num_groups Number of groups in `group`.
+ * @param[in] group_size Pointer to an array of length equal to `num_groups`, containing the size of each group.
+ * @param sinks Destinations for the means and RSS values of each group.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Count_, typename Output_>
+void group_rss(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Count_* const group_size,
+    const GroupRssSinks<Output_, Index_>& sinks,
+    const GroupRssOptions<Output_>& opt
+) {
+    stream_group_rss(row, mat, group, num_groups, group_size, opt, [&](Index_ start, Index_ length, std::vector<Output_*>& means, std::vector<Output_*>& rss) -> void {
+        if (sinks.mean) {
+            sinks.mean->write(start, length, means);
+        }
+        if (sinks.rss) {
+            sinks.rss->write(start, length, rss);
+        }
+    });
 }
 
 /**
@@ -631,6 +1503,305 @@ GroupRssResult<Output_> group_rss(
     return output;
 }
 
+/**
+ * Overload of `group_rss()` that allocates memory for the results of the transformed values.
+ *
+ * @tparam Output_ Floating-point type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute RSS values for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ *
+ * @return RSS and mean of the transformed values in each group for each row/column.
+ */
+template<typename Output_, typename Value_, typename Index_, typename Group_, class Transform_> 
+GroupRssResult<Output_> group_rss(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Transform_& transform,
+    const GroupRssOptions<Output_>& opt
+) {
+    GroupRssResult<Output_> output;
+    sanisizer::resize(output.mean, num_groups);
+    sanisizer::resize(output.rss, num_groups);
+
+    GroupRssBuffers<Output_> buffers;
+    sanisizer::resize(buffers.mean, num_groups);
+    sanisizer::resize(buffers.rss, num_groups);
+
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        tatami::resize_container_to_Index_size(output.mean[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        buffers.mean[g] = output.mean[g].data();
+        tatami::resize_container_to_Index_size(output.rss[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        buffers.rss[g] = output.rss[g].data();
+    }
+
+    group_rss(row, mat, group, num_groups, buffers, transform, opt);
+    return output;
+}
+
+/**
+ * @brief Result buffers for `group_rss_interleaved()`.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ */
+template<typename Output_>
+struct GroupRssInterleavedBuffers {
+    /**
+     * Pointer to an array of length equal to the product of the number of groups and the appropriate dimension extent (rows for `row = true`, columns otherwise).
+     * After `group_rss_interleaved()`, the sample mean of row/column `d` for group `g` is stored in `mean[d * num_groups + g]`.
+     */
+    Output_* mean = NULL;
+
+    /**
+     * Pointer to an array of length equal to the product of the number of groups and the appropriate dimension extent (rows for `row = true`, columns otherwise).
+     * After `group_rss_interleaved()`, the residual sum of squares of row/column `d` for group `g` is stored in `rss[d * num_groups + g]`.
+     */
+    Output_* rss = NULL;
+};
+
+/**
+ * Compute per-group means and RSS values for each element of a chosen dimension of a `tatami::Matrix`, storing the results in an interleaved layout.
+ * This is equivalent to `group_rss()` except that the results for all groups of each row/column are stored contiguously,
+ * which is more cache-friendly for downstream applications that use all groups of a row/column together.
+ *
+ * Both the direct and running paths write directly to `output`.
+ * In the running path, the per-thread partial results for all groups are also stored in the interleaved layout,
+ * though the partial results for the blocks in `GroupRssOptions::deterministic` mode are still stored separately for each group.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Count_ Numeric type of the group sizes, typically integer.
+ * @tparam Output_ Floating-point type of the output value.
+ *
+ * @param row Whether to compute RSS values for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param[in] group_size Pointer to an array of length equal to `num_groups`, containing the size of each group.
+ * @param[out] output Buffers in which to store the results.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Count_, typename Output_>
+void group_rss_interleaved(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Count_* const group_size,
+    const GroupRssInterleavedBuffers<Output_>& output,
+    const GroupRssOptions<Output_>& opt
+) {
+    group_rss_interleaved(row, mat, group, num_groups, group_size, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute per-group means and RSS values of transformed values for each element of a chosen dimension of a `tatami::Matrix`, storing the results in an interleaved layout.
+ * This is equivalent to calling the other `group_rss_interleaved()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformation is performed inside the kernels to avoid a separate pass over each extracted row/column.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Count_ Numeric type of the group sizes, typically integer.
+ * @tparam Output_ Floating-point type of the output value.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute RSS values for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param[in] group_size Pointer to an array of length equal to `num_groups`, containing the size of each group.
+ * @param[out] output Buffers in which to store the results.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Count_, typename Output_, class Transform_>
+void group_rss_interleaved(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Count_* const group_size,
+    const GroupRssInterleavedBuffers<Output_>& output,
+    const Transform_& transform,
+    const GroupRssOptions<Output_>& opt
+) {
+    if (num_groups == 0) {
+        return;
+    }
+
+    const auto cur_plan = plan(row, mat, num_groups, transform, opt);
+    trace_path(opt.tracer, "group_rss", cur_plan.running, mat.is_sparse(), false);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    reserve_workspace(opt.workspace, planned_opt.num_threads);
+
+    GroupRssBuffers<Output_> buffers;
+    buffers.mean = interleaved_pointers(output.mean, num_groups);
+    buffers.rss = interleaved_pointers(output.rss, num_groups);
+    if (!cur_plan.running) {
+        group_rss_direct(row, mat, group, num_groups, group_size, buffers, transform, planned_opt, num_groups);
+    } else {
+        group_rss_running<true>(row, mat, group, num_groups, group_size, buffers, transform, planned_opt);
+    }
+    group_rss_unshift_means(mat, static_cast<Index_>(row ? mat.nrow() : mat.ncol()), group_size, buffers.mean, transform, num_groups);
+}
+
+/**
+ * @brief Results of `group_rss_interleaved()`.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ */
+template<typename Output_>
+struct GroupRssInterleavedResult {
+    /**
+     * Vector of length equal to the product of the number of groups and the appropriate dimension extent (rows for `row = true`, columns otherwise).
+     * The sample mean of row/column `d` for group `g` is stored at `d * num_groups + g`.
+     */
+    std::vector<Output_> mean;
+
+    /**
+     * Vector of length equal to the product of the number of groups and the appropriate dimension extent (rows for `row = true`, columns otherwise).
+     * The residual sum of squares of row/column `d` for group `g` is stored at `d * num_groups + g`.
+     */
+    std::vector<Output_> rss;
+};
+
+/**
+ * Overload of `group_rss_interleaved()` that computes the group sizes and allocates memory for the results.
+ *
+ * @tparam Output_ Floating-point type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ *
+ * @param row Whether to compute RSS values for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param opt Further options.
+ *
+ * @return RSS and mean of each group for each row/column.
+ */
+template<typename Output_, typename Value_, typename Index_, typename Group_> 
+GroupRssInterleavedResult<Output_> group_rss_interleaved(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const GroupRssOptions<Output_>& opt
+) {
+    auto group_size = sanisizer::create<std::vector<Index_> >(num_groups);
+    const auto otherdim = (row ? mat.ncol() : mat.nrow());
+    for (Index_ o = 0; o < otherdim; ++o) {
+        group_size[group[o]] += 1;
+    }
+
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    const auto total = sanisizer::product<typename std::vector<Output_>::size_type>(dim, num_groups);
+    GroupRssInterleavedResult<Output_> output;
+    output.mean = sanisizer::create<std::vector<Output_> >(total
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    output.rss = sanisizer::create<std::vector<Output_> >(total
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+
+    GroupRssInterleavedBuffers<Output_> buffers;
+    buffers.mean = output.mean.data();
+    buffers.rss = output.rss.data();
+    group_rss_interleaved(row, mat, group, num_groups, group_size.data(), buffers, opt);
+    return output;
+}
+
+/**
+ * Overload of `group_rss_interleaved()` that computes the group sizes and allocates memory for the results of the transformed values.
+ *
+ * @tparam Output_ Floating-point type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute RSS values for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ *
+ * @return RSS and mean of the transformed values in each group for each row/column.
+ */
+template<typename Output_, typename Value_, typename Index_, typename Group_, class Transform_> 
+GroupRssInterleavedResult<Output_> group_rss_interleaved(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Transform_& transform,
+    const GroupRssOptions<Output_>& opt
+) {
+    auto group_size = sanisizer::create<std::vector<Index_> >(num_groups);
+    const auto otherdim = (row ? mat.ncol() : mat.nrow());
+    for (Index_ o = 0; o < otherdim; ++o) {
+        group_size[group[o]] += 1;
+    }
+
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    const auto total = sanisizer::product<typename std::vector<Output_>::size_type>(dim, num_groups);
+    GroupRssInterleavedResult<Output_> output;
+    output.mean = sanisizer::create<std::vector<Output_> >(total
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    output.rss = sanisizer::create<std::vector<Output_> >(total
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+
+    GroupRssInterleavedBuffers<Output_> buffers;
+    buffers.mean = output.mean.data();
+    buffers.rss = output.rss.data();
+    group_rss_interleaved(row, mat, group, num_groups, group_size.data(), buffers, transform, opt);
+    return output;
+}
+
 }
 
 #endif
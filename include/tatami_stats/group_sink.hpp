@@ -0,0 +1,167 @@
+#ifndef TATAMI_STATS_GROUP_SINK_HPP
+#define TATAMI_STATS_GROUP_SINK_HPP
+
+#include <vector>
+#include <memory>
+#include <optional>
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "tatami/tatami.hpp"
+#include "sanisizer/sanisizer.hpp"
+
+#include "plan.hpp"
+
+/**
+ * @file group_sink.hpp
+ *
+ * @brief Stream grouped statistics to a user-defined destination.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @brief Destination for tiles of grouped statistics.
+ *
+ * For large numbers of groups, the `num_groups * dim` output arrays of functions like `group_sum()` may not fit in memory.
+ * Instead, the overloads that accept a `GroupSink` process the target dimension in tiles of consecutive rows/columns.
+ * The results for each tile are passed to `write()`, after which the memory is reused for the next tile.
+ * This allows applications to write the results directly to a memory-mapped file, a compressed store, etc.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * @tparam Index_ Integer type of the row/column indices.
+ */
+template<typename Output_, typename Index_>
+class GroupSink {
+public:
+    /**
+     * @cond
+     */
+    GroupSink() = default;
+    GroupSink(const GroupSink&) = delete;
+    GroupSink& operator=(const GroupSink&) = delete;
+    virtual ~GroupSink() = default;
+    /**
+     * @endcond
+     */
+
+    /**
+     * Receive the results for a tile of rows/columns of the target dimension.
+     * Tiles are written in order of increasing `start` from the calling thread, and together cover the entire target dimension.
+     *
+     * @param start Index of the first row/column in the tile.
+     * @param length Number of rows/columns in the tile.
+     * @param values Vector of length equal to the number of groups.
+     * Each element is a pointer to an array of length `length`, containing the statistic for the corresponding group at rows/columns `[start, start + length)`.
+     * These arrays are only valid for the duration of the call and will be overwritten by the next tile.
+     */
+    virtual void write(Index_ start, Index_ length, const std::vector<Output_*>& values) = 0;
+};
+
+/**
+ * @cond
+ */
+// Used to keep GroupSink subclasses away from the overloads that accept a transformation in the same position.
+template<typename Output_, typename Index_>
+std::true_type is_group_sink_test(const GroupSink<Output_, Index_>*);
+
+std::false_type is_group_sink_test(const void*);
+
+template<class Object_>
+constexpr bool is_group_sink = decltype(is_group_sink_test(std::declval<const Object_*>()))::value;
+
+// Default memory for the tile buffers when no memory limit is supplied.
+constexpr std::size_t GROUP_SINK_DEFAULT_TILE_BYTES = 64 * 1024 * 1024;
+/**
+ * @endcond
+ */
+
+/**
+ * Choose the number of rows/columns of the target dimension in each tile, for the overloads of grouped statistics that write to `GroupSink`s.
+ * Only the results for one tile are held in memory at any time, but the running path reads the entire matrix once per tile, so larger tiles are more efficient.
+ *
+ * If `tile_size` is non-zero, it is used directly.
+ * Otherwise, the tile size is chosen so that the buffers for each tile use half of `max_memory_bytes`, or 64 MiB if `max_memory_bytes` is not set.
+ * In both cases, the remainder of `max_memory_bytes` is used as the limit for computing the statistics in each tile.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param dim Extent of the target dimension.
+ * @param num_groups Number of groups.
+ * @param num_stats Number of statistics that are reported for each group, e.g., 2 for the mean and RSS.
+ * @param tile_size Requested number of rows/columns in each tile, usually from the `tile_size` member of the options.
+ * @param max_memory_bytes Maximum memory usage in bytes, usually from the `max_memory_bytes` member of the options.
+ *
+ * @return Number of rows/columns in each tile, no greater than `dim`.
+ */
+template<typename Output_, typename Index_>
+Index_ choose_tile_size(const Index_ dim, const std::size_t num_groups, const std::size_t num_stats, const std::size_t tile_size, const std::optional<std::size_t>& max_memory_bytes) {
+    std::size_t chosen = tile_size;
+    if (chosen == 0) {
+        const std::size_t available = (max_memory_bytes.has_value() ? *max_memory_bytes / 2 : GROUP_SINK_DEFAULT_TILE_BYTES);
+        const std::size_t per_element = std::max(saturating_multiply(saturating_multiply(num_groups, num_stats), sizeof(Output_)), static_cast<std::size_t>(1));
+        chosen = std::max(available / per_element, static_cast<std::size_t>(1));
+    }
+    return static_cast<Index_>(std::min(chosen, static_cast<std::size_t>(dim))); // cast is safe as the result is no greater than dim.
+}
+
+/**
+ * @cond
+ */
+// Memory limit for the kernel after accounting for the tile buffers.
+inline std::optional<std::size_t> remaining_memory_bytes(const std::optional<std::size_t>& max_memory_bytes, const std::size_t used) {
+    if (!max_memory_bytes.has_value()) {
+        return max_memory_bytes;
+    }
+    return (*max_memory_bytes > used ? *max_memory_bytes - used : 0);
+}
+
+// Call 'fun(tile, start, length, buffers)' for each tile of the target dimension, where 'tile' is a tatami::Matrix containing the rows/columns in '[start, start + length)'.
+// 'buffers' has one entry per statistic, each of which is a vector of 'num_groups' pointers to arrays of length 'length'.
+template<typename Output_, typename Value_, typename Index_, class Function_>
+void stream_group_tiles(
+    const bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const std::size_t num_groups,
+    const std::size_t num_stats,
+    const Index_ tile_size,
+    Function_ fun
+) {
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    if (dim == 0) {
+        return;
+    }
+
+    // Allocating the buffers once and reusing them for all tiles.
+    const std::size_t num_arrays = sanisizer::product<std::size_t>(num_groups, num_stats);
+    auto store = sanisizer::create<std::vector<Output_> >(sanisizer::product<std::size_t>(num_arrays, tile_size));
+    auto buffers = sanisizer::create<std::vector<std::vector<Output_*> > >(num_stats);
+    for (std::size_t s = 0; s < num_stats; ++s) {
+        auto& current = buffers[s];
+        current.reserve(num_groups);
+        for (std::size_t g = 0; g < num_groups; ++g) {
+            current.push_back(store.data() + (s * num_groups + g) * static_cast<std::size_t>(tile_size));
+        }
+    }
+
+    // Non-owning pointer to the matrix, for the subset wrapper.
+    std::shared_ptr<const tatami::Matrix<Value_, Index_> > ptr(std::shared_ptr<const tatami::Matrix<Value_, Index_> >(), &mat);
+
+    Index_ start = 0;
+    while (start < dim) {
+        const Index_ length = std::min(tile_size, static_cast<Index_>(dim - start));
+        const tatami::DelayedSubsetBlock<Value_, Index_> tile(ptr, start, length, row);
+        fun(static_cast<const tatami::Matrix<Value_, Index_>&>(tile), start, length, buffers);
+        start += length;
+    }
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
@@ -2,16 +2,23 @@
 #define TATAMI_STATS_GROUPED_SUMS_HPP
 
 #include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
 #include "sum.hpp"
+#include "group_sink.hpp"
+#include "small_groups.hpp"
+#include "transform.hpp"
 
 #include <vector>
+#include <array>
 #include <algorithm>
 #include <cstddef>
+#include <memory>
+#include <type_traits>
 
 #include "tatami/tatami.hpp"
 #include "sanisizer/sanisizer.hpp"
 #include "auveh/auveh.hpp"
-#include "jiwoo/jiwoo.hpp"
 
 /**
  * @file group_sum.hpp
@@ -36,39 +43,206 @@ struct GroupSumOptions {
      * See `tatami::parallelize()` for more details on the parallelization mechanism.
      */
     int num_threads = 1;
+
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Whether the running path should visit the other dimension in group order.
+     * If true, the rows/columns of the other dimension are sorted by group and extracted with an oracle, so that all rows/columns of one group are processed consecutively.
+     * The sums for each group then stay in cache until that group is finished, rather than switching between groups for every extracted row/column.
+     * Each thread processes a contiguous run of groups and writes directly to `output`, so no per-thread partial sums are required;
+     * however, if there are fewer groups than threads, some threads will be idle.
+     * This is most effective when the groups are interleaved along the other dimension and the matrix supports efficient access to arbitrary rows/columns.
+     * The results are also the same for any `num_threads`.
+     */
+    bool group_ordered = false;
+
+    /**
+     * Number of rows/columns of the target dimension in each tile, for the `group_sum()` overload that writes to a `GroupSink`.
+     * If zero, this is chosen automatically, see `choose_tile_size()` for details.
+     */
+    std::size_t tile_size = 0;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Workspace to reuse buffers across calls, see @ref common_options_workspace.
+     */
+    Workspace* workspace = NULL;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
 };
 
 /**
  * @cond
  */
-template<typename Value_, typename Index_, typename Group_, typename Output_>
+// Specialization of group_sum_direct() for small numbers of groups, see small_groups.hpp.
+template<std::size_t num_groups_, typename Value_, typename Index_, typename Group_, typename Output_, class Transform_>
+void group_sum_direct_small(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::vector<Index_>& group_size,
+    std::vector<Output_*>& output,
+    const Transform_& transform,
+    const GroupSumOptions& opt,
+    const std::size_t step
+) {
+    const Index_ otherdim = (row ? mat.ncol() : mat.nrow());
+
+    if (mat.sparse()) {
+        const auto zero = transformed_zero<Output_, Value_>(transform);
+        parallelize_vectors([&](int thread, Index_ start, Index_ len) -> void {
+            TraceScope tscope(opt.tracer, "group_sum", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, start, len, opt.prefetch, opt.executor);
+            std::vector<Value_> vholder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, vholder);
+            std::vector<Index_> iholder;
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, otherdim, iholder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+
+            for (Index_ x = 0; x < len; ++x) {
+                auto range = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                const auto vals = transform_values(transform, range.value, range.number, tbuffer, static_cast<Output_>(0));
+                const auto get_group = [&](Index_ j) -> std::size_t { return group[range.index[j]]; };
+                std::array<Output_, num_groups_> tmp{};
+                small_group_sums(tmp, vals, range.number, get_group, opt.skip_nan);
+
+                // Adding the contribution of the structural zeros in each group for transformations that don't preserve zero.
+                if constexpr(!transform_preserves_zero<Transform_>) {
+                    std::array<Index_, num_groups_> counts{};
+                    small_group_counts(counts, range.number, get_group);
+                    for (std::size_t g = 0; g < num_groups_; ++g) {
+                        tmp[g] += zero * static_cast<Output_>(group_size[g] - counts[g]);
+                    }
+                }
+
+                const std::size_t offset = static_cast<std::size_t>(start + x) * step;
+                for (std::size_t g = 0; g < num_groups_; ++g) {
+                    output[g][offset] = tmp[g];
+                }
+            }
+        }, mat, row, opt);
+
+    } else {
+        parallelize_vectors([&](int thread, Index_ start, Index_ len) -> void {
+            TraceScope tscope(opt.tracer, "group_sum", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, start, len, opt.prefetch, opt.executor);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, holder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+
+            for (Index_ x = 0; x < len; ++x) {
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer); });
+                const auto vals = transform_values(transform, ptr, otherdim, tbuffer, static_cast<Output_>(0));
+                std::array<Output_, num_groups_> tmp{};
+                small_group_sums(tmp, vals, otherdim, [&](Index_ j) -> std::size_t { return group[j]; }, opt.skip_nan);
+
+                const std::size_t offset = static_cast<std::size_t>(start + x) * step;
+                for (std::size_t g = 0; g < num_groups_; ++g) {
+                    output[g][offset] = tmp[g];
+                }
+            }
+        }, mat, row, opt);
+    }
+}
+
+// For the interleaved layout, each output[g] points to the start of group g's entries in the [dim][num_groups] array, so 'step' is the number of groups.
+template<typename Value_, typename Index_, typename Group_, typename Output_, class Transform_>
 void group_sum_direct(
     bool row,
     const tatami::Matrix<Value_, Index_>& mat,
     const Group_* group,
     const std::size_t num_groups,
     std::vector<Output_*>& output,
-    const GroupSumOptions& opt
+    const Transform_& transform,
+    const GroupSumOptions& opt,
+    const std::size_t step = 1
 ) {
-    const Index_ dim = (row ? mat.nrow() : mat.ncol());
     const Index_ otherdim = (row ? mat.ncol() : mat.nrow());
 
+    // Group sizes are only needed to add the contribution of the structural zeros for transformations that don't preserve zero.
+    std::vector<Index_> group_size;
+    if constexpr(!transform_preserves_zero<Transform_>) {
+        if (mat.sparse()) {
+            group_size.resize(sanisizer::cast<I<decltype(group_size.size())> >(num_groups));
+            for (Index_ o = 0; o < otherdim; ++o) {
+                ++group_size[group[o]];
+            }
+        }
+    }
+
+    const bool small = dispatch_small_groups(num_groups, [&](auto ngroups) -> void {
+        group_sum_direct_small<decltype(ngroups)::value>(row, mat, group, group_size, output, transform, opt, step);
+    });
+    if (small) {
+        return;
+    }
+
+    typedef TransformedValue<Value_, Output_, Transform_> Transformed;
+
     if (mat.sparse()) {
-        tatami::parallelize([&](int, Index_ start, Index_ len) -> void {
-            auto ext = tatami::consecutive_extractor<true>(mat, row, start, len);
-            auto xbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(otherdim);
-            auto tmp = sanisizer::create<std::vector<Output_> >(num_groups);
+        const auto zero = transformed_zero<Output_, Value_>(transform);
+        parallelize_vectors([&](int thread, Index_ start, Index_ len) -> void {
+            TraceScope tscope(opt.tracer, "group_sum", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, start, len, opt.prefetch, opt.executor);
+            std::vector<Value_> vholder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, vholder);
+            std::vector<Index_> iholder;
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, otherdim, iholder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            std::vector<Output_> sholder;
+            const auto tmp = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS, num_groups, sholder);
+            std::vector<Index_> cholder;
+            Index_* counts = NULL;
+            if constexpr(!transform_preserves_zero<Transform_>) {
+                counts = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS + 1, num_groups, cholder);
+            }
 
             for (Index_ x = 0; x < len; ++x) {
-                auto range = ext->fetch(xbuffer.data(), ibuffer.data());
-                std::fill(tmp.begin(), tmp.end(), static_cast<Output_>(0));
+                auto range = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                const auto vals = transform_values(transform, range.value, range.number, tbuffer, static_cast<Output_>(0));
+                std::fill_n(tmp, num_groups, static_cast<Output_>(0));
 
-                nanable_ifelse<Value_>(
+                nanable_ifelse<Transformed>(
                     opt.skip_nan,
                     [&]() -> void {
                         for (Index_ j = 0; j < range.number; ++j) {
-                            const auto val = range.value[j];
+                            const auto val = vals[j];
                             if (!std::isnan(val)) {
                                 tmp[group[range.index[j]]] += val;
                             }
@@ -76,32 +250,50 @@ void group_sum_direct(
                     },
                     [&]() -> void {
                         for (Index_ j = 0; j < range.number; ++j) {
-                            tmp[group[range.index[j]]] += range.value[j];
+                            tmp[group[range.index[j]]] += vals[j];
                         }
                     }
                 );
 
+                // Adding the contribution of the structural zeros in each group for transformations that don't preserve zero.
+                if constexpr(!transform_preserves_zero<Transform_>) {
+                    std::fill_n(counts, num_groups, 0);
+                    for (Index_ j = 0; j < range.number; ++j) {
+                        ++counts[group[range.index[j]]];
+                    }
+                    for (I<decltype(num_groups)> g = 0; g < num_groups; ++g) {
+                        tmp[g] += zero * static_cast<Output_>(group_size[g] - counts[g]);
+                    }
+                }
+
+                const std::size_t offset = static_cast<std::size_t>(start + x) * step;
                 for (I<decltype(num_groups)> g = 0; g < num_groups; ++g) {
-                    output[g][start + x] = tmp[g];
+                    output[g][offset] = tmp[g];
                 }
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
 
     } else {
-        tatami::parallelize([&](int, Index_ start, Index_ len) -> void {
-            auto ext = tatami::consecutive_extractor<false>(mat, row, start, len);
-            auto xbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            auto tmp = sanisizer::create<std::vector<Output_> >(num_groups);
+        parallelize_vectors([&](int thread, Index_ start, Index_ len) -> void {
+            TraceScope tscope(opt.tracer, "group_sum", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, start, len, opt.prefetch, opt.executor);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, holder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            std::vector<Output_> sholder;
+            const auto tmp = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS, num_groups, sholder);
 
             for (Index_ x = 0; x < len; ++x) {
-                auto ptr = ext->fetch(xbuffer.data());
-                std::fill(tmp.begin(), tmp.end(), static_cast<Output_>(0));
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer); });
+                const auto vals = transform_values(transform, ptr, otherdim, tbuffer, static_cast<Output_>(0));
+                std::fill_n(tmp, num_groups, static_cast<Output_>(0));
 
-                nanable_ifelse<Value_>(
+                nanable_ifelse<Transformed>(
                     opt.skip_nan,
                     [&]() -> void {
                         for (Index_ j = 0; j < otherdim; ++j) {
-                            const auto val = ptr[j];
+                            const auto val = vals[j];
                             if (!std::isnan(val)) {
                                 tmp[group[j]] += val;
                             }
@@ -109,62 +301,214 @@ void group_sum_direct(
                     },
                     [&]() -> void {
                         for (Index_ j = 0; j < otherdim; ++j) {
-                            tmp[group[j]] += ptr[j];
+                            tmp[group[j]] += vals[j];
                         }
                     }
                 );
 
+                const std::size_t offset = static_cast<std::size_t>(start + x) * step;
                 for (I<decltype(num_groups)> g = 0; g < num_groups; ++g) {
-                    output[g][start + x] = tmp[g];
+                    output[g][offset] = tmp[g];
                 }
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
     }
 }
 
-template<typename Value_, typename Index_, typename Group_, typename Output_>
-void group_sum_running(
+// Visits the other dimension in group order, see GroupSumOptions::group_ordered.
+// Each worker handles a contiguous run of groups, balanced by the group sizes, and accumulates directly into the output arrays.
+// For the interleaved layout, neighboring entries of the output array belong to groups that may be processed by different threads,
+// so each thread accumulates into a contiguous per-thread buffer and scatters the sums into the output once each group is finished.
+// This avoids false sharing of the output cache lines for every extracted row/column.
+template<bool interleaved_, typename Value_, typename Index_, typename Group_, typename Output_, class Transform_>
+void group_sum_ordered(
     bool row,
     const tatami::Matrix<Value_, Index_>& mat,
     const Group_* group,
     const std::size_t num_groups,
     std::vector<Output_*>& output,
+    const Transform_& transform,
     const GroupSumOptions& opt
 ) {
     const Index_ dim = (row ? mat.nrow() : mat.ncol());
     const Index_ otherdim = (row ? mat.ncol() : mat.nrow());
+
+    auto group_size = sanisizer::create<std::vector<Index_> >(num_groups);
+    for (Index_ o = 0; o < otherdim; ++o) {
+        ++group_size[group[o]];
+    }
+    auto group_starts = sanisizer::create<std::vector<Index_> >(sanisizer::sum<std::size_t>(num_groups, 1));
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        group_starts[g + 1] = group_starts[g] + group_size[g];
+    }
+    auto ordered = tatami::create_container_of_Index_size<std::vector<Index_> >(otherdim);
+    {
+        auto offsets = group_starts;
+        for (Index_ o = 0; o < otherdim; ++o) {
+            ordered[offsets[group[o]]++] = o;
+        }
+    }
+
+    const auto boundaries = partition_by_cost(num_groups, group_size.data(), opt.num_threads);
+    const bool is_sparse = mat.is_sparse();
+
+    // For sparse matrices, the transformed zero is subtracted from each non-zero value and added back at the end, as in sum_running().
+    typedef TransformedValue<Value_, Output_, Transform_> Transformed;
+    const auto zero = transformed_zero<Output_, Value_>(transform);
+
+    parallelize_by_boundaries([&](int thread, std::size_t gs, std::size_t gl) -> void {
+        TraceScope tscope(opt.tracer, "group_sum", "compute", thread);
+        const std::size_t step = (interleaved_ ? num_groups : 1);
+        std::vector<Output_> sholder;
+        Output_* sum_buffer = NULL;
+        if constexpr(interleaved_) {
+            sum_buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS, dim, sholder);
+        }
+        std::vector<Value_> vholder;
+        const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, vholder);
+        std::vector<Index_> iholder;
+        Index_* ibuffer = NULL;
+        if (is_sparse) {
+            ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, dim, iholder);
+        }
+
+        for (std::size_t g = gs, gend = gs + gl; g < gend; ++g) {
+            const Index_ gsize = group_size[g];
+            if (gsize == 0) {
+                fill_strided(output[g], dim, step, static_cast<Output_>(0));
+                continue;
+            }
+            const auto sum_ptr = (interleaved_ ? sum_buffer : output[g]);
+            std::fill_n(sum_ptr, dim, static_cast<Output_>(0));
+            std::shared_ptr<const tatami::Oracle<Index_> > oracle = std::make_shared<tatami::FixedViewOracle<Index_> >(ordered.data() + group_starts[g], static_cast<std::size_t>(gsize));
+
+            if (is_sparse) {
+                tatami::Options topt;
+                topt.sparse_ordered_index = false;
+                auto ext = prefetch_oracular_extractor<true>(mat, !row, std::move(oracle), opt.prefetch, opt.executor, topt);
+                for (Index_ x = 0; x < gsize; ++x) {
+                    auto range = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                    nanable_ifelse<Transformed>(
+                        opt.skip_nan,
+                        [&]() -> void {
+                            AUVEH_NODEP
+                            for (Index_ i = 0; i < range.number; ++i) {
+                                const auto val = transform_value(transform, range.value[i], zero);
+                                if (!std::isnan(val)) {
+                                    sum_ptr[range.index[i]] += val;
+                                } else if constexpr(!transform_preserves_zero<Transform_>) {
+                                    sum_ptr[range.index[i]] -= zero; // cancelling out the transformed zero that is added back for this skipped value.
+                                }
+                            }
+                        },
+                        [&]() -> void {
+                            AUVEH_NODEP
+                            for (Index_ i = 0; i < range.number; ++i) {
+                                sum_ptr[range.index[i]] += transform_value(transform, range.value[i], zero);
+                            }
+                        }
+                    );
+                }
+
+                if constexpr(!transform_preserves_zero<Transform_>) {
+                    const Output_ total_zero = zero * static_cast<Output_>(gsize);
+                    for (Index_ d = 0; d < dim; ++d) {
+                        sum_ptr[d] += total_zero;
+                    }
+                }
+
+            } else {
+                auto ext = prefetch_oracular_extractor<false>(mat, !row, std::move(oracle), opt.prefetch, opt.executor);
+                for (Index_ x = 0; x < gsize; ++x) {
+                    auto ptr = tscope.fetch([&]() { return ext->fetch(vbuffer); });
+                    nanable_ifelse<Transformed>(
+                        opt.skip_nan,
+                        [&]() -> void {
+                            AUVEH_NODEP
+                            for (Index_ d = 0; d < dim; ++d) {
+                                const auto val = transform_value(transform, ptr[d], static_cast<Output_>(0));
+                                if (!std::isnan(val)) {
+                                    sum_ptr[d] += val;
+                                }
+                            }
+                        },
+                        [&]() -> void {
+                            AUVEH_NODEP
+                            for (Index_ d = 0; d < dim; ++d) {
+                                sum_ptr[d] += transform_value(transform, ptr[d], static_cast<Output_>(0));
+                            }
+                        }
+                    );
+                }
+            }
+
+            if constexpr(interleaved_) {
+                for (Index_ d = 0; d < dim; ++d) {
+                    output[g][static_cast<std::size_t>(d) * step] = sum_ptr[d];
+                }
+            }
+        }
+    }, boundaries, opt.executor);
+}
+
+// As in group_sum_direct(), except that the stride is a template parameter so that the group-major loops are unchanged.
+// For the interleaved layout, the per-thread partial sums are also interleaved, so each thread only needs one array.
+template<bool interleaved_, typename Value_, typename Index_, typename Group_, typename Output_, class Transform_>
+void group_sum_running(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    std::vector<Output_*>& output,
+    const Transform_& transform,
+    const GroupSumOptions& opt
+) {
+    if (opt.group_ordered) {
+        group_sum_ordered<interleaved_>(row, mat, group, num_groups, output, transform, opt);
+        return;
+    }
+
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
     const bool is_sparse = mat.is_sparse();
 
     const auto do_parallel = opt.num_threads > 1;
-    std::optional<std::vector<std::optional<std::vector<Output_*> > > > all_partial_sums;
+    std::optional<PartialBuffers<Output_> > all_partial_sums;
     if (do_parallel) {
-        all_partial_sums.emplace(sanisizer::cast<I<decltype(all_partial_sums->size())> >(opt.num_threads - 1));
+        all_partial_sums.emplace(opt.workspace, WORKSPACE_PARTIAL, opt.num_threads, opt.allocator, (interleaved_ ? 1 : num_groups));
     }
-    jiwoo::Scope lib_all_sum(all_partial_sums); // RAII freeing of all threads' memory.
 
-    for (std::size_t g = 0; g < num_groups; ++g) {
-        std::fill_n(output[g], dim, 0);
+    if constexpr(interleaved_) {
+        std::fill_n(output[0], static_cast<std::size_t>(dim) * num_groups, 0);
+    } else {
+        for (std::size_t g = 0; g < num_groups; ++g) {
+            std::fill_n(output[g], dim, 0);
+        }
     }
 
-    const auto nused = tatami::parallelize([&](int thread, Index_ start, Index_ len) -> void {
-        // If we can, directly dump the sum to the output pointers, otherwise put it into a temporary.
-        std::optional<std::vector<Output_*> > cur_sums;
-        jiwoo::Scope libsum(cur_sums); // RAII freeing of this thread's memory.
+    // For sparse matrices, the transformed zero is subtracted from each non-zero value and added back at the end, as in sum_running().
+    typedef TransformedValue<Value_, Output_, Transform_> Transformed;
+    const auto zero = transformed_zero<Output_, Value_>(transform);
 
+    const auto nused = parallelize_vectors([&](int thread, Index_ start, Index_ len) -> void {
+        TraceScope tscope(opt.tracer, "group_sum", "compute", thread);
+        const std::size_t step = (interleaved_ ? num_groups : 1); // defined here so that it is a known constant for the group-major layout.
+
+        // If we can, directly dump the sum to the output pointers, otherwise put it into a temporary.
         Output_** sum_ptrs;
+        std::vector<Output_*> interleaved_ptrs;
         if (!do_parallel) {
             sum_ptrs = output.data();
         } else {
             if (thread == 0) {
                 sum_ptrs = output.data();
             } else {
-                cur_sums.emplace(sanisizer::cast<I<decltype(cur_sums->size())> >(num_groups));
-                for (std::size_t g = 0; g < num_groups; ++g) {
-                    auto ptr = new Output_ [dim]; // cast to size_t is safe due to the tatami contract.
-                    (*cur_sums)[g] = ptr;
-                    std::fill_n(ptr, dim, 0);
+                if constexpr(interleaved_) {
+                    interleaved_ptrs = interleaved_pointers(all_partial_sums->acquire(thread, static_cast<std::size_t>(dim) * num_groups)[0], num_groups);
+                    sum_ptrs = interleaved_ptrs.data();
+                } else {
+                    sum_ptrs = all_partial_sums->acquire(thread, dim);
                 }
-                sum_ptrs = cur_sums->data();
+                tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim) * num_groups);
             }
         }
 
@@ -173,78 +517,110 @@ void group_sum_running(
             // as addition order for each objective vector is already well-defined for a running calculation.
             tatami::Options topt;
             topt.sparse_ordered_index = false; 
-            auto ext = tatami::consecutive_extractor<true>(mat, !row, start, len, topt);
-            auto xbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
-            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
+            auto ext = prefetch_consecutive_extractor<true>(mat, !row, start, len, opt.prefetch, opt.executor, topt);
+            std::vector<Value_> vholder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, vholder);
+            std::vector<Index_> iholder;
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, dim, iholder);
 
             for (Index_ x = 0; x < len; ++x) {
-                auto range = ext->fetch(xbuffer.data(), ibuffer.data());
+                auto range = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
                 const auto sum_ptr = sum_ptrs[group[start + x]];
 
-                nanable_ifelse<Value_>(
+                nanable_ifelse<Transformed>(
                     opt.skip_nan,
                     [&]() -> void {
                         AUVEH_NODEP
                         for (Index_ i = 0; i < range.number; ++i) {
-                            const auto val = range.value[i];
+                            const auto val = transform_value(transform, range.value[i], zero);
                             if (!std::isnan(val)) {
-                                sum_ptr[range.index[i]] += val;
+                                sum_ptr[static_cast<std::size_t>(range.index[i]) * step] += val;
+                            } else if constexpr(!transform_preserves_zero<Transform_>) {
+                                sum_ptr[static_cast<std::size_t>(range.index[i]) * step] -= zero; // cancelling out the transformed zero that is added back for this skipped value.
                             }
                         }
                     },
                     [&]() -> void {
                         AUVEH_NODEP
                         for (Index_ i = 0; i < range.number; ++i) {
-                            sum_ptr[range.index[i]] += range.value[i];
+                            sum_ptr[static_cast<std::size_t>(range.index[i]) * step] += transform_value(transform, range.value[i], zero);
                         }
                     }
                 );
             }
 
         } else {
-            auto ext = tatami::consecutive_extractor<false>(mat, !row, start, len);
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
+            auto ext = prefetch_consecutive_extractor<false>(mat, !row, start, len, opt.prefetch, opt.executor);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, holder);
 
             for (Index_ x = 0; x < len; ++x) {
-                auto ptr = ext->fetch(buffer.data());
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer); });
                 const auto sum_ptr = sum_ptrs[group[start + x]];
 
-                nanable_ifelse<Value_>(
+                nanable_ifelse<Transformed>(
                     opt.skip_nan,
                     [&]() -> void {
                         AUVEH_NODEP
                         for (Index_ d = 0; d < dim; ++d) {
-                            const auto val = ptr[d];
+                            const auto val = transform_value(transform, ptr[d], static_cast<Output_>(0));
                             if (!std::isnan(val)) {
-                                sum_ptr[d] += val;
+                                sum_ptr[static_cast<std::size_t>(d) * step] += val;
                             }
                         }
                     },
                     [&]() -> void {
                         AUVEH_NODEP
                         for (Index_ d = 0; d < dim; ++d) {
-                            sum_ptr[d] += ptr[d];
+                            sum_ptr[static_cast<std::size_t>(d) * step] += transform_value(transform, ptr[d], static_cast<Output_>(0));
                         }
                     }
                 );
             }
         }
+    }, mat, !row, opt);
 
-        if (do_parallel) {
-            if (thread > 0) {
-                jiwoo::transfer(cur_sums, (*all_partial_sums)[thread - 1]);
+    if (do_parallel) {
+        parallelize_merge([&](Index_ start, Index_ length) -> void {
+            if constexpr(interleaved_) {
+                // All groups for the assigned rows/columns form a single contiguous range.
+                const std::size_t first = static_cast<std::size_t>(start) * num_groups, last = static_cast<std::size_t>(start + length) * num_groups;
+                const auto cur_out = output[0];
+                for (int u = 1; u < nused; ++u) {
+                    const auto cur_sum = all_partial_sums->get(u)[0];
+                    AUVEH_NODEP
+                    for (std::size_t k = first; k < last; ++k) {
+                        cur_out[k] += cur_sum[k];
+                    }
+                }
+            } else {
+                const Index_ end = start + length;
+                for (std::size_t g = 0; g < num_groups; ++g) {
+                    const auto cur_out = output[g];
+                    for (int u = 1; u < nused; ++u) {
+                        const auto cur_sum = all_partial_sums->get(u)[g];
+                        AUVEH_NODEP
+                        for (Index_ d = start; d < end; ++d) {
+                            cur_out[d] += cur_sum[d];
+                        }
+                    }
+                }
             }
-        }
-    }, otherdim, opt.num_threads);
+        }, dim, opt, "group_sum");
+    }
 
-    if (do_parallel) {
-        for (std::size_t g = 0; g < num_groups; ++g) {
-            const auto cur_out = output[g];
-            for (int u = 1; u < nused; ++u) {
-                const auto& cur_sum = (*((*all_partial_sums)[u - 1]))[g];
-                AUVEH_NODEP
+    if constexpr(!transform_preserves_zero<Transform_>) {
+        if (is_sparse) {
+            const Index_ otherdim = (row ? mat.ncol() : mat.nrow());
+            auto group_size = sanisizer::create<std::vector<Index_> >(num_groups);
+            for (Index_ o = 0; o < otherdim; ++o) {
+                ++group_size[group[o]];
+            }
+            const std::size_t step = (interleaved_ ? num_groups : 1);
+            for (std::size_t g = 0; g < num_groups; ++g) {
+                const Output_ total_zero = zero * static_cast<Output_>(group_size[g]);
                 for (Index_ d = 0; d < dim; ++d) {
-                    cur_out[d] += cur_sum[d];
+                    output[g][static_cast<std::size_t>(d) * step] += total_zero;
                 }
             }
         }
@@ -254,6 +630,66 @@ void group_sum_running(
  * @endcond
  */
 
+/**
+ * Plan the computation of `group_sum()`, see `Plan` for details.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute the group-wise sums for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param num_groups Number of groups.
+ * @param opt Options for `group_sum()`.
+ *
+ * @return Plan for `group_sum()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `GroupSumOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Output_ = double, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const std::size_t num_groups, const GroupSumOptions& opt) {
+    return plan<Output_>(row, mat, num_groups, IdentityTransform(), opt);
+}
+
+/**
+ * Plan the computation of `group_sum()` with a transformation, see `Plan` for details.
+ * This is the same as the other `plan()` overload, except that the estimated memory usage includes the buffers for the transformed values.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the group-wise sums for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param num_groups Number of groups.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Options for `group_sum()`.
+ *
+ * @return Plan for `group_sum()` with the supplied arguments.
+ */
+template<typename Output_ = double, typename Value_, typename Index_, class Transform_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const std::size_t num_groups, const Transform_& transform, const GroupSumOptions& opt) {
+    (void)transform;
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = saturating_add(
+        otherdim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0) + (is_identity_transform<Transform_> ? 0 : sizeof(Output_))),
+        saturating_multiply(num_groups, sizeof(Output_))
+    );
+    model.running_buffer = dim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0));
+    if (opt.group_ordered) { // each thread accumulates directly into the output arrays, or into a buffer for one group at a time for group_sum_interleaved().
+        model.running_buffer += dim * sizeof(Output_);
+    } else {
+        model.running_partial_rest = saturating_multiply(num_groups, dim * sizeof(Output_));
+    }
+    return choose_plan(model, row, mat, opt);
+}
+
 /**
  * Compute per-group sums for each element of a chosen dimension of a `tatami::Matrix`.
  *
@@ -285,10 +721,55 @@ void group_sum(
     std::vector<Output_*>& output,
     const GroupSumOptions& opt
 ) {
-    if (mat.prefer_rows() == row) {
-        group_sum_direct(row, mat, group, num_groups, output, opt);
+    group_sum(row, mat, group, num_groups, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute per-group sums of transformed values for each element of a chosen dimension of a `tatami::Matrix`.
+ * This is equivalent to calling the other `group_sum()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformation is performed inside the summation loops to avoid a separate pass over each extracted row/column.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row.
+ * @tparam Output_ Numeric type of the output value.
+ * It is assumed that this is large enough to store the sums. 
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute group-wise sums within each row.
+ * If false, sums are computed within the column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * This can be determined by calling `tatami_stats::total_groups()` on `group`.
+ * @param[out] output Vector of length equal to the number of groups.
+ * Each element is a pointer to an array of length equal to the number of rows (if `row = true`) or columns (otherwise).
+ * On output, each array will contain the row/column sums of the transformed values for the corresponding group. 
+ * @param transform Transformation to apply to each matrix value.
+ * If `GroupSumOptions::skip_nan = true`, NaNs are skipped after the transformation.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_, class Transform_>
+void group_sum(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    std::vector<Output_*>& output,
+    const Transform_& transform,
+    const GroupSumOptions& opt
+) {
+    const auto cur_plan = plan<Output_>(row, mat, num_groups, transform, opt);
+    trace_path(opt.tracer, "group_sum", cur_plan.running, mat.is_sparse(), opt.skip_nan);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    reserve_workspace(opt.workspace, planned_opt.num_threads);
+    if (!cur_plan.running) {
+        group_sum_direct(row, mat, group, num_groups, output, transform, planned_opt);
     } else {
-        group_sum_running(row, mat, group, num_groups, output, opt);
+        group_sum_running<false>(row, mat, group, num_groups, output, transform, planned_opt);
     }
 }
 
@@ -338,6 +819,273 @@ std::vector<std::vector<Output_> > group_sum(
     return output;
 }
 
+/**
+ * Overload of `group_sum()` that allocates memory for the output sums of transformed values.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * It is assumed that this is large enough to store the sums. 
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ * This should not be a `GroupSink`, which is handled by the other overload.
+ *
+ * @param row Whether to compute group-wise sums within each row.
+ * If false, sums are computed within the column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * This can be determined by calling `tatami_stats::total_groups()` on `group`.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ *
+ * @return Vector of length equal to the number of groups.
+ * Each element is a vector of length equal to the number of rows (if `row = true`) or columns (otherwise),
+ * containing the row/column sums of the transformed values for the corresponding group. 
+ */
+template<typename Output_ = double, typename Value_, typename Index_, typename Group_, class Transform_, typename = std::enable_if_t<!is_group_sink<Transform_> > >
+std::vector<std::vector<Output_> > group_sum(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    const Transform_& transform,
+    const GroupSumOptions& opt
+) {
+    auto output = sanisizer::create<std::vector<std::vector<Output_> > >(num_groups);
+    auto ptrs = sanisizer::create<std::vector<Output_*> >(num_groups);
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        tatami::resize_container_to_Index_size(output[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        ptrs[g] = output[g].data();
+    }
+    group_sum(row, mat, group, num_groups, ptrs, transform, opt);
+    return output;
+}
+
+/**
+ * Compute per-group sums for each element of a chosen dimension of a `tatami::Matrix`, storing the results in an interleaved layout.
+ * This is equivalent to `group_sum()` except that the sums for all groups of each row/column are stored contiguously.
+ * The direct path then writes one contiguous array per row/column, and the running path accumulates all groups of each row/column in the same cache lines.
+ * This layout is also more cache-friendly for downstream applications that use all groups of a row/column together.
+ *
+ * For dense matrices, the running path accumulates each row/column of the other dimension into strided entries of `output`,
+ * which is less efficient than the contiguous updates of the group-major layout when there are many groups.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row.
+ * @tparam Output_ Numeric type of the output value.
+ * It is assumed that this is large enough to store the sums. 
+ *
+ * @param row Whether to compute group-wise sums within each row.
+ * If false, sums are computed within the column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * This can be determined by calling `tatami_stats::total_groups()` on `group`.
+ * @param[out] output Pointer to an array of length equal to the product of \f$N\f$ and the number of rows (if `row = true`) or columns (otherwise).
+ * On output, the sum for group `g` in row/column `d` is stored in `output[d * num_groups + g]`.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_>
+void group_sum_interleaved(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    Output_* output,
+    const GroupSumOptions& opt
+) {
+    group_sum_interleaved(row, mat, group, num_groups, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute per-group sums of transformed values for each element of a chosen dimension of a `tatami::Matrix`, storing the results in an interleaved layout.
+ * This is equivalent to calling the other `group_sum_interleaved()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformation is performed inside the summation loops to avoid a separate pass over each extracted row/column.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row.
+ * @tparam Output_ Numeric type of the output value.
+ * It is assumed that this is large enough to store the sums. 
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute group-wise sums within each row.
+ * If false, sums are computed within the column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * This can be determined by calling `tatami_stats::total_groups()` on `group`.
+ * @param[out] output Pointer to an array of length equal to the product of \f$N\f$ and the number of rows (if `row = true`) or columns (otherwise).
+ * On output, the sum of transformed values for group `g` in row/column `d` is stored in `output[d * num_groups + g]`.
+ * @param transform Transformation to apply to each matrix value.
+ * If `GroupSumOptions::skip_nan = true`, NaNs are skipped after the transformation.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_, class Transform_>
+void group_sum_interleaved(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    Output_* output,
+    const Transform_& transform,
+    const GroupSumOptions& opt
+) {
+    if (num_groups == 0) {
+        return;
+    }
+
+    const auto cur_plan = plan<Output_>(row, mat, num_groups, transform, opt);
+    trace_path(opt.tracer, "group_sum", cur_plan.running, mat.is_sparse(), opt.skip_nan);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    reserve_workspace(opt.workspace, planned_opt.num_threads);
+    auto ptrs = interleaved_pointers(output, num_groups);
+    if (!cur_plan.running) {
+        group_sum_direct(row, mat, group, num_groups, ptrs, transform, planned_opt, num_groups);
+    } else {
+        group_sum_running<true>(row, mat, group, num_groups, ptrs, transform, planned_opt);
+    }
+}
+
+/**
+ * Overload of `group_sum_interleaved()` that allocates memory for the output sums.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * It is assumed that this is large enough to store the sums. 
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row.
+ *
+ * @param row Whether to compute group-wise sums within each row.
+ * If false, sums are computed within the column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * This can be determined by calling `tatami_stats::total_groups()` on `group`.
+ * @param opt Further options.
+ *
+ * @return Vector of length equal to the product of \f$N\f$ and the number of rows (if `row = true`) or columns (otherwise).
+ * The sum for group `g` in row/column `d` is stored at `d * num_groups + g`.
+ */
+template<typename Output_ = double, typename Value_, typename Index_, typename Group_>
+std::vector<Output_> group_sum_interleaved(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    const GroupSumOptions& opt
+) {
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    auto output = sanisizer::create<std::vector<Output_> >(sanisizer::product<typename std::vector<Output_>::size_type>(dim, num_groups)
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    group_sum_interleaved(row, mat, group, num_groups, output.data(), opt);
+    return output;
+}
+
+/**
+ * Overload of `group_sum_interleaved()` that allocates memory for the output sums of transformed values.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * It is assumed that this is large enough to store the sums. 
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute group-wise sums within each row.
+ * If false, sums are computed within the column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * This can be determined by calling `tatami_stats::total_groups()` on `group`.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ *
+ * @return Vector of length equal to the product of \f$N\f$ and the number of rows (if `row = true`) or columns (otherwise).
+ * The sum of transformed values for group `g` in row/column `d` is stored at `d * num_groups + g`.
+ */
+template<typename Output_ = double, typename Value_, typename Index_, typename Group_, class Transform_>
+std::vector<Output_> group_sum_interleaved(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    const Transform_& transform,
+    const GroupSumOptions& opt
+) {
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    auto output = sanisizer::create<std::vector<Output_> >(sanisizer::product<typename std::vector<Output_>::size_type>(dim, num_groups)
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    group_sum_interleaved(row, mat, group, num_groups, output.data(), transform, opt);
+    return output;
+}
+
+/**
+ * Overload of `group_sum()` that writes the per-group sums to a `GroupSink`.
+ * The target dimension is processed in tiles of `GroupSumOptions::tile_size` rows/columns, see `choose_tile_size()` for details.
+ * Each tile is computed by calling `group_sum()` on a `tatami::DelayedSubsetBlock` of `mat`.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row.
+ * @tparam Output_ Numeric type of the output value.
+ * It is assumed that this is large enough to store the sums. 
+ *
+ * @param row Whether to compute group-wise sums within each row.
+ * If false, sums are computed within the column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * This can be determined by calling `tatami_stats::total_groups()` on `group`.
+ * @param sink Destination for the row/column sums of each group.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_>
+void group_sum(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* group,
+    const std::size_t num_groups,
+    GroupSink<Output_, Index_>& sink,
+    const GroupSumOptions& opt
+) {
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    const auto tile_size = choose_tile_size<Output_>(dim, num_groups, 1, opt.tile_size, opt.max_memory_bytes);
+    auto tile_opt = opt;
+    tile_opt.max_memory_bytes = remaining_memory_bytes(opt.max_memory_bytes, saturating_multiply(num_groups, static_cast<std::size_t>(tile_size) * sizeof(Output_)));
+
+    stream_group_tiles<Output_>(row, mat, num_groups, 1, tile_size, [&](const tatami::Matrix<Value_, Index_>& tile, Index_ start, Index_ length, std::vector<std::vector<Output_*> >& buffers) -> void {
+        group_sum(row, tile, group, num_groups, buffers[0], tile_opt);
+        sink.write(start, length, buffers[0]);
+    });
+}
+
 }
 
 #endif
@@ -14,6 +14,8 @@
 
 #include "group_rss.hpp"
 #include "skip_nan/group_rss.hpp"
+#include "group_sink.hpp"
+#include "transform.hpp"
 #include "utils.hpp"
 
 /**
@@ -42,6 +44,72 @@ struct GroupVarianceOptions {
      */
     int num_threads = 1;
 
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Whether the running path should give the same results for any `num_threads`, see `GroupRssOptions::deterministic` for details.
+     */
+    bool deterministic = false;
+
+    /**
+     * Whether the running path should accumulate shifted sums instead of using Welford's algorithm, see `shifted_rss.hpp` for details.
+     * This avoids a division for each element, at the cost of two more arrays per group of length equal to the number of rows/columns in each thread.
+     * Ignored if `skip_nan = true`.
+     */
+    bool shifted_sums = false;
+
+    /**
+     * Whether the running path should visit the other dimension in group order, see `GroupRssOptions::group_ordered` for details.
+     * Ignored if `skip_nan = true`.
+     */
+    bool group_ordered = false;
+
+    /**
+     * Number of rows/columns of the target dimension in each tile, for the `group_variance()` overload that writes to `GroupVarianceSinks`.
+     * If zero, this is chosen automatically, see `choose_tile_size()` for details.
+     */
+    std::size_t tile_size = 0;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Workspace to reuse buffers across calls, see @ref common_options_workspace.
+     */
+    Workspace* workspace = NULL;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+
     /**
      * Placeholder value to use for the mean when the extent of the relevant dimension is zero.
      * This is NaN if supported by `Output_`, otherwise zero.
@@ -77,6 +145,70 @@ struct GroupVarianceBuffers {
     std::vector<Output_*> variance;
 };
 
+/**
+ * @brief Destinations for the results of `group_variance()`.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Index_ Integer type of the row/column indices.
+ */
+template<typename Output_, typename Index_>
+struct GroupVarianceSinks {
+    /**
+     * Destination for the sample mean of each row/column in each group.
+     * If NULL, the means are not reported.
+     */
+    GroupSink<Output_, Index_>* mean = NULL;
+
+    /**
+     * Destination for the sample variance of each row/column in each group.
+     * If NULL, the variances are not reported.
+     */
+    GroupSink<Output_, Index_>* variance = NULL;
+};
+
+/**
+ * @cond
+ */
+template<typename Output_>
+GroupRssOptions<Output_> group_variance_rss_options(const GroupVarianceOptions<Output_>& opt) {
+    GroupRssOptions<Output_> ropt;
+    ropt.num_threads = opt.num_threads;
+    ropt.balance_nonzeros = opt.balance_nonzeros;
+    ropt.executor = opt.executor;
+    ropt.tracer = opt.tracer;
+    ropt.max_memory_bytes = opt.max_memory_bytes;
+    ropt.strategy = opt.strategy;
+    ropt.deterministic = opt.deterministic;
+    ropt.shifted_sums = opt.shifted_sums;
+    ropt.group_ordered = opt.group_ordered;
+    ropt.tile_size = opt.tile_size;
+    ropt.prefetch = opt.prefetch;
+    ropt.workspace = opt.workspace;
+    ropt.allocator = opt.allocator;
+    return ropt;
+}
+
+// Converts the RSS values for the first 'length' elements of each group into variances, in place.
+template<typename Output_, typename Count_, typename Index_>
+void group_rss_to_variance(const std::vector<Output_*>& rss, const Count_* const group_size, const Index_ length, const Output_ variance_placeholder) {
+    const std::size_t num_groups = rss.size();
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        const auto outvar = rss[g];
+        const auto gsize = group_size[g];
+        if (gsize <= 1) {
+            std::fill_n(outvar, length, variance_placeholder);
+        } else {
+            AUVEH_NODEP
+            for (Index_ d = 0; d < length; ++d) {
+                outvar[d] /= gsize - 1;
+            }
+        }
+    }
+}
+/**
+ * @endcond
+ */
+
 /**
  * Compute per-group variances for each element of a chosen dimension of a `tatami::Matrix`.
  *
@@ -106,12 +238,51 @@ void group_variance(
     const Count_* const group_size,
     GroupVarianceBuffers<Output_>& output,
     const GroupVarianceOptions<Output_>& opt
+) {
+    group_variance(row, mat, group, num_groups, group_size, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute per-group variances of transformed values for each element of a chosen dimension of a `tatami::Matrix`.
+ * This is equivalent to calling the other `group_variance()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformation is performed inside the kernels to avoid a separate pass over each extracted row/column.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Count_ Numeric type of the group sizes, typically integer.
+ * @tparam Output_ Floating-point type of the output value.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute variances for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param[in] group_size Pointer to an array of length equal to `num_groups`, containing the size of each group.
+ * @param[out] output Buffers in which to store the results.
+ * On output, each array stores the means and variances of the transformed values in the corresponding group.
+ * @param transform Transformation to apply to each matrix value.
+ * If `GroupVarianceOptions::skip_nan = true`, NaNs are skipped after the transformation.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Count_, typename Output_, class Transform_>
+void group_variance(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Count_* const group_size,
+    GroupVarianceBuffers<Output_>& output,
+    const Transform_& transform,
+    const GroupVarianceOptions<Output_>& opt
 ) {
     assert(sanisizer::is_equal(num_groups, output.mean.size()));
     assert(sanisizer::is_equal(num_groups, output.variance.size()));
     const auto dim = (row ? mat.nrow() : mat.ncol());
 
-    nanable_ifelse<Value_>(
+    nanable_ifelse<TransformedValue<Value_, Output_, Transform_> >(
         opt.skip_nan,
 
         [&]() -> void {
@@ -119,19 +290,31 @@ void group_variance(
             tmp.mean = output.mean;
             tmp.rss = output.variance;
 
-            auto count = sanisizer::create<std::vector<std::vector<Index_> > >(num_groups);
+            // The non-NaN counts for all groups are stored contiguously, with 'dim' entries per group.
+            const std::size_t dim_size = dim; // cast is safe due to the tatami contract.
+            std::vector<Index_> cholder;
+            reserve_workspace(opt.workspace, 1);
+            const auto count = workspace_buffer(opt.workspace, 0, WORKSPACE_CALLER, sanisizer::product<std::size_t>(num_groups, dim_size), cholder);
             tmp.count.reserve(num_groups);
             for (std::size_t g = 0; g < num_groups; ++g) {
-                tatami::resize_container_to_Index_size(count[g], dim);
-                tmp.count.push_back(count[g].data());
+                tmp.count.push_back(count + g * dim_size);
             }
 
             skip_nan::GroupRssOptions ropt;
             ropt.num_threads = opt.num_threads;
-            skip_nan::group_rss(row, mat, group, num_groups, tmp, ropt);
+            ropt.balance_nonzeros = opt.balance_nonzeros;
+            ropt.executor = opt.executor;
+            ropt.tracer = opt.tracer;
+            ropt.max_memory_bytes = opt.max_memory_bytes;
+            ropt.strategy = opt.strategy;
+            ropt.deterministic = opt.deterministic;
+            ropt.prefetch = opt.prefetch;
+            ropt.workspace = opt.workspace;
+            ropt.allocator = opt.allocator;
+            skip_nan::group_rss(row, mat, group, num_groups, tmp, transform, ropt);
             for (std::size_t g = 0; g < num_groups; ++g) {
                 const auto outvar = output.variance[g];
-                const auto curcounts = count[g];
+                const auto curcounts = tmp.count[g];
                 AUVEH_NODEP
                 for (Index_ d = 0; d < dim; ++d) {
                     if (curcounts[d] <= 1) {
@@ -147,23 +330,8 @@ void group_variance(
             GroupRssBuffers<Output_> tmp;
             tmp.mean = output.mean;
             tmp.rss = output.variance;
-
-            GroupRssOptions ropt;
-            ropt.num_threads = opt.num_threads;
-            group_rss(row, mat, group, num_groups, group_size, tmp, ropt);
-
-            for (std::size_t g = 0; g < num_groups; ++g) {
-                const auto outvar = output.variance[g];
-                const auto gsize = group_size[g];
-                if (gsize <= 1) {
-                    std::fill_n(outvar, dim, opt.variance_placeholder);
-                } else {
-                    AUVEH_NODEP
-                    for (Index_ d = 0; d < dim; ++d) {
-                        outvar[d] /= gsize - 1;
-                    }
-                }
-            }
+            group_rss(row, mat, group, num_groups, group_size, tmp, transform, group_variance_rss_options(opt));
+            group_rss_to_variance(output.variance, group_size, dim, opt.variance_placeholder);
         }
     );
 }
@@ -194,13 +362,115 @@ void group_variance(
     const std::size_t num_groups,
     GroupVarianceBuffers<Output_>& output,
     const GroupVarianceOptions<Output_>& opt
+) {
+    group_variance(row, mat, group, num_groups, output, IdentityTransform(), opt);
+}
+
+/**
+ * Overload that computes the group sizes before calling `group_variance()` with a transformation.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Output_ Floating-point type of the output value.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute variances for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param[out] output Buffers in which to store the results.
+ * On output, each array stores the means and variances of the transformed values in the corresponding group.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_, class Transform_>
+void group_variance(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    GroupVarianceBuffers<Output_>& output,
+    const Transform_& transform,
+    const GroupVarianceOptions<Output_>& opt
 ) {
     auto group_size = sanisizer::create<std::vector<Index_> >(num_groups);
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
     for (Index_ o = 0; o < otherdim; ++o) {
         group_size[group[o]] += 1;
     }
-    group_variance(row, mat, group, num_groups, group_size.data(), output, opt);
+    group_variance(row, mat, group, num_groups, group_size.data(), output, transform, opt);
+}
+
+/**
+ * Overload of `group_variance()` that writes the per-group means and variances to `GroupSink`s.
+ * The target dimension is processed in tiles of `GroupVarianceOptions::tile_size` rows/columns, see `choose_tile_size()` for details.
+ * If `GroupVarianceOptions::skip_nan = false`, this uses the same tiles as the `group_rss()` overload for `GroupRssSinks`, converting the RSS values of each tile into variances before they are written.
+ * Otherwise, each tile is computed by calling `group_variance()` on a `tatami::DelayedSubsetBlock` of `mat`.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Count_ Numeric type of the group sizes, typically integer.
+ * @tparam Output_ Floating-point type of the output value.
+ *
+ * @param row Whether to compute variances for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param[in] group_size Pointer to an array of length equal to `num_groups`, containing the size of each group.
+ * @param sinks Destinations for the means and variances of each group.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Count_, typename Output_>
+void group_variance(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Count_* const group_size,
+    const GroupVarianceSinks<Output_, Index_>& sinks,
+    const GroupVarianceOptions<Output_>& opt
+) {
+    const auto write = [&](Index_ start, Index_ length, const std::vector<Output_*>& means, const std::vector<Output_*>& variances) -> void {
+        if (sinks.mean) {
+            sinks.mean->write(start, length, means);
+        }
+        if (sinks.variance) {
+            sinks.variance->write(start, length, variances);
+        }
+    };
+
+    nanable_ifelse<Value_>(
+        opt.skip_nan,
+
+        [&]() -> void {
+            // The variances depend on the per-element counts of non-NaN values, so we compute them directly for each tile.
+            const Index_ dim = (row ? mat.nrow() : mat.ncol());
+            const auto tile_size = choose_tile_size<Output_>(dim, num_groups, 2, opt.tile_size, opt.max_memory_bytes);
+            auto tile_opt = opt;
+            tile_opt.max_memory_bytes = remaining_memory_bytes(opt.max_memory_bytes, saturating_multiply(num_groups, static_cast<std::size_t>(tile_size) * 2 * sizeof(Output_)));
+
+            stream_group_tiles<Output_>(row, mat, num_groups, 2, tile_size, [&](const tatami::Matrix<Value_, Index_>& tile, Index_ start, Index_ length, std::vector<std::vector<Output_*> >& buffers) -> void {
+                GroupVarianceBuffers<Output_> tile_buffers;
+                tile_buffers.mean = buffers[0];
+                tile_buffers.variance = buffers[1];
+                group_variance(row, tile, group, num_groups, group_size, tile_buffers, tile_opt);
+                write(start, length, buffers[0], buffers[1]);
+            });
+        },
+
+        [&]() -> void {
+            stream_group_rss(row, mat, group, num_groups, group_size, group_variance_rss_options(opt), [&](Index_ start, Index_ length, std::vector<Output_*>& means, std::vector<Output_*>& rss) -> void {
+                group_rss_to_variance(rss, group_size, length, opt.variance_placeholder);
+                write(start, length, means, rss);
+            });
+        }
+    );
 }
 
 /**
@@ -279,6 +549,63 @@ GroupVarianceResult<Output_> group_variance(
     return output;
 }
 
+/**
+ * Overload of `group_variance()` that allocates memory for the results of the transformed values.
+ *
+ * @tparam Output_ Floating-point type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute variances for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ *
+ * @return Variance and mean of the transformed values in each group for each row/column.
+ */
+template<typename Output_ = double, typename Value_, typename Index_, typename Group_, class Transform_> 
+GroupVarianceResult<Output_> group_variance(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Transform_& transform,
+    const GroupVarianceOptions<Output_>& opt
+) {
+    GroupVarianceResult<Output_> output;
+    sanisizer::resize(output.mean, num_groups);
+    sanisizer::resize(output.variance, num_groups);
+
+    GroupVarianceBuffers<Output_> buffers;
+    sanisizer::resize(buffers.mean, num_groups);
+    sanisizer::resize(buffers.variance, num_groups);
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        tatami::resize_container_to_Index_size(output.mean[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        buffers.mean[g] = output.mean[g].data();
+        tatami::resize_container_to_Index_size(output.variance[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        buffers.variance[g] = output.variance[g].data();
+    }
+
+    group_variance(row, mat, group, num_groups, buffers, transform, opt);
+    return output;
+}
+
 }
 
 #endif
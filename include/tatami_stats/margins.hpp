@@ -0,0 +1,535 @@
+#ifndef TATAMI_STATS_MARGINS_HPP
+#define TATAMI_STATS_MARGINS_HPP
+
+#include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <optional>
+#include <cmath>
+#include <cstddef>
+
+#include "tatami/tatami.hpp"
+#include "sanisizer/sanisizer.hpp"
+#include "quickstats/quickstats.hpp"
+
+/**
+ * @file margins.hpp
+ *
+ * @brief Compute row and column statistics in a single pass through a `tatami::Matrix`.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @brief Options for `margins()`.
+ * @tparam Output_ Floating-point type of the output data.
+ */
+template<typename Output_ = double>
+struct MarginsOptions {
+    /**
+     * Whether to check for NaNs in the input, and skip them.
+     * If false, NaNs are assumed to be absent, and the behavior of the calculations in the presence of NaNs is undefined.
+     */
+    bool skip_nan = false;
+
+    /**
+     * Whether to compute the sum of each row/column.
+     * Only used in the `margins()` overload that allocates the output vectors.
+     */
+    bool compute_sum = true;
+
+    /**
+     * Whether to count the number of non-zero values in each row/column.
+     * Only used in the `margins()` overload that allocates the output vectors.
+     */
+    bool compute_count = false;
+
+    /**
+     * Whether to compute the mean of each row/column.
+     * Only used in the `margins()` overload that allocates the output vectors.
+     */
+    bool compute_mean = false;
+
+    /**
+     * Whether to compute the variance of each row/column.
+     * Only used in the `margins()` overload that allocates the output vectors.
+     */
+    bool compute_variance = false;
+
+    /**
+     * Number of threads to use when iterating over a `tatami::Matrix`.
+     * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     */
+    int num_threads = 1;
+
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Workspace to reuse buffers across calls, see @ref common_options_workspace.
+     */
+    Workspace* workspace = NULL;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+
+    /**
+     * Placeholder value to use for the mean when there are no (unskipped) observations in a row/column.
+     * This is NaN if supported by `Output_`, otherwise zero.
+     */
+    Output_ mean_placeholder = quickstats::nan_if_available_else_zero<Output_>();
+
+    /**
+     * Placeholder value to use for the variance when there are fewer than 2 (unskipped) observations in a row/column.
+     * This is NaN if supported by `Output_`, otherwise zero.
+     */
+    Output_ variance_placeholder = quickstats::nan_if_available_else_zero<Output_>();
+};
+
+/**
+ * @brief Result buffers for one dimension in `margins()`.
+ *
+ * Each pointer should either be NULL, in which case the corresponding statistic is not computed;
+ * or point to an array of length equal to the number of rows (for `row_output` in `margins()`) or columns (for `column_output`).
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Count_ Integer type of the non-zero counts.
+ */
+template<typename Output_, typename Count_>
+struct MarginBuffers {
+    /**
+     * After `margins()`, this is filled with the sum of each row/column.
+     */
+    Output_* sum = NULL;
+
+    /**
+     * After `margins()`, this is filled with the number of non-zero values in each row/column.
+     * NaNs are considered to be non-zero unless `MarginsOptions::skip_nan = true`, in which case they are ignored.
+     */
+    Count_* count = NULL;
+
+    /**
+     * After `margins()`, this is filled with the mean of each row/column.
+     */
+    Output_* mean = NULL;
+
+    /**
+     * After `margins()`, this is filled with the sample variance of each row/column.
+     */
+    Output_* variance = NULL;
+};
+
+/**
+ * @cond
+ */
+template<bool skip_nan_, typename Value_, typename Index_, typename Output_, typename Count_>
+void margins_internal(
+    const tatami::Matrix<Value_, Index_>& mat,
+    const MarginBuffers<Output_, Count_>& primary,
+    const MarginBuffers<Output_, Count_>& secondary,
+    const MarginsOptions<Output_>& opt)
+{
+    const bool prow = mat.prefer_rows();
+    const Index_ sdim = (prow ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+
+    // Layout of the per-thread partial results for the secondary dimension.
+    // Means and variances are computed with Welford's method, considering only the non-zero values; the zeros are added at the end of each thread.
+    const bool do_ssum = secondary.sum != NULL;
+    const bool do_welford = (secondary.mean != NULL || secondary.variance != NULL);
+    const bool do_nnz = (secondary.count != NULL || do_welford);
+    const bool do_valid = (skip_nan_ && do_welford);
+    const std::size_t num_output_arrays = static_cast<std::size_t>(do_ssum) + (do_welford ? 2 : 0);
+    const std::size_t num_count_arrays = static_cast<std::size_t>(do_nnz) + static_cast<std::size_t>(do_valid);
+
+    std::optional<PartialBuffers<Output_> > all_partial_output;
+    if (num_output_arrays) {
+        all_partial_output.emplace(opt.workspace, WORKSPACE_PARTIAL, opt.num_threads, opt.allocator, num_output_arrays);
+    }
+    std::optional<PartialBuffers<Count_> > all_partial_count;
+    if (num_count_arrays) {
+        all_partial_count.emplace(opt.workspace, WORKSPACE_PARTIAL + 1, opt.num_threads, opt.allocator, num_count_arrays);
+    }
+    auto thread_lengths = sanisizer::create<std::vector<Index_> >(std::max(opt.num_threads, 1));
+
+    const int nused = parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+        TraceScope tscope(opt.tracer, "margins", "compute", thread);
+        thread_lengths[thread] = l;
+
+        Output_* ssum = NULL;
+        Output_* smean = NULL;
+        Output_* srss = NULL;
+        if (num_output_arrays) {
+            const auto ptrs = all_partial_output->acquire(thread, sdim);
+            tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(sdim) * num_output_arrays);
+            std::size_t counter = 0;
+            if (do_ssum) {
+                ssum = ptrs[counter++];
+            }
+            if (do_welford) {
+                smean = ptrs[counter++];
+                srss = ptrs[counter++];
+            }
+        }
+
+        Count_* snnz = NULL;
+        Count_* svalid = NULL;
+        if (num_count_arrays) {
+            const auto ptrs = all_partial_count->acquire(thread, sdim);
+            tscope.add_bytes(sizeof(Count_) * static_cast<std::size_t>(sdim) * num_count_arrays);
+            if (do_nnz) {
+                snnz = ptrs[0];
+            }
+            if (do_valid) {
+                svalid = ptrs[num_count_arrays - 1];
+            }
+        }
+
+        // Processes a single vector of the preferred dimension, where 'get_index' maps each position in 'value' to its secondary index.
+        // This directly computes the statistics for that vector while accumulating the running statistics for each secondary element.
+        auto process = [&](const Index_ p, const Index_ number, const Value_* const value, auto get_index) -> void {
+            Output_ psum = 0;
+            Index_ pnnz = 0, pnan = 0;
+
+            for (Index_ i = 0; i < number; ++i) {
+                const auto val = value[i];
+                const Index_ d = get_index(i);
+                if constexpr(skip_nan_) {
+                    if (std::isnan(val)) {
+                        ++pnan;
+                        if (do_valid) {
+                            ++svalid[d]; // counting the NaNs for now, we'll convert this to the number of valid values later.
+                        }
+                        continue;
+                    }
+                }
+                if (val == 0) {
+                    continue;
+                }
+
+                psum += val;
+                ++pnnz;
+                if (do_ssum) {
+                    ssum[d] += val;
+                }
+                if (do_nnz) {
+                    auto& nnz = snnz[d];
+                    ++nnz;
+                    if (do_welford) {
+                        quickstats::update_rss(smean[d], srss[d], val, nnz);
+                    }
+                }
+            }
+
+            if (primary.sum) {
+                primary.sum[p] = psum;
+            }
+            if (primary.count) {
+                primary.count[p] = pnnz;
+            }
+
+            if (primary.mean || primary.variance) {
+                const Index_ valid = sdim - pnan;
+                const Output_ pmean = (valid ? psum / valid : opt.mean_placeholder);
+                if (primary.mean) {
+                    primary.mean[p] = pmean;
+                }
+
+                if (primary.variance) {
+                    if (valid < 2) {
+                        primary.variance[p] = opt.variance_placeholder;
+                    } else {
+                        Output_ prss = 0;
+                        for (Index_ i = 0; i < number; ++i) {
+                            const auto val = value[i];
+                            if constexpr(skip_nan_) {
+                                if (std::isnan(val)) {
+                                    continue;
+                                }
+                            }
+                            const Output_ delta = static_cast<Output_>(val) - pmean;
+                            prss += delta * delta;
+                        }
+                        const Index_ num_zeros = valid - (number - pnan); // for the zeros that are not structurally present in sparse vectors.
+                        prss += pmean * pmean * num_zeros;
+                        primary.variance[p] = prss / (valid - 1);
+                    }
+                }
+            }
+        };
+
+        if (sparse) {
+            tatami::Options topt;
+            topt.sparse_ordered_index = false; // ordering doesn't matter.
+            auto ext = prefetch_consecutive_extractor<true>(mat, prow, s, l, opt.prefetch, opt.executor, topt);
+            std::vector<Value_> vholder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, sdim, vholder);
+            std::vector<Index_> iholder;
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, sdim, iholder);
+
+            for (Index_ x = 0; x < l; ++x) {
+                const auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                process(x + s, out.number, out.value, [&](Index_ i) -> Index_ { return out.index[i]; });
+            }
+
+        } else {
+            auto ext = prefetch_consecutive_extractor<false>(mat, prow, s, l, opt.prefetch, opt.executor);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, sdim, holder);
+
+            for (Index_ x = 0; x < l; ++x) {
+                const auto ptr = tscope.fetch([&]() { return ext->fetch(buffer); });
+                process(x + s, sdim, ptr, [](Index_ i) -> Index_ { return i; });
+            }
+        }
+
+        // Adding the zeros to the running means and variances.
+        if (do_welford) {
+            AUVEH_NODEP
+            for (Index_ d = 0; d < sdim; ++d) {
+                Count_ valid = l;
+                if (do_valid) {
+                    svalid[d] = l - svalid[d]; // could be zero, so the update with zeros needs to be safe.
+                    valid = svalid[d];
+                }
+                quickstats::update_rss_with_zeros(smean[d], srss[d], static_cast<Count_>(valid - snnz[d]), valid);
+            }
+        }
+    }, mat, prow, opt);
+
+    parallelize_merge([&](Index_ start, Index_ length) -> void {
+        const Index_ end = start + length;
+
+        if (secondary.sum) {
+            std::fill(secondary.sum + start, secondary.sum + end, 0);
+            for (int u = 0; u < nused; ++u) {
+                const auto cur_sum = all_partial_output->get(u)[0];
+                AUVEH_NODEP
+                for (Index_ d = start; d < end; ++d) {
+                    secondary.sum[d] += cur_sum[d];
+                }
+            }
+        }
+
+        if (secondary.count) {
+            std::fill(secondary.count + start, secondary.count + end, 0);
+            for (int u = 0; u < nused; ++u) {
+                const auto cur_nnz = all_partial_count->get(u)[0];
+                AUVEH_NODEP
+                for (Index_ d = start; d < end; ++d) {
+                    secondary.count[d] += cur_nnz[d];
+                }
+            }
+        }
+
+        if (do_welford) {
+            const std::size_t moffset = do_ssum;
+            const std::size_t voffset = num_count_arrays - 1;
+            for (Index_ d = start; d < end; ++d) {
+                Count_ total = 0;
+                for (int u = 0; u < nused; ++u) {
+                    total += (do_valid ? all_partial_count->get(u)[voffset][d] : static_cast<Count_>(thread_lengths[u]));
+                }
+
+                Output_ mean = 0;
+                for (int u = 0; u < nused; ++u) {
+                    const Count_ cur_count = (do_valid ? all_partial_count->get(u)[voffset][d] : static_cast<Count_>(thread_lengths[u]));
+                    if (cur_count > 0) { // protect against NaN means at a count of 0.
+                        mean += all_partial_output->get(u)[moffset][d] * (static_cast<Output_>(cur_count) / static_cast<Output_>(total));
+                    }
+                }
+
+                Output_ rss = 0;
+                for (int u = 0; u < nused; ++u) {
+                    const Count_ cur_count = (do_valid ? all_partial_count->get(u)[voffset][d] : static_cast<Count_>(thread_lengths[u]));
+                    const auto cur = all_partial_output->get(u);
+                    rss += quickstats::recenter_rss(cur_count, cur[moffset + 1][d], cur[moffset][d], mean);
+                }
+
+                if (secondary.mean) {
+                    secondary.mean[d] = (total ? mean : opt.mean_placeholder);
+                }
+                if (secondary.variance) {
+                    secondary.variance[d] = (total < 2 ? opt.variance_placeholder : rss / (total - 1));
+                }
+            }
+        }
+    }, sdim, opt, "margins");
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Compute statistics for both rows and columns of a `tatami::Matrix` in a single pass.
+ * This iterates over the preferred dimension of `mat`, directly computing statistics for each element of the preferred dimension
+ * while accumulating running statistics for each element of the other dimension from the same extracted values.
+ * It is more efficient than separate calls to `sum()`, `variance()`, etc. for each dimension,
+ * as the matrix is only extracted once and never along its non-preferred dimension.
+ *
+ * Sums are computed by direct accumulation, while the means and variances are computed with the standard two-pass method (preferred dimension) or Welford's method (other dimension).
+ * If `MarginsOptions::skip_nan = true`, NaNs are ignored in all statistics.
+ *
+ * @tparam Value_ Numeric type of the input data.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Count_ Integer type of the non-zero counts.
+ *
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[out] row_output Buffers for the row statistics.
+ * On output, the non-NULL buffers will contain the corresponding statistics for each row.
+ * @param[out] column_output Buffers for the column statistics.
+ * On output, the non-NULL buffers will contain the corresponding statistics for each column.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Output_, typename Count_>
+void margins(
+    const tatami::Matrix<Value_, Index_>& mat,
+    const MarginBuffers<Output_, Count_>& row_output,
+    const MarginBuffers<Output_, Count_>& column_output,
+    const MarginsOptions<Output_>& opt)
+{
+    const bool prow = mat.prefer_rows();
+    const auto& primary = (prow ? row_output : column_output);
+    const auto& secondary = (prow ? column_output : row_output);
+    reserve_workspace(opt.workspace, opt.num_threads);
+
+    nanable_ifelse<Value_>(
+        opt.skip_nan,
+        [&]() -> void {
+            margins_internal<true>(mat, primary, secondary, opt);
+        },
+        [&]() -> void {
+            margins_internal<false>(mat, primary, secondary, opt);
+        }
+    );
+}
+
+/**
+ * @brief Statistics for one dimension in `margins()`.
+ *
+ * Each vector is empty if the corresponding statistic was not requested in `MarginsOptions`,
+ * otherwise it has length equal to the number of rows (for `MarginsResult::row`) or columns (for `MarginsResult::column`).
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Count_ Integer type of the non-zero counts.
+ */
+template<typename Output_, typename Count_>
+struct MarginStatistics {
+    /**
+     * Sum of each row/column.
+     */
+    std::vector<Output_> sum;
+
+    /**
+     * Number of non-zero values in each row/column.
+     */
+    std::vector<Count_> count;
+
+    /**
+     * Mean of each row/column.
+     */
+    std::vector<Output_> mean;
+
+    /**
+     * Sample variance of each row/column.
+     */
+    std::vector<Output_> variance;
+};
+
+/**
+ * @brief Results of `margins()`.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Count_ Integer type of the non-zero counts.
+ */
+template<typename Output_, typename Count_>
+struct MarginsResult {
+    /**
+     * Statistics for each row.
+     */
+    MarginStatistics<Output_, Count_> row;
+
+    /**
+     * Statistics for each column.
+     */
+    MarginStatistics<Output_, Count_> column;
+};
+
+/**
+ * @cond
+ */
+template<typename Output_, typename Count_, typename Index_>
+MarginBuffers<Output_, Count_> allocate_margins(MarginStatistics<Output_, Count_>& stats, const Index_ dim, const MarginsOptions<Output_>& opt) {
+    MarginBuffers<Output_, Count_> buffers;
+
+    auto allocate = [&](auto& vec, bool requested) -> auto* {
+        if (!requested) {
+            return static_cast<I<decltype(vec.data())> >(NULL);
+        }
+        tatami::resize_container_to_Index_size(vec, dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        return vec.data();
+    };
+
+    buffers.sum = allocate(stats.sum, opt.compute_sum);
+    buffers.count = allocate(stats.count, opt.compute_count);
+    buffers.mean = allocate(stats.mean, opt.compute_mean);
+    buffers.variance = allocate(stats.variance, opt.compute_variance);
+    return buffers;
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Overload of `margins()` that allocates memory for the requested statistics.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Value_ Numeric type of the input data.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param opt Further options, including the statistics to be computed.
+ *
+ * @return Statistics for each row and column.
+ */
+template<typename Output_ = double, typename Value_, typename Index_>
+MarginsResult<Output_, Index_> margins(const tatami::Matrix<Value_, Index_>& mat, const MarginsOptions<Output_>& opt) {
+    MarginsResult<Output_, Index_> output;
+    const auto row_buffers = allocate_margins(output.row, mat.nrow(), opt);
+    const auto column_buffers = allocate_margins(output.column, mat.ncol(), opt);
+    margins(mat, row_buffers, column_buffers, opt);
+    return output;
+}
+
+}
+
+#endif
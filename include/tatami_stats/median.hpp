@@ -2,10 +2,15 @@
 #define TATAMI_STATS_MEDIAN_HPP
 
 #include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+#include "select.hpp"
+#include "transform.hpp"
 
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include <cstddef>
 #include <limits>
 
 #include "tatami/tatami.hpp"
@@ -33,8 +38,50 @@ struct MedianOptions {
     /**
      * Number of threads to use when computing medians across a `tatami::Matrix`.
      * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     * If there are fewer rows/columns than threads and each row/column is very long, the threads are instead used to select the median within each row/column.
      */
     int num_threads = 1;
+
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Whether to distribute work across threads by work stealing, see `WorkStealingQueue` for details.
+     * This is useful when the cost of computing each statistic is highly variable, e.g., for sparse matrices with a skewed distribution of non-zero elements.
+     * Only used if `num_threads > 1`, in which case `balance_nonzeros` is ignored.
+     */
+    bool work_stealing = false;
+
+    /**
+     * Number of rows/columns in each chunk when `work_stealing = true`.
+     * Smaller chunks improve load balancing at the cost of more scheduling overhead.
+     * If zero, this is automatically chosen to yield several chunks per thread.
+     */
+    std::size_t work_stealing_chunk_size = 0;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Workspace to reuse buffers across calls, see @ref common_options_workspace.
+     */
+    Workspace* workspace = NULL;
 };
 
 /**
@@ -88,35 +135,93 @@ Output_ median_direct(Value_* value, Index_ num_nonzero, Index_ num_all, bool sk
  */
 template<typename Value_, typename Index_, typename Output_>
 void median(const bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* const output, const MedianOptions& opt) {
+    median(row, mat, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute medians of transformed values for each element of a chosen dimension of a `tatami::Matrix`.
+ * This is equivalent to calling the other `median()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformed values are written directly into the buffer that is used for selection.
+ *
+ * @tparam Value_ Numeric type of the input values.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Output_ Floating-point type of the output value.
+ * This should be capable of storing NaNs.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the median for each row.
+ * If false, the median is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[out] output Pointer to an array of length equal to the number of rows (if `row = true`) or columns (otherwise).
+ * On output, this will contain the row/column medians of the transformed values.
+ * @param transform Transformation to apply to each matrix value.
+ * If `MedianOptions::skip_nan = true`, NaNs are skipped after the transformation.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void median(const bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* const output, const Transform_& transform, const MedianOptions& opt) {
+    trace_path(opt.tracer, "median", false, mat.sparse(), opt.skip_nan);
     const auto dim = (row ? mat.nrow() : mat.ncol());
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
+    if (parallel_select_should_use(opt.num_threads, dim, otherdim)) {
+        parallel_select_quantiles(row, mat, 0.5, output, transform, opt, "median");
+        return;
+    }
+
+    reserve_workspace(opt.workspace, opt.num_threads);
 
     if (mat.sparse()) {
         tatami::Options topt;
         topt.sparse_extract_index = false;
         topt.sparse_ordered_index = false; // we'll be sorting by value anyway.
 
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<true>(mat, row, s, l, topt);
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            auto vbuffer = buffer.data();
-            for (Index_ x = 0; x < l; ++x) {
-                auto range = ext->fetch(vbuffer, NULL);
-                tatami::copy_n(range.value, range.number, vbuffer);
-                output[x + s] = median_direct<Output_>(vbuffer, range.number, otherdim, opt.skip_nan);
+        // Transformed values are shifted so that the structural zeros are still zero, and the transformed zero is added back to the median.
+        const auto zero = transformed_zero<Output_, Value_>(transform);
+
+        parallelize_chunks([&](int thread, WorkStealingQueue<Index_>& queue) -> void {
+            TraceScope tscope(opt.tracer, "median", "compute", thread);
+            std::vector<Value_> holder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, holder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            Index_ s, l;
+            while (queue.next(thread, s, l)) {
+                auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor, topt);
+                for (Index_ x = 0; x < l; ++x) {
+                    auto range = tscope.fetch([&]() { return ext->fetch(vbuffer, NULL); });
+
+                    // For sparse vectors where the median falls among the zeros, we don't even need to copy the non-zero values.
+                    const auto copy = copy_sparse_for_quantile(transform, range.value, range.number, otherdim, 0.5, opt.skip_nan, vbuffer, tbuffer, zero);
+                    if (copy == NULL) {
+                        output[x + s] = zero;
+                        continue;
+                    }
+
+                    output[x + s] = median_direct<Output_>(copy, range.number, otherdim, opt.skip_nan);
+                    if constexpr(!transform_preserves_zero<Transform_>) {
+                        output[x + s] += zero;
+                    }
+                }
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
 
     } else {
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            auto ext = tatami::consecutive_extractor<false>(mat, row, s, l);
-            for (Index_ x = 0; x < l; ++x) {
-                auto ptr = ext->fetch(buffer.data());
-                tatami::copy_n(ptr, otherdim, buffer.data());
-                output[x + s] = median_direct<Output_>(buffer.data(), otherdim, opt.skip_nan);
+        parallelize_chunks([&](int thread, WorkStealingQueue<Index_>& queue) -> void {
+            TraceScope tscope(opt.tracer, "median", "compute", thread);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, holder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            Index_ s, l;
+            while (queue.next(thread, s, l)) {
+                auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
+                for (Index_ x = 0; x < l; ++x) {
+                    auto ptr = tscope.fetch([&]() { return ext->fetch(buffer); });
+                    const auto copy = copy_transformed_values(transform, ptr, otherdim, buffer, tbuffer, static_cast<Output_>(0));
+                    output[x + s] = median_direct<Output_>(copy, otherdim, opt.skip_nan);
+                }
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
     }
 }
 
@@ -148,6 +253,36 @@ std::vector<Output_> median(const bool row, const tatami::Matrix<Value_, Index_>
     return output;
 }
 
+/**
+ * Overload of `median()` that allocates memory for the output medians of transformed values.
+ *
+ * @tparam Output_ Floating-point type of the output value.
+ * This should be capable of storing NaNs.
+ * @tparam Value_ Numeric type of the input values.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the median for each row.
+ * If false, the median is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ *
+ * @return Vector of length equal to the number of rows (if `row = true`) or columns (otherwise),
+ * containing the row/column medians of the transformed values.
+ */
+template<typename Output_ = double, typename Value_, typename Index_, class Transform_>
+std::vector<Output_> median(const bool row, const tatami::Matrix<Value_, Index_>& mat, const Transform_& transform, const MedianOptions& opt) {
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    auto output = sanisizer::create<std::vector<Output_> >(dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    median(row, mat, output.data(), transform, opt);
+    return output;
+}
+
 }
 
 #endif
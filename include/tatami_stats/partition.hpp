@@ -0,0 +1,408 @@
+#ifndef TATAMI_STATS_PARTITION_HPP
+#define TATAMI_STATS_PARTITION_HPP
+
+#include "utils.hpp"
+#include "allocator.hpp"
+#include "executor.hpp"
+#include "trace.hpp"
+#include "plan.hpp"
+#include "workspace.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#include "tatami/tatami.hpp"
+#include "sanisizer/sanisizer.hpp"
+
+/**
+ * @file partition.hpp
+ *
+ * @brief Partition work across threads based on the cost of each vector, or by work stealing.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @cond
+ */
+// Runs 'fun(w)' for each worker 'w' in [0, num_workers), either via the executor or via tatami::parallelize().
+template<class Function_>
+void run_workers(Function_ fun, const int num_workers, Executor* const executor) {
+    if (executor) {
+        executor->run(num_workers, fun);
+    } else {
+        tatami::parallelize([&](int, int start, int length) -> void {
+            for (int w = start, end = start + length; w < end; ++w) {
+                fun(w);
+            }
+        }, num_workers, num_workers);
+    }
+}
+
+template<typename Index_>
+std::vector<Index_> fixed_size_boundaries(const Index_ num, const Index_ chunk_size) {
+    std::vector<Index_> boundaries(1);
+    Index_ position = 0;
+    while (position < num) {
+        const Index_ remaining = num - position;
+        position += (remaining < chunk_size ? remaining : chunk_size);
+        boundaries.push_back(position);
+    }
+    return boundaries;
+}
+
+// Same split as tatami::parallelize().
+template<typename Index_>
+std::vector<Index_> equal_boundaries(const Index_ num, const int num_threads) {
+    const int nthreads = std::max(num_threads, 1);
+    const Index_ per_thread = (num / nthreads) + (num % nthreads > 0);
+    return fixed_size_boundaries(num, per_thread);
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Run a function over pre-defined chunks of vectors in parallel, e.g., from `partition_by_cost()`.
+ * Each chunk is processed by a separate worker.
+ *
+ * @tparam Function_ Function to be executed by each worker, with the same signature as described in `tatami::parallelize()`.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param fun Function to execute for each chunk.
+ * This should accept the chunk index, the index of the first vector in the chunk, and the number of vectors in the chunk.
+ * @param boundaries Vector of chunk boundaries, see the return value of `partition_by_cost()`.
+ * @param executor Pointer to an executor for running the workers.
+ * If NULL, workers are run via `tatami::parallelize()`.
+ *
+ * @return Number of chunks, i.e., the number of workers that were used.
+ */
+template<class Function_, typename Index_>
+int parallelize_by_boundaries(Function_ fun, const std::vector<Index_>& boundaries, Executor* const executor = NULL) {
+    const int num_chunks = sanisizer::cast<int>(boundaries.size() - 1);
+    run_workers([&](int c) -> void {
+        fun(c, boundaries[c], static_cast<Index_>(boundaries[c + 1] - boundaries[c]));
+    }, num_chunks, executor);
+    return num_chunks;
+}
+
+/**
+ * Count the number of structural non-zero elements in each row/column of a sparse `tatami::Matrix`.
+ * This is intended to provide cheap cost estimates for `partition_by_cost()`.
+ * Neither the values nor the indices are extracted, so this should be fast for the preferred dimension of compressed sparse matrices.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to count the non-zero elements in each row.
+ * If false, the non-zero elements in each column are counted instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param num_threads Number of threads to use.
+ * See `tatami::parallelize()` for more details on the parallelization mechanism.
+ * @param executor Pointer to an executor for running the threads.
+ * If NULL, threads are run via `tatami::parallelize()`.
+ *
+ * @return Vector of length equal to the number of rows (if `row = true`) or columns (otherwise),
+ * containing the number of structural non-zeros in each row/column.
+ * For dense matrices, all elements are considered to be structural non-zeros.
+ */
+template<typename Value_, typename Index_>
+std::vector<Index_> count_structural_nonzeros(const bool row, const tatami::Matrix<Value_, Index_>& mat, const int num_threads, Executor* const executor = NULL) {
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    const auto otherdim = (row ? mat.ncol() : mat.nrow());
+    auto output = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
+
+    if (mat.is_sparse()) {
+        tatami::Options topt;
+        topt.sparse_extract_index = false;
+        topt.sparse_extract_value = false;
+        parallelize_by_boundaries([&](int, Index_ s, Index_ l) -> void {
+            auto ext = tatami::consecutive_extractor<true>(mat, row, s, l, topt);
+            for (Index_ x = 0; x < l; ++x) {
+                const auto range = ext->fetch(NULL, NULL);
+                output[x + s] = range.number;
+            }
+        }, equal_boundaries(dim, num_threads), executor);
+    } else {
+        std::fill(output.begin(), output.end(), otherdim);
+    }
+
+    return output;
+}
+
+/**
+ * Partition a sequence of vectors into contiguous chunks of roughly equal total cost.
+ * A constant of 1 is added to each vector's cost to account for the fixed overhead of processing each vector, e.g., extraction.
+ * Every chunk is guaranteed to be non-empty, though there may be fewer chunks than `num_threads` if a few vectors dominate the total cost.
+ *
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Cost_ Numeric type of the cost estimates.
+ *
+ * @param num Number of vectors.
+ * @param[in] cost Pointer to an array of length `num`, containing the estimated cost of processing each vector.
+ * This is typically the number of non-zero elements from `count_structural_nonzeros()`.
+ * All values should be non-negative.
+ * @param num_threads Number of threads.
+ *
+ * @return Vector of chunk boundaries.
+ * The \f$i\f$-th chunk consists of vectors in \f$[b_i, b_{i+1})\f$ where \f$b_i\f$ is the \f$i\f$-th element of the returned vector.
+ * The first element is always zero and the last element is always `num`.
+ */
+template<typename Index_, typename Cost_>
+std::vector<Index_> partition_by_cost(const Index_ num, const Cost_* const cost, const int num_threads) {
+    std::vector<Index_> boundaries(1);
+    if (num == 0) {
+        return boundaries;
+    }
+
+    // Every vector gets its own chunk if we have enough threads.
+    const int num_chunks = std::max(num_threads, 1);
+    if (!sanisizer::is_less_than(num_chunks, num)) {
+        sanisizer::resize(boundaries, sanisizer::sum<std::size_t>(num, 1));
+        std::iota(boundaries.begin(), boundaries.end(), static_cast<Index_>(0));
+        return boundaries;
+    }
+
+    double total = 0;
+    for (Index_ i = 0; i < num; ++i) {
+        total += static_cast<double>(cost[i]) + 1;
+    }
+
+    boundaries.reserve(num_chunks + 1);
+    int next_chunk = 1;
+    double threshold = total * next_chunk / num_chunks;
+    double cumulative = 0;
+
+    // Don't cut after the last vector, otherwise we'd get an empty chunk.
+    for (Index_ i = 0, last = num - 1; i < last && next_chunk < num_chunks; ++i) {
+        cumulative += static_cast<double>(cost[i]) + 1;
+        if (cumulative >= threshold) {
+            boundaries.push_back(i + 1);
+            do {
+                ++next_chunk;
+                threshold = total * next_chunk / num_chunks;
+            } while (next_chunk < num_chunks && cumulative >= threshold);
+        }
+    }
+
+    boundaries.push_back(num);
+    return boundaries;
+}
+
+/**
+ * @brief Work-stealing queue of chunks of vectors.
+ *
+ * Each worker owns a contiguous run of chunks, which it processes from the front.
+ * Once a worker's own run is exhausted, it steals chunks from the back of other workers' runs.
+ * This improves load balancing when the cost of each vector is highly variable and difficult to predict, e.g., for selection-based statistics like medians.
+ * Each run is protected by its own mutex, which is only contended when a steal is in progress.
+ *
+ * @tparam Index_ Integer type of the row/column indices.
+ */
+template<typename Index_>
+class WorkStealingQueue {
+public:
+    /**
+     * @param boundaries Vector of chunk boundaries, see the return value of `partition_by_cost()`.
+     * @param num_workers Number of workers.
+     * This is capped at the number of chunks.
+     */
+    WorkStealingQueue(std::vector<Index_> boundaries, const int num_workers) : my_boundaries(std::move(boundaries)) {
+        const std::size_t num_chunks = my_boundaries.size() - 1;
+        const int max_runs = std::max(num_workers, 1);
+        const std::size_t num_runs = (sanisizer::is_less_than(num_chunks, max_runs) ? num_chunks : static_cast<std::size_t>(max_runs));
+
+        // Using a unique_ptr as the mutex is neither copyable nor movable.
+        my_runs.reset(new Run[num_runs]);
+        my_num_runs = num_runs;
+        for (std::size_t r = 0; r < num_runs; ++r) {
+            my_runs[r].front = (num_chunks * r) / num_runs;
+            my_runs[r].back = (num_chunks * (r + 1)) / num_runs;
+        }
+    }
+
+    /**
+     * @return Number of workers, i.e., the number of runs of chunks.
+     */
+    int num_workers() const {
+        return static_cast<int>(my_num_runs); // guaranteed to fit as it's no greater than the 'num_workers' in the constructor.
+    }
+
+    /**
+     * Claim the next chunk for a worker.
+     * This is thread-safe and should be called repeatedly by each worker until it returns false.
+     *
+     * @param worker Index of the worker, in \f$[0, W)\f$ where \f$W\f$ is the output of `num_workers()`.
+     * @param[out] start On output, the index of the first vector in the claimed chunk.
+     * @param[out] length On output, the number of vectors in the claimed chunk.
+     *
+     * @return Whether a chunk was claimed.
+     * If false, all chunks have been claimed and `start` and `length` are not modified.
+     */
+    bool next(const int worker, Index_& start, Index_& length) {
+        std::size_t chunk;
+        if (pop_front(my_runs[worker], chunk)) {
+            set_chunk(chunk, start, length);
+            return true;
+        }
+
+        for (std::size_t offset = 1; offset < my_num_runs; ++offset) {
+            auto& victim = my_runs[(worker + offset) % my_num_runs];
+            if (pop_back(victim, chunk)) {
+                set_chunk(chunk, start, length);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    std::vector<Index_> my_boundaries;
+
+    struct Run {
+        std::mutex lock;
+        std::size_t front = 0, back = 0;
+    };
+    std::unique_ptr<Run[]> my_runs;
+    std::size_t my_num_runs;
+
+    static bool pop_front(Run& run, std::size_t& chunk) {
+        std::lock_guard<std::mutex> guard(run.lock);
+        if (run.front == run.back) {
+            return false;
+        }
+        chunk = run.front;
+        ++run.front;
+        return true;
+    }
+
+    static bool pop_back(Run& run, std::size_t& chunk) {
+        std::lock_guard<std::mutex> guard(run.lock);
+        if (run.front == run.back) {
+            return false;
+        }
+        --run.back;
+        chunk = run.back;
+        return true;
+    }
+
+    void set_chunk(const std::size_t chunk, Index_& start, Index_& length) const {
+        start = my_boundaries[chunk];
+        length = my_boundaries[chunk + 1] - start;
+    }
+};
+
+/**
+ * @cond
+ */
+// Central dispatch for all kernels, which iterate over all rows (if 'row = true') or columns of 'mat'.
+// 'Options_' is any of the option structs with 'num_threads', 'balance_nonzeros', 'executor' and 'tracer' members.
+template<typename Value_, typename Index_, class Options_, class Function_>
+int parallelize_vectors(Function_ fun, const tatami::Matrix<Value_, Index_>& mat, const bool row, const Options_& opt) {
+    const Index_ num = (row ? mat.nrow() : mat.ncol());
+    if (opt.balance_nonzeros && opt.num_threads > 1 && mat.is_sparse()) {
+        const auto nnz = count_structural_nonzeros(row, mat, opt.num_threads, opt.executor);
+        return parallelize_by_boundaries(std::move(fun), partition_by_cost(num, nnz.data(), opt.num_threads), opt.executor);
+    }
+    if (opt.executor) {
+        return parallelize_by_boundaries(std::move(fun), equal_boundaries(num, opt.num_threads), opt.executor);
+    }
+    return tatami::parallelize(std::move(fun), num, opt.num_threads);
+}
+
+// Dispatch for merging the per-thread partial results of the running kernels, by splitting 'dim' across threads.
+// 'fun' should accept the start and length of its range of 'dim'.
+// This is only parallelized with an executor, as it's not worth creating new threads for a cheap merge.
+// 'kernel' is the name of the calling function, for tracing purposes.
+template<typename Index_, class Options_, class Function_>
+void parallelize_merge(Function_ fun, const Index_ dim, const Options_& opt, const char* const kernel) {
+    if (opt.executor && opt.num_threads > 1) {
+        parallelize_by_boundaries([&](int t, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, kernel, "merge", t);
+            fun(s, l);
+        }, equal_boundaries(dim, opt.num_threads), opt.executor);
+    } else {
+        TraceScope tscope(opt.tracer, kernel, "merge", 0);
+        fun(static_cast<Index_>(0), dim);
+    }
+}
+
+// Alternative dispatch for kernels that support work stealing.
+// Here, 'fun' is called once per worker with the worker index and a WorkStealingQueue, from which it should claim chunks until exhaustion.
+// 'Options_' should also have the 'work_stealing' and 'work_stealing_chunk_size' members.
+template<typename Value_, typename Index_, class Options_, class Function_>
+int parallelize_chunks(Function_ fun, const tatami::Matrix<Value_, Index_>& mat, const bool row, const Options_& opt) {
+    const Index_ num = (row ? mat.nrow() : mat.ncol());
+    const int num_threads = std::max(opt.num_threads, 1);
+    std::vector<Index_> boundaries;
+
+    if (opt.work_stealing && num_threads > 1) {
+        std::size_t chunk_size = opt.work_stealing_chunk_size;
+        if (chunk_size == 0) {
+            // Aiming for several chunks per thread so that there's something left to steal.
+            constexpr int chunks_per_thread = 8;
+            chunk_size = std::max(static_cast<std::size_t>(num) / (static_cast<std::size_t>(num_threads) * chunks_per_thread), static_cast<std::size_t>(1));
+        }
+        boundaries = fixed_size_boundaries(num, sanisizer::is_less_than(num, chunk_size) ? num : static_cast<Index_>(chunk_size));
+
+    } else if (opt.balance_nonzeros && num_threads > 1 && mat.is_sparse()) {
+        const auto nnz = count_structural_nonzeros(row, mat, num_threads, opt.executor);
+        boundaries = partition_by_cost(num, nnz.data(), num_threads);
+
+    } else {
+        boundaries = equal_boundaries(num, num_threads);
+    }
+
+    WorkStealingQueue<Index_> queue(std::move(boundaries), num_threads);
+    const int num_workers = queue.num_workers();
+    run_workers([&](int w) -> void {
+        fun(w, queue);
+    }, num_workers, opt.executor);
+    return num_workers;
+}
+
+// Returns the boundaries of the blocks along the other dimension, or an empty vector if no splitting is required.
+// Floating-point kernels should only split if requested by the caller and never in deterministic mode, as the number of blocks depends on the number of threads.
+template<typename Index_>
+std::vector<Index_> split_boundaries(const Index_ dim, const Index_ otherdim, const int num_threads) {
+    const std::size_t num_blocks = split_num_blocks(dim, otherdim, num_threads);
+    if (num_blocks <= 1) {
+        return std::vector<Index_>();
+    }
+    return equal_boundaries(otherdim, static_cast<int>(num_blocks)); // cast is safe as num_blocks <= num_threads.
+}
+
+// Calls 'fun(b, block)' in parallel for each block of the other dimension,
+// where 'block' is a tatami::Matrix containing the elements in '[boundaries[b], boundaries[b + 1])' of the other dimension for all vectors of the target dimension.
+template<typename Value_, typename Index_, class Function_>
+void parallelize_split(Function_ fun, const tatami::Matrix<Value_, Index_>& mat, const bool row, const std::vector<Index_>& boundaries, Executor* const executor) {
+    // Non-owning pointer to the matrix, for the subset wrapper.
+    std::shared_ptr<const tatami::Matrix<Value_, Index_> > ptr(std::shared_ptr<const tatami::Matrix<Value_, Index_> >(), &mat);
+    parallelize_by_boundaries([&](int b, Index_ start, Index_ length) -> void {
+        const tatami::DelayedSubsetBlock<Value_, Index_> block(ptr, start, length, !row);
+        fun(b, static_cast<const tatami::Matrix<Value_, Index_>&>(block));
+    }, boundaries, executor);
+}
+
+// Options for running a kernel on a single block in parallelize_split(), which is already inside a worker.
+// Callers should also drop the workspace, if any, as its per-thread buffers would be shared by all blocks.
+template<class Options_>
+Options_ split_options(const Options_& opt) {
+    auto copy = opt;
+    copy.num_threads = 1;
+    copy.balance_nonzeros = false;
+    copy.executor = NULL;
+    return copy;
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
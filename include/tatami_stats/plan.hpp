@@ -0,0 +1,328 @@
+#ifndef TATAMI_STATS_PLAN_HPP
+#define TATAMI_STATS_PLAN_HPP
+
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <optional>
+
+#include "tatami/tatami.hpp"
+
+/**
+ * @file plan.hpp
+ *
+ * @brief Plan the strategy and memory usage of a computation.
+ */
+
+namespace tatami_stats {
+
+/**
+ * Strategy for choosing between the direct and running paths, see `Plan` for details.
+ */
+enum class PlanStrategy : char {
+    /**
+     * Use the direct path if the preferred access dimension of the matrix is the same as the target dimension, otherwise use the running path.
+     * All requested threads are used.
+     */
+    PREFERRED,
+
+    /**
+     * Choose the path and the number of threads (up to the requested number) that minimize the estimated cost, see `choose_by_cost()` for details.
+     */
+    COST,
+
+    /**
+     * Always use the direct path with all requested threads.
+     */
+    DIRECT,
+
+    /**
+     * Always use the running path with all requested threads.
+     */
+    RUNNING
+};
+
+/**
+ * @brief Execution plan for a statistic.
+ *
+ * For statistics that can be computed by either extracting each row/column of the target dimension ("direct"),
+ * or by iterating across the other dimension and accumulating partial results for all elements of the target dimension ("running"),
+ * the plan describes the chosen path, the number of threads and the estimated peak memory usage.
+ * These are typically obtained by calling the `plan()` overload for the relevant options structure.
+ */
+struct Plan {
+    /**
+     * Whether the running path is used.
+     */
+    bool running = false;
+
+    /**
+     * Number of threads to use.
+     */
+    int num_threads = 1;
+
+    /**
+     * Estimated peak memory usage in bytes, across all threads.
+     * This includes the workspace buffers for extraction and transformation, the rings for prefetching,
+     * and any partial results for each thread, for each block of the other dimension, or for each node of the deterministic reduction.
+     * It does not include the output buffers or the memory used by the `tatami::Matrix` itself.
+     */
+    std::size_t memory = 0;
+
+    /**
+     * Whether `memory` fits within the `max_memory_bytes` budget of the options, if one was supplied.
+     *
+     * When fitting the plan within the budget, the number of threads on the path chosen by the `strategy` is first reduced until the estimated usage fits.
+     * If that is not sufficient, the other path is tried in the same manner, as it may not need to store per-thread partial results.
+     * If no configuration fits, the one with the lowest estimated usage is returned and this is set to false.
+     * The computation will still use this plan if it is run, so callers that need a hard limit should check this flag beforehand.
+     */
+    bool feasible = true;
+};
+
+/**
+ * @cond
+ */
+// Saturating arithmetic to avoid overflow when estimating memory usage for very large matrices.
+inline std::size_t saturating_add(const std::size_t left, const std::size_t right) {
+    const std::size_t maxed = std::numeric_limits<std::size_t>::max();
+    return (left > maxed - right ? maxed : left + right);
+}
+
+inline std::size_t saturating_multiply(const std::size_t left, const std::size_t right) {
+    const std::size_t maxed = std::numeric_limits<std::size_t>::max();
+    return (left && right > maxed / left ? maxed : left * right);
+}
+
+// When the target dimension is smaller than the number of threads, the direct path can't use all threads as it only parallelizes across 'dim'.
+// In such cases, we also split the other dimension into blocks, compute partial results for each block, and merge them afterwards.
+// Each block should be large enough to amortize the cost of its extractor and the merge.
+constexpr std::size_t SPLIT_MIN_BLOCK_SIZE = 1024;
+
+// Number of blocks of the other dimension on the direct path, where 1 means that no splitting is performed.
+inline std::size_t split_num_blocks(const std::size_t dim, const std::size_t otherdim, const int num_threads) {
+    if (num_threads <= 1 || dim >= static_cast<std::size_t>(num_threads)) {
+        return 1;
+    }
+    const std::size_t num_blocks = std::min(static_cast<std::size_t>(num_threads), otherdim / SPLIT_MIN_BLOCK_SIZE);
+    return (num_blocks > 1 ? num_blocks : 1);
+}
+
+// Bytes used by each thread in each path.
+// 'running_partial_all' is only allocated if more than one thread is used, in which case it is allocated by all threads.
+// 'running_partial_rest' is only allocated by all threads but the first, which stores its partial results in the output buffers instead.
+// 'running_deterministic_node' is the size of each partial result in deterministic_running(), which replaces the other partial results if non-zero.
+// 'direct_split_partial' is allocated once per block if the direct path splits the other dimension, see split_num_blocks().
+// 'dim' and 'otherdim' are filled by choose_plan().
+struct MemoryModel {
+    std::size_t direct_buffer = 0;
+    std::size_t direct_split_partial = 0;
+    std::size_t running_buffer = 0;
+    std::size_t running_partial_all = 0;
+    std::size_t running_partial_rest = 0;
+    std::size_t running_deterministic_node = 0;
+
+    std::size_t dim = 0;
+    std::size_t otherdim = 0;
+};
+
+// Size of each partial result in deterministic_running(), where each array is padded to a multiple of 64 bytes if there are multiple arrays.
+template<typename Type_>
+std::size_t deterministic_node_memory(const std::size_t num_arrays, const std::size_t dim) {
+    const std::size_t array_size = saturating_multiply(dim, sizeof(Type_));
+    return saturating_multiply(num_arrays, (num_arrays > 1 ? saturating_add(array_size, 64) : array_size));
+}
+
+// Upper bound on the number of partial results held by each thread in deterministic_running().
+// Each thread's stack holds disjoint aligned subtrees covering its run of leaves, of which there are at most two per level;
+// one more partial result is needed for the current leaf before it is merged.
+// Each leaf contains at least one vector, so the number of leaves in each thread is no greater than the number of vectors.
+inline std::size_t deterministic_nodes_per_thread(const std::size_t otherdim, const std::size_t num_threads) {
+    std::size_t per_thread = otherdim / num_threads + (otherdim % num_threads > 0);
+    std::size_t levels = 0;
+    while (per_thread) {
+        ++levels;
+        per_thread >>= 1;
+    }
+    return 2 * levels + 1;
+}
+
+// Bytes used by the ring of a PrefetchExtractor in each thread, for 'number' vectors of length 'extent'.
+template<typename Value_, typename Index_>
+std::size_t prefetch_memory(const std::size_t depth, const std::size_t number, const std::size_t extent, const bool sparse) {
+    if (depth == 0 || number <= 1) {
+        return 0;
+    }
+    const std::size_t num_slots = std::min(depth, number) + 1;
+    return saturating_multiply(saturating_multiply(num_slots, extent), sizeof(Value_) + (sparse ? sizeof(Index_) : 0));
+}
+
+inline std::size_t estimate_memory(const MemoryModel& model, const bool running, const int num_threads) {
+    const std::size_t nthreads = (num_threads > 1 ? num_threads : 1);
+    if (!running) {
+        std::size_t total = saturating_multiply(model.direct_buffer, nthreads);
+        const std::size_t num_blocks = split_num_blocks(model.dim, model.otherdim, num_threads);
+        if (num_blocks > 1) {
+            total = saturating_add(total, saturating_multiply(model.direct_split_partial, num_blocks));
+        }
+        return total;
+    }
+
+    std::size_t total = saturating_multiply(model.running_buffer, nthreads);
+    if (model.running_deterministic_node) {
+        const std::size_t num_nodes = saturating_multiply(deterministic_nodes_per_thread(model.otherdim, nthreads), nthreads);
+        total = saturating_add(total, saturating_multiply(model.running_deterministic_node, num_nodes));
+    } else if (nthreads > 1) {
+        total = saturating_add(total, saturating_multiply(model.running_partial_all, nthreads));
+        total = saturating_add(total, saturating_multiply(model.running_partial_rest, nthreads - 1));
+    }
+    return total;
+}
+
+// Fits a plan within the memory budget, by first reducing the number of threads on the preferred path, and then switching to the other path.
+// If no configuration satisfies the budget, the one with the lowest memory usage is returned and marked as infeasible.
+inline Plan fit_plan(const MemoryModel& model, const bool running, const int num_threads, const std::optional<std::size_t>& max_memory_bytes) {
+    Plan output;
+    output.running = running;
+    output.num_threads = (num_threads > 1 ? num_threads : 1);
+    output.memory = estimate_memory(model, output.running, output.num_threads);
+    if (!max_memory_bytes.has_value() || output.memory <= *max_memory_bytes) {
+        return output;
+    }
+
+    const std::size_t budget = *max_memory_bytes;
+    Plan best = output;
+    for (int p = 0; p < 2; ++p) {
+        const bool cur_running = (p == 0 ? running : !running);
+        for (int t = output.num_threads; t >= 1; --t) {
+            const auto mem = estimate_memory(model, cur_running, t);
+            if (mem < best.memory) {
+                best.running = cur_running;
+                best.num_threads = t;
+                best.memory = mem;
+                if (mem <= budget) {
+                    return best;
+                }
+            }
+        }
+    }
+
+    best.feasible = false;
+    return best;
+}
+/**
+ * @endcond
+ */
+
+
+/**
+ * Choose the path and number of threads for a statistic by minimizing a simple cost model.
+ * The cost of each path is the sum of the per-vector extraction overhead and the per-element processing cost, divided across threads.
+ * Elements that are not accessed along the preferred dimension (based on `tatami::Matrix::prefer_rows_proportion()`) are penalized,
+ * while sparse matrices (based on `tatami::Matrix::is_sparse_proportion()`) are assumed to have fewer elements to process.
+ * The running path incurs an additional cost for initializing and merging the per-thread partial results for each element of the target dimension.
+ * Each additional thread has a fixed startup cost, so fewer threads are used for small problems where the startup dominates.
+ * This is smaller if an `Executor` is used, as the threads are already running.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether the statistic is computed for each row.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param num_threads Maximum number of threads.
+ * @param has_executor Whether an `Executor` will be used to run the threads.
+ *
+ * @return Plan with the chosen path and number of threads.
+ * Note that the `Plan::memory` is not filled.
+ */
+template<typename Value_, typename Index_>
+Plan choose_by_cost(const bool row, const tatami::Matrix<Value_, Index_>& mat, const int num_threads, const bool has_executor) {
+    // Costs are in arbitrary units, roughly equal to the time required to process a single element along the preferred dimension.
+    constexpr double fetch_cost = 50;
+    constexpr double nonpreferred_penalty = 4;
+    constexpr double assumed_density = 0.1;
+    constexpr double merge_cost = 2;
+    const double startup_cost = (has_executor ? 5000 : 50000);
+
+    const double dim = (row ? mat.nrow() : mat.ncol());
+    const double otherdim = (row ? mat.ncol() : mat.nrow());
+    const double sparse_prop = mat.is_sparse_proportion();
+    const double num_elements = dim * otherdim * (1 - sparse_prop * (1 - assumed_density));
+
+    const double prefer_rows = mat.prefer_rows_proportion();
+    const double direct_preferred = (row ? prefer_rows : 1 - prefer_rows);
+    const double direct_penalty = direct_preferred + (1 - direct_preferred) * nonpreferred_penalty;
+    const double running_penalty = (1 - direct_preferred) + direct_preferred * nonpreferred_penalty;
+
+    const double direct_work = dim * fetch_cost + num_elements * direct_penalty;
+    const double running_work = otherdim * fetch_cost + num_elements * running_penalty;
+
+    Plan output;
+    output.running = (mat.prefer_rows() != row);
+    double best = std::numeric_limits<double>::infinity();
+    const int max_threads = (num_threads > 1 ? num_threads : 1);
+
+    // Iterating so that, in case of ties, the preferred path is chosen with the fewest threads.
+    for (int p = 0; p < 2; ++p) {
+        const bool running = (p == 0 ? output.running : !output.running);
+        for (int t = 1; t <= max_threads; ++t) {
+            const double overhead = (t - 1) * startup_cost;
+            double cost;
+            if (running) {
+                cost = running_work / t + dim * (1 + (t - 1) * merge_cost) + overhead;
+            } else {
+                cost = direct_work / t + overhead;
+            }
+            if (cost < best) {
+                best = cost;
+                output.running = running;
+                output.num_threads = t;
+            }
+        }
+    }
+
+    return output;
+}
+
+/**
+ * @cond
+ */
+// Chooses a plan based on the strategy in 'opt', and then fits it within the memory budget.
+// 'Options_' is any of the option structs with 'num_threads', 'executor', 'strategy', 'prefetch' and 'max_memory_bytes' members.
+// The prefetching rings are added to the per-thread buffers of 'model' here, as all kernels prefetch the full extent of each vector in both paths.
+template<typename Value_, typename Index_, class Options_>
+Plan choose_plan(MemoryModel model, const bool row, const tatami::Matrix<Value_, Index_>& mat, const Options_& opt) {
+    model.dim = (row ? mat.nrow() : mat.ncol());
+    model.otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    model.direct_buffer = saturating_add(model.direct_buffer, prefetch_memory<Value_, Index_>(opt.prefetch, model.dim, model.otherdim, sparse));
+    model.running_buffer = saturating_add(model.running_buffer, prefetch_memory<Value_, Index_>(opt.prefetch, model.otherdim, model.dim, sparse));
+
+    bool running = (mat.prefer_rows() != row);
+    int num_threads = opt.num_threads;
+    switch (opt.strategy) {
+        case PlanStrategy::PREFERRED:
+            break;
+        case PlanStrategy::DIRECT:
+            running = false;
+            break;
+        case PlanStrategy::RUNNING:
+            running = true;
+            break;
+        case PlanStrategy::COST:
+            {
+                const auto costed = choose_by_cost(row, mat, opt.num_threads, opt.executor != NULL);
+                running = costed.running;
+                num_threads = costed.num_threads;
+            }
+            break;
+    }
+    return fit_plan(model, running, num_threads, opt.max_memory_bytes);
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef TATAMI_STATS_PREFETCH_HPP
+#define TATAMI_STATS_PREFETCH_HPP
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <functional>
+
+#include "tatami/tatami.hpp"
+#include "sanisizer/sanisizer.hpp"
+
+#include "executor.hpp"
+
+/**
+ * @file prefetch.hpp
+ *
+ * @brief Overlap extraction with computation for I/O-bound matrices.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @brief Extractor that fetches vectors ahead of the caller.
+ *
+ * For disk-backed or remote matrices, each call to `fetch()` may stall on I/O, during which the calling thread sits idle.
+ * This class wraps an oracular extractor and uses a separate I/O task to fetch the next few vectors into a ring of buffers while the caller is processing the current vector.
+ * All kernels use this class when their `prefetch` option is positive.
+ *
+ * If no `Executor` is supplied, the I/O task runs in a dedicated thread, so each worker thread is paired with an I/O thread.
+ * Otherwise, the I/O task is submitted to the executor via `Executor::submit()`, and no extra threads are created.
+ * The task exits once the ring is full and is resubmitted when half of the ring is free.
+ * If the I/O task is not running when the caller needs the next vector (e.g., because all of the executor's threads are busy), the caller fetches that vector itself.
+ * This means that prefetching only has an effect if the executor has idle threads, e.g., if the pool has more threads than `num_threads`.
+ * If the executor does not support `submit()`, no prefetching is performed.
+ *
+ * Prefetching is only worthwhile if the cost of extraction is comparable to the cost of the computation,
+ * e.g., when reading from a file-backed matrix that is not already in the page cache.
+ * For in-memory matrices, the synchronization between the two threads will usually outweigh any benefit.
+ *
+ * @tparam sparse_ Whether the wrapped extractor is sparse.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Extractor_ Pointer to an oracular extractor, typically the `std::unique_ptr` returned by `tatami::consecutive_extractor()` or `tatami::new_extractor()`.
+ */
+template<bool sparse_, typename Value_, typename Index_, class Extractor_>
+class PrefetchExtractor {
+public:
+    /**
+     * @param ext Pointer to an oracular extractor.
+     * @param extent Extent of the non-target dimension, i.e., the maximum length of each extracted vector.
+     * @param number Number of vectors to be extracted from `ext`, i.e., the total number of predictions from its oracle.
+     * @param depth Maximum number of vectors to fetch ahead of the caller.
+     * If zero, no I/O task is created and `fetch()` is forwarded directly to `ext`.
+     * @param executor Executor to run the I/O task.
+     * If NULL, a dedicated thread is created instead.
+     */
+    PrefetchExtractor(Extractor_ ext, const Index_ extent, const Index_ number, const std::size_t depth, Executor* const executor = NULL) :
+        my_ext(std::move(ext)), my_extent(extent), my_executor(executor)
+    {
+        if (depth == 0 || number <= 1) {
+            return;
+        }
+
+        // One extra slot for the vector that is held by the caller.
+        my_num_slots = sanisizer::sum<std::size_t>(std::min(depth, static_cast<std::size_t>(number)), 1);
+        my_values.resize(sanisizer::product<typename decltype(my_values)::size_type>(my_num_slots, extent));
+        if constexpr(sparse_) {
+            my_indices.resize(sanisizer::product<typename decltype(my_indices)::size_type>(my_num_slots, extent));
+            my_ranges.resize(my_num_slots);
+        }
+
+        my_sync = std::make_shared<Sync>();
+        my_sync->number = number;
+        my_sync->num_slots = my_num_slots;
+        my_sync->pending = true;
+
+        if (executor == NULL) {
+            my_thread = std::thread([sync = my_sync, this]() -> void { produce(*sync, this, true); });
+        } else if (!executor->submit(create_task())) {
+            my_num_slots = 0;
+            my_values = std::vector<Value_>();
+            my_indices = std::vector<Index_>();
+            my_ranges = std::vector<tatami::SparseRange<Value_, Index_> >();
+            my_sync.reset();
+        }
+    }
+
+    /**
+     * @cond
+     */
+    PrefetchExtractor(const PrefetchExtractor&) = delete;
+    PrefetchExtractor& operator=(const PrefetchExtractor&) = delete;
+
+    ~PrefetchExtractor() {
+        if (my_sync) {
+            auto& sync = *my_sync;
+            std::unique_lock<std::mutex> lck(sync.lock);
+            sync.stop = true;
+            sync.cv.notify_all();
+            // Once any in-progress fetch is finished, no I/O task will touch this extractor again.
+            // Submitted tasks that have not yet started will only see 'stop', so we don't have to wait for them.
+            sync.cv.wait(lck, [&]() -> bool { return !sync.fetching; });
+        }
+        if (my_thread.joinable()) {
+            my_thread.join();
+        }
+    }
+    /**
+     * @endcond
+     */
+
+    /**
+     * Fetch the next vector from a dense extractor.
+     *
+     * @param buffer Pointer to an array of length no less than `extent`.
+     * This is only used if `depth = 0`.
+     * @return Pointer to an array containing the contents of the next vector.
+     * This is valid until the next call to `fetch()`.
+     */
+    const Value_* fetch(Value_* const buffer) {
+        if (my_num_slots == 0) {
+            return my_ext->fetch(buffer);
+        }
+        const auto slot = next_slot();
+        return my_values.data() + slot * static_cast<std::size_t>(my_extent);
+    }
+
+    /**
+     * Fetch the next vector from a sparse extractor.
+     *
+     * @param vbuffer Pointer to an array of length no less than `extent`.
+     * This is only used if `depth = 0`.
+     * @param ibuffer Pointer to an array of length no less than `extent`.
+     * This is only used if `depth = 0`.
+     * @return Contents of the next vector.
+     * The pointers are valid until the next call to `fetch()`.
+     * Either may be NULL if the values or indices were not extracted by the wrapped extractor.
+     */
+    tatami::SparseRange<Value_, Index_> fetch(Value_* const vbuffer, Index_* const ibuffer) {
+        if (my_num_slots == 0) {
+            return my_ext->fetch(vbuffer, ibuffer);
+        }
+        const auto slot = next_slot();
+        return my_ranges[slot];
+    }
+
+private:
+    Extractor_ my_ext;
+    Index_ my_extent;
+    Executor* my_executor;
+
+    std::size_t my_num_slots = 0;
+    std::vector<Value_> my_values;
+    std::vector<Index_> my_indices;
+    std::vector<tatami::SparseRange<Value_, Index_> > my_ranges;
+
+    // Shared with the I/O tasks, as a submitted task may only start after the extractor is destroyed.
+    struct Sync {
+        std::mutex lock;
+        std::condition_variable cv;
+        std::size_t number = 0;
+        std::size_t num_slots = 0;
+        std::size_t produced = 0; // number of vectors that have been fetched into the ring.
+        std::size_t consumed = 0; // number of vectors that have been returned to the caller.
+        bool fetching = false; // whether a vector is currently being fetched, by either the I/O task or the caller.
+        bool pending = false; // whether an I/O task has been submitted and has not yet exited.
+        bool stop = false;
+        std::exception_ptr error;
+
+        // We can overwrite a slot once the caller has moved past the vector that was previously stored in it.
+        bool has_free_slot() const {
+            return produced + 1 < consumed + num_slots;
+        }
+    };
+    std::shared_ptr<Sync> my_sync;
+    std::thread my_thread;
+
+    std::function<void()> create_task() {
+        return [sync = my_sync, this]() -> void { produce(*sync, this, false); };
+    }
+
+    void fill(const std::size_t target) {
+        const std::size_t slot = target % my_num_slots;
+        const std::size_t offset = slot * static_cast<std::size_t>(my_extent);
+        const auto vslot = my_values.data() + offset;
+        if constexpr(sparse_) {
+            const auto islot = my_indices.data() + offset;
+            auto range = my_ext->fetch(vslot, islot);
+            if (range.value && range.value != vslot) {
+                std::copy_n(range.value, range.number, vslot);
+                range.value = vslot;
+            }
+            if (range.index && range.index != islot) {
+                std::copy_n(range.index, range.number, islot);
+                range.index = islot;
+            }
+            my_ranges[slot] = range;
+        } else {
+            const auto ptr = my_ext->fetch(vslot);
+            if (ptr != vslot) {
+                std::copy_n(ptr, my_extent, vslot);
+            }
+        }
+    }
+
+    // Fetches the next vector into the ring. 
+    // This should be called with 'lck' held and 'sync.fetching = false', and returns with 'lck' held.
+    static void fetch_next(Sync& sync, PrefetchExtractor* const self, std::unique_lock<std::mutex>& lck) {
+        const std::size_t target = sync.produced;
+        sync.fetching = true;
+        lck.unlock();
+
+        std::exception_ptr err;
+        try {
+            self->fill(target);
+        } catch (...) {
+            err = std::current_exception();
+        }
+
+        lck.lock();
+        sync.fetching = false;
+        if (err) {
+            sync.error = err;
+        } else {
+            ++sync.produced;
+        }
+        sync.cv.notify_all();
+    }
+
+    // This is static as 'self' must not be touched if 'sync.stop' is set, i.e., the extractor was destroyed before the task started.
+    // If 'block = false', the task exits once the ring is full so that it does not hold on to one of the executor's threads.
+    static void produce(Sync& sync, PrefetchExtractor* const self, const bool block) {
+        std::unique_lock<std::mutex> lck(sync.lock);
+        while (true) {
+            sync.cv.wait(lck, [&]() -> bool {
+                return sync.stop || (!sync.fetching && (!block || sync.error || sync.produced == sync.number || sync.has_free_slot()));
+            });
+            if (sync.stop || sync.error || sync.produced == sync.number || !sync.has_free_slot()) {
+                break;
+            }
+            fetch_next(sync, self, lck);
+        }
+        sync.pending = false;
+        sync.cv.notify_all();
+    }
+
+    std::size_t next_slot() {
+        auto& sync = *my_sync;
+        std::unique_lock<std::mutex> lck(sync.lock);
+        ++sync.consumed; // this also releases the slot of the previous vector, as the caller no longer needs it.
+        sync.cv.notify_all();
+
+        // Resubmitting the I/O task once half of the ring is free, so that we don't pay for a submission for every vector.
+        if (my_executor && !sync.pending && !sync.error && sync.produced < sync.number) {
+            const std::size_t free_slots = sync.consumed + sync.num_slots - 1 - sync.produced;
+            if (free_slots * 2 >= sync.num_slots - 1) {
+                sync.pending = true;
+                lck.unlock();
+                const bool submitted = my_executor->submit(create_task());
+                lck.lock();
+                if (!submitted) {
+                    sync.pending = false;
+                }
+            }
+        }
+
+        while (sync.produced < sync.consumed && !sync.error) {
+            if (!sync.fetching) {
+                // The I/O task is not running, e.g., because the executor's threads are busy, so we fetch the next vector ourselves.
+                fetch_next(sync, this, lck);
+            } else {
+                sync.cv.wait(lck, [&]() -> bool { return sync.produced >= sync.consumed || sync.error || !sync.fetching; });
+            }
+        }
+
+        if (sync.produced < sync.consumed) {
+            std::rethrow_exception(sync.error);
+        }
+        return (sync.consumed - 1) % sync.num_slots;
+    }
+};
+
+/**
+ * @cond
+ */
+template<bool sparse_, typename Value_, typename Index_, class Extractor_>
+auto wrap_prefetch_extractor(Extractor_ ext, const Index_ extent, const Index_ number, const std::size_t depth, Executor* const executor) {
+    return std::make_unique<PrefetchExtractor<sparse_, Value_, Index_, Extractor_> >(std::move(ext), extent, number, depth, executor);
+}
+
+// Drop-in replacements for tatami::consecutive_extractor() and tatami::new_extractor() that prefetch 'depth' vectors ahead.
+template<bool sparse_, typename Value_, typename Index_>
+auto prefetch_consecutive_extractor(
+    const tatami::Matrix<Value_, Index_>& mat,
+    const bool row,
+    const Index_ start,
+    const Index_ length,
+    const std::size_t depth,
+    Executor* const executor,
+    const tatami::Options& topt = tatami::Options()
+) {
+    return wrap_prefetch_extractor<sparse_, Value_>(
+        tatami::consecutive_extractor<sparse_>(mat, row, start, length, topt),
+        (row ? mat.ncol() : mat.nrow()),
+        length,
+        depth,
+        executor
+    );
+}
+
+template<bool sparse_, typename Value_, typename Index_>
+auto prefetch_oracular_extractor(
+    const tatami::Matrix<Value_, Index_>& mat,
+    const bool row,
+    std::shared_ptr<const tatami::Oracle<Index_> > oracle,
+    const std::size_t depth,
+    Executor* const executor,
+    const tatami::Options& topt = tatami::Options()
+) {
+    const Index_ number = oracle->total(); // cast is safe as the number of predictions should fit in Index_.
+    return wrap_prefetch_extractor<sparse_, Value_>(
+        tatami::new_extractor<sparse_, true>(mat, row, std::move(oracle), topt),
+        (row ? mat.ncol() : mat.nrow()),
+        number,
+        depth,
+        executor
+    );
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
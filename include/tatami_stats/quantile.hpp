@@ -2,10 +2,15 @@
 #define TATAMI_STATS_QUANTILE_HPP
 
 #include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+#include "select.hpp"
+#include "transform.hpp"
 
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include <cstddef>
 #include <limits>
 #include <type_traits>
 
@@ -34,8 +39,45 @@ struct QuantileOptions {
     /**
      * Number of threads to use when computing quantiles across a `tatami::Matrix`.
      * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     * If there are fewer rows/columns than threads and each row/column is very long, the threads are instead used to select the quantile within each row/column.
      */
     int num_threads = 1;
+
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Whether to distribute work across threads by work stealing, see `WorkStealingQueue` for details.
+     * This is useful when the cost of computing each statistic is highly variable, e.g., for sparse matrices with a skewed distribution of non-zero elements.
+     * Only used if `num_threads > 1`, in which case `balance_nonzeros` is ignored.
+     */
+    bool work_stealing = false;
+
+    /**
+     * Number of rows/columns in each chunk when `work_stealing = true`.
+     * Smaller chunks improve load balancing at the cost of more scheduling overhead.
+     * If zero, this is automatically chosen to yield several chunks per thread.
+     */
+    std::size_t work_stealing_chunk_size = 0;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
 };
 
 /**
@@ -63,6 +105,41 @@ void quantile(
     Output_* const output,
     const QuantileOptions& opt
 ) {
+    quantile(row, mat, prob, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute quantiles of transformed values for each element of a chosen dimension of a `tatami::Matrix`.
+ * This is equivalent to calling the other `quantile()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformed values are written directly into the buffer that is used for selection.
+ *
+ * @tparam Value_ Numeric type of the input values.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Output_ Floating-point type of the output value.
+ * This should be capable of storing NaNs.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the quantile for each row.
+ * If false, the quantile is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param prob Probability of the quantile to compute.
+ * This should be in \f$[0, 1]\f$.
+ * @param[out] output Pointer to an array of length equal to the number of rows (if `row = true`) or columns (otherwise).
+ * On output, this will contain the row/column quantiles of the transformed values.
+ * @param transform Transformation to apply to each matrix value.
+ * If `QuantileOptions::skip_nan = true`, NaNs are skipped after the transformation.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void quantile(
+    const bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const double prob,
+    Output_* const output,
+    const Transform_& transform,
+    const QuantileOptions& opt
+) {
+    trace_path(opt.tracer, "quantile", false, mat.sparse(), opt.skip_nan);
     const auto dim = (row ? mat.nrow() : mat.ncol());
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
     if (otherdim == 0) {
@@ -71,66 +148,98 @@ void quantile(
         return;
     }
 
-    tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
+    if (parallel_select_should_use(opt.num_threads, dim, otherdim)) {
+        parallel_select_quantiles(row, mat, prob, output, transform, opt, "quantile");
+        return;
+    }
+
+    parallelize_chunks([&](int thread, WorkStealingQueue<Index_>& queue) -> void {
+        TraceScope tscope(opt.tracer, "quantile", "compute", thread);
+        std::vector<Output_> tholder;
+        const auto tbuffer = transform_buffer<Output_, Transform_>(NULL, thread, otherdim, tholder);
         std::optional<quickstats::SingleQuantileFixedNumber<Output_> > qcalcs_fixed;
         std::optional<quickstats::SingleQuantileVariableNumber<Output_> > qcalcs_var;
         // Index_ is safe to cast to std::size_t as that's part of the tatami contract.
-        nanable_ifelse<Value_>(
+        // The fixed calculator is still used with 'skip_nan = true' for vectors without any NaNs.
+        qcalcs_fixed.emplace(otherdim, prob);
+        nanable_ifelse<TransformedValue<Value_, Output_, Transform_> >(
             opt.skip_nan,
             [&]() -> void {
                 qcalcs_var.emplace(otherdim, prob);
             },
-            [&]() -> void {
-                qcalcs_fixed.emplace(otherdim, prob);
-            }
+            []() -> void {}
         );
 
         if (mat.sparse()) {
             tatami::Options topt;
             topt.sparse_extract_index = false;
             topt.sparse_ordered_index = false; // we'll be sorting by value anyway.
-            auto ext = tatami::consecutive_extractor<true>(mat, row, s, l, topt);
             auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
             auto vbuffer = buffer.data();
 
-            for (Index_ x = 0; x < l; ++x) {
-                auto range = ext->fetch(vbuffer, NULL);
-                tatami::copy_n(range.value, range.number, vbuffer);
-
-                nanable_ifelse<Value_>(
-                    opt.skip_nan,
-                    [&]() -> void {
-                        const auto new_non_zeros = shift_nans(vbuffer, range.number);
-                        output[x + s] = (*qcalcs_var)(otherdim - (range.number - new_non_zeros), new_non_zeros, vbuffer);
-                    },
-                    [&]() -> void {
-                        output[x + s] = (*qcalcs_fixed)(range.number, vbuffer);
+            // Transformed values are shifted so that the structural zeros are still zero, and the transformed zero is added back to the quantile.
+            const auto zero = transformed_zero<Output_, Value_>(transform);
+
+            Index_ s, l;
+            while (queue.next(thread, s, l)) {
+                auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor, topt);
+                for (Index_ x = 0; x < l; ++x) {
+                    auto range = tscope.fetch([&]() { return ext->fetch(vbuffer, NULL); });
+
+                    // For sparse vectors where the quantile falls among the zeros, we don't even need to copy the non-zero values.
+                    const auto copy = copy_sparse_for_quantile(transform, range.value, range.number, otherdim, prob, opt.skip_nan, vbuffer, tbuffer, zero);
+                    if (copy == NULL) {
+                        output[x + s] = zero;
+                        continue;
                     }
-                );
-            }
 
+                    nanable_ifelse<TransformedValue<Value_, Output_, Transform_> >(
+                        opt.skip_nan,
+                        [&]() -> void {
+                            const auto new_non_zeros = shift_nans(copy, range.number);
+                            if (new_non_zeros == range.number) {
+                                output[x + s] = (*qcalcs_fixed)(range.number, copy);
+                            } else {
+                                output[x + s] = (*qcalcs_var)(otherdim - (range.number - new_non_zeros), new_non_zeros, copy);
+                            }
+                        },
+                        [&]() -> void {
+                            output[x + s] = (*qcalcs_fixed)(range.number, copy);
+                        }
+                    );
+                    if constexpr(!transform_preserves_zero<Transform_>) {
+                        output[x + s] += zero;
+                    }
+                }
+
+            }
         } else {
             auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            auto ext = tatami::consecutive_extractor<false>(mat, row, s, l);
-
-            for (Index_ x = 0; x < l; ++x) {
-                auto bufptr = buffer.data();
-                auto raw = ext->fetch(bufptr);
-                tatami::copy_n(raw, otherdim, bufptr);
-
-                nanable_ifelse<Value_>(
-                    opt.skip_nan,
-                    [&]() -> void {
-                        const auto new_total = shift_nans(bufptr, otherdim);
-                        output[x + s] = (*qcalcs_var)(new_total, bufptr);
-                    },
-                    [&]() -> void {
-                        output[x + s] = (*qcalcs_fixed)(bufptr);
-                    }
-                );
+            Index_ s, l;
+            while (queue.next(thread, s, l)) {
+                auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
+                for (Index_ x = 0; x < l; ++x) {
+                    auto raw = tscope.fetch([&]() { return ext->fetch(buffer.data()); });
+                    const auto bufptr = copy_transformed_values(transform, raw, otherdim, buffer.data(), tbuffer, static_cast<Output_>(0));
+
+                    nanable_ifelse<TransformedValue<Value_, Output_, Transform_> >(
+                        opt.skip_nan,
+                        [&]() -> void {
+                            const auto new_total = shift_nans(bufptr, otherdim);
+                            if (new_total == otherdim) {
+                                output[x + s] = (*qcalcs_fixed)(bufptr);
+                            } else {
+                                output[x + s] = (*qcalcs_var)(new_total, bufptr);
+                            }
+                        },
+                        [&]() -> void {
+                            output[x + s] = (*qcalcs_fixed)(bufptr);
+                        }
+                    );
+                }
             }
         }
-    }, dim, opt.num_threads);
+    }, mat, row, opt);
 }
 
 /**
@@ -168,6 +277,44 @@ std::vector<Output_> quantile(
     return output;
 }
 
+/**
+ * Overload of `quantile()` that allocates memory for the output quantiles of transformed values.
+ *
+ * @tparam Output_ Floating-point type of the output value.
+ * This should be capable of storing NaNs.
+ * @tparam Value_ Numeric type of the input values.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the quantile for each row.
+ * If false, the quantile is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param prob Probability of the quantile to compute.
+ * This should be in \f$[0, 1]\f$.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ *
+ * @return Vector of length equal to the number of rows (if `row = true`) or columns (otherwise),
+ * containing the row/column quantiles of the transformed values.
+ */
+template<typename Output_ = double, typename Value_, typename Index_, class Transform_>
+std::vector<Output_> quantile(
+    const bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const double prob,
+    const Transform_& transform,
+    const QuantileOptions& opt
+) {
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    auto output = sanisizer::create<std::vector<Output_> >(dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    quantile(row, mat, prob, output.data(), transform, opt);
+    return output;
+}
+
 }
 
 #endif
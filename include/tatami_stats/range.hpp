@@ -2,6 +2,9 @@
 #define TATAMI_STATS_RANGE_HPP
 
 #include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+#include "transform.hpp"
 
 #include <vector>
 #include <algorithm>
@@ -55,9 +58,47 @@ struct RangeOptions {
     /**
      * Number of threads to use when computing ranges across a `tatami::Matrix`.
      * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     * On the direct path, if there are fewer rows/columns than threads, the other dimension is also split across threads and the partial ranges are combined.
      */
     int num_threads = 1;
 
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+
     /**
      * Placeholder for the minimum value in `RangeBuffers::minimum` or `RangeResults::minimum`,
      * when there are zero columns (if `row == true`) or rows (otherwise).
@@ -152,48 +193,65 @@ struct RangeBuffers {
 /**
  * @cond
  */
-template<typename Value_, typename Index_, typename Output_>
-void range_direct(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuffers<Output_>& output, const RangeOptions<Output_>& opt) {
-    const auto dim = (row ? mat.nrow() : mat.ncol());
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void range_direct(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuffers<Output_>& output, const Transform_& transform, const RangeOptions<Output_>& opt) {
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
 
     if (mat.is_sparse()) {
         tatami::Options topt;
         topt.sparse_extract_index = false;
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<true>(mat, row, s, l, topt);
+
+        // Shifting the transformed values so that the structural zeros are still zero, and adding the transformed zero back to the minimum/maximum.
+        const auto zero = transformed_zero<Output_, Value_>(transform);
+
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "range", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor, topt);
             auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(NULL, thread, otherdim, tholder);
             for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(vbuffer.data(), NULL);
-                output.minimum[x + s] = min_direct(out.value, out.number, otherdim, opt);
-                output.maximum[x + s] = max_direct(out.value, out.number, otherdim, opt);
+                auto out = tscope.fetch([&]() { return ext->fetch(vbuffer.data(), NULL); });
+                const auto vals = transform_values(transform, out.value, out.number, tbuffer, zero);
+                output.minimum[x + s] = min_direct(vals, out.number, otherdim, opt);
+                output.maximum[x + s] = max_direct(vals, out.number, otherdim, opt);
+                if constexpr(!transform_preserves_zero<Transform_>) {
+                    if (otherdim) {
+                        output.minimum[x + s] += zero;
+                        output.maximum[x + s] += zero;
+                    }
+                }
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
 
     } else {
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<false>(mat, row, s, l);
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "range", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
             auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(NULL, thread, otherdim, tholder);
             for (Index_ x = 0; x < l; ++x) {
-                auto ptr = ext->fetch(buffer.data());
-                output.minimum[x + s] = min_direct(ptr, otherdim, opt);
-                output.maximum[x + s] = max_direct(ptr, otherdim, opt);
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer.data()); });
+                const auto vals = transform_values(transform, ptr, otherdim, tbuffer, static_cast<Output_>(0));
+                output.minimum[x + s] = min_direct(vals, otherdim, opt);
+                output.maximum[x + s] = max_direct(vals, otherdim, opt);
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
     }
 }
 
-template<typename Value_, typename Index_, typename Output_>
-void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuffers<Output_>& output, const RangeOptions<Output_>& opt) {
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuffers<Output_>& output, const Transform_& transform, const RangeOptions<Output_>& opt) {
     const auto dim = (row ? mat.nrow() : mat.ncol());
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
     const bool is_sparse = mat.is_sparse();
 
     const bool do_parallel = opt.num_threads > 1; 
-    std::optional<std::vector<std::optional<std::vector<Output_> > > > all_partial_min, all_partial_max;
+    std::optional<PartialBuffers<Output_> > all_partial_min, all_partial_max;
     if (do_parallel) {
-        all_partial_min.emplace(sanisizer::cast<I<decltype(all_partial_min->size())> >(opt.num_threads - 1));
-        all_partial_max.emplace(sanisizer::cast<I<decltype(all_partial_max->size())> >(opt.num_threads - 1));
+        all_partial_min.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL, opt.num_threads, opt.allocator);
+        all_partial_max.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL + 1, opt.num_threads, opt.allocator);
     }
 
     if (otherdim == 0) {
@@ -202,10 +260,13 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
         return;
     }
 
-    const auto nused = tatami::parallelize([&](int thread, Index_ s, Index_ l) -> void {
+    // For sparse matrices, the transformed values are shifted so that structural zeros are still zero, see range_direct().
+    const auto zero = transformed_zero<Output_, Value_>(transform);
+
+    const auto nused = parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+        TraceScope tscope(opt.tracer, "range", "compute", thread);
         Output_* min_ptr;
         Output_* max_ptr;
-        std::optional<std::vector<Output_> > cur_min, cur_max;
         if (!do_parallel) {
             min_ptr = output.minimum;
             max_ptr = output.maximum;
@@ -214,17 +275,17 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
                 min_ptr = output.minimum;
                 max_ptr = output.maximum;
             } else {
-                cur_min.emplace(tatami::cast_Index_to_container_size<std::vector<Output_> >(dim));
-                cur_max.emplace(tatami::cast_Index_to_container_size<std::vector<Output_> >(dim));
-                min_ptr = cur_min->data();
-                max_ptr = cur_max->data();
+                min_ptr = all_partial_min->acquire(thread, dim)[0];
+                tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim));
+                max_ptr = all_partial_max->acquire(thread, dim)[0];
+                tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim));
             }
         }
 
         if (is_sparse) {
             tatami::Options topt;
             topt.sparse_ordered_index = false;
-            auto ext = tatami::consecutive_extractor<true>(mat, !row, s, l, topt);
+            auto ext = prefetch_consecutive_extractor<true>(mat, !row, s, l, opt.prefetch, opt.executor, topt);
             auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
             auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
 
@@ -234,7 +295,7 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
             auto nonzeros = tatami::create_container_of_Index_size<std::vector<Index_> >(dim, 1);
 
             for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(vbuffer.data(), ibuffer.data());
+                auto out = tscope.fetch([&]() { return ext->fetch(vbuffer.data(), ibuffer.data()); });
 
                 // For the first observed vector in each thread, we can optimize it a little as we don't need to read existing min/max.
                 if (x == 0) {
@@ -246,7 +307,7 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
                     }
                     AUVEH_NODEP
                     for (Index_ i = 0; i < out.number; ++i) {
-                        const auto val = out.value[i];
+                        const auto val = transform_value(transform, out.value[i], zero);
                         const auto idx = out.index[i];
                         min_ptr[idx] = val;
                         max_ptr[idx] = val;
@@ -254,7 +315,7 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
                 } else {
                     AUVEH_NODEP
                     for (Index_ i = 0; i < out.number; ++i) {
-                        const auto val = out.value[i];
+                        const auto val = transform_value(transform, out.value[i], zero);
                         const auto idx = out.index[i];
                         auto& min_current = min_ptr[idx];
                         min_current = std::min(min_current, val); // using min/max as this is more easily vectorizable by the compiler.
@@ -276,20 +337,24 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
             }
 
         } else {
-            auto ext = tatami::consecutive_extractor<false>(mat, !row, s, l);
+            auto ext = prefetch_consecutive_extractor<false>(mat, !row, s, l, opt.prefetch, opt.executor);
             auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
 
             for (Index_ x = 0; x < l; ++x) {
-                auto ptr = ext->fetch(buffer.data());
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer.data()); });
 
                 // For the first observed vector in each thread, we can optimize it a little as we don't need to read existing min/max.
                 if (x == 0) {
-                    std::copy_n(ptr, dim, min_ptr);
-                    std::copy_n(ptr, dim, max_ptr);
+                    AUVEH_NODEP
+                    for (Index_ i = 0; i < dim; ++i) {
+                        const auto val = transform_value(transform, ptr[i], static_cast<Output_>(0));
+                        min_ptr[i] = val;
+                        max_ptr[i] = val;
+                    }
                 } else {
                     AUVEH_NODEP
                     for (Index_ i = 0; i < dim; ++i) {
-                        const auto val = ptr[i];
+                        const auto val = transform_value(transform, ptr[i], static_cast<Output_>(0));
                         auto& min_current = min_ptr[i];
                         min_current = std::min(min_current, val); // min/max is more easily vectorizable.
                         auto& max_current = max_ptr[i];
@@ -298,33 +363,119 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
                 }
             }
         }
+    }, mat, !row, opt);
 
-        if (do_parallel) {
-            if (thread > 0) {
-                (*all_partial_min)[thread - 1] = std::move(cur_min);
-                (*all_partial_max)[thread - 1] = std::move(cur_max);
+    if (do_parallel) {
+        parallelize_merge([&](Index_ start, Index_ length) -> void {
+            const Index_ end = start + length;
+            for (int u = 1; u < nused; ++u) {
+                const auto cur_min = all_partial_min->get(u)[0];
+                const auto cur_max = all_partial_max->get(u)[0];
+                AUVEH_NODEP
+                for (Index_ d = start; d < end; ++d) {
+                    // All threads would have processed at least one element,
+                    // so we don't have to worry about dirty input buffers.
+                    output.minimum[d] = std::min(output.minimum[d], cur_min[d]);
+                    output.maximum[d] = std::max(output.maximum[d], cur_max[d]);
+                }
             }
-        }
-    }, otherdim, opt.num_threads);
+        }, dim, opt, "range");
+    }
 
-    if (do_parallel) {
-        for (int u = 1; u < nused; ++u) {
-            const auto& cur_min = *((*all_partial_min)[u - 1]);
-            const auto& cur_max = *((*all_partial_max)[u - 1]);
-            AUVEH_NODEP
+    if constexpr(!transform_preserves_zero<Transform_>) {
+        if (is_sparse) {
             for (Index_ d = 0; d < dim; ++d) {
-                // All threads would have processed at least one element,
-                // so we don't have to worry about dirty input buffers.
-                output.minimum[d] = std::min(output.minimum[d], cur_min[d]);
-                output.maximum[d] = std::max(output.maximum[d], cur_max[d]);
+                output.minimum[d] += zero;
+                output.maximum[d] += zero;
             }
         }
     }
 }
+
+// Splitting the other dimension across threads when 'dim' is too small to occupy them, see split_boundaries().
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void range_split(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuffers<Output_>& output, const Transform_& transform, const std::vector<Index_>& boundaries, const RangeOptions<Output_>& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t num_blocks = boundaries.size() - 1;
+    const auto partial_size = sanisizer::product<typename std::vector<Output_>::size_type>(num_blocks, dim);
+    auto partial_min = sanisizer::create<std::vector<Output_> >(partial_size);
+    auto partial_max = sanisizer::create<std::vector<Output_> >(partial_size);
+
+    const auto block_opt = split_options(opt);
+    parallelize_split([&](int b, const tatami::Matrix<Value_, Index_>& block) -> void {
+        const std::size_t offset = static_cast<std::size_t>(b) * dim;
+        RangeBuffers<Output_> buffers;
+        buffers.minimum = partial_min.data() + offset;
+        buffers.maximum = partial_max.data() + offset;
+        range_direct(row, block, buffers, transform, block_opt);
+    }, mat, row, boundaries, opt.executor);
+
+    std::copy_n(partial_min.begin(), dim, output.minimum);
+    std::copy_n(partial_max.begin(), dim, output.maximum);
+    for (std::size_t b = 1; b < num_blocks; ++b) {
+        const std::size_t offset = b * dim;
+        for (std::size_t d = 0; d < dim; ++d) {
+            output.minimum[d] = std::min(output.minimum[d], partial_min[offset + d]);
+            output.maximum[d] = std::max(output.maximum[d], partial_max[offset + d]);
+        }
+    }
+}
 /**
  * @endcond
  */
 
+/**
+ * Plan the computation of `range()`, see `Plan` for details.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute the range for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param opt Options for `range()`.
+ *
+ * @return Plan for `range()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `RangeOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Output_, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const RangeOptions<Output_>& opt) {
+    return plan(row, mat, IdentityTransform(), opt);
+}
+
+/**
+ * Plan the computation of `range()` with a transformation, see `Plan` for details.
+ * This is the same as the other `plan()` overload, except that the estimated memory usage includes the buffers for the transformed values.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the range for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Options for `range()`.
+ *
+ * @return Plan for `range()` with the supplied arguments.
+ */
+template<typename Output_, typename Value_, typename Index_, class Transform_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const Transform_& transform, const RangeOptions<Output_>& opt) {
+    (void)transform;
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = otherdim * (sizeof(Value_) + (is_identity_transform<Transform_> ? 0 : sizeof(Output_)));
+    model.running_buffer = dim * (sizeof(Value_) + (sparse ? 2 * sizeof(Index_) : 0));
+    model.running_partial_rest = dim * 2 * sizeof(Output_);
+    model.direct_split_partial = dim * 2 * sizeof(Output_);
+    return choose_plan(model, row, mat, opt);
+}
+
 /**
  * Compute ranges for each element of a chosen dimension of a `tatami::Matrix`.
  *
@@ -342,10 +493,43 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
  */
 template<typename Value_, typename Index_, typename Output_>
 void range(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuffers<Output_>& output, const RangeOptions<Output_>& opt) {
-    if (mat.prefer_rows() == row) {
-        range_direct(row, mat, output, opt);
+    range(row, mat, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute ranges of transformed values for each element of a chosen dimension of a `tatami::Matrix`.
+ * This is equivalent to calling the other `range()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformation is performed inside the minimum/maximum loops to avoid a separate pass over each extracted row/column.
+ *
+ * @tparam Value_ Numeric type of the input data.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Output_ Numeric type of the output data.
+ * It is assumed that this is large enough to store the maxima/minima of the transformed values.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the range for each row.
+ * If false, the range is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[out] output Buffers to output arrays.
+ * On output, this will contain the row/column minima and maxima of the transformed values.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void range(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuffers<Output_>& output, const Transform_& transform, const RangeOptions<Output_>& opt) {
+    const auto cur_plan = plan(row, mat, transform, opt);
+    trace_path(opt.tracer, "range", cur_plan.running, mat.is_sparse(), false);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    if (!cur_plan.running) {
+        const auto splits = split_boundaries(row ? mat.nrow() : mat.ncol(), row ? mat.ncol() : mat.nrow(), planned_opt.num_threads);
+        if (splits.empty()) {
+            range_direct(row, mat, output, transform, planned_opt);
+        } else {
+            range_split(row, mat, output, transform, splits, planned_opt);
+        }
     } else {
-        range_running(row, mat, output, opt);
+        range_running(row, mat, output, transform, planned_opt);
     }
 }
 
@@ -407,6 +591,46 @@ RangeResult<Output_> range(bool row, const tatami::Matrix<Value_, Index_>& mat,
     return output;
 }
 
+/**
+ * Overload of `range()` that allocates memory for the minimum/maximum of the transformed values.
+ *
+ * @tparam Value_ Numeric type of the input data.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ * @tparam Output_ Numeric type of the output data.
+ * It is assumed that this is large enough to store the maxima/minima of the transformed values.
+ *
+ * @param row Whether to compute the range for each row.
+ * If false, the range is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ *
+ * @return Minimum and maximum of the transformed values for each row/column.
+ */
+template<typename Value_, typename Index_, class Transform_, typename Output_>
+RangeResult<Output_> range(bool row, const tatami::Matrix<Value_, Index_>& mat, const Transform_& transform, const RangeOptions<Output_>& opt) {
+    RangeResult<Output_> output;
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    tatami::resize_container_to_Index_size(output.minimum, dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    tatami::resize_container_to_Index_size(output.maximum, dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+
+    RangeBuffers<Output_> buffers;
+    buffers.minimum = output.minimum.data();
+    buffers.maximum = output.maximum.data();
+    range(row, mat, buffers, transform, opt);
+
+    return output;
+}
+
 }
 
 #endif
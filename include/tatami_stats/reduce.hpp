@@ -0,0 +1,331 @@
+#ifndef TATAMI_STATS_REDUCE_HPP
+#define TATAMI_STATS_REDUCE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+
+#include "tatami/tatami.hpp"
+#include "sanisizer/sanisizer.hpp"
+#include "auveh/auveh.hpp"
+
+#include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+
+/**
+ * @file reduce.hpp
+ *
+ * @brief Compute user-defined reductions for each row or column of a `tatami::Matrix`.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @brief Options for `reduce()`.
+ */
+struct ReduceOptions {
+    /**
+     * Number of threads to use when computing reductions across a `tatami::Matrix`.
+     * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     */
+    int num_threads = 1;
+
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Workspace to reuse buffers across calls, see @ref common_options_workspace.
+     */
+    Workspace* workspace = NULL;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+};
+
+/**
+ * @cond
+ */
+template<class Policy_>
+using ReduceState = I<decltype(std::declval<const Policy_&>().init())>;
+
+template<typename Value_, typename Index_, typename Output_, class Policy_>
+void reduce_direct(bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* output, const Policy_& policy, const ReduceOptions& opt) {
+    const auto otherdim = (row ? mat.ncol() : mat.nrow());
+
+    if (mat.is_sparse()) {
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "reduce", "compute", thread);
+            tatami::Options topt;
+            topt.sparse_extract_index = false;
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor, topt);
+            std::vector<Value_> vholder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, vholder);
+
+            for (Index_ x = 0; x < l; ++x) {
+                const auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, NULL); });
+                auto state = policy.init();
+                for (Index_ i = 0; i < out.number; ++i) {
+                    policy.update(state, out.value[i]);
+                }
+                if (out.number < otherdim) {
+                    policy.add_zeros(state, static_cast<Index_>(otherdim - out.number));
+                }
+                output[x + s] = policy.finalize(state, otherdim);
+            }
+        }, mat, row, opt);
+
+    } else {
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "reduce", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, holder);
+
+            for (Index_ x = 0; x < l; ++x) {
+                const auto ptr = tscope.fetch([&]() { return ext->fetch(buffer); });
+                auto state = policy.init();
+                for (Index_ i = 0; i < otherdim; ++i) {
+                    policy.update(state, ptr[i]);
+                }
+                output[x + s] = policy.finalize(state, otherdim);
+            }
+        }, mat, row, opt);
+    }
+}
+
+template<typename Value_, typename Index_, typename Output_, class Policy_>
+void reduce_running(bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* output, const Policy_& policy, const ReduceOptions& opt) {
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    const auto otherdim = (row ? mat.ncol() : mat.nrow());
+    typedef ReduceState<Policy_> State;
+
+    if (otherdim == 0) {
+        const auto empty = policy.init();
+        for (Index_ d = 0; d < dim; ++d) {
+            output[d] = policy.finalize(empty, otherdim);
+        }
+        return;
+    }
+
+    // Each thread needs its own states, as they can't be stored in the output buffer prior to finalization.
+    // We don't use PartialBuffers here as the states are initialized by the policy rather than zeroed.
+    const int num_threads = std::max(opt.num_threads, 1);
+    auto state_ptrs = sanisizer::create<std::vector<State*> >(num_threads);
+    std::vector<AllocatedArray<State> > state_holders;
+    if (!opt.workspace) {
+        state_holders.resize(state_ptrs.size());
+    }
+
+    const bool is_sparse = mat.is_sparse();
+    const int nused = parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+        TraceScope tscope(opt.tracer, "reduce", "compute", thread);
+        State* states;
+        if (opt.workspace) {
+            states = opt.workspace->buffer<State>(thread, WORKSPACE_PARTIAL, dim);
+        } else {
+            auto& holder = state_holders[thread];
+            holder = AllocatedArray<State>(opt.allocator, dim);
+            states = holder.data();
+        }
+        tscope.add_bytes(sizeof(State) * static_cast<std::size_t>(dim));
+        std::fill_n(states, dim, policy.init());
+        state_ptrs[thread] = states;
+
+        if (is_sparse) {
+            tatami::Options topt;
+            topt.sparse_ordered_index = false;
+            auto ext = prefetch_consecutive_extractor<true>(mat, !row, s, l, opt.prefetch, opt.executor, topt);
+            std::vector<Value_> vholder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, vholder);
+            std::vector<Index_> iholder;
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, dim, iholder);
+            std::vector<Index_> nholder;
+            const auto nonzeros = workspace_buffer(opt.workspace, thread, WORKSPACE_NONZEROS, dim, nholder);
+            std::fill_n(nonzeros, dim, 0);
+
+            for (Index_ x = 0; x < l; ++x) {
+                const auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                for (Index_ i = 0; i < out.number; ++i) {
+                    const auto d = out.index[i];
+                    policy.update(states[d], out.value[i]);
+                    ++nonzeros[d];
+                }
+            }
+
+            for (Index_ d = 0; d < dim; ++d) {
+                if (nonzeros[d] < l) {
+                    policy.add_zeros(states[d], static_cast<Index_>(l - nonzeros[d]));
+                }
+            }
+
+        } else {
+            auto ext = prefetch_consecutive_extractor<false>(mat, !row, s, l, opt.prefetch, opt.executor);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, holder);
+
+            for (Index_ x = 0; x < l; ++x) {
+                const auto ptr = tscope.fetch([&]() { return ext->fetch(buffer); });
+                for (Index_ d = 0; d < dim; ++d) {
+                    policy.update(states[d], ptr[d]);
+                }
+            }
+        }
+    }, mat, !row, opt);
+
+    // Merging in order of the threads, so that the results are reproducible for a given number of threads.
+    parallelize_merge([&](Index_ start, Index_ length) -> void {
+        const Index_ end = start + length;
+        const auto first = state_ptrs[0];
+        for (Index_ d = start; d < end; ++d) {
+            auto state = first[d];
+            for (int u = 1; u < nused; ++u) {
+                policy.merge(state, state_ptrs[u][d]);
+            }
+            output[d] = policy.finalize(state, otherdim);
+        }
+    }, dim, opt, "reduce");
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Plan the computation of `reduce()`, see `Plan` for details.
+ *
+ * @tparam Policy_ Class of the reduction policy, see `reduce()` for details.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute the reduction for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param opt Options for `reduce()`.
+ *
+ * @return Plan for `reduce()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `ReduceOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<class Policy_, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const ReduceOptions& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = otherdim * sizeof(Value_);
+    model.running_buffer = dim * (sizeof(Value_) + (sparse ? 2 * sizeof(Index_) : 0));
+    model.running_partial_all = dim * sizeof(ReduceState<Policy_>);
+    return choose_plan(model, row, mat, opt);
+}
+
+/**
+ * Compute a user-defined reduction for each element of a chosen dimension of a `tatami::Matrix`.
+ * This handles the choice of iteration path, the skipping of structural zeros in sparse matrices, parallelization and the merging of per-thread results,
+ * so that users only need to implement the arithmetic of the reduction in `policy`.
+ *
+ * `policy` should be an instance of a class with the following `const` methods:
+ *
+ * - `State init()`, which returns the initial state of the reduction for a row/column.
+ *   `State` should be trivially default-constructible, trivially destructible and copyable, e.g., an arithmetic type or a simple struct of arithmetic types.
+ * - `void update(State& state, Value_ x)`, which updates `state` with a (possibly non-zero) value `x` from the row/column.
+ * - `void add_zeros(State& state, Index_ k)`, which updates `state` with `k` zeros.
+ *   This should use a closed-form expression that is equivalent to calling `update()` on `state` with zero for `k` times.
+ *   It is only called for sparse matrices with `k > 0`.
+ * - `void merge(State& left, const State& right)`, which combines the states from two disjoint subsets of the row/column into `left`.
+ * - `Output_ finalize(const State& state, Index_ n)`, which returns the final result of the reduction, given the `state` for all `n` values in the row/column.
+ *
+ * The reduction should be insensitive to the order of values, as the values of each row/column may be visited in any order and split across threads.
+ * If `update()` and `merge()` are not exactly associative, e.g., due to floating-point round-off, the results may vary slightly with the number of threads and the choice of path.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Output_ Type of the output value.
+ * @tparam Policy_ Class of the reduction policy.
+ *
+ * @param row Whether to compute the reduction for each row.
+ * If false, the reduction is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[out] output Pointer to an array of length equal to the number of rows (if `row = true`) or columns (otherwise).
+ * On output, this will contain the result of the reduction for each row/column.
+ * @param policy Policy for the reduction, as described above.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Output_, class Policy_>
+void reduce(bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* output, const Policy_& policy, const ReduceOptions& opt) {
+    const auto cur_plan = plan<Policy_>(row, mat, opt);
+    trace_path(opt.tracer, "reduce", cur_plan.running, mat.is_sparse(), false);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    reserve_workspace(opt.workspace, planned_opt.num_threads);
+    if (!cur_plan.running) {
+        reduce_direct(row, mat, output, policy, planned_opt);
+    } else {
+        reduce_running(row, mat, output, policy, planned_opt);
+    }
+}
+
+/**
+ * Overload of `reduce()` that allocates memory for the output.
+ *
+ * @tparam Output_ Type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Policy_ Class of the reduction policy, see `reduce()` for details.
+ *
+ * @param row Whether to compute the reduction for each row.
+ * If false, the reduction is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param policy Policy for the reduction.
+ * @param opt Further options.
+ *
+ * @return Vector of length equal to the number of rows (if `row = true`) or columns (otherwise),
+ * containing the result of the reduction for each row/column.
+ */
+template<typename Output_ = double, typename Value_, typename Index_, class Policy_>
+std::vector<Output_> reduce(bool row, const tatami::Matrix<Value_, Index_>& mat, const Policy_& policy, const ReduceOptions& opt) {
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    auto output = sanisizer::create<std::vector<Output_> >(dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    reduce(row, mat, output.data(), policy, opt);
+    return output;
+}
+
+}
+
+#endif
@@ -2,6 +2,11 @@
 #define TATAMI_STATS_RSS_HPP
 
 #include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+#include "transform.hpp"
+#include "deterministic.hpp"
+#include "shifted_rss.hpp"
 
 #include <vector>
 #include <cmath>
@@ -9,6 +14,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <optional>
+#include <cassert>
 
 #include "tatami/tatami.hpp"
 #include "sanisizer/sanisizer.hpp"
@@ -31,9 +37,75 @@ struct RssOptions {
     /**
      * Number of threads to use for iterating over a `tatami::Matrix`.
      * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     * On the direct path, the other dimension may also be split across threads if there are fewer rows/columns than threads, see `split_other`.
      */
     int num_threads = 1;
 
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Whether the running path should give the same results for any `num_threads`.
+     * If true, the rows/columns are processed in fixed blocks that do not depend on the number of threads,
+     * and the partial means and RSS for the blocks are combined in a fixed order, so the results are bitwise identical for any `num_threads`.
+     * This is slightly slower and stores a few more partial results per thread.
+     * The direct path is deterministic as `split_other` is ignored in this mode, but note that `plan()` may choose a different path for different `num_threads` if `strategy = PlanStrategy::COST` or `max_memory_bytes` is set.
+     */
+    bool deterministic = false;
+
+    /**
+     * Whether to split the other dimension across threads on the direct path when there are fewer rows/columns than threads.
+     * If true, the partial means and RSS values for each block of the other dimension are combined afterwards.
+     * This improves parallelization for short, wide matrices but the results will differ slightly from those with `split_other = false` due to round-off, and will depend on `num_threads`.
+     * Ignored if `deterministic = true`.
+     */
+    bool split_other = false;
+
+    /**
+     * Whether the running path should accumulate shifted sums instead of using Welford's algorithm, see `shifted_rss.hpp` for details.
+     * This avoids a division for each element, at the cost of two more arrays of length equal to the number of rows/columns in each thread.
+     */
+    bool shifted_sums = false;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Workspace to reuse buffers across calls, see @ref common_options_workspace.
+     */
+    Workspace* workspace = NULL;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+
     /**
      * Placeholder value to use for the mean when the extent of the relevant dimension is zero.
      * This is NaN if supported by `Output_`, otherwise it is zero.
@@ -64,9 +136,8 @@ struct RssBuffers {
 /**
  * @cond
  */
-template<typename Value_, typename Index_, typename Output_>
-void rss_direct(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_>& output, const RssOptions<Output_>& opt) {
-    const auto dim = (row ? mat.nrow() : mat.ncol());
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void rss_direct(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_>& output, const Transform_& transform, const RssOptions<Output_>& opt) {
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
     quickstats::RssOptions<Output_> ropt;
     ropt.mean_placeholder = opt.mean_placeholder;
@@ -75,35 +146,55 @@ void rss_direct(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<
         tatami::Options topt;
         topt.sparse_extract_index = false;
 
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<true>(mat, row, s, l, topt);
-            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            quickstats::RssWorkspace<Output_> work;
+        // Shifting the transformed values so that the structural zeros are still zero. This doesn't affect the RSS, only the mean.
+        const auto zero = transformed_zero<Output_, Value_>(transform);
+
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "rss", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor, topt);
+            std::vector<Value_> vholder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, vholder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            quickstats::RssWorkspace<Output_> wholder;
+            auto& work = workspace_object(opt.workspace, thread, WORKSPACE_VALUES, wholder);
             for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(vbuffer.data(), NULL);
-                const auto res = quickstats::rss(otherdim, out.number, out.value, work, ropt);
+                auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, NULL); });
+                const auto vals = transform_values(transform, out.value, out.number, tbuffer, zero);
+                const auto res = quickstats::rss(otherdim, out.number, vals, work, ropt);
                 output.mean[x + s] = res.mean;
                 output.rss[x + s] = res.rss;
+                if constexpr(!transform_preserves_zero<Transform_>) {
+                    if (otherdim > 0) {
+                        output.mean[x + s] += zero;
+                    }
+                }
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
 
     } else {
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<false>(mat, row, s, l);
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            quickstats::RssWorkspace<Output_> work;
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "rss", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, holder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            quickstats::RssWorkspace<Output_> wholder;
+            auto& work = workspace_object(opt.workspace, thread, WORKSPACE_VALUES, wholder);
             for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(buffer.data());
-                const auto res = quickstats::rss(otherdim, out, work, ropt);
+                auto out = tscope.fetch([&]() { return ext->fetch(buffer); });
+                const auto vals = transform_values(transform, out, otherdim, tbuffer, static_cast<Output_>(0));
+                const auto res = quickstats::rss(otherdim, vals, work, ropt);
                 output.mean[x + s] = res.mean;
                 output.rss[x + s] = res.rss;
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
     }
 }
 
-template<typename Value_, typename Index_, typename Output_>
-void rss_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_>& output, const RssOptions<Output_>& opt) {
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void rss_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_>& output, const Transform_& transform, const RssOptions<Output_>& opt) {
     const auto dim = (row ? mat.nrow() : mat.ncol());
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
     if (otherdim == 0) {
@@ -112,142 +203,386 @@ void rss_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers
         return;
     }
 
-    assert(opt.num_threads > 0);
-    const bool do_parallel = opt.num_threads > 1;
-    std::optional<std::vector<std::optional<std::vector<Output_> > > > all_partial_mean, all_partial_rss;
-    std::optional<std::vector<Index_> > all_partial_count;
-    if (do_parallel) {
-        // -1, as we'll repurpose the RSS output buffer to store the partial RSS of the first thread.
-        all_partial_rss.emplace(sanisizer::cast<I<decltype(all_partial_rss->size())> >(opt.num_threads - 1));
-        all_partial_mean.emplace(sanisizer::cast<I<decltype(all_partial_mean->size())> >(opt.num_threads));
-        all_partial_count.emplace(sanisizer::cast<I<decltype(all_partial_count->size())> >(opt.num_threads));
-    }
+    // For sparse matrices, the transformed values are shifted so that structural zeros are still zero, see rss_direct().
+    const bool is_sparse = mat.is_sparse();
+    const auto zero = transformed_zero<Output_, Value_>(transform);
 
-    // We overwrite any existing mean value in the array in the do_parallel=true situation.
-    // So, the initial value doesn't need to be zero.
-    if (!do_parallel) {
-        std::fill_n(output.mean, dim, 0);
-    }
-    std::fill_n(output.rss, dim, 0);
+    // Each worker computes the mean and RSS of the next 'number' vectors from its range in 'partial[0]' and 'partial[1]', respectively.
+    const auto create_sparse_worker = [&](int thread, Index_ s, Index_ l) {
+        tatami::Options topt;
+        topt.sparse_ordered_index = false;
+        auto ext = prefetch_consecutive_extractor<true>(mat, !row, s, l, opt.prefetch, opt.executor, topt);
+        return [
+            &,
+            thread,
+            ext = std::move(ext),
+            vholder = std::vector<Value_>(),
+            iholder = std::vector<Index_>(),
+            nholder = std::vector<Index_>(),
+            sholder = std::vector<Output_>(),
+            ssholder = std::vector<Output_>()
+        ](
+            TraceScope& tscope,
+            Index_ number,
+            Output_* const* partial,
+            Index_* counts
+        ) mutable -> void {
+            const auto mean_ptr = partial[0];
+            const auto rss_ptr = partial[1];
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, vholder);
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, dim, iholder);
+            const auto nonzeros = workspace_buffer(opt.workspace, thread, WORKSPACE_NONZEROS, dim, nholder);
+            std::fill_n(nonzeros, dim, 0);
+
+            if (opt.shifted_sums) {
+                const auto sum = workspace_buffer(opt.workspace, thread, WORKSPACE_SHIFTED, dim, sholder);
+                const auto sum_squares = workspace_buffer(opt.workspace, thread, WORKSPACE_SHIFTED + 1, dim, ssholder);
+                std::fill_n(sum, dim, 0);
+                std::fill_n(sum_squares, dim, 0);
+
+                for (Index_ x = 0; x < number; ++x) {
+                    auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                    AUVEH_NODEP
+                    for (Index_ i = 0; i < out.number; ++i) {
+                        const auto d = out.index[i];
+                        const Output_ val = transform_value(transform, out.value[i], zero);
+                        // Using the first non-zero value of each element as its shift, see shifted_rss.hpp.
+                        auto& shift = mean_ptr[d];
+                        shift = (nonzeros[d] == 0 ? val : shift);
+                        const Output_ delta = val - shift;
+                        sum[d] += delta;
+                        sum_squares[d] += delta * delta;
+                        ++nonzeros[d];
+                    }
+                }
 
-    const bool is_sparse = mat.is_sparse();
-    const int nused = tatami::parallelize([&](int thread, Index_ s, Index_ l) -> void {
-        Output_* rss_ptr;
-        Output_* mean_ptr;
-        std::optional<std::vector<Output_> > cur_rss, cur_mean;
+                AUVEH_NODEP
+                for (Index_ d = 0; d < dim; ++d) {
+                    shifted_rss_fold_with_zeros<Output_>(mean_ptr[d], rss_ptr[d], sum[d], sum_squares[d], 0, number, nonzeros[d]);
+                }
 
-        if (!do_parallel) {
-            // Storing mean and RSS directly in the output vector to cut down two allocations if we're not working in parallel.
-            rss_ptr = output.rss;
-            mean_ptr = output.mean;
-        } else {
-            // Storing the partial RSS directly in the output vector to save ourselves an allocation if we're in the first thread.
-            // We can't do the same for the mean, though, as we need to keep the partial mean and the global mean separate for the reduction.
-            cur_mean.emplace(tatami::cast_Index_to_container_size<std::vector<Output_> >(dim));
-            mean_ptr = cur_mean->data();
-            if (thread == 0) {
-                rss_ptr = output.rss;
-            } else {
-                cur_rss.emplace(tatami::cast_Index_to_container_size<std::vector<Output_> >(dim));
-                rss_ptr = cur_rss->data();
+                if (counts) {
+                    counts[0] = number;
+                }
+                return;
             }
-        }
-
-        if (is_sparse) {
-            tatami::Options topt;
-            topt.sparse_ordered_index = false;
-            auto ext = tatami::consecutive_extractor<true>(mat, !row, s, l, topt);
-            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
-            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
-            auto nonzeros = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
 
-            for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(vbuffer.data(), ibuffer.data());
+            for (Index_ x = 0; x < number; ++x) {
+                auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
                 AUVEH_NODEP
                 for (Index_ i = 0; i < out.number; ++i) {
                     const auto d = out.index[i];
                     auto& nnz = nonzeros[d];
-                    quickstats::update_rss(mean_ptr[d], rss_ptr[d], out.value[i], ++nnz); // increment is safe as 'nnz + 1 <= l' fits in an Index_;
+                    quickstats::update_rss(mean_ptr[d], rss_ptr[d], transform_value(transform, out.value[i], zero), ++nnz); // increment is safe as 'nnz + 1 <= number' fits in an Index_;
                 }
             }
 
             AUVEH_NODEP
             for (Index_ d = 0; d < dim; ++d) {
-                // otherdim > 0 is guaranteed, so we can use the unsafe version.
-                quickstats::update_rss_with_zeros_unsafe(mean_ptr[d], rss_ptr[d], static_cast<Index_>(l - nonzeros[d]), l);
+                // number > 0 is guaranteed, so we can use the unsafe version.
+                quickstats::update_rss_with_zeros_unsafe(mean_ptr[d], rss_ptr[d], static_cast<Index_>(number - nonzeros[d]), number);
             }
 
-        } else {
-            auto ext = tatami::consecutive_extractor<false>(mat, !row, s, l);
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
+            if (counts) {
+                counts[0] = number;
+            }
+        };
+    };
+
+    const auto create_dense_worker = [&](int thread, Index_ s, Index_ l) {
+        auto ext = prefetch_consecutive_extractor<false>(mat, !row, s, l, opt.prefetch, opt.executor);
+        return [&, thread, ext = std::move(ext), holder = std::vector<Value_>(), sholder = std::vector<Output_>(), ssholder = std::vector<Output_>()](
+            TraceScope& tscope,
+            Index_ number,
+            Output_* const* partial,
+            Index_* counts
+        ) mutable -> void {
+            const auto mean_ptr = partial[0];
+            const auto rss_ptr = partial[1];
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, holder);
+
+            if (opt.shifted_sums) {
+                const auto sum = workspace_buffer(opt.workspace, thread, WORKSPACE_SHIFTED, dim, sholder);
+                const auto sum_squares = workspace_buffer(opt.workspace, thread, WORKSPACE_SHIFTED + 1, dim, ssholder);
+                std::fill_n(sum, dim, 0);
+                std::fill_n(sum_squares, dim, 0);
+
+                Index_ folded = 0;
+                for (Index_ x = 0; x < number; ++x) {
+                    auto out = tscope.fetch([&]() { return ext->fetch(buffer); });
+                    if (x == 0) {
+                        AUVEH_NODEP
+                        for (Index_ d = 0; d < dim; ++d) {
+                            mean_ptr[d] = transform_value(transform, out[d], static_cast<Output_>(0));
+                        }
+                    }
+
+                    AUVEH_NODEP
+                    for (Index_ d = 0; d < dim; ++d) {
+                        const Output_ delta = transform_value(transform, out[d], static_cast<Output_>(0)) - mean_ptr[d];
+                        sum[d] += delta;
+                        sum_squares[d] += delta * delta;
+                    }
+
+                    const Index_ block_count = x - folded + 1; // fits in an Index_ as it is no greater than 'number'.
+                    if (static_cast<std::size_t>(block_count) == SHIFTED_RSS_BLOCK_SIZE || x + 1 == number) {
+                        AUVEH_NODEP
+                        for (Index_ d = 0; d < dim; ++d) {
+                            shifted_rss_fold<Output_>(mean_ptr[d], rss_ptr[d], sum[d], sum_squares[d], folded, block_count);
+                        }
+                        folded = x + 1;
+                    }
+                }
 
-            for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(buffer.data());
-                AUVEH_NODEP
-                for (Index_ d = 0; d < dim; ++d) {
-                    quickstats::update_rss(mean_ptr[d], rss_ptr[d], out[d], x + 1); // increment is safe as ' x + 1 <= l' fits in an Index_.
+            } else {
+                for (Index_ x = 0; x < number; ++x) {
+                    auto out = tscope.fetch([&]() { return ext->fetch(buffer); });
+                    AUVEH_NODEP
+                    for (Index_ d = 0; d < dim; ++d) {
+                        quickstats::update_rss(mean_ptr[d], rss_ptr[d], transform_value(transform, out[d], static_cast<Output_>(0)), x + 1); // increment is safe as ' x + 1 <= number' fits in an Index_.
+                    }
                 }
             }
+
+            if (counts) {
+                counts[0] = number;
+            }
+        };
+    };
+
+    const auto run = [&](const auto& create_worker) -> void {
+        if (opt.deterministic) {
+            Output_* const outputs[2] = { output.mean, output.rss };
+            deterministic_running<Output_>(
+                deterministic_leaves(mat, !row, dim, 2, opt),
+                2,
+                dim,
+                1,
+                create_worker,
+                [](Output_* const* left, const Index_* left_count, Output_* const* right, const Index_* right_count, Index_ start, Index_ end) -> void {
+                    const auto lmean = left[0], lrss = left[1], rmean = right[0], rrss = right[1];
+                    const Output_ lcount = left_count[0], rcount = right_count[0];
+                    AUVEH_NODEP
+                    for (Index_ d = start; d < end; ++d) {
+                        deterministic_merge_rss(lmean[d], lrss[d], lcount, rmean[d], rrss[d], rcount);
+                    }
+                },
+                outputs,
+                static_cast<Index_*>(NULL),
+                opt,
+                "rss"
+            );
+            return;
         }
 
+        assert(opt.num_threads > 0);
+        const bool do_parallel = opt.num_threads > 1;
+        std::optional<PartialBuffers<Output_> > all_partial_mean, all_partial_rss;
+        std::optional<std::vector<Index_> > all_partial_count;
         if (do_parallel) {
-            (*all_partial_count)[thread] = l;
-            (*all_partial_mean)[thread] = std::move(cur_mean);
-            if (thread > 0) {
-                (*all_partial_rss)[thread - 1] = std::move(cur_rss);
-            }
+            // The first thread's partial RSS is stored in the RSS output buffer, so its entry in all_partial_rss is unused.
+            all_partial_rss.emplace(opt.workspace, WORKSPACE_PARTIAL, opt.num_threads, opt.allocator);
+            all_partial_mean.emplace(opt.workspace, WORKSPACE_PARTIAL + 1, opt.num_threads, opt.allocator);
+            all_partial_count.emplace(sanisizer::cast<I<decltype(all_partial_count->size())> >(opt.num_threads));
         }
-    }, otherdim, opt.num_threads);
-    assert(nused > 0);
-
-    // Don't check nused > 1, as it's possible for do_parallel = true with nused = 1 if not all threads are used.
-    // This would cause us to leave output.mean and output.rss empty.
-    if (do_parallel) {
-        const auto& ap_count = *all_partial_count;
-        const auto& ap_mean = *all_partial_mean;
-        const auto& ap_rss = *all_partial_rss;
-
-        // Computing the global mean. All ap_count is positive so we don't have to worry about cur_mean[d] being NaN.
-        for (int u = 0; u < nused; ++u) {
-            const Output_ mult = static_cast<Output_>(ap_count[u]) / static_cast<Output_>(otherdim);
-            const auto& cur_mean = *(ap_mean[u]);
-            if (u == 0) {
-                AUVEH_NODEP
-                for (Index_ d = 0; d < dim; ++d) {
-                    output.mean[d] = cur_mean[d] * mult;
-                }
+
+        // We overwrite any existing mean value in the array in the do_parallel=true situation.
+        // So, the initial value doesn't need to be zero.
+        if (!do_parallel) {
+            std::fill_n(output.mean, dim, 0);
+        }
+        std::fill_n(output.rss, dim, 0);
+
+        const int nused = parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "rss", "compute", thread);
+            Output_* partial[2];
+            auto& mean_ptr = partial[0];
+            auto& rss_ptr = partial[1];
+
+            if (!do_parallel) {
+                // Storing mean and RSS directly in the output vector to cut down two allocations if we're not working in parallel.
+                rss_ptr = output.rss;
+                mean_ptr = output.mean;
             } else {
-                AUVEH_NODEP
-                for (Index_ d = 0; d < dim; ++d) {
-                    output.mean[d] += cur_mean[d] * mult;
+                // Storing the partial RSS directly in the output vector to save ourselves an allocation if we're in the first thread.
+                // We can't do the same for the mean, though, as we need to keep the partial mean and the global mean separate for the reduction.
+                mean_ptr = all_partial_mean->acquire(thread, dim)[0];
+                tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim));
+                if (thread == 0) {
+                    rss_ptr = output.rss;
+                } else {
+                    rss_ptr = all_partial_rss->acquire(thread, dim)[0];
+                    tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim));
                 }
             }
-        }
 
-        // Combining the RSS. We can use recenter_rss_unsafe() as we are guaranteed that cur_count > 0,
-        // as parallelize() will only ever split into non-empty ranges if those ranges are used.
-        for (int u = 0; u < nused; ++u) {
-            const auto cur_count = ap_count[u];
-            const auto& cur_mean = *(ap_mean[u]);
-            if (u == 0) {
-                AUVEH_NODEP
-                for (Index_ d = 0; d < dim; ++d) {
-                    output.rss[d] = quickstats::recenter_rss_unsafe(cur_count, output.rss[d], cur_mean[d], output.mean[d]); 
+            auto worker = create_worker(thread, s, l);
+            worker(tscope, l, partial, NULL);
+
+            if (do_parallel) {
+                (*all_partial_count)[thread] = l;
+            }
+        }, mat, !row, opt);
+        assert(nused > 0);
+
+        // Don't check nused > 1, as it's possible for do_parallel = true with nused = 1 if not all threads are used.
+        // This would cause us to leave output.mean and output.rss empty.
+        if (do_parallel) {
+            parallelize_merge([&](Index_ start, Index_ length) -> void {
+                const Index_ end = start + length;
+                const auto& ap_count = *all_partial_count;
+                const auto& ap_mean = *all_partial_mean;
+                const auto& ap_rss = *all_partial_rss;
+
+                // Computing the global mean. All ap_count is positive so we don't have to worry about cur_mean[d] being NaN.
+                for (int u = 0; u < nused; ++u) {
+                    const Output_ mult = static_cast<Output_>(ap_count[u]) / static_cast<Output_>(otherdim);
+                    const auto cur_mean = ap_mean.get(u)[0];
+                    if (u == 0) {
+                        AUVEH_NODEP
+                        for (Index_ d = start; d < end; ++d) {
+                            output.mean[d] = cur_mean[d] * mult;
+                        }
+                    } else {
+                        AUVEH_NODEP
+                        for (Index_ d = start; d < end; ++d) {
+                            output.mean[d] += cur_mean[d] * mult;
+                        }
+                    }
                 }
-            } else {
-                const auto& cur_rss = *(ap_rss[u - 1]);
-                AUVEH_NODEP
-                for (Index_ d = 0; d < dim; ++d) {
-                    output.rss[d] += quickstats::recenter_rss_unsafe(cur_count, cur_rss[d], cur_mean[d], output.mean[d]); 
+
+                // Combining the RSS. We can use recenter_rss_unsafe() as we are guaranteed that cur_count > 0,
+                // as parallelize() will only ever split into non-empty ranges if those ranges are used.
+                for (int u = 0; u < nused; ++u) {
+                    const auto cur_count = ap_count[u];
+                    const auto cur_mean = ap_mean.get(u)[0];
+                    if (u == 0) {
+                        AUVEH_NODEP
+                        for (Index_ d = start; d < end; ++d) {
+                            output.rss[d] = quickstats::recenter_rss_unsafe(cur_count, output.rss[d], cur_mean[d], output.mean[d]); 
+                        }
+                    } else {
+                        const auto cur_rss = ap_rss.get(u)[0];
+                        AUVEH_NODEP
+                        for (Index_ d = start; d < end; ++d) {
+                            output.rss[d] += quickstats::recenter_rss_unsafe(cur_count, cur_rss[d], cur_mean[d], output.mean[d]); 
+                        }
+                    }
                 }
+            }, dim, opt, "rss");
+        }
+    };
+
+    if (is_sparse) {
+        run(create_sparse_worker);
+    } else {
+        run(create_dense_worker);
+    }
+
+    if constexpr(!transform_preserves_zero<Transform_>) {
+        if (is_sparse) {
+            for (Index_ d = 0; d < dim; ++d) {
+                output.mean[d] += zero;
             }
         }
     }
 }
+
+// Splitting the other dimension across threads when 'dim' is too small to occupy them, see split_boundaries().
+// The per-block means and RSS values are merged with Chan's method.
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void rss_split(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_>& output, const Transform_& transform, const std::vector<Index_>& boundaries, const RssOptions<Output_>& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t num_blocks = boundaries.size() - 1;
+    const auto partial_size = sanisizer::product<typename std::vector<Output_>::size_type>(num_blocks, dim);
+    auto partial_mean = sanisizer::create<std::vector<Output_> >(partial_size);
+    auto partial_rss = sanisizer::create<std::vector<Output_> >(partial_size);
+
+    auto block_opt = split_options(opt);
+    block_opt.workspace = NULL;
+    parallelize_split([&](int b, const tatami::Matrix<Value_, Index_>& block) -> void {
+        const std::size_t offset = static_cast<std::size_t>(b) * dim;
+        RssBuffers<Output_> buffers;
+        buffers.mean = partial_mean.data() + offset;
+        buffers.rss = partial_rss.data() + offset;
+        rss_direct(row, block, buffers, transform, block_opt);
+    }, mat, row, boundaries, opt.executor);
+
+    std::copy_n(partial_mean.begin(), dim, output.mean);
+    std::copy_n(partial_rss.begin(), dim, output.rss);
+    Output_ count = boundaries[1];
+    for (std::size_t b = 1; b < num_blocks; ++b) {
+        const std::size_t offset = b * dim;
+        const Output_ block_count = boundaries[b + 1] - boundaries[b];
+        for (std::size_t d = 0; d < dim; ++d) {
+            deterministic_merge_rss(output.mean[d], output.rss[d], count, partial_mean[offset + d], partial_rss[offset + d], block_count);
+        }
+        count += block_count;
+    }
+}
 /**
  * @endcond
  */
 
+/**
+ * Plan the computation of `rss()`, see `Plan` for details.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute the RSS for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param opt Options for `rss()`.
+ *
+ * @return Plan for `rss()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `RssOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Output_, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const RssOptions<Output_>& opt) {
+    return plan(row, mat, IdentityTransform(), opt);
+}
+
+/**
+ * Plan the computation of `rss()` with a transformation, see `Plan` for details.
+ * This is the same as the other `plan()` overload, except that the estimated memory usage includes the buffers for the transformed values.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the RSS for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Options for `rss()`.
+ *
+ * @return Plan for `rss()` with the supplied arguments.
+ */
+template<typename Output_, typename Value_, typename Index_, class Transform_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const Transform_& transform, const RssOptions<Output_>& opt) {
+    (void)transform;
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = otherdim * (sizeof(Value_) + (is_identity_transform<Transform_> ? 0 : sizeof(Output_)));
+    model.running_buffer = dim * (sizeof(Value_) + (sparse ? 2 * sizeof(Index_) : 0) + (opt.shifted_sums ? 2 * sizeof(Output_) : 0));
+    if (opt.deterministic) {
+        model.running_deterministic_node = deterministic_node_memory<Output_>(2, dim);
+    } else {
+        model.running_partial_all = dim * sizeof(Output_);
+        model.running_partial_rest = dim * sizeof(Output_);
+    }
+    if (opt.split_other && !opt.deterministic) {
+        model.direct_split_partial = dim * 2 * sizeof(Output_);
+    }
+    return choose_plan(model, row, mat, opt);
+}
+
 /**
  * Compute residual sums of squares (RSS) for each element of a chosen dimension of a `tatami::Matrix`.
  * This may use either Welford's method or the standard two-pass method,
@@ -266,10 +601,44 @@ void rss_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers
  */
 template<typename Value_, typename Index_, typename Output_>
 void rss(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_>& output, const RssOptions<Output_>& opt) {
-    if (mat.prefer_rows() == row) {
-        rss_direct(row, mat, output, opt);
+    rss(row, mat, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute the RSS of transformed values for each element of a chosen dimension of a `tatami::Matrix`.
+ * This is equivalent to calling the other `rss()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformation is performed inside the kernels to avoid a separate pass over each extracted row/column.
+ *
+ * @tparam Value_ Numeric type of the input data.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the RSS for each row.
+ * If false, the RSS is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[out] output Buffers to output arrays.
+ * On output, this will contain the row/column means and RSSs of the transformed values.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void rss(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_>& output, const Transform_& transform, const RssOptions<Output_>& opt) {
+    const auto cur_plan = plan(row, mat, transform, opt);
+    trace_path(opt.tracer, "rss", cur_plan.running, mat.is_sparse(), false);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    reserve_workspace(opt.workspace, planned_opt.num_threads);
+    if (!cur_plan.running) {
+        // Splitting the other dimension makes the results depend on the number of threads, so it is opt-in and skipped in deterministic mode.
+        const auto splits = (!planned_opt.split_other || planned_opt.deterministic ? std::vector<Index_>() : split_boundaries(row ? mat.nrow() : mat.ncol(), row ? mat.ncol() : mat.nrow(), planned_opt.num_threads));
+        if (splits.empty()) {
+            rss_direct(row, mat, output, transform, planned_opt);
+        } else {
+            rss_split(row, mat, output, transform, splits, planned_opt);
+        }
     } else {
-        rss_running(row, mat, output, opt);
+        rss_running(row, mat, output, transform, planned_opt);
     }
 }
 
@@ -330,6 +699,45 @@ RssResult<Output_> rss(bool row, const tatami::Matrix<Value_, Index_>& mat, cons
     return output;
 }
 
+/**
+ * Overload of `rss()` that allocates memory for the output arrays, for transformed values.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Value_ Numeric type of the input data.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the RSS for each row.
+ * If false, the RSS is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ *
+ * @return The mean and RSS of the transformed values in each row/column.
+ */
+template<typename Output_ = double, typename Value_, typename Index_, class Transform_>
+RssResult<Output_> rss(bool row, const tatami::Matrix<Value_, Index_>& mat, const Transform_& transform, const RssOptions<Output_>& opt) {
+    RssResult<Output_> output;
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    tatami::resize_container_to_Index_size(output.mean, dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    tatami::resize_container_to_Index_size(output.rss, dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+
+    RssBuffers<Output_> buffers;
+    buffers.mean = output.mean.data();
+    buffers.rss = output.rss.data();
+
+    rss(row, mat, buffers, transform, opt);
+    return output;
+}
+
 }
 
 #endif
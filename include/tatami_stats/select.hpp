@@ -0,0 +1,293 @@
+#ifndef TATAMI_STATS_SELECT_HPP
+#define TATAMI_STATS_SELECT_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+#include "tatami/tatami.hpp"
+#include "sanisizer/sanisizer.hpp"
+
+#include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+#include "trace.hpp"
+#include "transform.hpp"
+
+/**
+ * @file select.hpp
+ *
+ * @brief Parallel selection of quantiles within a single long vector.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @cond
+ */
+// Parallel selection is only worthwhile for very long vectors, where the cost of a sequential selection dominates the thread overhead.
+constexpr std::size_t PARALLEL_SELECT_MIN_SIZE = 1048576;
+
+// Number of values to sample for choosing the pivots.
+// The rank of the target in the sample has a standard deviation of at most sqrt(sample)/2, so we pad the pivots by 4 standard deviations on either side.
+// This leaves a few percent of the vector as candidates for the final sequential selection, and the pivots rarely miss.
+constexpr std::size_t PARALLEL_SELECT_SAMPLE_SIZE = 16384;
+
+inline bool parallel_select_should_use(const int num_threads, const std::size_t dim, const std::size_t otherdim) {
+    return num_threads > 1 && dim < static_cast<std::size_t>(num_threads) && otherdim >= PARALLEL_SELECT_MIN_SIZE;
+}
+
+// Computes the quantile of 'num' non-NaN values in 'ptr' and 'num_zeros' implicit zeros with the same interpolation as quickstats, using 'num_threads' threads.
+// We sample the values to choose two pivots that are likely to bracket the target ranks,
+// count the values below and between the pivots in parallel, and gather the values between the pivots into a smaller buffer for a sequential selection.
+// If the pivots do not bracket the target ranks, we fall back to a sequential selection on the entire vector.
+// The implicit zeros are never materialized; they are treated as a single block of known size when sampling, counting and selecting,
+// so sparse vectors only need a buffer for their non-zero values.
+// The contents of 'ptr' are not modified, except in the fallback where they may be reordered.
+template<typename Output_, typename Value_>
+Output_ parallel_select_quantile(
+    Value_* const ptr,
+    const std::size_t num,
+    const std::size_t num_zeros,
+    const double prob,
+    const int num_threads,
+    Executor* const executor,
+    const std::size_t sample_size = PARALLEL_SELECT_SAMPLE_SIZE)
+{
+    const std::size_t total = sanisizer::sum<std::size_t>(num, num_zeros);
+    if (total == 0) {
+        return std::numeric_limits<Output_>::quiet_NaN();
+    }
+
+    const double position = static_cast<double>(total - 1) * prob;
+    const std::size_t lower_rank = std::floor(position), upper_rank = std::ceil(position);
+    const double fraction = position - static_cast<double>(lower_rank);
+
+    // Selecting from the candidates plus 'candidate_zeros' implicit zeros, where 'offset' is the number of values below all candidates.
+    // The implicit zeros sit between the negative and non-negative candidates, so we only need to partition the candidates if there are any implicit zeros.
+    const auto interpolate = [&](Value_* const candidates, const std::size_t num_candidates, const std::size_t candidate_zeros, const std::size_t offset) -> Output_ {
+        const auto candidates_end = candidates + num_candidates;
+        const auto nonnegative = (candidate_zeros ? std::partition(candidates, candidates_end, [](const Value_ val) -> bool { return val < 0; }) : candidates);
+        const std::size_t num_negative = nonnegative - candidates;
+
+        const std::size_t lower = lower_rank - offset;
+        Output_ lower_val;
+        Value_* next_start = NULL;
+        Value_* next_end = NULL;
+        if (lower < num_negative) {
+            const auto lower_it = candidates + lower;
+            std::nth_element(candidates, lower_it, nonnegative);
+            lower_val = *lower_it;
+            next_start = lower_it + 1;
+            next_end = nonnegative; // if this is empty, the next value must be an implicit zero.
+        } else if (lower < num_negative + candidate_zeros) {
+            lower_val = 0;
+            if (lower + 1 == num_negative + candidate_zeros) {
+                next_start = nonnegative;
+                next_end = candidates_end;
+            }
+        } else {
+            const auto lower_it = candidates + (lower - candidate_zeros);
+            std::nth_element(nonnegative, lower_it, candidates_end);
+            lower_val = *lower_it;
+            next_start = lower_it + 1;
+            next_end = candidates_end;
+        }
+
+        if (upper_rank == lower_rank) {
+            return lower_val;
+        }
+        const Output_ upper_val = (next_start == next_end ? 0 : *std::min_element(next_start, next_end));
+        return lower_val + (upper_val - lower_val) * fraction;
+    };
+
+    // Sampling at regular intervals, which is still representative if the values are sorted.
+    // The implicit zeros are treated as a block after the explicit values.
+    const std::size_t num_sample = std::min(total, std::max(sample_size, static_cast<std::size_t>(1)));
+    auto sample = sanisizer::create<std::vector<Value_> >(num_sample);
+    for (std::size_t i = 0; i < num_sample; ++i) {
+        const std::size_t j = static_cast<double>(i) / static_cast<double>(num_sample) * static_cast<double>(total);
+        sample[i] = (j < num ? ptr[j] : 0);
+    }
+    std::sort(sample.begin(), sample.end());
+
+    const std::size_t padding = 2 * std::ceil(std::sqrt(static_cast<double>(num_sample))) + 1;
+    const double scale = static_cast<double>(num_sample) / static_cast<double>(total);
+    const std::size_t lower_sample = std::floor(static_cast<double>(lower_rank) * scale);
+    const std::size_t upper_sample = std::ceil(static_cast<double>(upper_rank) * scale);
+    const bool has_lower = lower_sample >= padding;
+    const bool has_upper = sanisizer::sum<std::size_t>(upper_sample, padding) < num_sample;
+    if (!has_lower && !has_upper) {
+        return interpolate(ptr, num, num_zeros, 0);
+    }
+    const Value_ lower_pivot = (has_lower ? sample[lower_sample - padding] : Value_());
+    const Value_ upper_pivot = (has_upper ? sample[upper_sample + padding] : Value_());
+
+    const auto in_range = [&](const Value_ val) -> bool {
+        return (!has_lower || val >= lower_pivot) && (!has_upper || val <= upper_pivot);
+    };
+
+    const auto boundaries = equal_boundaries(num, num_threads);
+    const auto num_chunks = boundaries.size() - 1;
+    std::vector<std::size_t> below(num_chunks), between(num_chunks);
+    parallelize_by_boundaries([&](int c, std::size_t start, std::size_t length) -> void {
+        std::size_t cur_below = 0, cur_between = 0;
+        for (std::size_t i = start, end = start + length; i < end; ++i) {
+            const auto val = ptr[i];
+            cur_below += (has_lower && val < lower_pivot);
+            cur_between += in_range(val);
+        }
+        below[c] = cur_below;
+        between[c] = cur_between;
+    }, boundaries, executor);
+
+    std::size_t total_below = 0, total_between = 0;
+    std::vector<std::size_t> offsets(num_chunks);
+    for (std::size_t c = 0; c < num_chunks; ++c) {
+        total_below += below[c];
+        offsets[c] = total_between;
+        total_between += between[c];
+    }
+
+    std::size_t zeros_between = 0;
+    if (has_lower && 0 < lower_pivot) {
+        total_below += num_zeros;
+    } else if (in_range(0)) {
+        zeros_between = num_zeros;
+    }
+    if (total_below > lower_rank || upper_rank >= total_below + total_between + zeros_between) {
+        return interpolate(ptr, num, num_zeros, 0);
+    }
+
+    auto candidates = sanisizer::create<std::vector<Value_> >(total_between);
+    parallelize_by_boundaries([&](int c, std::size_t start, std::size_t length) -> void {
+        auto output = candidates.data() + offsets[c];
+        for (std::size_t i = start, end = start + length; i < end; ++i) {
+            const auto val = ptr[i];
+            if (in_range(val)) {
+                *output = val;
+                ++output;
+            }
+        }
+    }, boundaries, executor);
+
+    return interpolate(candidates.data(), total_between, zeros_between, total_below);
+}
+
+// Copies the transformed non-zero values of a sparse vector into a modifiable buffer for quantile calculations, see copy_transformed_values().
+// Values are shifted by the transformed zero so that the structural zeros are still zero; the caller should add it back to the quantile.
+// Returns NULL if the quantile lies among the structural zeros, in which case it is equal to the transformed zero.
+// For the identity, this is checked before copying so that the copy can be skipped altogether.
+template<typename Output_, typename Value_, typename Index_, class Transform_>
+TransformedValue<Value_, Output_, Transform_>* copy_sparse_for_quantile(
+    const Transform_& transform,
+    const Value_* const value,
+    const Index_ num_nonzero,
+    const Index_ num_all,
+    const double prob,
+    const bool skip_nan,
+    Value_* const value_buffer,
+    Output_* const buffer,
+    const Output_ zero
+) {
+    if constexpr(is_identity_transform<Transform_>) {
+        if (sparse_quantile_is_zero(value, num_nonzero, num_all, prob, skip_nan)) {
+            return NULL;
+        }
+    }
+
+    const auto copy = copy_transformed_values(transform, value, num_nonzero, value_buffer, buffer, zero);
+
+    if constexpr(!is_identity_transform<Transform_>) {
+        if (sparse_quantile_is_zero(copy, num_nonzero, num_all, prob, skip_nan)) {
+            return NULL;
+        }
+    }
+
+    return copy;
+}
+
+// Computes the quantile for each vector in turn, using all threads to select within each vector.
+// This is used by median() and quantile() when there are fewer vectors than threads, see parallel_select_should_use().
+template<typename Value_, typename Index_, typename Output_, class Transform_, class Options_>
+void parallel_select_quantiles(
+    const bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const double prob,
+    Output_* const output,
+    const Transform_& transform,
+    const Options_& opt,
+    const char* const kernel)
+{
+    // Otherwise, the target ranks would lie outside of each vector.
+    if (!(prob >= 0 && prob <= 1)) {
+        throw std::runtime_error("quantile probability should lie in [0, 1]");
+    }
+
+    TraceScope tscope(opt.tracer, kernel, "select", 0);
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    const Index_ otherdim = (row ? mat.ncol() : mat.nrow());
+    auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
+    const auto bufptr = buffer.data();
+    std::vector<Output_> tholder;
+    const auto tbuffer = transform_buffer<Output_, Transform_>(NULL, 0, otherdim, tholder);
+
+    if (mat.sparse()) {
+        tatami::Options topt;
+        topt.sparse_extract_index = false;
+        topt.sparse_ordered_index = false; // we'll be selecting by value anyway.
+        auto ext = prefetch_consecutive_extractor<true>(mat, row, static_cast<Index_>(0), dim, opt.prefetch, opt.executor, topt);
+        const auto zero = transformed_zero<Output_, Value_>(transform);
+
+        for (Index_ x = 0; x < dim; ++x) {
+            auto range = tscope.fetch([&]() { return ext->fetch(bufptr, NULL); });
+
+            // The structural zeros are passed as a count, so only the non-zero values need to be copied.
+            const auto copy = copy_sparse_for_quantile(transform, range.value, range.number, otherdim, prob, opt.skip_nan, bufptr, tbuffer, zero);
+            if (copy == NULL) {
+                output[x] = zero;
+                continue;
+            }
+
+            Index_ num_nonzero = range.number, num_all = otherdim;
+            nanable_ifelse<I<decltype(*copy)> >(
+                opt.skip_nan,
+                [&]() -> void {
+                    num_nonzero = shift_nans(copy, num_nonzero);
+                    num_all -= range.number - num_nonzero;
+                },
+                []() -> void {}
+            );
+            output[x] = parallel_select_quantile<Output_>(copy, num_nonzero, num_all - num_nonzero, prob, opt.num_threads, opt.executor);
+            if constexpr(!transform_preserves_zero<Transform_>) {
+                output[x] += zero;
+            }
+        }
+
+    } else {
+        auto ext = prefetch_consecutive_extractor<false>(mat, row, static_cast<Index_>(0), dim, opt.prefetch, opt.executor);
+        for (Index_ x = 0; x < dim; ++x) {
+            auto ptr = tscope.fetch([&]() { return ext->fetch(bufptr); });
+            const auto copy = copy_transformed_values(transform, ptr, otherdim, bufptr, tbuffer, static_cast<Output_>(0));
+            Index_ num = otherdim;
+            nanable_ifelse<I<decltype(*copy)> >(
+                opt.skip_nan,
+                [&]() -> void {
+                    num = shift_nans(copy, num);
+                },
+                []() -> void {}
+            );
+            output[x] = parallel_select_quantile<Output_>(copy, num, 0, prob, opt.num_threads, opt.executor);
+        }
+    }
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef TATAMI_STATS_SHIFTED_RSS_HPP
+#define TATAMI_STATS_SHIFTED_RSS_HPP
+
+#include <cstddef>
+
+/**
+ * @file shifted_rss.hpp
+ *
+ * @brief Division-free updates for the running RSS calculations.
+ *
+ * By default, the running paths of `rss()`, `skip_nan::rss()` and `group_rss()` update the mean and RSS of each row/column with Welford's algorithm.
+ * This requires a division for every observation, and for sparse matrices, the divisor differs between rows/columns, which prevents vectorization.
+ * If `shifted_sums = true` in the options, we instead accumulate the sum and sum of squares of the difference between each observation and a per-row/column shift.
+ * These accumulations involve no division and can be vectorized across rows/columns.
+ * The mean and RSS are then recovered from the shifted sums and combined with the current mean and RSS by Chan's method.
+ *
+ * For dense matrices, the shift is initially set to the first observation (or the first non-NaN observation for `skip_nan::rss()`).
+ * Every `SHIFTED_RSS_BLOCK_SIZE` observations, the shifted sums for the block are folded into the running mean and RSS, and the updated mean is used as the shift for the next block.
+ * For sparse matrices, the shift for each row/column is set to its first structural non-zero (and non-NaN) value, and the shifted sums are only folded at the end,
+ * as folding all rows/columns after every block would be more expensive than the updates for the non-zero elements.
+ * The structural zeros are not part of the shifted sums, so they are added exactly during the final fold, based on the number of zeros and the shift.
+ * Rows/columns with no non-zero values have a shift of zero, which is exact as all of their observations are zero.
+ *
+ * For n observations with variance v and mean m, the rounding error in the RSS computed from the shifted sums is roughly proportional to ε n (v + (m - s)^2) for a shift s and machine epsilon ε.
+ * This is comparable to the ε n v error of Welford's algorithm if the shift is within a few standard deviations of the mean,
+ * which is usually the case when the shift is an observation or the mean of the previous observations.
+ * The accuracy degrades if the mean drifts by many standard deviations along the other dimension, e.g., when the rows/columns are sorted by their values;
+ * in such cases, the periodic re-centering for dense matrices limits the error to that within each block.
+ * The error never approaches that of the naive sum-of-squares formula, which corresponds to a shift of zero.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @cond
+ */
+constexpr std::size_t SHIFTED_RSS_BLOCK_SIZE = 64;
+
+// Folds the shifted sums of the latest block of 'block_count' observations into the running 'mean' and 'rss' of 'count' observations,
+// where the shift is the current value of 'mean'. The shifted sums are then reset for the next block.
+template<typename Output_>
+void shifted_rss_fold(Output_& mean, Output_& rss, Output_& sum, Output_& sum_squares, const Output_ count, const Output_ block_count) {
+    if (block_count == 0) {
+        return;
+    }
+    const Output_ delta = sum / block_count;
+    const Output_ block_rss = sum_squares - sum * delta;
+    const Output_ total = count + block_count;
+    mean += delta * (block_count / total);
+    rss += block_rss + delta * delta * (count * block_count / total);
+    sum = 0;
+    sum_squares = 0;
+}
+
+// Same as shifted_rss_fold(), but for sparse data where the 'block_count - block_nonzero' structural zeros were not added to the shifted sums.
+template<typename Output_>
+void shifted_rss_fold_with_zeros(Output_& mean, Output_& rss, Output_& sum, Output_& sum_squares, const Output_ count, const Output_ block_count, const Output_ block_nonzero) {
+    const Output_ num_zero = block_count - block_nonzero;
+    sum -= mean * num_zero;
+    sum_squares += mean * mean * num_zero;
+    shifted_rss_fold(mean, rss, sum, sum_squares, count, block_count);
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
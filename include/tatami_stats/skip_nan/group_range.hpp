@@ -0,0 +1,611 @@
+#ifndef TATAMI_STATS_SKIP_NAN_GROUP_RANGE_HPP
+#define TATAMI_STATS_SKIP_NAN_GROUP_RANGE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <cassert>
+#include <cmath>
+
+#include "tatami/tatami.hpp"
+#include "sanisizer/sanisizer.hpp"
+#include "auveh/auveh.hpp"
+
+#include "../utils.hpp"
+#include "../partition.hpp"
+#include "../prefetch.hpp"
+#include "range.hpp"
+
+/**
+ * @file group_range.hpp
+ *
+ * @brief Compute group-wise ranges while skipping NaNs.
+ */
+
+namespace tatami_stats {
+
+namespace skip_nan {
+
+/**
+ * @brief Options for `skip_nan::group_range()`.
+ * @tparam Output_ Numeric type of the output data.
+ */
+template<typename Output_ = double>
+struct GroupRangeOptions {
+    /**
+     * Number of threads to use when computing ranges across a `tatami::Matrix`.
+     * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     */
+    int num_threads = 1;
+
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+
+    /**
+     * Placeholder for the minimum value in `GroupRangeBuffers::minimum` or `GroupRangeResult::minimum`,
+     * when a group has no non-NaN values in a row/column.
+     */
+    Output_ minimum_placeholder = default_minimum_placeholder<Output_>();
+
+    /**
+     * Placeholder for the maximum value in `GroupRangeBuffers::maximum` or `GroupRangeResult::maximum`,
+     * when a group has no non-NaN values in a row/column.
+     */
+    Output_ maximum_placeholder = default_maximum_placeholder<Output_>();
+};
+
+/**
+ * @brief Result buffers for `skip_nan::group_range()`.
+ *
+ * @tparam Output_ Numeric type of the output data.
+ * @tparam Count_ Numeric type of the non-NaN counts.
+ * This is typically an integer type.
+ */
+template<typename Output_, typename Count_>
+struct GroupRangeBuffers {
+    /**
+     * Vector of length equal to the number of groups.
+     * Each element is a pointer to an array of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise).
+     * After `skip_nan::group_range()`, this is filled with the minimum value of each row/column for the corresponding group.
+     */
+    std::vector<Output_*> minimum;
+
+    /**
+     * Vector of length equal to the number of groups.
+     * Each element is a pointer to an array of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise).
+     * After `skip_nan::group_range()`, this is filled with the maximum value of each row/column for the corresponding group.
+     */
+    std::vector<Output_*> maximum;
+
+    /**
+     * Vector of length equal to the number of groups.
+     * Each element is a pointer to an array of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise).
+     * After `skip_nan::group_range()`, this is filled with the number of unskipped observations in each row/column for the corresponding group.
+     */
+    std::vector<Count_*> count;
+};
+
+/**
+ * @cond
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_, typename Count_>
+void group_range_direct(
+    const bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Index_* const group_size,
+    GroupRangeBuffers<Output_, Count_>& output,
+    const GroupRangeOptions<Output_>& opt
+) {
+    const auto otherdim = (row ? mat.ncol() : mat.nrow());
+
+    if (mat.sparse()) {
+        tatami::Options topt;
+        topt.sparse_ordered_index = false;
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "skip_nan::group_range", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor, topt);
+            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
+            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(otherdim);
+            auto cur_min = sanisizer::create<std::vector<Output_> >(num_groups);
+            auto cur_max = sanisizer::create<std::vector<Output_> >(num_groups);
+            auto cur_observed = sanisizer::create<std::vector<Index_> >(num_groups); // number of non-NaN structural non-zeros in each group.
+            auto cur_nan = sanisizer::create<std::vector<Index_> >(num_groups);
+
+            for (Index_ x = 0; x < l; ++x) {
+                auto range = tscope.fetch([&]() { return ext->fetch(vbuffer.data(), ibuffer.data()); });
+                std::fill(cur_observed.begin(), cur_observed.end(), 0);
+                std::fill(cur_nan.begin(), cur_nan.end(), 0);
+
+                for (Index_ i = 0; i < range.number; ++i) {
+                    const auto val = range.value[i];
+                    const auto g = group[range.index[i]];
+                    if (std::isnan(val)) {
+                        ++cur_nan[g];
+                    } else {
+                        if (cur_observed[g] == 0) {
+                            cur_min[g] = val;
+                            cur_max[g] = val;
+                        } else {
+                            cur_min[g] = std::min(cur_min[g], static_cast<Output_>(val));
+                            cur_max[g] = std::max(cur_max[g], static_cast<Output_>(val));
+                        }
+                        ++cur_observed[g];
+                    }
+                }
+
+                for (std::size_t g = 0; g < num_groups; ++g) {
+                    const auto num_valid = group_size[g] - cur_nan[g];
+                    Output_ gmin, gmax;
+                    if (num_valid == 0) {
+                        gmin = opt.minimum_placeholder;
+                        gmax = opt.maximum_placeholder;
+                    } else if (cur_observed[g] == 0) {
+                        gmin = 0;
+                        gmax = 0;
+                    } else {
+                        gmin = cur_min[g];
+                        gmax = cur_max[g];
+                        if (cur_observed[g] < num_valid) {
+                            gmin = std::min(gmin, static_cast<Output_>(0));
+                            gmax = std::max(gmax, static_cast<Output_>(0));
+                        }
+                    }
+                    output.minimum[g][s + x] = gmin;
+                    output.maximum[g][s + x] = gmax;
+                    output.count[g][s + x] = num_valid;
+                }
+            }
+        }, mat, row, opt);
+
+    } else {
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "skip_nan::group_range", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
+            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
+            auto cur_min = sanisizer::create<std::vector<Output_> >(num_groups);
+            auto cur_max = sanisizer::create<std::vector<Output_> >(num_groups);
+            auto cur_count = sanisizer::create<std::vector<Index_> >(num_groups);
+
+            for (Index_ x = 0; x < l; ++x) {
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer.data()); });
+                std::fill(cur_count.begin(), cur_count.end(), 0);
+
+                for (Index_ j = 0; j < otherdim; ++j) {
+                    const auto val = ptr[j];
+                    if (!std::isnan(val)) {
+                        const auto g = group[j];
+                        if (cur_count[g] == 0) {
+                            cur_min[g] = val;
+                            cur_max[g] = val;
+                        } else {
+                            cur_min[g] = std::min(cur_min[g], static_cast<Output_>(val));
+                            cur_max[g] = std::max(cur_max[g], static_cast<Output_>(val));
+                        }
+                        ++cur_count[g];
+                    }
+                }
+
+                for (std::size_t g = 0; g < num_groups; ++g) {
+                    if (cur_count[g]) {
+                        output.minimum[g][s + x] = cur_min[g];
+                        output.maximum[g][s + x] = cur_max[g];
+                    } else {
+                        output.minimum[g][s + x] = opt.minimum_placeholder;
+                        output.maximum[g][s + x] = opt.maximum_placeholder;
+                    }
+                    output.count[g][s + x] = cur_count[g];
+                }
+            }
+        }, mat, row, opt);
+    }
+}
+
+template<typename Value_, typename Index_, typename Group_, typename Output_, typename Count_>
+void group_range_running(
+    const bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    GroupRangeBuffers<Output_, Count_>& output,
+    const GroupRangeOptions<Output_>& opt
+) {
+    const Index_ dim = (row ? mat.nrow() : mat.ncol());
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        std::fill_n(output.count[g], dim, 0);
+    }
+
+    // The min/max are only initialized once the count is positive, so there's no need to wipe them here.
+    const bool do_parallel = opt.num_threads > 1;
+    std::optional<PartialBuffers<Output_> > all_partial_min, all_partial_max;
+    std::optional<PartialBuffers<Count_> > all_partial_count;
+    if (do_parallel) {
+        all_partial_min.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL, opt.num_threads, opt.allocator, num_groups);
+        all_partial_max.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL + 1, opt.num_threads, opt.allocator, num_groups);
+        all_partial_count.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL + 2, opt.num_threads, opt.allocator, num_groups);
+    }
+
+    const bool is_sparse = mat.is_sparse();
+    const int nused = parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+        TraceScope tscope(opt.tracer, "skip_nan::group_range", "compute", thread);
+        Output_** min_ptrs;
+        Output_** max_ptrs;
+        Count_** count_ptrs;
+        if (!do_parallel || thread == 0) {
+            min_ptrs = output.minimum.data();
+            max_ptrs = output.maximum.data();
+            count_ptrs = output.count.data();
+        } else {
+            min_ptrs = all_partial_min->acquire(thread, dim);
+            tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim) * num_groups);
+            max_ptrs = all_partial_max->acquire(thread, dim);
+            tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim) * num_groups);
+            count_ptrs = all_partial_count->acquire(thread, dim);
+            tscope.add_bytes(sizeof(Count_) * static_cast<std::size_t>(dim) * num_groups);
+        }
+
+        if (is_sparse) {
+            tatami::Options topt;
+            topt.sparse_ordered_index = false;
+            auto ext = prefetch_consecutive_extractor<true>(mat, !row, s, l, opt.prefetch, opt.executor, topt);
+            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
+            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
+            auto cur_observed = sanisizer::create<std::vector<Index_> >(num_groups);
+            auto nonzeros = sanisizer::create<std::vector<std::vector<Index_> > >(num_groups);
+            for (std::size_t g = 0; g < num_groups; ++g) {
+                tatami::resize_container_to_Index_size(nonzeros[g], dim);
+            }
+
+            for (Index_ x = 0; x < l; ++x) {
+                auto out = tscope.fetch([&]() { return ext->fetch(vbuffer.data(), ibuffer.data()); });
+                const auto grp = group[s + x];
+                ++cur_observed[grp];
+                const auto min_ptr = min_ptrs[grp];
+                const auto max_ptr = max_ptrs[grp];
+                const auto count_ptr = count_ptrs[grp];
+                auto& nnz = nonzeros[grp];
+
+                AUVEH_NODEP
+                for (Index_ i = 0; i < out.number; ++i) {
+                    const auto val = out.value[i];
+                    const auto idx = out.index[i];
+                    if (!std::isnan(val)) {
+                        auto& min_current = min_ptr[idx];
+                        auto& max_current = max_ptr[idx];
+                        if (count_ptr[idx] == 0) {
+                            min_current = val;
+                            max_current = val;
+                        } else {
+                            min_current = std::min(min_current, static_cast<Output_>(val));
+                            max_current = std::max(max_current, static_cast<Output_>(val));
+                        }
+                        ++count_ptr[idx];
+                    }
+                    ++nnz[idx];
+                }
+            }
+
+            // Structural zeros are counted per group using the number of vectors from each group in this thread.
+            for (std::size_t g = 0; g < num_groups; ++g) {
+                const auto curtotal = cur_observed[g];
+                if (curtotal) {
+                    const auto min_ptr = min_ptrs[g];
+                    const auto max_ptr = max_ptrs[g];
+                    const auto count_ptr = count_ptrs[g];
+                    const auto& nnz = nonzeros[g];
+                    AUVEH_NODEP
+                    for (Index_ d = 0; d < dim; ++d) {
+                        if (curtotal > nnz[d]) {
+                            auto& min_current = min_ptr[d];
+                            auto& max_current = max_ptr[d];
+                            if (count_ptr[d] == 0) {
+                                min_current = 0;
+                                max_current = 0;
+                            } else {
+                                min_current = std::min(min_current, static_cast<Output_>(0));
+                                max_current = std::max(max_current, static_cast<Output_>(0));
+                            }
+                            count_ptr[d] += curtotal - nnz[d];
+                        }
+                    }
+                }
+            }
+
+        } else {
+            auto ext = prefetch_consecutive_extractor<false>(mat, !row, s, l, opt.prefetch, opt.executor);
+            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
+
+            for (Index_ x = 0; x < l; ++x) {
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer.data()); });
+                const auto grp = group[s + x];
+                const auto min_ptr = min_ptrs[grp];
+                const auto max_ptr = max_ptrs[grp];
+                const auto count_ptr = count_ptrs[grp];
+
+                AUVEH_NODEP
+                for (Index_ d = 0; d < dim; ++d) {
+                    const auto val = ptr[d];
+                    if (!std::isnan(val)) {
+                        auto& min_current = min_ptr[d];
+                        auto& max_current = max_ptr[d];
+                        if (count_ptr[d] == 0) {
+                            min_current = val;
+                            max_current = val;
+                        } else {
+                            min_current = std::min(min_current, static_cast<Output_>(val));
+                            max_current = std::max(max_current, static_cast<Output_>(val));
+                        }
+                        ++count_ptr[d];
+                    }
+                }
+            }
+        }
+    }, mat, !row, opt);
+
+    if (do_parallel) {
+        parallelize_merge([&](Index_ start, Index_ length) -> void {
+            const Index_ end = start + length;
+            for (std::size_t g = 0; g < num_groups; ++g) {
+                const auto out_min = output.minimum[g];
+                const auto out_max = output.maximum[g];
+                const auto out_count = output.count[g];
+                for (int u = 1; u < nused; ++u) {
+                    const auto cur_min = all_partial_min->get(u)[g];
+                    const auto cur_max = all_partial_max->get(u)[g];
+                    const auto cur_count = all_partial_count->get(u)[g];
+                    AUVEH_NODEP
+                    for (Index_ d = start; d < end; ++d) {
+                        if (!cur_count[d]) {
+                            continue;
+                        }
+                        if (out_count[d]) {
+                            out_min[d] = std::min(cur_min[d], out_min[d]);
+                            out_max[d] = std::max(cur_max[d], out_max[d]);
+                        } else {
+                            out_min[d] = cur_min[d];
+                            out_max[d] = cur_max[d];
+                        }
+                        out_count[d] += cur_count[d];
+                    }
+                }
+            }
+        }, dim, opt, "skip_nan::group_range");
+    }
+
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        const auto out_min = output.minimum[g];
+        const auto out_max = output.maximum[g];
+        const auto out_count = output.count[g];
+        for (Index_ d = 0; d < dim; ++d) {
+            if (out_count[d] == 0) {
+                out_min[d] = opt.minimum_placeholder;
+                out_max[d] = opt.maximum_placeholder;
+            }
+        }
+    }
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Plan the computation of `skip_nan::group_range()`, see `Plan` for details.
+ *
+ * @tparam Count_ Integer type of the number of non-NaN values.
+ * @tparam Output_ Numeric type of the output data.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute ranges for the rows.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param num_groups Number of groups.
+ * @param opt Options for `skip_nan::group_range()`.
+ *
+ * @return Plan for `skip_nan::group_range()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `GroupRangeOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Count_, typename Output_, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const std::size_t num_groups, const GroupRangeOptions<Output_>& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = saturating_add(otherdim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0)), saturating_multiply(num_groups, 2 * sizeof(Output_) + 2 * sizeof(Index_)));
+    model.running_buffer = saturating_add(dim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0)), (sparse ? saturating_multiply(num_groups, dim * sizeof(Index_)) : 0));
+    model.running_partial_rest = saturating_multiply(num_groups, dim * (2 * sizeof(Output_) + sizeof(Count_)));
+    return choose_plan(model, row, mat, opt);
+}
+
+/**
+ * Compute per-group ranges for each element of a chosen dimension of a `tatami::Matrix`, after skipping any NaNs.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Output_ Numeric type of the output data.
+ * It is assumed that this is large enough to store the maxima/minima.
+ * @tparam Count_ Numeric type of the non-NaN counts.
+ * This is typically an integer type.
+ *
+ * @param row Whether to compute ranges for the rows.
+ * If false, ranges are computed for the columns instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param[out] output Buffers in which to store the results.
+ * On output, each array stores the minima, maxima and non-NaN counts of the corresponding group.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_, typename Count_>
+void group_range(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    GroupRangeBuffers<Output_, Count_>& output,
+    const GroupRangeOptions<Output_>& opt
+) {
+    assert(sanisizer::is_equal(num_groups, output.minimum.size()));
+    assert(sanisizer::is_equal(num_groups, output.maximum.size()));
+    assert(sanisizer::is_equal(num_groups, output.count.size()));
+    const auto cur_plan = plan<Count_>(row, mat, num_groups, opt);
+    trace_path(opt.tracer, "skip_nan::group_range", cur_plan.running, mat.is_sparse(), true);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+
+    if (!cur_plan.running) {
+        auto group_size = sanisizer::create<std::vector<Index_> >(num_groups);
+        const auto otherdim = (row ? mat.ncol() : mat.nrow());
+        for (Index_ o = 0; o < otherdim; ++o) {
+            group_size[group[o]] += 1;
+        }
+        group_range_direct(row, mat, group, num_groups, group_size.data(), output, planned_opt);
+    } else {
+        group_range_running(row, mat, group, num_groups, output, planned_opt);
+    }
+}
+
+/**
+ * @brief Results of `skip_nan::group_range()`.
+ *
+ * @tparam Output_ Numeric type of the output data.
+ * @tparam Count_ Numeric type of the non-NaN counts.
+ * This is typically an integer type.
+ */
+template<typename Output_, typename Count_>
+struct GroupRangeResult {
+    /**
+     * Vector of length equal to the number of groups.
+     * Each element is a vector of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise),
+     * containing the minimum value of each row/column for the corresponding group.
+     */
+    std::vector<std::vector<Output_> > minimum;
+
+    /**
+     * Vector of length equal to the number of groups.
+     * Each element is a vector of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise),
+     * containing the maximum value of each row/column for the corresponding group.
+     */
+    std::vector<std::vector<Output_> > maximum;
+
+    /**
+     * Vector of length equal to the number of groups.
+     * Each element is a vector of length equal to the appropriate dimension extent (rows for `row = true`, columns otherwise),
+     * containing the number of unskipped observations in each row/column for the corresponding group.
+     */
+    std::vector<std::vector<Count_> > count;
+};
+
+/**
+ * Overload of `skip_nan::group_range()` that allocates memory for the results.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Output_ Numeric type of the output data.
+ * It is assumed that this is large enough to store the maxima/minima.
+ * @tparam Count_ Numeric type of the non-NaN counts.
+ * This is typically an integer type.
+ *
+ * @param row Whether to compute ranges for the rows.
+ * If false, ranges are computed for the columns instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param opt Further options.
+ *
+ * @return Minimum, maximum and non-NaN count of each group for each row/column.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_ = Value_, typename Count_ = Index_>
+GroupRangeResult<Output_, Count_> group_range(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const GroupRangeOptions<Output_>& opt
+) {
+    GroupRangeResult<Output_, Count_> output;
+    sanisizer::resize(output.minimum, num_groups);
+    sanisizer::resize(output.maximum, num_groups);
+    sanisizer::resize(output.count, num_groups);
+
+    GroupRangeBuffers<Output_, Count_> buffers;
+    sanisizer::resize(buffers.minimum, num_groups);
+    sanisizer::resize(buffers.maximum, num_groups);
+    sanisizer::resize(buffers.count, num_groups);
+
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        tatami::resize_container_to_Index_size(output.minimum[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        buffers.minimum[g] = output.minimum[g].data();
+
+        tatami::resize_container_to_Index_size(output.maximum[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        buffers.maximum[g] = output.maximum[g].data();
+
+        tatami::resize_container_to_Index_size(output.count[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        buffers.count[g] = output.count[g].data();
+    }
+
+    group_range(row, mat, group, num_groups, buffers, opt);
+    return output;
+}
+
+}
+
+}
+
+#endif
@@ -13,9 +13,12 @@
 #include "sanisizer/sanisizer.hpp"
 #include "quickstats/quickstats.hpp"
 #include "auveh/auveh.hpp"
-#include "jiwoo/jiwoo.hpp"
 
 #include "../group_rss.hpp"
+#include "../partition.hpp"
+#include "../prefetch.hpp"
+#include "../deterministic.hpp"
+#include "../transform.hpp"
 
 /**
  * @file group_rss.hpp
@@ -39,6 +42,57 @@ struct GroupRssOptions {
      */
     int num_threads = 1;
 
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Whether the running path should give the same results for any `num_threads`.
+     * If true, the rows/columns are processed in fixed blocks that do not depend on the number of threads,
+     * and the partial means and RSS for the blocks are combined in a fixed order, so the results are bitwise identical for any `num_threads`.
+     * This is slightly slower and stores a few more partial results per thread, including the per-element counts of non-NaN values for each group.
+     * The direct path is always deterministic, but note that `plan()` may choose a different path for different `num_threads` if `strategy = PlanStrategy::COST` or `max_memory_bytes` is set.
+     */
+    bool deterministic = false;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Workspace to reuse buffers across calls, see @ref common_options_workspace.
+     */
+    Workspace* workspace = NULL;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+
     /**
      * Placeholder value to use for the mean of empty groups.
      * This is NaN if supported by `Output_`, otherwise it is zero.
@@ -80,16 +134,16 @@ struct GroupRssBuffers {
 /**
  * @cond
  */
-template<typename Value_, typename Index_, typename Group_, typename Output_, typename Count_>
+template<typename Value_, typename Index_, typename Group_, typename Output_, typename Count_, class Transform_>
 void group_rss_direct(
     const bool row,
     const tatami::Matrix<Value_, Index_>& mat, 
     const Group_* const group, 
     const std::size_t num_groups, 
     GroupRssBuffers<Output_, Count_>& output,
+    const Transform_& transform,
     const GroupRssOptions<Output_>& opt
 ) {
-    const auto dim = (row ? mat.nrow() : mat.ncol());
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
 
     if (mat.sparse()) {
@@ -97,22 +151,35 @@ void group_rss_direct(
         for (Index_ i = 0; i < otherdim; ++i) {
             full_group_sizes[group[i]] += 1;
         }
-
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<true>(mat, row, s, l);
-            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(otherdim);
-            auto cur_means = sanisizer::create<std::vector<Output_> >(num_groups);
-            auto cur_rss = sanisizer::create<std::vector<Output_> >(num_groups);
-            auto cur_non_zeros = sanisizer::create<std::vector<Index_> >(num_groups);
-            auto cur_sizes = sanisizer::create<std::vector<Index_> >(num_groups);
+        const auto zero = transformed_zero<Output_, Value_>(transform); // for shifting sparse values, see skip_nan::group_rss_unshift_means().
+
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "skip_nan::group_rss", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor);
+            std::vector<Value_> vholder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, vholder);
+            std::vector<Index_> iholder;
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, otherdim, iholder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            std::vector<Output_> mholder, rholder;
+            const auto cur_means = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS, num_groups, mholder);
+            const auto cur_rss = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS + 1, num_groups, rholder);
+            std::vector<Index_> nholder, zholder;
+            const auto cur_non_zeros = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS + 2, num_groups, nholder);
+            const auto cur_sizes = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS + 3, num_groups, zholder);
+            std::fill_n(cur_means, num_groups, 0);
+            std::fill_n(cur_rss, num_groups, 0);
+            std::fill_n(cur_non_zeros, num_groups, 0);
+            std::fill_n(cur_sizes, num_groups, 0);
 
             for (Index_ x = 0; x < l; ++x) {
-                auto range = ext->fetch(vbuffer.data(), ibuffer.data());
+                auto range = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                const auto vals = transform_values(transform, range.value, range.number, tbuffer, zero);
 
                 // Computing the mean first.
                 for (Index_ i = 0; i < range.number; ++i) {
-                    const auto val = range.value[i];
+                    const auto val = vals[i];
                     const auto b = group[range.index[i]];
                     if (!std::isnan(val)) {
                         ++cur_non_zeros[b];
@@ -126,11 +193,11 @@ void group_rss_direct(
                     cur_sizes[g] = actual_size;
                     output.count[g][s + x] = actual_size;
                 }
-                group_rss_finish_means(num_groups, cur_sizes.data(), cur_means, static_cast<Index_>(s + x), output.mean, opt.mean_placeholder);
+                group_rss_finish_means(num_groups, cur_sizes, cur_means, static_cast<Index_>(s + x), output.mean, opt.mean_placeholder);
 
                 // Now computing the RSS.
                 for (Index_ i = 0; i < range.number; ++i) {
-                    const auto val = range.value[i];
+                    const auto val = vals[i];
                     if (!std::isnan(val)) {
                         const auto g = group[range.index[i]];
                         const auto delta = val - cur_means[g];
@@ -146,27 +213,37 @@ void group_rss_direct(
                     }
                 }
 
-                std::fill(cur_means.begin(), cur_means.end(), 0);
-                std::fill(cur_rss.begin(), cur_rss.end(), 0);
-                std::fill(cur_non_zeros.begin(), cur_non_zeros.end(), 0);
-                std::fill(cur_sizes.begin(), cur_sizes.end(), 0);
+                std::fill_n(cur_means, num_groups, 0);
+                std::fill_n(cur_rss, num_groups, 0);
+                std::fill_n(cur_non_zeros, num_groups, 0);
+                std::fill_n(cur_sizes, num_groups, 0);
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
 
     } else {
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<false>(mat, row, s, l);
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            auto cur_means = sanisizer::create<std::vector<Output_> >(num_groups);
-            auto cur_rss = sanisizer::create<std::vector<Output_> >(num_groups);
-            auto cur_sizes = sanisizer::create<std::vector<Index_> >(num_groups);
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "skip_nan::group_rss", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, holder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            std::vector<Output_> mholder, rholder;
+            const auto cur_means = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS, num_groups, mholder);
+            const auto cur_rss = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS + 1, num_groups, rholder);
+            std::vector<Index_> zholder;
+            const auto cur_sizes = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS + 3, num_groups, zholder);
+            std::fill_n(cur_means, num_groups, 0);
+            std::fill_n(cur_rss, num_groups, 0);
+            std::fill_n(cur_sizes, num_groups, 0);
 
             for (Index_ x = 0; x < l; ++x) {
-                auto ptr = ext->fetch(buffer.data());
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer); });
+                const auto vals = transform_values(transform, ptr, otherdim, tbuffer, static_cast<Output_>(0));
 
                 // Computing the mean first.
                 for (Index_ j = 0; j < otherdim; ++j) {
-                    const auto val = ptr[j];
+                    const auto val = vals[j];
                     if (!std::isnan(val)) {
                         const auto g = group[j];
                         cur_means[g] += val;
@@ -176,11 +253,11 @@ void group_rss_direct(
                 for (std::size_t g = 0; g < num_groups; ++g) {
                     output.count[g][s + x] = cur_sizes[g];
                 }
-                group_rss_finish_means(num_groups, cur_sizes.data(), cur_means, static_cast<Index_>(s + x), output.mean, opt.mean_placeholder);
+                group_rss_finish_means(num_groups, cur_sizes, cur_means, static_cast<Index_>(s + x), output.mean, opt.mean_placeholder);
 
                 // Now computing the RSS.
                 for (Index_ j = 0; j < otherdim; ++j) {
-                    const auto val = ptr[j];
+                    const auto val = vals[j];
                     if (!std::isnan(val)) {
                         const auto g = group[j];
                         const auto delta = val - cur_means[g];
@@ -191,21 +268,22 @@ void group_rss_direct(
                     output.rss[g][s + x] = cur_rss[g];
                 }
 
-                std::fill(cur_means.begin(), cur_means.end(), 0);
-                std::fill(cur_rss.begin(), cur_rss.end(), 0);
-                std::fill(cur_sizes.begin(), cur_sizes.end(), 0);
+                std::fill_n(cur_means, num_groups, 0);
+                std::fill_n(cur_rss, num_groups, 0);
+                std::fill_n(cur_sizes, num_groups, 0);
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
     }
 }
 
-template<typename Value_, typename Index_, typename Group_, typename Output_, typename Count_>
+template<typename Value_, typename Index_, typename Group_, typename Output_, typename Count_, class Transform_>
 void group_rss_running(
     const bool row,
     const tatami::Matrix<Value_, Index_>& mat,
     const Group_* const group, 
     const std::size_t num_groups, 
     GroupRssBuffers<Output_, Count_>& output,
+    const Transform_& transform,
     const GroupRssOptions<Output_>& opt
 ) {
     const auto dim = (row ? mat.nrow() : mat.ncol());
@@ -226,201 +304,271 @@ void group_rss_running(
         }
     }
 
-    const bool do_parallel = opt.num_threads > 1;
-    std::optional<std::vector<std::optional<std::vector<Output_*> > > > all_partial_mean, all_partial_rss;
-    std::optional<std::vector<std::optional<std::vector<Count_*> > > > all_partial_count;
-    if (do_parallel) {
-        // -1, as we'll repurpose the RSS output buffer to store the partial RSS of the first thread.
-        all_partial_rss.emplace(sanisizer::cast<I<decltype(all_partial_rss->size())> >(opt.num_threads - 1));
-        all_partial_mean.emplace(sanisizer::cast<I<decltype(all_partial_mean->size())> >(opt.num_threads));
-        all_partial_count.emplace(sanisizer::cast<I<decltype(all_partial_count->size())> >(opt.num_threads));
-    }
-    jiwoo::Scope lib_all_mean(all_partial_mean), lib_all_rss(all_partial_rss); // RAII freeing of all threads' memory.
-    jiwoo::Scope lib_all_count(all_partial_count);
-
-    const bool is_sparse = mat.is_sparse();
-    const int nused = tatami::parallelize([&](int thread, Index_ s, Index_ l) -> void {
-        std::optional<std::vector<Output_*> > cur_mean, cur_rss;
-        jiwoo::Scope libmean(cur_mean), librss(cur_rss); // RAII freeing of each thread's memory.
-        std::optional<std::vector<Count_*> > cur_count;
-        jiwoo::Scope libcount(cur_count);
-
-        Output_** mean_ptrs;
-        Output_** rss_ptrs;
-        Count_** count_ptrs;
-        if (!do_parallel) {
-            // Storing mean and RSS directly in the output vector to cut down two allocations if we're not working in parallel.
-            mean_ptrs = output.mean.data();
-            rss_ptrs = output.rss.data();
-            count_ptrs = output.count.data();
-
-        } else {
-            // Storing the partial RSS directly in the output vectors to save ourselves an allocation if we're in the first thread.
-            if (thread == 0) {
-                rss_ptrs = output.rss.data();
-            } else {
-                cur_rss.emplace(sanisizer::cast<I<decltype(cur_rss->size())> >(num_groups));
-                for (std::size_t g = 0; g < num_groups; ++g) {
-                    auto ptr = new Output_ [dim]; // cast to size_t is safe due to the tatami contract.
-                    (*cur_rss)[g] = ptr;
-                    std::fill_n(ptr, dim, 0);
-                }
-                rss_ptrs = cur_rss->data();
-            }
-
-            // We can't do the same for the mean, though, as we need to keep the partial mean and the global mean separate for the reduction.
-            cur_mean.emplace(sanisizer::cast<I<decltype(cur_mean->size())> >(num_groups));
-            for (std::size_t g = 0; g < num_groups; ++g) {
-                auto ptr = new Output_ [dim]; // cast to size_t is safe due to the tatami contract.
-                (*cur_mean)[g] = ptr;
-                std::fill_n(ptr, dim, 0);
-            }
-            mean_ptrs = cur_mean->data();
-
-            // Similarly, we need to keep the global count separate from the partial count for reduction.
-            cur_count.emplace(sanisizer::cast<I<decltype(cur_count->size())> >(num_groups));
-            for (std::size_t g = 0; g < num_groups; ++g) {
-                auto ptr = new Count_ [dim]; // cast to size_t is safe due to the tatami contract.
-                (*cur_count)[g] = ptr;
-                std::fill_n(ptr, dim, 0);
-            }
-            count_ptrs = cur_count->data();
-        }
-
-        if (is_sparse) {
-            auto ext = tatami::consecutive_extractor<true>(mat, !row, s, l);
-            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
-            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
-            auto nonzeros = sanisizer::create<std::vector<std::vector<Count_> > >(num_groups);
-            for (std::size_t g = 0; g < num_groups; ++g) {
-                tatami::resize_container_to_Index_size(nonzeros[g], dim);
-            }
-
-            auto cur_group_size = sanisizer::create<std::vector<Count_> >(num_groups);
-            for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(vbuffer.data(), ibuffer.data());
-                const auto grp = group[s + x];
+    const auto zero = transformed_zero<Output_, Value_>(transform); // for shifting sparse values, see skip_nan::group_rss_unshift_means().
+
+    // Each worker accumulates the means, RSS and non-NaN counts for the next 'number' vectors in its range into the supplied zero-initialized arrays.
+    // This is called once per thread for the whole range, or once per leaf in deterministic mode.
+    // The non-zero counts for all groups are stored contiguously in a single buffer, with 'dim' entries per group.
+    const auto grouped_dim = sanisizer::product<std::size_t>(num_groups, dim);
+    const auto create_sparse_worker = [&](int thread, Index_ s, Index_ l) {
+        auto ext = prefetch_consecutive_extractor<true>(mat, !row, s, l, opt.prefetch, opt.executor);
+        return [
+            &,
+            thread,
+            ext = std::move(ext),
+            vholder = std::vector<Value_>(),
+            iholder = std::vector<Index_>(),
+            nholder = std::vector<Count_>(),
+            gholder = std::vector<Count_>(),
+            next = s
+        ](
+            TraceScope& tscope,
+            const Index_ number,
+            Output_* const* mean_ptrs,
+            Output_* const* rss_ptrs,
+            auto* const* count_ptrs
+        ) mutable -> void {
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, vholder);
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, dim, iholder);
+            const auto nonzeros = workspace_buffer(opt.workspace, thread, WORKSPACE_NONZEROS, grouped_dim, nholder);
+            const auto cur_group_size = workspace_buffer(opt.workspace, thread, WORKSPACE_GROUPS, num_groups, gholder);
+            std::fill_n(nonzeros, grouped_dim, 0);
+            std::fill_n(cur_group_size, num_groups, 0);
+
+            for (Index_ x = 0; x < number; ++x) {
+                auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                const auto grp = group[next + x];
                 ++cur_group_size[grp];
 
                 const auto mptr = mean_ptrs[grp];
                 const auto rptr = rss_ptrs[grp];
                 const auto cptr = count_ptrs[grp];
-                auto& nnz = nonzeros[grp];
+                const auto nnz = nonzeros + static_cast<std::size_t>(grp) * dim;
 
                 AUVEH_NODEP
                 for (Index_ i = 0; i < out.number; ++i) {
                     const auto d = out.index[i];
-                    const auto val = out.value[i];
+                    const auto val = transform_value(transform, out.value[i], zero);
                     if (!std::isnan(val)) {
-                        quickstats::update_rss(mptr[d], rptr[d], val, ++nnz[d]); // increment is safe as 'nnz + 1 <= l' fits in an Index_.
+                        quickstats::update_rss(mptr[d], rptr[d], val, ++nnz[d]); // increment is safe as 'nnz + 1 <= number' fits in an Index_.
                     } else {
                         ++cptr[d];
                     }
                 }
             }
+            next += number;
 
             for (std::size_t g = 0; g < num_groups; ++g) {
                 const auto mptr = mean_ptrs[g];
                 const auto rptr = rss_ptrs[g];
                 const auto cptr = count_ptrs[g];
-                const auto& nnz = nonzeros[g];
+                const auto nnz = nonzeros + g * static_cast<std::size_t>(dim);
                 const auto curtotal = cur_group_size[g];
 
                 AUVEH_NODEP
                 for (Index_ d = 0; d < dim; ++d) {
                     auto& unskipped_total = cptr[d];
                     unskipped_total = curtotal - unskipped_total; // could be zero, so the update with zeros needs to be safe.
-                    quickstats::update_rss_with_zeros(mptr[d], rptr[d], static_cast<Count_>(unskipped_total - nnz[d]), unskipped_total);
+                    quickstats::update_rss_with_zeros(mptr[d], rptr[d], static_cast<Count_>(unskipped_total - nnz[d]), static_cast<Count_>(unskipped_total));
                 }
             }
-
-        } else {
-            auto ext = tatami::consecutive_extractor<false>(mat, !row, s, l);
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
-
-            for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(buffer.data());
-                const auto grp = group[s + x];
+        };
+    };
+
+    const auto create_dense_worker = [&](int thread, Index_ s, Index_ l) {
+        auto ext = prefetch_consecutive_extractor<false>(mat, !row, s, l, opt.prefetch, opt.executor);
+        return [
+            &,
+            thread,
+            ext = std::move(ext),
+            holder = std::vector<Value_>(),
+            next = s
+        ](
+            TraceScope& tscope,
+            const Index_ number,
+            Output_* const* mean_ptrs,
+            Output_* const* rss_ptrs,
+            auto* const* count_ptrs
+        ) mutable -> void {
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, holder);
+            for (Index_ x = 0; x < number; ++x) {
+                auto out = tscope.fetch([&]() { return ext->fetch(buffer); });
+                const auto grp = group[next + x];
                 const auto mptr = mean_ptrs[grp];
                 const auto rptr = rss_ptrs[grp];
                 const auto cptr = count_ptrs[grp];
 
                 AUVEH_NODEP
                 for (Index_ d = 0; d < dim; ++d) {
-                    const auto val = out[d];
+                    const auto val = transform_value(transform, out[d], static_cast<Output_>(0));
                     if (!std::isnan(val)) {
-                        quickstats::update_rss(mptr[d], rptr[d], val, ++cptr[d]); // increment is safe as 'cptr[d] + 1 <= l' fits in an Index_.
+                        quickstats::update_rss(mptr[d], rptr[d], val, ++cptr[d]); // increment is safe as 'cptr[d] + 1 <= number' fits in an Index_.
                     }
                 }
             }
-        }
+            next += number;
+        };
+    };
+
+    const auto run = [&](const auto& create_worker) -> void {
+        if (opt.deterministic) {
+            // The partial results for each leaf are group-major, with the means for all groups followed by the RSS values for all groups.
+            // The per-element counts of non-NaN values for each group are stored as the counts of each partial result.
+            auto outputs = output.mean;
+            outputs.insert(outputs.end(), output.rss.begin(), output.rss.end());
+            const std::size_t dim_size = dim; // cast is safe due to the tatami contract.
+            auto counts = sanisizer::create<std::vector<Index_> >(sanisizer::product<std::size_t>(num_groups, dim_size));
+            std::vector<Index_*> count_ptrs(num_groups);
+
+            deterministic_running<Output_>(
+                deterministic_leaves(mat, !row, dim, sanisizer::product<std::size_t>(num_groups, 2), opt),
+                sanisizer::product<std::size_t>(num_groups, 2),
+                dim,
+                counts.size(),
+                [&](int thread, Index_ s, Index_ l) {
+                    return [
+                        worker = create_worker(thread, s, l),
+                        num_groups,
+                        dim_size,
+                        count_ptrs
+                    ](TraceScope& tscope, Index_ number, Output_* const* arrays, Index_* counts) mutable -> void {
+                        for (std::size_t g = 0; g < num_groups; ++g) {
+                            count_ptrs[g] = counts + g * dim_size;
+                        }
+                        worker(tscope, number, arrays, arrays + num_groups, count_ptrs.data());
+                    };
+                },
+                [&](Output_* const* left, const Index_* left_count, Output_* const* right, const Index_* right_count, Index_ start, Index_ end) -> void {
+                    for (std::size_t g = 0; g < num_groups; ++g) {
+                        const auto lmean = left[g], lrss = left[g + num_groups], rmean = right[g], rrss = right[g + num_groups];
+                        const auto lcount = left_count + g * dim_size, rcount = right_count + g * dim_size;
+                        for (Index_ d = start; d < end; ++d) {
+                            deterministic_merge_rss<Output_>(lmean[d], lrss[d], lcount[d], rmean[d], rrss[d], rcount[d]);
+                        }
+                    }
+                },
+                outputs.data(),
+                counts.data(),
+                opt,
+                "skip_nan::group_rss"
+            );
 
-        if (do_parallel) {
-            jiwoo::transfer(cur_count, (*all_partial_count)[thread]);
-            jiwoo::transfer(cur_mean, (*all_partial_mean)[thread]);
-            if (thread > 0) {
-                jiwoo::transfer(cur_rss, (*all_partial_rss)[thread - 1]);
+            for (std::size_t g = 0; g < num_groups; ++g) {
+                std::copy_n(counts.begin() + g * dim_size, dim_size, output.count[g]);
             }
-        }
-    }, otherdim, opt.num_threads);
-    assert(nused > 0);
-
-    if (do_parallel) {
-        const auto& ap_mean = *all_partial_mean;
-        const auto& ap_rss = *all_partial_rss;
-        const auto& ap_count = *all_partial_count;
 
-        for (std::size_t g = 0; g < num_groups; ++g) {
-            const auto cur_global_count = output.count[g];
-            for (int u = 0; u < nused; ++u) {
-                const auto& cur_count = (*(ap_count[u]))[g];
-                AUVEH_NODEP
-                for (Index_ d = 0; d < dim; ++d) {
-                    cur_global_count[d] += cur_count[d];
-                }
+        } else {
+            const bool do_parallel = opt.num_threads > 1;
+            std::optional<PartialBuffers<Output_> > all_partial_mean, all_partial_rss;
+            std::optional<PartialBuffers<Count_> > all_partial_count;
+            if (do_parallel) {
+                // The first thread's partial RSS is stored in the RSS output buffers, so its entry in all_partial_rss is unused.
+                all_partial_rss.emplace(opt.workspace, WORKSPACE_PARTIAL, opt.num_threads, opt.allocator, num_groups);
+                all_partial_mean.emplace(opt.workspace, WORKSPACE_PARTIAL + 1, opt.num_threads, opt.allocator, num_groups);
+                all_partial_count.emplace(opt.workspace, WORKSPACE_PARTIAL + 2, opt.num_threads, opt.allocator, num_groups);
             }
-        }
 
-        // Computing the global mean.
-        for (std::size_t g = 0; g < num_groups; ++g) {
-            const auto cur_global_count = output.count[g];
-            const auto cur_global_mean = output.mean[g];
+            const int nused = parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+                TraceScope tscope(opt.tracer, "skip_nan::group_rss", "compute", thread);
+                Output_** mean_ptrs;
+                Output_** rss_ptrs;
+                Count_** count_ptrs;
+                if (!do_parallel) {
+                    // Storing mean and RSS directly in the output vector to cut down two allocations if we're not working in parallel.
+                    mean_ptrs = output.mean.data();
+                    rss_ptrs = output.rss.data();
+                    count_ptrs = output.count.data();
 
-            for (int u = 0; u < nused; ++u) {
-                const auto& cur_mean = (*(ap_mean[u]))[g];
-                const auto& cur_count = (*(ap_count[u]))[g];
-                AUVEH_NODEP
-                for (Index_ d = 0; d < dim; ++d) {
-                    if (cur_count[d] > 0) {
-                        const auto mult = static_cast<Output_>(cur_count[d]) / static_cast<Output_>(cur_global_count[d]);
-                        cur_global_mean[d] += cur_mean[d] * mult;
+                } else {
+                    // Storing the partial RSS directly in the output vectors to save ourselves an allocation if we're in the first thread.
+                    if (thread == 0) {
+                        rss_ptrs = output.rss.data();
+                    } else {
+                        rss_ptrs = all_partial_rss->acquire(thread, dim);
+                        tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim) * num_groups);
                     }
+
+                    // We can't do the same for the mean, though, as we need to keep the partial mean and the global mean separate for the reduction.
+                    mean_ptrs = all_partial_mean->acquire(thread, dim);
+                    tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim) * num_groups);
+
+                    // Similarly, we need to keep the global count separate from the partial count for reduction.
+                    count_ptrs = all_partial_count->acquire(thread, dim);
+                    tscope.add_bytes(sizeof(Count_) * static_cast<std::size_t>(dim) * num_groups);
                 }
-            }
-        }
 
-        // Combining the RSS. We need to use the safe variant of recenter_rss(), just to protect against the
-        // case where a group has no observations within a particular thread. 
-        for (std::size_t g = 0; g < num_groups; ++g) {
-            const auto cur_global_mean = output.mean[g];
-            const auto cur_output = output.rss[g];
-            for (int u = 0; u < nused; ++u) {
-                const auto& cur_mean = (*(ap_mean[u]))[g];
-                const auto& cur_count = (*(ap_count[u]))[g];
-                if (u == 0) {
-                    AUVEH_NODEP
-                    for (Index_ d = 0; d < dim; ++d) {
-                        cur_output[d] = quickstats::recenter_rss(cur_count[d], cur_output[d], cur_mean[d], cur_global_mean[d]); 
+                auto worker = create_worker(thread, s, l);
+                worker(tscope, l, mean_ptrs, rss_ptrs, count_ptrs);
+            }, mat, !row, opt);
+            assert(nused > 0);
+
+            if (do_parallel) {
+                parallelize_merge([&](Index_ start, Index_ length) -> void {
+                    const Index_ end = start + length;
+                    const auto& ap_mean = *all_partial_mean;
+                    const auto& ap_rss = *all_partial_rss;
+                    const auto& ap_count = *all_partial_count;
+
+                    for (std::size_t g = 0; g < num_groups; ++g) {
+                        const auto cur_global_count = output.count[g];
+                        for (int u = 0; u < nused; ++u) {
+                            const auto& cur_count = ap_count.get(u)[g];
+                            AUVEH_NODEP
+                            for (Index_ d = start; d < end; ++d) {
+                                cur_global_count[d] += cur_count[d];
+                            }
+                        }
                     }
-                } else {
-                    const auto& cur_rss = (*(ap_rss[u - 1]))[g];
-                    AUVEH_NODEP
-                    for (Index_ d = 0; d < dim; ++d) {
-                        cur_output[d] += quickstats::recenter_rss(cur_count[d], cur_rss[d], cur_mean[d], cur_global_mean[d]); 
+
+                    // Computing the global mean.
+                    for (std::size_t g = 0; g < num_groups; ++g) {
+                        const auto cur_global_count = output.count[g];
+                        const auto cur_global_mean = output.mean[g];
+
+                        for (int u = 0; u < nused; ++u) {
+                            const auto& cur_mean = ap_mean.get(u)[g];
+                            const auto& cur_count = ap_count.get(u)[g];
+                            AUVEH_NODEP
+                            for (Index_ d = start; d < end; ++d) {
+                                if (cur_count[d] > 0) {
+                                    const auto mult = static_cast<Output_>(cur_count[d]) / static_cast<Output_>(cur_global_count[d]);
+                                    cur_global_mean[d] += cur_mean[d] * mult;
+                                }
+                            }
+                        }
                     }
-                }
+
+                    // Combining the RSS. We need to use the safe variant of recenter_rss(), just to protect against the
+                    // case where a group has no observations within a particular thread. 
+                    for (std::size_t g = 0; g < num_groups; ++g) {
+                        const auto cur_global_mean = output.mean[g];
+                        const auto cur_output = output.rss[g];
+                        for (int u = 0; u < nused; ++u) {
+                            const auto& cur_mean = ap_mean.get(u)[g];
+                            const auto& cur_count = ap_count.get(u)[g];
+                            if (u == 0) {
+                                AUVEH_NODEP
+                                for (Index_ d = start; d < end; ++d) {
+                                    cur_output[d] = quickstats::recenter_rss(cur_count[d], cur_output[d], cur_mean[d], cur_global_mean[d]); 
+                                }
+                            } else {
+                                const auto& cur_rss = ap_rss.get(u)[g];
+                                AUVEH_NODEP
+                                for (Index_ d = start; d < end; ++d) {
+                                    cur_output[d] += quickstats::recenter_rss(cur_count[d], cur_rss[d], cur_mean[d], cur_global_mean[d]); 
+                                }
+                            }
+                        }
+                    }
+                }, dim, opt, "skip_nan::group_rss");
             }
         }
+    };
+
+    if (mat.is_sparse()) {
+        run(create_sparse_worker);
+    } else {
+        run(create_dense_worker);
     }
 
     for (std::size_t g = 0; g < num_groups; ++g) {
@@ -433,10 +581,96 @@ void group_rss_running(
         }
     }
 }
+
+// Adds the transformed zero back to the means after the kernels shifted the sparse values, see tatami_stats::group_rss_unshift_means().
+// Only the means with at least one unskipped observation are modified, as the others are set to the placeholder.
+template<typename Value_, typename Index_, typename Output_, typename Count_, class Transform_>
+void group_rss_unshift_means(const tatami::Matrix<Value_, Index_>& mat, const Index_ dim, GroupRssBuffers<Output_, Count_>& output, const Transform_& transform) {
+    if constexpr(!transform_preserves_zero<Transform_>) {
+        if (!mat.is_sparse()) {
+            return;
+        }
+        const auto zero = transformed_zero<Output_, Value_>(transform);
+        const std::size_t num_groups = output.mean.size();
+        for (std::size_t g = 0; g < num_groups; ++g) {
+            const auto mptr = output.mean[g];
+            const auto cptr = output.count[g];
+            for (Index_ d = 0; d < dim; ++d) {
+                if (cptr[d] > 0) {
+                    mptr[d] += zero;
+                }
+            }
+        }
+    }
+}
 /**
  * @endcond
  */
 
+/**
+ * Plan the computation of `skip_nan::group_rss()`, see `Plan` for details.
+ *
+ * @tparam Count_ Integer type of the number of non-NaN values.
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute RSS values for the rows.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param num_groups Number of groups.
+ * @param opt Options for `skip_nan::group_rss()`.
+ *
+ * @return Plan for `skip_nan::group_rss()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `GroupRssOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Count_, typename Output_, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const std::size_t num_groups, const GroupRssOptions<Output_>& opt) {
+    return plan<Count_>(row, mat, num_groups, IdentityTransform(), opt);
+}
+
+/**
+ * Plan the computation of `skip_nan::group_rss()` with a transformation, see `Plan` for details.
+ * This is the same as the other `plan()` overload, except that the estimated memory usage includes the buffers for the transformed values.
+ *
+ * @tparam Count_ Integer type of the number of non-NaN values.
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute RSS values for the rows.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param num_groups Number of groups.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Options for `skip_nan::group_rss()`.
+ *
+ * @return Plan for `skip_nan::group_rss()` with the supplied arguments.
+ */
+template<typename Count_, typename Output_, typename Value_, typename Index_, class Transform_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const std::size_t num_groups, const Transform_& transform, const GroupRssOptions<Output_>& opt) {
+    (void)transform;
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = saturating_add(
+        otherdim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0) + (is_identity_transform<Transform_> ? 0 : sizeof(Output_))),
+        saturating_multiply(num_groups, 2 * sizeof(Output_) + 2 * sizeof(Index_))
+    );
+    model.running_buffer = saturating_add(dim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0)), (sparse ? saturating_multiply(num_groups, dim * sizeof(Count_)) : 0));
+    if (opt.deterministic) {
+        // The per-element counts of non-NaN values for each group are also stored in each partial result.
+        model.running_deterministic_node = saturating_add(deterministic_node_memory<Output_>(saturating_multiply(num_groups, 2), dim), saturating_multiply(num_groups, dim * sizeof(Index_)));
+    } else {
+        model.running_partial_all = saturating_multiply(num_groups, dim * (sizeof(Output_) + sizeof(Count_)));
+        model.running_partial_rest = saturating_multiply(num_groups, dim * sizeof(Output_));
+    }
+    return choose_plan(model, row, mat, opt);
+}
+
 /**
  * Compute per-group variances for each element of a chosen dimension of a `tatami::Matrix`.
  *
@@ -465,15 +699,59 @@ void group_rss(
     const std::size_t num_groups,
     GroupRssBuffers<Output_, Count_>& output,
     const GroupRssOptions<Output_>& opt
+) {
+    group_rss(row, mat, group, num_groups, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute per-group RSS values of transformed values for each element of a chosen dimension of a `tatami::Matrix`, after skipping any NaNs.
+ * This is equivalent to calling the other `skip_nan::group_rss()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformation is performed inside the kernels to avoid a separate pass over each extracted row/column.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Output_ Floating-point type of the output value.
+ * @tparam Count_ Numeric type of the non-NaN counts.
+ * This is typically an integer type.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute variances for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param[out] output Buffers in which to store the results.
+ * On output, each array stores the means, RSS values and counts of the transformed values in the corresponding group.
+ * @param transform Transformation to apply to each matrix value.
+ * NaNs are skipped after the transformation.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Group_, typename Output_, typename Count_, class Transform_>
+void group_rss(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    GroupRssBuffers<Output_, Count_>& output,
+    const Transform_& transform,
+    const GroupRssOptions<Output_>& opt
 ) {
     assert(sanisizer::is_equal(num_groups, output.mean.size()));
     assert(sanisizer::is_equal(num_groups, output.rss.size()));
     assert(sanisizer::is_equal(num_groups, output.count.size()));
-    if (mat.prefer_rows() == row) {
-        group_rss_direct(row, mat, group, num_groups, output, opt);
+    const auto cur_plan = plan<Count_>(row, mat, num_groups, transform, opt);
+    trace_path(opt.tracer, "skip_nan::group_rss", cur_plan.running, mat.is_sparse(), true);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    reserve_workspace(opt.workspace, planned_opt.num_threads);
+    if (!cur_plan.running) {
+        group_rss_direct(row, mat, group, num_groups, output, transform, planned_opt);
     } else {
-        group_rss_running(row, mat, group, num_groups, output, opt);
+        group_rss_running(row, mat, group, num_groups, output, transform, planned_opt);
     }
+    group_rss_unshift_means(mat, static_cast<Index_>(row ? mat.nrow() : mat.ncol()), output, transform);
 }
 
 /**
@@ -573,6 +851,76 @@ GroupRssResult<Output_, Count_> group_rss(
     return output;
 }
 
+/**
+ * Overload of `skip_nan::group_rss()` that allocates memory for the results of the transformed values.
+ *
+ * @tparam Output_ Floating-point type of the output value.
+ * @tparam Count_ Numeric type of the non-NaN counts.
+ * This is typically an integer type.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Group_ Integer type of the group assignments for each row/column.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute variances for the rows.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[in] group Pointer to an array of length equal to the number of columns (if `row = true`) or rows (otherwise).
+ * Each value should be an integer that specifies the group assignment.
+ * Values should lie in \f$[0, N)\f$ where \f$N\f$ is the number of unique groups.
+ * @param num_groups Number of groups, i.e., \f$N\f$.
+ * @param transform Transformation to apply to each matrix value.
+ * NaNs are skipped after the transformation.
+ * @param opt Further options.
+ *
+ * @return RSS, mean and count of the transformed values in each group for each row/column.
+ */
+template<typename Output_, typename Count_, typename Value_, typename Index_, typename Group_, class Transform_> 
+GroupRssResult<Output_, Count_> group_rss(
+    bool row,
+    const tatami::Matrix<Value_, Index_>& mat,
+    const Group_* const group,
+    const std::size_t num_groups,
+    const Transform_& transform,
+    const GroupRssOptions<Output_>& opt
+) {
+    GroupRssResult<Output_, Count_> output;
+    sanisizer::resize(output.mean, num_groups);
+    sanisizer::resize(output.rss, num_groups);
+    sanisizer::resize(output.count, num_groups);
+
+    GroupRssBuffers<Output_, Count_> buffers;
+    sanisizer::resize(buffers.mean, num_groups);
+    sanisizer::resize(buffers.rss, num_groups);
+    sanisizer::resize(buffers.count, num_groups);
+
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        tatami::resize_container_to_Index_size(output.mean[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        buffers.mean[g] = output.mean[g].data();
+
+        tatami::resize_container_to_Index_size(output.rss[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        buffers.rss[g] = output.rss[g].data();
+
+        tatami::resize_container_to_Index_size(output.count[g], dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+            , -1
+#endif
+        );
+        buffers.count[g] = output.count[g].data();
+    }
+
+    group_rss(row, mat, group, num_groups, buffers, transform, opt);
+    return output;
+}
+
 }
 
 }
@@ -2,6 +2,8 @@
 #define TATAMI_STATS_SKIP_NAN_RANGE_HPP
 
 #include "../utils.hpp"
+#include "../partition.hpp"
+#include "../prefetch.hpp"
 
 #include <vector>
 #include <algorithm>
@@ -57,9 +59,47 @@ struct RangeOptions {
     /**
      * Number of threads to use when computing ranges across a `tatami::Matrix`.
      * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     * On the direct path, if there are fewer rows/columns than threads, the other dimension is also split across threads and the partial ranges are combined.
      */
     int num_threads = 1;
 
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+
     /**
      * Placeholder for the minimum value in `RangeBuffers::minimum` or `RangeResults::minimum`,
      * when there are zero columns (if `row == true`) or rows (otherwise).
@@ -177,36 +217,37 @@ struct RangeBuffers {
  */
 template<typename Value_, typename Index_, typename Output_, typename Count_>
 void range_direct(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuffers<Output_, Count_>& output, const RangeOptions<Output_>& opt) {
-    const auto dim = (row ? mat.nrow() : mat.ncol());
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
 
     if (mat.is_sparse()) {
         tatami::Options topt;
         topt.sparse_extract_index = false;
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<true>(mat, row, s, l, topt);
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "skip_nan::range", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor, topt);
             auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
             for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(vbuffer.data(), NULL);
+                auto out = tscope.fetch([&]() { return ext->fetch(vbuffer.data(), NULL); });
                 auto res = range_direct(out.value, out.number, otherdim, opt);
                 output.minimum[x + s] = res.minimum;
                 output.maximum[x + s] = res.maximum;
                 output.count[x + s] = res.count;
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
 
     } else {
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<false>(mat, row, s, l);
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "skip_nan::range", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
             auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
             for (Index_ x = 0; x < l; ++x) {
-                auto ptr = ext->fetch(buffer.data());
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer.data()); });
                 auto res = range_direct(ptr, otherdim, opt);
                 output.minimum[x + s] = res.minimum;
                 output.maximum[x + s] = res.maximum;
                 output.count[x + s] = res.count;
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
     }
 }
 
@@ -217,12 +258,12 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
     const bool is_sparse = mat.is_sparse();
 
     const bool do_parallel = opt.num_threads > 1; 
-    std::optional<std::vector<std::optional<std::vector<Output_> > > > all_partial_min, all_partial_max;
-    std::optional<std::vector<std::optional<std::vector<Count_> > > > all_partial_count;
+    std::optional<PartialBuffers<Output_> > all_partial_min, all_partial_max;
+    std::optional<PartialBuffers<Count_> > all_partial_count;
     if (do_parallel) {
-        all_partial_min.emplace(sanisizer::cast<I<decltype(all_partial_min->size())> >(opt.num_threads - 1));
-        all_partial_max.emplace(sanisizer::cast<I<decltype(all_partial_max->size())> >(opt.num_threads - 1));
-        all_partial_count.emplace(sanisizer::cast<I<decltype(all_partial_count->size())> >(opt.num_threads - 1));
+        all_partial_min.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL, opt.num_threads, opt.allocator);
+        all_partial_max.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL + 1, opt.num_threads, opt.allocator);
+        all_partial_count.emplace(static_cast<Workspace*>(NULL), WORKSPACE_PARTIAL + 2, opt.num_threads, opt.allocator);
     }
 
     std::fill_n(output.count, dim, 0);
@@ -241,12 +282,11 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
         std::fill_n(output.maximum, dim, 0);
     }
 
-    const auto nused = tatami::parallelize([&](int thread, Index_ s, Index_ l) -> void {
+    const auto nused = parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+        TraceScope tscope(opt.tracer, "skip_nan::range", "compute", thread);
         Output_* min_ptr;
         Output_* max_ptr;
         Count_* count_ptr;
-        std::optional<std::vector<Output_> > cur_min, cur_max;
-        std::optional<std::vector<Count_> > cur_count;
         if (!do_parallel) {
             min_ptr = output.minimum;
             max_ptr = output.maximum;
@@ -257,25 +297,25 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
                 max_ptr = output.maximum;
                 count_ptr = output.count;
             } else {
-                cur_min.emplace(tatami::cast_Index_to_container_size<std::vector<Output_> >(dim));
-                cur_max.emplace(tatami::cast_Index_to_container_size<std::vector<Output_> >(dim));
-                cur_count.emplace(tatami::cast_Index_to_container_size<std::vector<Count_> >(dim));
-                min_ptr = cur_min->data();
-                max_ptr = cur_max->data();
-                count_ptr = cur_count->data();
+                min_ptr = all_partial_min->acquire(thread, dim)[0];
+                tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim));
+                max_ptr = all_partial_max->acquire(thread, dim)[0];
+                tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim));
+                count_ptr = all_partial_count->acquire(thread, dim)[0];
+                tscope.add_bytes(sizeof(Count_) * static_cast<std::size_t>(dim));
             }
         }
 
         if (is_sparse) {
             tatami::Options topt;
             topt.sparse_ordered_index = false;
-            auto ext = tatami::consecutive_extractor<true>(mat, !row, s, l, topt);
+            auto ext = prefetch_consecutive_extractor<true>(mat, !row, s, l, opt.prefetch, opt.executor, topt);
             auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
             auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
             auto nonzeros = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
 
             for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(vbuffer.data(), ibuffer.data());
+                auto out = tscope.fetch([&]() { return ext->fetch(vbuffer.data(), ibuffer.data()); });
 
                 // For the first observed vector in each thread, we can optimize it a little as we don't need to read existing min/max.
                 if (x == 0) {
@@ -327,11 +367,11 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
             }
 
         } else {
-            auto ext = tatami::consecutive_extractor<false>(mat, !row, s, l);
+            auto ext = prefetch_consecutive_extractor<false>(mat, !row, s, l, opt.prefetch, opt.executor);
             auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
 
             for (Index_ x = 0; x < l; ++x) {
-                auto ptr = ext->fetch(buffer.data());
+                auto ptr = tscope.fetch([&]() { return ext->fetch(buffer.data()); });
 
                 if (x == 0) {
                     // For the first observed vector in each thread,
@@ -368,35 +408,73 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
                 }
             }
         }
-
-        if (do_parallel) {
-            if (thread > 0) {
-                (*all_partial_min)[thread - 1] = std::move(cur_min);
-                (*all_partial_max)[thread - 1] = std::move(cur_max);
-                (*all_partial_count)[thread - 1] = std::move(cur_count);
-            }
-        }
-    }, otherdim, opt.num_threads);
+    }, mat, !row, opt);
 
     if (do_parallel) {
-        for (int u = 1; u < nused; ++u) {
-            const auto& cur_min = *((*all_partial_min)[u - 1]);
-            const auto& cur_max = *((*all_partial_max)[u - 1]);
-            const auto& cur_count = *((*all_partial_count)[u - 1]);
-            AUVEH_NODEP
-            for (Index_ d = 0; d < dim; ++d) {
-                if (!cur_count[d]) {
-                    continue;
-                }
-                if (output.count[d]) {
-                    output.minimum[d] = std::min(cur_min[d], output.minimum[d]);
-                    output.maximum[d] = std::max(cur_max[d], output.maximum[d]);
-                } else {
-                    output.minimum[d] = cur_min[d];
-                    output.maximum[d] = cur_max[d];
+        parallelize_merge([&](Index_ start, Index_ length) -> void {
+            const Index_ end = start + length;
+            for (int u = 1; u < nused; ++u) {
+                const auto cur_min = all_partial_min->get(u)[0];
+                const auto cur_max = all_partial_max->get(u)[0];
+                const auto cur_count = all_partial_count->get(u)[0];
+                AUVEH_NODEP
+                for (Index_ d = start; d < end; ++d) {
+                    if (!cur_count[d]) {
+                        continue;
+                    }
+                    if (output.count[d]) {
+                        output.minimum[d] = std::min(cur_min[d], output.minimum[d]);
+                        output.maximum[d] = std::max(cur_max[d], output.maximum[d]);
+                    } else {
+                        output.minimum[d] = cur_min[d];
+                        output.maximum[d] = cur_max[d];
+                    }
+                    output.count[d] += cur_count[d];
                 }
-                output.count[d] += cur_count[d];
             }
+        }, dim, opt, "skip_nan::range");
+    }
+}
+
+// Splitting the other dimension across threads when 'dim' is too small to occupy them, see split_boundaries().
+// Blocks with no non-NaN values are ignored when merging, as they only contain the placeholders.
+template<typename Value_, typename Index_, typename Output_, typename Count_>
+void range_split(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuffers<Output_, Count_>& output, const std::vector<Index_>& boundaries, const RangeOptions<Output_>& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t num_blocks = boundaries.size() - 1;
+    const auto partial_size = sanisizer::product<typename std::vector<Output_>::size_type>(num_blocks, dim);
+    auto partial_min = sanisizer::create<std::vector<Output_> >(partial_size);
+    auto partial_max = sanisizer::create<std::vector<Output_> >(partial_size);
+    auto partial_count = sanisizer::create<std::vector<Count_> >(partial_size);
+
+    const auto block_opt = split_options(opt);
+    parallelize_split([&](int b, const tatami::Matrix<Value_, Index_>& block) -> void {
+        const std::size_t offset = static_cast<std::size_t>(b) * dim;
+        RangeBuffers<Output_, Count_> buffers;
+        buffers.minimum = partial_min.data() + offset;
+        buffers.maximum = partial_max.data() + offset;
+        buffers.count = partial_count.data() + offset;
+        range_direct(row, block, buffers, block_opt);
+    }, mat, row, boundaries, opt.executor);
+
+    std::copy_n(partial_min.begin(), dim, output.minimum);
+    std::copy_n(partial_max.begin(), dim, output.maximum);
+    std::copy_n(partial_count.begin(), dim, output.count);
+    for (std::size_t b = 1; b < num_blocks; ++b) {
+        const std::size_t offset = b * dim;
+        for (std::size_t d = 0; d < dim; ++d) {
+            const auto block_count = partial_count[offset + d];
+            if (block_count == 0) {
+                continue;
+            }
+            if (output.count[d] == 0) {
+                output.minimum[d] = partial_min[offset + d];
+                output.maximum[d] = partial_max[offset + d];
+            } else {
+                output.minimum[d] = std::min(output.minimum[d], partial_min[offset + d]);
+                output.maximum[d] = std::max(output.maximum[d], partial_max[offset + d]);
+            }
+            output.count[d] += block_count;
         }
     }
 }
@@ -404,6 +482,36 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
  * @endcond
  */
 
+/**
+ * Plan the computation of `skip_nan::range()`, see `Plan` for details.
+ *
+ * @tparam Count_ Integer type of the number of non-NaN values.
+ * @tparam Output_ Numeric type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute the range for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param opt Options for `skip_nan::range()`.
+ *
+ * @return Plan for `skip_nan::range()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `RangeOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Count_, typename Output_, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const RangeOptions<Output_>& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = otherdim * sizeof(Value_);
+    model.running_buffer = dim * (sizeof(Value_) + (sparse ? 2 * sizeof(Index_) : 0));
+    model.running_partial_rest = dim * (2 * sizeof(Output_) + sizeof(Count_));
+    model.direct_split_partial = dim * (2 * sizeof(Output_) + sizeof(Count_));
+    return choose_plan(model, row, mat, opt);
+}
+
 /**
  * Compute ranges for each element of a chosen dimension of a `tatami::Matrix`, after skipping any NaNs.
  *
@@ -423,10 +531,19 @@ void range_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuf
  */
 template<typename Value_, typename Index_, typename Output_, typename Count_>
 void range(bool row, const tatami::Matrix<Value_, Index_>& mat, RangeBuffers<Output_, Count_>& output, const RangeOptions<Output_>& opt) {
-    if (mat.prefer_rows() == row) {
-        range_direct(row, mat, output, opt);
+    const auto cur_plan = plan<Count_>(row, mat, opt);
+    trace_path(opt.tracer, "skip_nan::range", cur_plan.running, mat.is_sparse(), true);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    if (!cur_plan.running) {
+        const auto splits = split_boundaries(row ? mat.nrow() : mat.ncol(), row ? mat.ncol() : mat.nrow(), planned_opt.num_threads);
+        if (splits.empty()) {
+            range_direct(row, mat, output, planned_opt);
+        } else {
+            range_split(row, mat, output, splits, planned_opt);
+        }
     } else {
-        range_running(row, mat, output, opt);
+        range_running(row, mat, output, planned_opt);
     }
 }
 
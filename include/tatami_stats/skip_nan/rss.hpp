@@ -2,6 +2,11 @@
 #define TATAMI_STATS_SKIP_NAN_RSS_HPP
 
 #include "../utils.hpp"
+#include "../partition.hpp"
+#include "../prefetch.hpp"
+#include "../transform.hpp"
+#include "../deterministic.hpp"
+#include "../shifted_rss.hpp"
 
 #include <vector>
 #include <cmath>
@@ -10,6 +15,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <optional>
+#include <cassert>
 
 #include "tatami/tatami.hpp"
 #include "sanisizer/sanisizer.hpp"
@@ -34,9 +40,75 @@ struct RssOptions {
     /**
      * Number of threads to use for iterating over a `tatami::Matrix`.
      * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     * On the direct path, the other dimension may also be split across threads if there are fewer rows/columns than threads, see `split_other`.
      */
     int num_threads = 1;
 
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Whether the running path should give the same results for any `num_threads`.
+     * If true, the rows/columns are processed in fixed blocks that do not depend on the number of threads,
+     * and the partial means and RSS for the blocks are combined in a fixed order, so the results are bitwise identical for any `num_threads`.
+     * This is slightly slower and stores a few more partial results per thread, including the per-element counts of non-NaN values.
+     * The direct path is deterministic as `split_other` is ignored in this mode, but note that `plan()` may choose a different path for different `num_threads` if `strategy = PlanStrategy::COST` or `max_memory_bytes` is set.
+     */
+    bool deterministic = false;
+
+    /**
+     * Whether to split the other dimension across threads on the direct path when there are fewer rows/columns than threads.
+     * If true, the partial means and RSS values for each block of the other dimension are combined afterwards.
+     * This improves parallelization for short, wide matrices but the results will differ slightly from those with `split_other = false` due to round-off, and will depend on `num_threads`.
+     * Ignored if `deterministic = true`.
+     */
+    bool split_other = false;
+
+    /**
+     * Whether the running path should accumulate shifted sums instead of using Welford's algorithm, see `shifted_rss.hpp` for details.
+     * This avoids a division for each element, at the cost of two more arrays of length equal to the number of rows/columns in each thread.
+     */
+    bool shifted_sums = false;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Workspace to reuse buffers across calls, see @ref common_options_workspace.
+     */
+    Workspace* workspace = NULL;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+
     /**
      * Placeholder value to use for the mean when the extent of the relevant dimension is zero.
      * This is NaN if supported by `Output_`, otherwise it is zero.
@@ -75,9 +147,8 @@ struct RssBuffers {
 /**
  * @cond
  */
-template<typename Value_, typename Index_, typename Output_, typename Count_>
-void rss_direct(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_, Count_>& output, const RssOptions<Output_>& opt) {
-    const auto dim = (row ? mat.nrow() : mat.ncol());
+template<typename Value_, typename Index_, typename Output_, typename Count_, class Transform_>
+void rss_direct(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_, Count_>& output, const Transform_& transform, const RssOptions<Output_>& opt) {
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
     quickstats::RssOptions<Output_> ropt;
     ropt.mean_placeholder = opt.mean_placeholder;
@@ -86,45 +157,64 @@ void rss_direct(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<
         tatami::Options topt;
         topt.sparse_extract_index = false;
 
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<true>(mat, row, s, l, topt);
-            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            quickstats::RssWorkspace<Output_> work;
+        // Shifting the transformed values so that the structural zeros are still zero, see tatami_stats::rss_direct().
+        const auto zero = transformed_zero<Output_, Value_>(transform);
+
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "skip_nan::rss", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor, topt);
+            std::vector<Value_> vholder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, vholder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            quickstats::RssWorkspace<Output_> wholder;
+            auto& work = workspace_object(opt.workspace, thread, WORKSPACE_VALUES, wholder);
             for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(vbuffer.data(), NULL);
-                tatami::copy_n(out.value, out.number, vbuffer.data());
-                const auto new_number = shift_nans(vbuffer.data(), out.number);
+                auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, NULL); });
+                const auto vals = copy_transformed_values(transform, out.value, out.number, vbuffer, tbuffer, zero);
+                const auto new_number = shift_nans(vals, out.number);
                 const Index_ new_total = otherdim - (out.number - new_number);
-                const auto res = quickstats::rss(new_total, new_number, vbuffer.data(), work, ropt);
+                const auto res = quickstats::rss(new_total, new_number, vals, work, ropt);
                 output.mean[x + s] = res.mean;
                 output.rss[x + s] = res.rss;
                 output.count[x + s] = new_total;
+                if constexpr(!transform_preserves_zero<Transform_>) {
+                    if (new_total > 0) {
+                        output.mean[x + s] += zero;
+                    }
+                }
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
 
     } else {
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<false>(mat, row, s, l);
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-            quickstats::RssWorkspace<Output_> work;
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "skip_nan::rss", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, holder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+            quickstats::RssWorkspace<Output_> wholder;
+            auto& work = workspace_object(opt.workspace, thread, WORKSPACE_VALUES, wholder);
             for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(buffer.data());
-                tatami::copy_n(out, otherdim, buffer.data());
-                const auto new_total = shift_nans(buffer.data(), otherdim);
-                const auto res = quickstats::rss(new_total, buffer.data(), work, ropt);
+                auto out = tscope.fetch([&]() { return ext->fetch(buffer); });
+                const auto vals = copy_transformed_values(transform, out, otherdim, buffer, tbuffer, static_cast<Output_>(0));
+                const auto new_total = shift_nans(vals, otherdim);
+                const auto res = quickstats::rss(new_total, vals, work, ropt);
                 output.mean[x + s] = res.mean;
                 output.rss[x + s] = res.rss;
                 output.count[x + s] = new_total;
             }
-        }, dim, opt.num_threads);
+        }, mat, row, opt);
     }
 }
 
-template<typename Value_, typename Index_, typename Output_, typename Count_>
-void rss_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_, Count_>& output, const RssOptions<Output_>& opt) {
+template<typename Value_, typename Index_, typename Output_, typename Count_, class Transform_>
+void rss_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_, Count_>& output, const Transform_& transform, const RssOptions<Output_>& opt) {
     const auto dim = (row ? mat.nrow() : mat.ncol());
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
     const bool is_sparse = mat.is_sparse();
+    const auto zero = transformed_zero<Output_, Value_>(transform); // for shifting sparse values, see rss_direct().
 
     std::fill_n(output.rss, dim, 0);
     std::fill_n(output.count, dim, 0);
@@ -135,61 +225,78 @@ void rss_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers
         std::fill_n(output.mean, dim, 0);
     }
 
-    assert(opt.num_threads > 0);
-    const bool do_parallel = opt.num_threads > 1;
-    std::optional<std::vector<std::optional<std::vector<Output_> > > > all_partial_mean, all_partial_rss;
-    std::optional<std::vector<std::optional<std::vector<Count_> > > > all_partial_count;
-    if (do_parallel) {
-        // -1, as we'll repurpose the output buffers to store the output of the first thread.
-        all_partial_rss.emplace(sanisizer::cast<I<decltype(all_partial_rss->size())> >(opt.num_threads - 1));
-        all_partial_mean.emplace(sanisizer::cast<I<decltype(all_partial_mean->size())> >(opt.num_threads));
-        all_partial_count.emplace(sanisizer::cast<I<decltype(all_partial_mean->size())> >(opt.num_threads));
-    }
+    // Each worker computes the mean, RSS and number of non-NaN values for the next 'number' vectors from its range,
+    // storing them in 'partial[0]', 'partial[1]' and 'count_ptr', respectively.
+    const auto create_sparse_worker = [&](int thread, Index_ s, Index_ l) {
+        tatami::Options topt;
+        topt.sparse_ordered_index = false;
+        auto ext = prefetch_consecutive_extractor<true>(mat, !row, s, l, opt.prefetch, opt.executor, topt);
+        return [
+            &,
+            thread,
+            ext = std::move(ext),
+            vholder = std::vector<Value_>(),
+            iholder = std::vector<Index_>(),
+            nholder = std::vector<Count_>(),
+            sholder = std::vector<Output_>(),
+            ssholder = std::vector<Output_>()
+        ](
+            TraceScope& tscope,
+            Index_ number,
+            Output_* const* partial,
+            auto* count_ptr
+        ) mutable -> void {
+            const auto mean_ptr = partial[0];
+            const auto rss_ptr = partial[1];
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, vholder);
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, dim, iholder);
+            const auto nonzeros = workspace_buffer(opt.workspace, thread, WORKSPACE_NONZEROS, dim, nholder);
+            std::fill_n(nonzeros, dim, 0);
+
+            if (opt.shifted_sums) {
+                const auto sum = workspace_buffer(opt.workspace, thread, WORKSPACE_SHIFTED, dim, sholder);
+                const auto sum_squares = workspace_buffer(opt.workspace, thread, WORKSPACE_SHIFTED + 1, dim, ssholder);
+                std::fill_n(sum, dim, 0);
+                std::fill_n(sum_squares, dim, 0);
+
+                for (Index_ x = 0; x < number; ++x) {
+                    auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                    AUVEH_NODEP
+                    for (Index_ i = 0; i < out.number; ++i) {
+                        const auto d = out.index[i];
+                        const auto val = transform_value(transform, out.value[i], zero);
+                        if (!std::isnan(val)) {
+                            // Using the first non-zero, non-NaN value of each element as its shift, see shifted_rss.hpp.
+                            auto& shift = mean_ptr[d];
+                            shift = (nonzeros[d] == 0 ? static_cast<Output_>(val) : shift);
+                            const Output_ delta = val - shift;
+                            sum[d] += delta;
+                            sum_squares[d] += delta * delta;
+                            ++nonzeros[d];
+                        } else {
+                            ++count_ptr[d];
+                        }
+                    }
+                }
 
-    const int nused = tatami::parallelize([&](int thread, Index_ s, Index_ l) -> void {
-        Output_* rss_ptr;
-        Output_* mean_ptr;
-        Count_* count_ptr;
-        std::optional<std::vector<Output_> > cur_rss, cur_mean;
-        std::optional<std::vector<Count_> > cur_count;
-
-        if (!do_parallel) {
-            // Storing mean and RSS directly in the output vector to cut down two allocations if we're not working in parallel.
-            rss_ptr = output.rss;
-            mean_ptr = output.mean;
-            count_ptr = output.count;
-        } else {
-            // Storing the partial RSS directly in the output vector to save ourselves an allocation if we're in the first thread.
-            // We can't do the same for the mean, though, as we need to keep the partial mean and the global mean separate for the reduction.
-            cur_mean.emplace(tatami::cast_Index_to_container_size<std::vector<Output_> >(dim));
-            mean_ptr = cur_mean->data();
-            cur_count.emplace(tatami::cast_Index_to_container_size<std::vector<Count_> >(dim));
-            count_ptr = cur_count->data();
-            if (thread == 0) {
-                rss_ptr = output.rss;
-            } else {
-                cur_rss.emplace(tatami::cast_Index_to_container_size<std::vector<Output_> >(dim));
-                rss_ptr = cur_rss->data();
+                AUVEH_NODEP
+                for (Index_ d = 0; d < dim; ++d) {
+                    auto& unskipped_total = count_ptr[d];
+                    unskipped_total = number - unskipped_total;
+                    shifted_rss_fold_with_zeros<Output_>(mean_ptr[d], rss_ptr[d], sum[d], sum_squares[d], 0, unskipped_total, nonzeros[d]);
+                }
+                return;
             }
-        }
-
-        if (is_sparse) {
-            tatami::Options topt;
-            topt.sparse_ordered_index = false;
-            auto ext = tatami::consecutive_extractor<true>(mat, !row, s, l, topt);
-            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
-            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
-            auto nonzeros = tatami::create_container_of_Index_size<std::vector<Count_> >(dim);
 
-            for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(vbuffer.data(), ibuffer.data());
+            for (Index_ x = 0; x < number; ++x) {
+                auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
                 AUVEH_NODEP
                 for (Index_ i = 0; i < out.number; ++i) {
                     const auto d = out.index[i];
-                    const auto val = out.value[i];
+                    const auto val = transform_value(transform, out.value[i], zero);
                     if (!std::isnan(val)) {
                         auto& nnz = nonzeros[d];
-                        quickstats::update_rss(mean_ptr[d], rss_ptr[d], val, ++nnz); // increment is safe as 'nnz + 1 <= l' fits in an Index_;
+                        quickstats::update_rss(mean_ptr[d], rss_ptr[d], val, ++nnz); // increment is safe as 'nnz + 1 <= number' fits in an Index_;
                     } else {
                         ++count_ptr[d];
                     }
@@ -199,88 +306,252 @@ void rss_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers
             AUVEH_NODEP
             for (Index_ d = 0; d < dim; ++d) {
                 auto& unskipped_total = count_ptr[d];
-                unskipped_total = l - unskipped_total; // could be zero, so the update with zeros needs to be safe.
-                quickstats::update_rss_with_zeros(mean_ptr[d], rss_ptr[d], static_cast<Count_>(unskipped_total - nonzeros[d]), unskipped_total);
+                unskipped_total = number - unskipped_total; // could be zero, so the update with zeros needs to be safe.
+                quickstats::update_rss_with_zeros(mean_ptr[d], rss_ptr[d], static_cast<Count_>(unskipped_total - nonzeros[d]), static_cast<Count_>(unskipped_total));
             }
+        };
+    };
+
+    const auto create_dense_worker = [&](int thread, Index_ s, Index_ l) {
+        auto ext = prefetch_consecutive_extractor<false>(mat, !row, s, l, opt.prefetch, opt.executor);
+        return [
+            &,
+            thread,
+            ext = std::move(ext),
+            holder = std::vector<Value_>(),
+            nholder = std::vector<Count_>(),
+            sholder = std::vector<Output_>(),
+            ssholder = std::vector<Output_>()
+        ](
+            TraceScope& tscope,
+            Index_ number,
+            Output_* const* partial,
+            auto* count_ptr
+        ) mutable -> void {
+            const auto mean_ptr = partial[0];
+            const auto rss_ptr = partial[1];
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, holder);
+
+            if (opt.shifted_sums) {
+                const auto block_count = workspace_buffer(opt.workspace, thread, WORKSPACE_NONZEROS, dim, nholder);
+                const auto sum = workspace_buffer(opt.workspace, thread, WORKSPACE_SHIFTED, dim, sholder);
+                const auto sum_squares = workspace_buffer(opt.workspace, thread, WORKSPACE_SHIFTED + 1, dim, ssholder);
+                std::fill_n(block_count, dim, 0);
+                std::fill_n(sum, dim, 0);
+                std::fill_n(sum_squares, dim, 0);
+
+                Index_ folded = 0;
+                for (Index_ x = 0; x < number; ++x) {
+                    auto out = tscope.fetch([&]() { return ext->fetch(buffer); });
+                    AUVEH_NODEP
+                    for (Index_ d = 0; d < dim; ++d) {
+                        const auto val = transform_value(transform, out[d], static_cast<Output_>(0));
+                        const bool keep = !std::isnan(val);
+                        // Using the first non-NaN value of each element as its shift until the first fold.
+                        auto& shift = mean_ptr[d];
+                        shift = (keep && count_ptr[d] + block_count[d] == 0 ? static_cast<Output_>(val) : shift);
+                        const Output_ delta = (keep ? val - shift : 0);
+                        sum[d] += delta;
+                        sum_squares[d] += delta * delta;
+                        block_count[d] += keep;
+                    }
 
-        } else {
-            auto ext = tatami::consecutive_extractor<false>(mat, !row, s, l);
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
+                    if (static_cast<std::size_t>(x - folded + 1) == SHIFTED_RSS_BLOCK_SIZE || x + 1 == number) {
+                        AUVEH_NODEP
+                        for (Index_ d = 0; d < dim; ++d) {
+                            shifted_rss_fold<Output_>(mean_ptr[d], rss_ptr[d], sum[d], sum_squares[d], count_ptr[d], block_count[d]);
+                            count_ptr[d] += block_count[d]; // addition is safe as the total is no greater than 'number'.
+                            block_count[d] = 0;
+                        }
+                        folded = x + 1;
+                    }
+                }
 
-            for (Index_ x = 0; x < l; ++x) {
-                auto out = ext->fetch(buffer.data());
-                AUVEH_NODEP
-                for (Index_ d = 0; d < dim; ++d) {
-                    const auto val = out[d];
-                    if (!std::isnan(val)) {
-                        quickstats::update_rss(mean_ptr[d], rss_ptr[d], val, ++count_ptr[d]); // increment is safe as 'count_ptr[d] + 1 <= l' fits in an index.
+            } else {
+                for (Index_ x = 0; x < number; ++x) {
+                    auto out = tscope.fetch([&]() { return ext->fetch(buffer); });
+                    AUVEH_NODEP
+                    for (Index_ d = 0; d < dim; ++d) {
+                        const auto val = transform_value(transform, out[d], static_cast<Output_>(0));
+                        if (!std::isnan(val)) {
+                            quickstats::update_rss(mean_ptr[d], rss_ptr[d], val, ++count_ptr[d]); // increment is safe as 'count_ptr[d] + 1 <= number' fits in an index.
+                        }
                     }
                 }
             }
+        };
+    };
+
+    const auto run = [&](const auto& create_worker) -> void {
+        if (opt.deterministic) {
+            // The per-element counts of non-NaN values are stored as the counts of each partial result.
+            Output_* const outputs[2] = { output.mean, output.rss };
+            auto counts = sanisizer::create<std::vector<Index_> >(dim);
+            deterministic_running<Output_>(
+                deterministic_leaves(mat, !row, dim, 2, opt),
+                2,
+                dim,
+                dim,
+                create_worker,
+                [](Output_* const* left, const Index_* left_count, Output_* const* right, const Index_* right_count, Index_ start, Index_ end) -> void {
+                    const auto lmean = left[0], lrss = left[1], rmean = right[0], rrss = right[1];
+                    for (Index_ d = start; d < end; ++d) {
+                        deterministic_merge_rss<Output_>(lmean[d], lrss[d], left_count[d], rmean[d], rrss[d], right_count[d]);
+                    }
+                },
+                outputs,
+                counts.data(),
+                opt,
+                "skip_nan::rss"
+            );
+            std::copy(counts.begin(), counts.end(), output.count);
+            return;
         }
 
-        // Moving results to the main containers.
+        assert(opt.num_threads > 0);
+        const bool do_parallel = opt.num_threads > 1;
+        std::optional<PartialBuffers<Output_> > all_partial_mean, all_partial_rss;
+        std::optional<PartialBuffers<Count_> > all_partial_count;
         if (do_parallel) {
-            (*all_partial_mean)[thread] = std::move(cur_mean);
-            (*all_partial_count)[thread] = std::move(cur_count);
-            if (thread > 0) {
-                (*all_partial_rss)[thread - 1] = std::move(cur_rss);
-            }
-        }
-    }, otherdim, opt.num_threads);
-    assert(nused > 0);
-
-    // Don't check nused > 1, as it's possible for do_parallel = true with nused = 1 if not all threads are used.
-    // This would cause us to leave output.mean and output.rss empty.
-    if (do_parallel) {
-        const auto& ap_mean = *all_partial_mean;
-        const auto& ap_rss = *all_partial_rss;
-        const auto& ap_count = *all_partial_count;
-
-        // Computing the global total.
-        for (int u = 0; u < nused; ++u) {
-            const auto& cur_count = *(ap_count[u]);
-            AUVEH_NODEP
-            for (Index_ d = 0; d < dim; ++d) {
-                output.count[d] += cur_count[d];
-            }
+            // The first thread's partial RSS is stored in the RSS output buffer, so its entry in all_partial_rss is unused.
+            all_partial_rss.emplace(opt.workspace, WORKSPACE_PARTIAL, opt.num_threads, opt.allocator);
+            all_partial_mean.emplace(opt.workspace, WORKSPACE_PARTIAL + 1, opt.num_threads, opt.allocator);
+            all_partial_count.emplace(opt.workspace, WORKSPACE_PARTIAL + 2, opt.num_threads, opt.allocator);
         }
 
-        // Computing the global mean from its components.
-        for (int u = 0; u < nused; ++u) {
-            const auto& cur_count = *(ap_count[u]);
-            const auto& cur_mean = *(ap_mean[u]);
-            AUVEH_NODEP
-            for (Index_ d = 0; d < dim; ++d) {
-                if (cur_count[d] > 0) { // protect against NaN means at a count of 0.
-                    const auto mult = static_cast<Output_>(cur_count[d]) / static_cast<Output_>(output.count[d]);
-                    output.mean[d] += cur_mean[d] * mult;
+        const int nused = parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "skip_nan::rss", "compute", thread);
+            Output_* partial[2];
+            auto& mean_ptr = partial[0];
+            auto& rss_ptr = partial[1];
+            Count_* count_ptr;
+
+            if (!do_parallel) {
+                // Storing mean and RSS directly in the output vector to cut down two allocations if we're not working in parallel.
+                rss_ptr = output.rss;
+                mean_ptr = output.mean;
+                count_ptr = output.count;
+            } else {
+                // Storing the partial RSS directly in the output vector to save ourselves an allocation if we're in the first thread.
+                // We can't do the same for the mean, though, as we need to keep the partial mean and the global mean separate for the reduction.
+                mean_ptr = all_partial_mean->acquire(thread, dim)[0];
+                tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim));
+                count_ptr = all_partial_count->acquire(thread, dim)[0];
+                tscope.add_bytes(sizeof(Count_) * static_cast<std::size_t>(dim));
+                if (thread == 0) {
+                    rss_ptr = output.rss;
+                } else {
+                    rss_ptr = all_partial_rss->acquire(thread, dim)[0];
+                    tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim));
                 }
             }
-        }
 
-        // Combining the RSS. This time, we need to use the safe version as we don't know whether all elements were skipped in a thread.
-        for (int u = 0; u < nused; ++u) {
-            const auto& cur_count = *(ap_count[u]);
-            const auto& cur_mean = *(ap_mean[u]);
-            if (u == 0) {
-                AUVEH_NODEP
-                for (Index_ d = 0; d < dim; ++d) {
-                    output.rss[d] = quickstats::recenter_rss(cur_count[d], output.rss[d], cur_mean[d], output.mean[d]); 
+            auto worker = create_worker(thread, s, l);
+            worker(tscope, l, partial, count_ptr);
+        }, mat, !row, opt);
+        assert(nused > 0);
+
+        // Don't check nused > 1, as it's possible for do_parallel = true with nused = 1 if not all threads are used.
+        // This would cause us to leave output.mean and output.rss empty.
+        if (do_parallel) {
+            parallelize_merge([&](Index_ start, Index_ length) -> void {
+                const Index_ end = start + length;
+                const auto& ap_mean = *all_partial_mean;
+                const auto& ap_rss = *all_partial_rss;
+                const auto& ap_count = *all_partial_count;
+
+                // Computing the global total.
+                for (int u = 0; u < nused; ++u) {
+                    const auto cur_count = ap_count.get(u)[0];
+                    AUVEH_NODEP
+                    for (Index_ d = start; d < end; ++d) {
+                        output.count[d] += cur_count[d];
+                    }
                 }
-            } else {
-                const auto& cur_rss = *(ap_rss[u - 1]);
-                AUVEH_NODEP
-                for (Index_ d = 0; d < dim; ++d) {
-                    output.rss[d] += quickstats::recenter_rss(cur_count[d], cur_rss[d], cur_mean[d], output.mean[d]); 
+
+                // Computing the global mean from its components.
+                for (int u = 0; u < nused; ++u) {
+                    const auto cur_count = ap_count.get(u)[0];
+                    const auto cur_mean = ap_mean.get(u)[0];
+                    AUVEH_NODEP
+                    for (Index_ d = start; d < end; ++d) {
+                        if (cur_count[d] > 0) { // protect against NaN means at a count of 0.
+                            const auto mult = static_cast<Output_>(cur_count[d]) / static_cast<Output_>(output.count[d]);
+                            output.mean[d] += cur_mean[d] * mult;
+                        }
+                    }
                 }
-            }
+
+                // Combining the RSS. This time, we need to use the safe version as we don't know whether all elements were skipped in a thread.
+                for (int u = 0; u < nused; ++u) {
+                    const auto cur_count = ap_count.get(u)[0];
+                    const auto cur_mean = ap_mean.get(u)[0];
+                    if (u == 0) {
+                        AUVEH_NODEP
+                        for (Index_ d = start; d < end; ++d) {
+                            output.rss[d] = quickstats::recenter_rss(cur_count[d], output.rss[d], cur_mean[d], output.mean[d]); 
+                        }
+                    } else {
+                        const auto cur_rss = ap_rss.get(u)[0];
+                        AUVEH_NODEP
+                        for (Index_ d = start; d < end; ++d) {
+                            output.rss[d] += quickstats::recenter_rss(cur_count[d], cur_rss[d], cur_mean[d], output.mean[d]); 
+                        }
+                    }
+                }
+            }, dim, opt, "skip_nan::rss");
         }
+
+    };
+
+    if (is_sparse) {
+        run(create_sparse_worker);
+    } else {
+        run(create_dense_worker);
     }
 
     for (Index_ d = 0; d < dim; ++ d) {
         if (output.count[d] == 0) { 
             output.mean[d] = opt.mean_placeholder;
+        } else if constexpr(!transform_preserves_zero<Transform_>) {
+            if (is_sparse) {
+                output.mean[d] += zero;
+            }
+        }
+    }
+}
+
+// Splitting the other dimension across threads when 'dim' is too small to occupy them, see split_boundaries().
+// The per-block means and RSS values are merged with Chan's method, using the number of non-NaN values in each block.
+template<typename Value_, typename Index_, typename Output_, typename Count_, class Transform_>
+void rss_split(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_, Count_>& output, const Transform_& transform, const std::vector<Index_>& boundaries, const RssOptions<Output_>& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t num_blocks = boundaries.size() - 1;
+    const auto partial_size = sanisizer::product<typename std::vector<Output_>::size_type>(num_blocks, dim);
+    auto partial_mean = sanisizer::create<std::vector<Output_> >(partial_size);
+    auto partial_rss = sanisizer::create<std::vector<Output_> >(partial_size);
+    auto partial_count = sanisizer::create<std::vector<Count_> >(partial_size);
+
+    auto block_opt = split_options(opt);
+    block_opt.workspace = NULL;
+    parallelize_split([&](int b, const tatami::Matrix<Value_, Index_>& block) -> void {
+        const std::size_t offset = static_cast<std::size_t>(b) * dim;
+        RssBuffers<Output_, Count_> buffers;
+        buffers.mean = partial_mean.data() + offset;
+        buffers.rss = partial_rss.data() + offset;
+        buffers.count = partial_count.data() + offset;
+        rss_direct(row, block, buffers, transform, block_opt);
+    }, mat, row, boundaries, opt.executor);
+
+    std::copy_n(partial_mean.begin(), dim, output.mean);
+    std::copy_n(partial_rss.begin(), dim, output.rss);
+    std::copy_n(partial_count.begin(), dim, output.count);
+    for (std::size_t b = 1; b < num_blocks; ++b) {
+        const std::size_t offset = b * dim;
+        for (std::size_t d = 0; d < dim; ++d) {
+            const auto block_count = partial_count[offset + d];
+            deterministic_merge_rss<Output_>(output.mean[d], output.rss[d], output.count[d], partial_mean[offset + d], partial_rss[offset + d], block_count);
+            output.count[d] += block_count;
         }
     }
 }
@@ -288,6 +559,68 @@ void rss_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers
  * @endcond
  */
 
+/**
+ * Plan the computation of `skip_nan::rss()`, see `Plan` for details.
+ *
+ * @tparam Count_ Integer type of the number of non-NaN values.
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute the RSS for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param opt Options for `skip_nan::rss()`.
+ *
+ * @return Plan for `skip_nan::rss()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `RssOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Count_, typename Output_, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const RssOptions<Output_>& opt) {
+    return plan<Count_>(row, mat, IdentityTransform(), opt);
+}
+
+/**
+ * Plan the computation of `skip_nan::rss()` with a transformation, see `Plan` for details.
+ * This is the same as the other `plan()` overload, except that the estimated memory usage includes the buffers for the transformed values.
+ *
+ * @tparam Count_ Integer type of the number of non-NaN values.
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the RSS for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Options for `skip_nan::rss()`.
+ *
+ * @return Plan for `skip_nan::rss()` with the supplied arguments.
+ */
+template<typename Count_, typename Output_, typename Value_, typename Index_, class Transform_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const Transform_& transform, const RssOptions<Output_>& opt) {
+    (void)transform;
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = otherdim * (sizeof(Value_) + (is_identity_transform<Transform_> ? 0 : sizeof(Output_)));
+    model.running_buffer = dim * (sizeof(Value_) + (sparse ? sizeof(Index_) + sizeof(Count_) : 0) + (opt.shifted_sums ? 2 * sizeof(Output_) + sizeof(Index_) : 0));
+    if (opt.deterministic) {
+        // The per-element counts of non-NaN values are also stored in each partial result.
+        model.running_deterministic_node = saturating_add(deterministic_node_memory<Output_>(2, dim), dim * sizeof(Index_));
+    } else {
+        model.running_partial_all = dim * (sizeof(Output_) + sizeof(Count_));
+        model.running_partial_rest = dim * sizeof(Output_);
+    }
+    if (opt.split_other && !opt.deterministic) {
+        model.direct_split_partial = dim * (2 * sizeof(Output_) + sizeof(Count_));
+    }
+    return choose_plan(model, row, mat, opt);
+}
+
 /**
  * Compute residual sums of squares (RSS) for each element of a chosen dimension of a `tatami::Matrix`, after skipping any NaNs.
  * This may use either Welford's method or the standard two-pass method,
@@ -308,10 +641,47 @@ void rss_running(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers
  */
 template<typename Value_, typename Index_, typename Output_, typename Count_>
 void rss(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_, Count_>& output, const RssOptions<Output_>& opt) {
-    if (mat.prefer_rows() == row) {
-        rss_direct(row, mat, output, opt);
+    rss(row, mat, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute the RSS of transformed values for each element of a chosen dimension of a `tatami::Matrix`, after skipping any NaNs.
+ * This is equivalent to calling the other `skip_nan::rss()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformation is performed inside the kernels to avoid a separate pass over each extracted row/column.
+ *
+ * @tparam Value_ Numeric type of the input data.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Count_ Numeric type of the non-NaN counts.
+ * This is typically an integer type.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the RSS for each row.
+ * If false, the RSS is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[out] output Buffers to output arrays.
+ * On output, this will contain the row/column means and RSSs of the transformed values.
+ * @param transform Transformation to apply to each matrix value.
+ * NaNs are skipped after the transformation.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Output_, typename Count_, class Transform_>
+void rss(bool row, const tatami::Matrix<Value_, Index_>& mat, RssBuffers<Output_, Count_>& output, const Transform_& transform, const RssOptions<Output_>& opt) {
+    const auto cur_plan = plan<Count_>(row, mat, transform, opt);
+    trace_path(opt.tracer, "skip_nan::rss", cur_plan.running, mat.is_sparse(), true);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    reserve_workspace(opt.workspace, planned_opt.num_threads);
+    if (!cur_plan.running) {
+        // Splitting the other dimension makes the results depend on the number of threads, so it is opt-in and skipped in deterministic mode.
+        const auto splits = (!planned_opt.split_other || planned_opt.deterministic ? std::vector<Index_>() : split_boundaries(row ? mat.nrow() : mat.ncol(), row ? mat.ncol() : mat.nrow(), planned_opt.num_threads));
+        if (splits.empty()) {
+            rss_direct(row, mat, output, transform, planned_opt);
+        } else {
+            rss_split(row, mat, output, transform, splits, planned_opt);
+        }
     } else {
-        rss_running(row, mat, output, opt);
+        rss_running(row, mat, output, transform, planned_opt);
     }
 }
 
@@ -389,6 +759,54 @@ RssResult<Output_, Count_> rss(bool row, const tatami::Matrix<Value_, Index_>& m
     return output;
 }
 
+/**
+ * Overload of `skip_nan::rss()` that allocates memory for the output arrays, for transformed values.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Count_ Numeric type of the non-NaN counts.
+ * This is typically an integer type.
+ * @tparam Value_ Numeric type of the input data.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the RSS for each row.
+ * If false, the RSS is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ *
+ * @return The mean and RSS of the transformed values in each row/column.
+ */
+template<typename Output_ = double, typename Count_, typename Value_, typename Index_, class Transform_>
+RssResult<Output_, Count_> rss(bool row, const tatami::Matrix<Value_, Index_>& mat, const Transform_& transform, const RssOptions<Output_>& opt) {
+    RssResult<Output_, Count_> output;
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+
+    tatami::resize_container_to_Index_size(output.mean, dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    tatami::resize_container_to_Index_size(output.rss, dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    tatami::resize_container_to_Index_size(output.count, dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+
+    RssBuffers<Output_, Count_> buffers;
+    buffers.mean = output.mean.data();
+    buffers.rss = output.rss.data();
+    buffers.count = output.count.data();
+
+    rss(row, mat, buffers, transform, opt);
+    return output;
+}
+
 }
 
 }
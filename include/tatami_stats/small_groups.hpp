@@ -0,0 +1,189 @@
+#ifndef TATAMI_STATS_SMALL_GROUPS_HPP
+#define TATAMI_STATS_SMALL_GROUPS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "utils.hpp"
+
+/**
+ * @file small_groups.hpp
+ *
+ * @brief Specialized kernels for small numbers of groups.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @cond
+ */
+// Largest number of groups for which the direct paths of group_sum() and group_rss() use the specialized kernels.
+// This is the measured break-even point of the masked kernels below against the generic kernels, on 100000-element vectors (GCC 12, x86-64, -O2 and -O3).
+// Each additional group adds a masked addition per element, while the generic kernel gets faster with more groups as consecutive updates are less likely to hit the same group:
+//
+// - With randomly interleaved groups, the masked kernels were ~10-35% faster for 2 groups but ~1.3-1.7x slower for 3 groups and ~2-4x slower for 4 groups.
+// - With contiguous groups, the masked kernels were ~25-50% faster for 3 groups, roughly even for 4-6 groups and ~1.4-2x slower for 7-8 groups.
+//
+// The layout of the groups is not known in advance, so we stop at 2 groups to avoid the large penalty for interleaved groups.
+constexpr std::size_t SMALL_GROUPS_MAX = 2;
+
+// Calls 'fun' with a std::integral_constant holding 'num_groups', if it is no greater than SMALL_GROUPS_MAX.
+// Returns false if 'num_groups' is too large, in which case the caller should use the generic kernel.
+template<std::size_t num_groups_ = 1, class Function_>
+bool dispatch_small_groups(const std::size_t num_groups, Function_&& fun) {
+    if constexpr(num_groups_ > SMALL_GROUPS_MAX) {
+        return false;
+    } else {
+        if (num_groups == num_groups_) {
+            fun(std::integral_constant<std::size_t, num_groups_>());
+            return true;
+        }
+        return dispatch_small_groups<num_groups_ + 1>(num_groups, std::forward<Function_>(fun));
+    }
+}
+
+// The kernels below accumulate per-group statistics into SMALL_GROUPS_LANES independent sets of accumulators,
+// where the j-th element goes into set 'j % SMALL_GROUPS_LANES' and the sets are combined in a fixed order at the end.
+// This breaks the dependency between successive updates to the same group, which otherwise limits throughput when groups are contiguous.
+// For a single group, no lookup is required and the compiler can vectorize across the elements.
+constexpr std::size_t SMALL_GROUPS_LANES = 4;
+
+// Returns 'val' if 'keep' is true and zero otherwise, without branching.
+// For IEEE floating-point types, we clear all bits with an integer mask, which compilers emit as a bitwise AND;
+// a conditional expression is often compiled into an unpredictable branch instead.
+template<typename Output_>
+Output_ small_group_mask(const bool keep, const Output_ val) {
+    if constexpr(std::is_floating_point<Output_>::value && std::numeric_limits<Output_>::is_iec559 && (sizeof(Output_) == 8 || sizeof(Output_) == 4)) {
+        typedef typename std::conditional<sizeof(Output_) == 8, std::uint64_t, std::uint32_t>::type Bits;
+        Bits bits;
+        std::memcpy(&bits, &val, sizeof(Output_));
+        bits &= -static_cast<Bits>(keep);
+        Output_ output;
+        std::memcpy(&output, &bits, sizeof(Output_));
+        return output;
+    } else {
+        return val * static_cast<Output_>(keep);
+    }
+}
+
+// For multiple groups, each element is added to every group's accumulator after masking out the contributions to the other groups.
+// The loops over groups and lanes are unrolled with fold expressions so that the accumulators are only indexed by compile-time constants,
+// allowing them to stay in (vector) registers instead of being loaded and stored through a runtime group index for every element.
+// This trades 'num_groups_' masked additions per element for the removal of the store-to-load dependency, which only pays off for a few groups, see SMALL_GROUPS_MAX.
+template<std::size_t group_, typename Output_, typename Index_, class Contribution_, std::size_t ... lane_>
+void small_group_masked_lanes(
+    std::array<Output_, SMALL_GROUPS_LANES>& partial,
+    const std::array<std::size_t, SMALL_GROUPS_LANES>& groups,
+    const Index_ j,
+    Contribution_& contribution,
+    std::index_sequence<lane_...>)
+{
+    ((partial[lane_] += small_group_mask(groups[lane_] == group_, contribution(static_cast<Index_>(j + lane_), group_))), ...);
+}
+
+template<typename Output_, std::size_t num_groups_, typename Index_, class Contribution_, std::size_t ... group_>
+void small_group_masked_add(
+    std::array<std::array<Output_, SMALL_GROUPS_LANES>, num_groups_>& partial,
+    const std::array<std::size_t, SMALL_GROUPS_LANES>& groups,
+    const Index_ j,
+    Contribution_& contribution,
+    std::index_sequence<group_...>)
+{
+    (small_group_masked_lanes<group_>(partial[group_], groups, j, contribution, std::make_index_sequence<SMALL_GROUPS_LANES>()), ...);
+}
+
+template<std::size_t num_groups_, typename Output_, typename Index_, class GetGroup_, class Contribution_>
+void small_group_accumulate(std::array<Output_, num_groups_>& output, const Index_ number, GetGroup_ get_group, Contribution_ contribution) {
+    std::array<std::array<Output_, SMALL_GROUPS_LANES>, num_groups_> partial{};
+    const Index_ full = number - number % static_cast<Index_>(SMALL_GROUPS_LANES);
+    Index_ j = 0;
+
+    if constexpr(num_groups_ == 1) {
+        for (; j < full; j += SMALL_GROUPS_LANES) {
+            for (std::size_t l = 0; l < SMALL_GROUPS_LANES; ++l) {
+                partial[0][l] += contribution(static_cast<Index_>(j + l), 0);
+            }
+        }
+        for (; j < number; ++j) {
+            partial[0][0] += contribution(j, 0);
+        }
+
+    } else {
+        std::array<std::size_t, SMALL_GROUPS_LANES> groups;
+        for (; j < full; j += SMALL_GROUPS_LANES) {
+            for (std::size_t l = 0; l < SMALL_GROUPS_LANES; ++l) {
+                groups[l] = get_group(static_cast<Index_>(j + l));
+            }
+            small_group_masked_add(partial, groups, j, contribution, std::make_index_sequence<num_groups_>());
+        }
+        for (; j < number; ++j) {
+            const std::size_t grp = get_group(j);
+            partial[grp][0] += contribution(j, grp);
+        }
+    }
+
+    for (std::size_t b = 0; b < num_groups_; ++b) {
+        for (std::size_t l = 0; l < SMALL_GROUPS_LANES; ++l) {
+            output[b] += partial[b][l];
+        }
+    }
+}
+
+template<std::size_t num_groups_, typename Output_, typename Value_, typename Index_, class GetGroup_>
+void small_group_sums(std::array<Output_, num_groups_>& sums, const Value_* const values, const Index_ number, GetGroup_ get_group, const bool skip_nan) {
+    nanable_ifelse<Value_>(
+        skip_nan,
+        [&]() -> void {
+            small_group_accumulate(sums, number, get_group, [&](Index_ j, std::size_t) -> Output_ {
+                const auto val = values[j];
+                return (std::isnan(val) ? static_cast<Output_>(0) : static_cast<Output_>(val));
+            });
+        },
+        [&]() -> void {
+            small_group_accumulate(sums, number, get_group, [&](Index_ j, std::size_t) -> Output_ {
+                return values[j];
+            });
+        }
+    );
+}
+
+template<std::size_t num_groups_, typename Count_, typename Index_, class GetGroup_>
+void small_group_counts(std::array<Count_, num_groups_>& counts, const Index_ number, GetGroup_ get_group) {
+    std::array<Count_, num_groups_> tmp{}; // local copy so that the compiler can keep the counts in registers.
+    for (Index_ j = 0; j < number; ++j) {
+        const std::size_t grp = get_group(j);
+        for (std::size_t b = 0; b < num_groups_; ++b) {
+            tmp[b] += (grp == b);
+        }
+    }
+    for (std::size_t b = 0; b < num_groups_; ++b) {
+        counts[b] += tmp[b];
+    }
+}
+
+template<std::size_t num_groups_, typename Output_, typename Value_, typename Index_, class GetGroup_>
+void small_group_squared_deviations(
+    std::array<Output_, num_groups_>& rss,
+    const std::array<Output_, num_groups_>& means,
+    const Value_* const values,
+    const Index_ number,
+    GetGroup_ get_group)
+{
+    small_group_accumulate(rss, number, get_group, [&](Index_ j, std::size_t b) -> Output_ {
+        const Output_ delta = values[j] - means[b];
+        return delta * delta;
+    });
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
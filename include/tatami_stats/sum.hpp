@@ -2,6 +2,10 @@
 #define TATAMI_STATS_SUM_HPP
 
 #include "utils.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+#include "transform.hpp"
+#include "deterministic.hpp"
 
 #include <vector>
 #include <numeric>
@@ -32,150 +36,228 @@ struct SumOptions {
     /**
      * Number of threads to use when computing sums across a `tatami::Matrix`.
      * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     * On the direct path, the other dimension may also be split across threads if there are fewer rows/columns than threads, see `split_other`.
      */
     int num_threads = 1;
+
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Whether the running path should give the same results for any `num_threads`.
+     * If true, the rows/columns are processed in fixed blocks that do not depend on the number of threads,
+     * and the partial sums for the blocks are merged in a fixed order, so the results are bitwise identical for any `num_threads`.
+     * This is slightly slower and stores a few more partial results per thread.
+     * The direct path is deterministic as `split_other` is ignored in this mode, but note that `plan()` may choose a different path for different `num_threads` if `strategy = PlanStrategy::COST` or `max_memory_bytes` is set.
+     */
+    bool deterministic = false;
+
+    /**
+     * Whether to split the other dimension across threads on the direct path when there are fewer rows/columns than threads.
+     * If true, the partial sums for each block of the other dimension are combined afterwards.
+     * This improves parallelization for short, wide matrices but the results will differ slightly from those with `split_other = false` due to round-off, and will depend on `num_threads`.
+     * Ignored if `deterministic = true`.
+     */
+    bool split_other = false;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Workspace to reuse buffers across calls, see @ref common_options_workspace.
+     */
+    Workspace* workspace = NULL;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
 };
 
 /**
  * @cond
  */
-template<typename Value_, typename Index_, typename Output_>
-void sum_direct(bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* output, const SumOptions& opt) {
-    const auto dim = (row ? mat.nrow() : mat.ncol());
+// NaN-free vectors are summed in the same manner as when 'skip_nan = false',
+// so that skipping NaNs only costs a quick scan on clean data.
+template<typename Output_, typename Value_, typename Index_>
+Output_ sum_values(const Value_* const vals, const Index_ number, quickstats::PairwiseSumWorkspace<Output_>& work, const bool skip_nan) {
+    const bool any_nan = nanable_ifelse_with_value<Value_>(
+        skip_nan,
+        [&]() -> bool {
+            return has_nan(vals, number);
+        },
+        []() -> bool {
+            return false;
+        }
+    );
+
+    if (any_nan) {
+        Output_ sum = 0;
+        for (Index_ i = 0; i < number; ++i) {
+            const auto val = vals[i];
+            if (!std::isnan(val)) {
+                sum += val;
+            }
+        }
+        return sum;
+    }
+
+    return quickstats::pairwise_sum(number, vals, work); // Index_ -> size_t conversion is safe, as per tatami's contract.
+}
+
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void sum_direct(bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* output, const Transform_& transform, const SumOptions& opt) {
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
 
     if (mat.is_sparse()) {
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
+        const auto zero = transformed_zero<Output_, Value_>(transform);
+
+        // Adding the contribution of the structural zeros for transformations that don't preserve zero.
+        const auto add_zeros = [&](Output_& sum, const Index_ number) -> void {
+            if constexpr(!transform_preserves_zero<Transform_>) {
+                if (number < otherdim) {
+                    sum += zero * static_cast<Output_>(otherdim - number);
+                }
+            }
+        };
+
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "sum", "compute", thread);
             tatami::Options topt;
             topt.sparse_extract_index = false;
-            auto ext = tatami::consecutive_extractor<true>(mat, row, s, l, topt);
-            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-
-            nanable_ifelse<Value_>(
-                opt.skip_nan,
-                [&]() -> void {
-                    for (Index_ x = 0; x < l; ++x) {
-                        const auto out = ext->fetch(vbuffer.data(), NULL);
-                        Output_ sum = 0;
-                        for (Index_ i = 0; i < out.number; ++i) {
-                            const auto val = out.value[i];
-                            if (!std::isnan(val)) {
-                                sum += val;
-                            }
-                        }
-                        output[x + s] = sum;
-                    }
-                },
-                [&]() -> void {
-                    quickstats::PairwiseSumWorkspace<Output_> work;
-                    for (Index_ x = 0; x < l; ++x) {
-                        const auto out = ext->fetch(vbuffer.data(), NULL);
-                        output[x + s] = quickstats::pairwise_sum(out.number, out.value, work); // Index_ -> size_t conversion is safe, as per tatami's contract.
-                    }
-                }
-            );
-        }, dim, opt.num_threads);
+            auto ext = prefetch_consecutive_extractor<true>(mat, row, s, l, opt.prefetch, opt.executor, topt);
+            std::vector<Value_> vholder;
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, vholder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+
+            quickstats::PairwiseSumWorkspace<Output_> wholder;
+            auto& work = workspace_object(opt.workspace, thread, WORKSPACE_VALUES, wholder);
+            for (Index_ x = 0; x < l; ++x) {
+                const auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, NULL); });
+                const auto vals = transform_values(transform, out.value, out.number, tbuffer, static_cast<Output_>(0));
+                Output_ sum = sum_values(vals, out.number, work, opt.skip_nan);
+                add_zeros(sum, out.number);
+                output[x + s] = sum;
+            }
+        }, mat, row, opt);
 
     } else {
-        tatami::parallelize([&](int, Index_ s, Index_ l) -> void {
-            auto ext = tatami::consecutive_extractor<false>(mat, row, s, l);
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(otherdim);
-
-            nanable_ifelse<Value_>(
-                opt.skip_nan,
-                [&]() -> void {
-                    for (Index_ x = 0; x < l; ++x) {
-                        const auto ptr = ext->fetch(buffer.data());
-                        Output_ sum = 0;
-                        for (Index_ i = 0; i < otherdim; ++i) {
-                            const auto val = ptr[i];
-                            if (!std::isnan(val)) {
-                                sum += val;
-                            }
-                        }
-                        output[x + s] = sum;
-                    }
-                },
-                [&]() -> void {
-                    quickstats::PairwiseSumWorkspace<Output_> work;
-                    for (Index_ x = 0; x < l; ++x) {
-                        const auto ptr = ext->fetch(buffer.data());
-                        output[x + s] = quickstats::pairwise_sum(otherdim, ptr, work); // Index_ -> size_t conversion is safe, as per tatami's contract.
-                    }
-                }
-            );
-        }, dim, opt.num_threads);
+        parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "sum", "compute", thread);
+            auto ext = prefetch_consecutive_extractor<false>(mat, row, s, l, opt.prefetch, opt.executor);
+            std::vector<Value_> holder;
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, otherdim, holder);
+            std::vector<Output_> tholder;
+            const auto tbuffer = transform_buffer<Output_, Transform_>(opt.workspace, thread, otherdim, tholder);
+
+            quickstats::PairwiseSumWorkspace<Output_> wholder;
+            auto& work = workspace_object(opt.workspace, thread, WORKSPACE_VALUES, wholder);
+            for (Index_ x = 0; x < l; ++x) {
+                const auto ptr = tscope.fetch([&]() { return ext->fetch(buffer); });
+                const auto vals = transform_values(transform, ptr, otherdim, tbuffer, static_cast<Output_>(0));
+                output[x + s] = sum_values(vals, otherdim, work, opt.skip_nan);
+            }
+        }, mat, row, opt);
     }
 }
 
-template<typename Value_, typename Index_, typename Output_>
-void sum_running(bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* output, const SumOptions& opt) {
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void sum_running(bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* output, const Transform_& transform, const SumOptions& opt) {
     const auto dim = (row ? mat.nrow() : mat.ncol());
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
+    typedef TransformedValue<Value_, Output_, Transform_> Transformed;
 
-    const bool do_parallel = (opt.num_threads > 1);
-    std::optional<std::vector<std::optional<std::vector<Output_> > > > all_partial_sum;
-    if (do_parallel) {
-        all_partial_sum.emplace(sanisizer::cast<I<decltype(all_partial_sum->size())> >(opt.num_threads - 1));
-    }
+    // For sparse matrices, the transformed zero is subtracted from each non-zero value and added back at the end.
+    const bool is_sparse = mat.is_sparse();
+    const auto zero = transformed_zero<Output_, Value_>(transform);
 
-    std::fill_n(output, dim, 0);
+    // Each worker adds the next 'number' vectors from its range to 'sums[0]'.
+    const auto create_sparse_worker = [&](int thread, Index_ s, Index_ l) {
+        tatami::Options topt;
+        topt.sparse_ordered_index = false; // ordering doesn't matter.
+        auto ext = prefetch_consecutive_extractor<true>(mat, !row, s, l, opt.prefetch, opt.executor, topt);
+        return [&, thread, ext = std::move(ext), vholder = std::vector<Value_>(), iholder = std::vector<Index_>()](
+            TraceScope& tscope,
+            Index_ number,
+            Output_* const* sums,
+            Index_*
+        ) mutable -> void {
+            const auto sum_ptr = sums[0];
+            const auto vbuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, vholder);
+            const auto ibuffer = workspace_buffer(opt.workspace, thread, WORKSPACE_INDICES, dim, iholder);
 
-    const auto nused = tatami::parallelize([&](int thread, Index_ s, Index_ l) -> void {
-        Output_* sum_ptr;
-        std::optional<std::vector<Output_> > cur_sum;
-        if (!do_parallel) {
-            sum_ptr = output;
-        } else {
-            if (thread == 0) {
-                sum_ptr = output;
-            } else {
-                cur_sum.emplace(tatami::cast_Index_to_container_size<std::vector<Output_> >(dim));
-                sum_ptr = cur_sum->data();
-            }
-        }
-
-        if (mat.is_sparse()) {
-            tatami::Options topt;
-            topt.sparse_ordered_index = false; // ordering doesn't matter.
-            auto ext = tatami::consecutive_extractor<true>(mat, !row, s, l, topt);
-            auto vbuffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
-            auto ibuffer = tatami::create_container_of_Index_size<std::vector<Index_> >(dim);
-
-            for (Index_ x = 0; x < l; ++x) {
-                const auto out = ext->fetch(vbuffer.data(), ibuffer.data());
-                nanable_ifelse<Value_>(
+            for (Index_ x = 0; x < number; ++x) {
+                const auto out = tscope.fetch([&]() { return ext->fetch(vbuffer, ibuffer); });
+                nanable_ifelse<Transformed>(
                     opt.skip_nan,
                     [&]() -> void {
                         AUVEH_NODEP
                         for (Index_ i = 0; i < out.number; ++i) {
-                            const auto val = out.value[i];
+                            const auto val = transform_value(transform, out.value[i], zero);
                             if (!std::isnan(val)) {
                                 sum_ptr[out.index[i]] += val;
+                            } else if constexpr(!transform_preserves_zero<Transform_>) {
+                                sum_ptr[out.index[i]] -= zero; // cancelling out the transformed zero that is added back for this skipped value.
                             }
                         }
                     },
                     [&]() -> void {
                         AUVEH_NODEP
                         for (Index_ i = 0; i < out.number; ++i) {
-                            sum_ptr[out.index[i]] += out.value[i];
+                            sum_ptr[out.index[i]] += transform_value(transform, out.value[i], zero);
                         }
                     }
                 );
             }
+        };
+    };
 
-        } else {
-            auto ext = tatami::consecutive_extractor<false>(mat, !row, s, l);
-            auto buffer = tatami::create_container_of_Index_size<std::vector<Value_> >(dim);
+    const auto create_dense_worker = [&](int thread, Index_ s, Index_ l) {
+        auto ext = prefetch_consecutive_extractor<false>(mat, !row, s, l, opt.prefetch, opt.executor);
+        return [&, thread, ext = std::move(ext), holder = std::vector<Value_>()](
+            TraceScope& tscope,
+            Index_ number,
+            Output_* const* sums,
+            Index_*
+        ) mutable -> void {
+            const auto sum_ptr = sums[0];
+            const auto buffer = workspace_buffer(opt.workspace, thread, WORKSPACE_VALUES, dim, holder);
 
-            for (Index_ x = 0; x < l; ++x) {
-                const auto ptr = ext->fetch(buffer.data());
-                nanable_ifelse<Value_>(
+            for (Index_ x = 0; x < number; ++x) {
+                const auto ptr = tscope.fetch([&]() { return ext->fetch(buffer); });
+                nanable_ifelse<Transformed>(
                     opt.skip_nan,
                     [&]() -> void {
                         AUVEH_NODEP
                         for (Index_ i = 0; i < dim; ++i) {
-                            const auto val = ptr[i];
+                            const auto val = transform_value(transform, ptr[i], static_cast<Output_>(0));
                             if (!std::isnan(val)) {
                                 sum_ptr[i] += val;
                             }
@@ -184,34 +266,178 @@ void sum_running(bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* o
                     [&]() -> void {
                         AUVEH_NODEP
                         for (Index_ i = 0; i < dim; ++i) {
-                            sum_ptr[i] += ptr[i];
+                            sum_ptr[i] += transform_value(transform, ptr[i], static_cast<Output_>(0));
                         }
                     }
                 );
             }
+        };
+    };
+
+    const auto run = [&](const auto& create_worker) -> void {
+        if (opt.deterministic) {
+            deterministic_running<Output_>(
+                deterministic_leaves(mat, !row, dim, 1, opt),
+                1,
+                dim,
+                0,
+                create_worker,
+                [](Output_* const* left, const Index_*, Output_* const* right, const Index_*, Index_ start, Index_ end) -> void {
+                    const auto lsum = left[0];
+                    const auto rsum = right[0];
+                    AUVEH_NODEP
+                    for (Index_ d = start; d < end; ++d) {
+                        lsum[d] += rsum[d];
+                    }
+                },
+                &output,
+                static_cast<Index_*>(NULL),
+                opt,
+                "sum"
+            );
+            return;
         }
 
+        const bool do_parallel = (opt.num_threads > 1);
+        std::optional<PartialBuffers<Output_> > all_partial_sum;
         if (do_parallel) {
-            if (thread > 0) {
-                (*all_partial_sum)[thread - 1] = std::move(cur_sum);
+            all_partial_sum.emplace(opt.workspace, WORKSPACE_PARTIAL, opt.num_threads, opt.allocator);
+        }
+
+        std::fill_n(output, dim, 0);
+
+        const auto nused = parallelize_vectors([&](int thread, Index_ s, Index_ l) -> void {
+            TraceScope tscope(opt.tracer, "sum", "compute", thread);
+            Output_* sum_ptr;
+            if (!do_parallel) {
+                sum_ptr = output;
+            } else {
+                if (thread == 0) {
+                    sum_ptr = output;
+                } else {
+                    sum_ptr = all_partial_sum->acquire(thread, dim)[0];
+                    tscope.add_bytes(sizeof(Output_) * static_cast<std::size_t>(dim));
+                }
             }
+
+            auto worker = create_worker(thread, s, l);
+            worker(tscope, l, &sum_ptr, NULL);
+        }, mat, !row, opt);
+
+        if (do_parallel) {
+            parallelize_merge([&](Index_ start, Index_ length) -> void {
+                const Index_ end = start + length;
+                for (int u = 1; u < nused; ++u) {
+                    const auto cur_sum = all_partial_sum->get(u)[0];
+                    AUVEH_NODEP
+                    for (Index_ d = start; d < end; ++d) {
+                        output[d] += cur_sum[d];
+                    }
+                }
+            }, dim, opt, "sum");
         }
-    }, otherdim, opt.num_threads);
+    };
+
+    if (is_sparse) {
+        run(create_sparse_worker);
+    } else {
+        run(create_dense_worker);
+    }
 
-    if (do_parallel) {
-        for (int u = 1; u < nused; ++u) {
-            const auto& cur_sum = *((*all_partial_sum)[u - 1]);
-            AUVEH_NODEP
+    if constexpr(!transform_preserves_zero<Transform_>) {
+        if (is_sparse && otherdim > 0) {
+            const Output_ all_zeros = zero * static_cast<Output_>(otherdim);
             for (Index_ d = 0; d < dim; ++d) {
-                output[d] += cur_sum[d];
+                output[d] += all_zeros;
             }
         }
     }
 }
+
+// Splitting the other dimension across threads when 'dim' is too small to occupy them, see split_boundaries().
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void sum_split(bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* output, const Transform_& transform, const std::vector<Index_>& boundaries, const SumOptions& opt) {
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t num_blocks = boundaries.size() - 1;
+    auto partials = sanisizer::create<std::vector<Output_> >(sanisizer::product<typename std::vector<Output_>::size_type>(num_blocks, dim));
+
+    auto block_opt = split_options(opt);
+    block_opt.workspace = NULL;
+    parallelize_split([&](int b, const tatami::Matrix<Value_, Index_>& block) -> void {
+        sum_direct(row, block, partials.data() + static_cast<std::size_t>(b) * dim, transform, block_opt);
+    }, mat, row, boundaries, opt.executor);
+
+    std::copy_n(partials.begin(), dim, output);
+    for (std::size_t b = 1; b < num_blocks; ++b) {
+        const auto current = partials.data() + b * dim;
+        AUVEH_NODEP
+        for (std::size_t d = 0; d < dim; ++d) {
+            output[d] += current[d];
+        }
+    }
+}
 /**
  * @endcond
  */
 
+/**
+ * Plan the computation of `sum()`, see `Plan` for details.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ *
+ * @param row Whether to compute the sum for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param opt Options for `sum()`.
+ *
+ * @return Plan for `sum()` with the supplied arguments.
+ * The path and number of threads are first chosen according to the `strategy` in `opt`,
+ * and then adjusted to fit within `SumOptions::max_memory_bytes` if it is set, see `Plan::feasible` for details.
+ */
+template<typename Output_ = double, typename Value_, typename Index_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const SumOptions& opt) {
+    return plan<Output_>(row, mat, IdentityTransform(), opt);
+}
+
+/**
+ * Plan the computation of `sum()` with a transformation, see `Plan` for details.
+ * This is the same as the other `plan()` overload, except that the estimated memory usage includes the buffers for the transformed values.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the sum for each row.
+ * If false, this is done for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Options for `sum()`.
+ *
+ * @return Plan for `sum()` with the supplied arguments.
+ */
+template<typename Output_ = double, typename Value_, typename Index_, class Transform_>
+Plan plan(const bool row, const tatami::Matrix<Value_, Index_>& mat, const Transform_& transform, const SumOptions& opt) {
+    (void)transform;
+    const std::size_t dim = (row ? mat.nrow() : mat.ncol());
+    const std::size_t otherdim = (row ? mat.ncol() : mat.nrow());
+    const bool sparse = mat.is_sparse();
+    MemoryModel model;
+    model.direct_buffer = otherdim * (sizeof(Value_) + (is_identity_transform<Transform_> ? 0 : sizeof(Output_)));
+    model.running_buffer = dim * (sizeof(Value_) + (sparse ? sizeof(Index_) : 0));
+    if (opt.deterministic) {
+        model.running_deterministic_node = deterministic_node_memory<Output_>(1, dim);
+    } else {
+        model.running_partial_rest = dim * sizeof(Output_);
+    }
+    if (opt.split_other && !opt.deterministic) {
+        model.direct_split_partial = dim * sizeof(Output_);
+    }
+    return choose_plan(model, row, mat, opt);
+}
+
 /**
  * Compute sums for each element of a chosen dimension of a `tatami::Matrix`.
  * This may either use pairwise summation or direct accumulation,
@@ -232,10 +458,46 @@ void sum_running(bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* o
  */
 template<typename Value_, typename Index_, typename Output_>
 void sum(bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* output, const SumOptions& opt) {
-    if (mat.prefer_rows() == row) {
-        sum_direct(row, mat, output, opt);
+    sum(row, mat, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute sums of transformed values for each element of a chosen dimension of a `tatami::Matrix`.
+ * This is equivalent to calling the other `sum()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformation is performed inside the summation loops to avoid a separate pass over each extracted row/column.
+ *
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Output_ Numeric type of the output value.
+ * It is assumed that this is large enough to store the sums. 
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the sum for each row.
+ * If false, the sum is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[out] output Pointer to an array of length equal to the number of rows (if `row = true`) or columns (otherwise).
+ * On output, this will contain the row/column sums of the transformed values.
+ * @param transform Transformation to apply to each matrix value.
+ * If `SumOptions::skip_nan = true`, NaNs are skipped after the transformation.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void sum(bool row, const tatami::Matrix<Value_, Index_>& mat, Output_* output, const Transform_& transform, const SumOptions& opt) {
+    const auto cur_plan = plan<Output_>(row, mat, transform, opt);
+    trace_path(opt.tracer, "sum", cur_plan.running, mat.is_sparse(), opt.skip_nan);
+    auto planned_opt = opt;
+    planned_opt.num_threads = cur_plan.num_threads;
+    reserve_workspace(opt.workspace, planned_opt.num_threads);
+    if (!cur_plan.running) {
+        // Splitting the other dimension makes the results depend on the number of threads, so it is opt-in and skipped in deterministic mode.
+        const auto splits = (!planned_opt.split_other || planned_opt.deterministic ? std::vector<Index_>() : split_boundaries(row ? mat.nrow() : mat.ncol(), row ? mat.ncol() : mat.nrow(), planned_opt.num_threads));
+        if (splits.empty()) {
+            sum_direct(row, mat, output, transform, planned_opt);
+        } else {
+            sum_split(row, mat, output, transform, splits, planned_opt);
+        }
     } else {
-        sum_running(row, mat, output, opt);
+        sum_running(row, mat, output, transform, planned_opt);
     }
 }
 
@@ -267,6 +529,36 @@ std::vector<Output_> sum(bool row, const tatami::Matrix<Value_, Index_>& mat, co
     return output;
 }
 
+/**
+ * Overload of `sum()` that allocates memory for the output sums of transformed values.
+ *
+ * @tparam Output_ Numeric type of the output value.
+ * It is assumed that this is large enough to store the sums. 
+ * @tparam Value_ Numeric type of the matrix value.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the sum for each row.
+ * If false, the sum is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ *
+ * @return Vector of length equal to the number of rows (if `row = true`) or columns (otherwise),
+ * containing the row/column sums of the transformed values.
+ */
+template<typename Output_ = double, typename Value_, typename Index_, class Transform_>
+std::vector<Output_> sum(bool row, const tatami::Matrix<Value_, Index_>& mat, const Transform_& transform, const SumOptions& opt) {
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    auto output = sanisizer::create<std::vector<Output_> >(dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    sum(row, mat, output.data(), transform, opt);
+    return output;
+}
+
 }
 
 #endif
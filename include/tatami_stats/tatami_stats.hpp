@@ -1,17 +1,36 @@
 #ifndef TATAMI_TATAMI_STATS_HPP
 #define TATAMI_TATAMI_STATS_HPP
 
+#include "allocator.hpp"
+#include "blocked_variance.hpp"
 #include "count.hpp"
+#include "deterministic.hpp"
+#include "executor.hpp"
+#include "group_count.hpp"
 #include "group_median.hpp"
+#include "group_range.hpp"
+#include "group_sink.hpp"
 #include "group_sum.hpp"
 #include "group_variance.hpp"
+#include "margins.hpp"
 #include "median.hpp"
+#include "partition.hpp"
+#include "plan.hpp"
+#include "prefetch.hpp"
 #include "quantile.hpp"
 #include "range.hpp"
+#include "reduce.hpp"
+#include "select.hpp"
+#include "shifted_rss.hpp"
+#include "small_groups.hpp"
 #include "sum.hpp"
+#include "trace.hpp"
+#include "transform.hpp"
 #include "utils.hpp"
 #include "variance.hpp"
+#include "workspace.hpp"
 
+#include "skip_nan/group_range.hpp"
 #include "skip_nan/rss.hpp"
 
 /**
@@ -33,4 +52,41 @@ namespace skip_nan {}
 
 }
 
+/**
+ * @page common_options Common options
+ *
+ * Most options structures share a few fields that control the execution of a function rather than the statistic itself.
+ * These have the same meaning wherever they are present, so they are only documented here.
+ *
+ * @section common_options_executor executor
+ *
+ * An `Executor` to use for running the threads, e.g., to reuse an application-wide thread pool.
+ * If provided, this replaces `tatami::parallelize()` and is also used to parallelize the merging of per-thread results, if any.
+ * If NULL, threads are created via `tatami::parallelize()` in each call.
+ *
+ * @section common_options_tracer tracer
+ *
+ * A `Tracer` to record the time spent and the work done in each phase, along with the path taken by the function.
+ * If NULL, no tracing is performed and the overhead is negligible, see `Tracer` for details.
+ *
+ * @section common_options_max_memory_bytes max_memory_bytes
+ *
+ * Maximum memory usage in bytes, as estimated by `Plan::memory`.
+ * If the estimated usage would exceed this limit, the number of threads is reduced and/or the other path is used, see `plan()` for details.
+ * If no configuration fits, the one with the lowest estimated usage is used instead, and `plan()` reports the budget as infeasible via `Plan::feasible`.
+ * Functions that are implemented on top of others (e.g., `variance()` on `rss()`) pass this limit on to the underlying function.
+ * If unset, no limit is applied.
+ *
+ * @section common_options_workspace workspace
+ *
+ * A `Workspace` to reuse buffers across calls, e.g., when the same function is repeatedly applied to different matrices.
+ * If NULL, buffers are allocated in each call.
+ *
+ * @section common_options_allocator allocator
+ *
+ * An `Allocator` for the per-thread partial results.
+ * If NULL, an `AlignedAllocator` is used with default arguments.
+ * This is ignored if a `workspace` is also supplied, in which case the allocator of the `Workspace` is used instead.
+ */
+
 #endif
@@ -0,0 +1,196 @@
+#ifndef TATAMI_STATS_TRANSFORM_HPP
+#define TATAMI_STATS_TRANSFORM_HPP
+
+#include <type_traits>
+#include <utility>
+
+#include "tatami/tatami.hpp"
+
+#include "utils.hpp"
+#include "workspace.hpp"
+
+/**
+ * @file transform.hpp
+ *
+ * @brief Element-wise transformations that are applied inside the statistics kernels.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @brief Identity transformation.
+ *
+ * This is the default transformation for functions like `sum()` and `variance()`, and is optimized away at compile time.
+ */
+struct IdentityTransform {
+    /**
+     * The identity transformation maps zero to zero.
+     */
+    static constexpr bool preserves_zero = true;
+
+    /**
+     * @tparam Value_ Numeric type of the matrix value.
+     * @param x Matrix value.
+     * @return `x`, unchanged.
+     */
+    template<typename Value_>
+    Value_ operator()(const Value_ x) const {
+        return x;
+    }
+};
+
+/**
+ * @brief Element-wise transformation of the matrix values.
+ *
+ * Functions like `sum()` and `variance()` accept a transformation that is applied to each matrix value before the statistic is computed.
+ * This gives the same results as wrapping the matrix in a `tatami::DelayedUnaryIsometricOperation`,
+ * but avoids the extra virtual call and the rewrite of the extraction buffer in each fetch.
+ * Transformed values are converted to the output type, so integer matrices can be transformed into floating-point values.
+ *
+ * For sparse matrices, all structural zeros are assumed to be transformed to `function(0)`, which should be finite.
+ * The sparsity of the matrix is still exploited when `function(0)` is not zero, as the contribution of the structural zeros is corrected for in each statistic.
+ * If `preserves_zero_ = true`, this correction is skipped entirely.
+ *
+ * Any functor can be used as a transformation in place of this class.
+ * If the functor has a `static constexpr bool preserves_zero` member, it is used in the same manner as `preserves_zero_`;
+ * otherwise, the transformation is assumed to not preserve zeros.
+ *
+ * @tparam Function_ Function that accepts a matrix value and returns the transformed value.
+ * @tparam preserves_zero_ Whether `Function_` maps zero to zero.
+ * This should only be set to true if it is known at compile time, otherwise the results will be incorrect for sparse matrices.
+ */
+template<class Function_, bool preserves_zero_ = false>
+struct Transform {
+    /**
+     * @param function Function that accepts a matrix value and returns the transformed value.
+     */
+    Transform(Function_ function) : function(std::move(function)) {}
+
+    /**
+     * Function that accepts a matrix value and returns the transformed value.
+     */
+    Function_ function;
+
+    /**
+     * Whether `function` maps zero to zero.
+     */
+    static constexpr bool preserves_zero = preserves_zero_;
+
+    /**
+     * @tparam Value_ Numeric type of the matrix value.
+     * @param x Matrix value.
+     * @return Transformed value.
+     */
+    template<typename Value_>
+    auto operator()(const Value_ x) const {
+        return function(x);
+    }
+};
+
+/**
+ * @tparam preserves_zero_ Whether `function` maps zero to zero.
+ * @tparam Function_ Function that accepts a matrix value and returns the transformed value.
+ * @param function Function that accepts a matrix value and returns the transformed value.
+ * @return A `Transform` for `function`.
+ */
+template<bool preserves_zero_ = false, class Function_>
+Transform<Function_, preserves_zero_> make_transform(Function_ function) {
+    return Transform<Function_, preserves_zero_>(std::move(function));
+}
+
+/**
+ * @cond
+ */
+template<class Transform_>
+constexpr bool is_identity_transform = std::is_same<I<Transform_>, IdentityTransform>::value;
+
+template<class Transform_, typename = int>
+struct TransformPreservesZero {
+    static constexpr bool value = false;
+};
+
+template<class Transform_>
+struct TransformPreservesZero<Transform_, decltype(static_cast<void>(Transform_::preserves_zero), 0)> {
+    static constexpr bool value = Transform_::preserves_zero;
+};
+
+template<class Transform_>
+constexpr bool transform_preserves_zero = TransformPreservesZero<I<Transform_> >::value;
+
+// Type of the values after transformation. We keep the matrix type for the identity so that its code paths are unchanged.
+template<typename Value_, typename Output_, class Transform_>
+using TransformedValue = std::conditional_t<is_identity_transform<Transform_>, Value_, Output_>;
+
+// Value of the structural zeros after transformation.
+template<typename Output_, typename Value_, class Transform_>
+Output_ transformed_zero(const Transform_& transform) {
+    if constexpr(transform_preserves_zero<Transform_>) {
+        return 0;
+    } else {
+        return transform(static_cast<Value_>(0));
+    }
+}
+
+// Transforms a single value. Sparse kernels subtract the transformed zero as a 'shift', so that structural zeros are still zero;
+// the contribution of the shift is then added back to the final statistic.
+template<typename Output_, typename Value_, class Transform_>
+TransformedValue<Value_, Output_, Transform_> transform_value(const Transform_& transform, const Value_ x, const Output_ shift) {
+    if constexpr(is_identity_transform<Transform_>) {
+        return x;
+    } else if constexpr(transform_preserves_zero<Transform_>) {
+        return transform(x);
+    } else {
+        return static_cast<Output_>(transform(x)) - shift;
+    }
+}
+
+// Transforms an array of values into 'buffer', returning a pointer to the transformed values.
+// For the identity, the input pointer is returned directly and 'buffer' is ignored.
+template<typename Output_, typename Value_, typename Index_, class Transform_>
+const TransformedValue<Value_, Output_, Transform_>* transform_values(const Transform_& transform, const Value_* const input, const Index_ number, Output_* const buffer, const Output_ shift) {
+    if constexpr(is_identity_transform<Transform_>) {
+        return input;
+    } else {
+        for (Index_ i = 0; i < number; ++i) {
+            buffer[i] = transform_value(transform, input[i], shift);
+        }
+        return buffer;
+    }
+}
+
+// Like transform_values(), but returns a modifiable array, e.g., for removing NaNs in place.
+// For the identity, the input values are copied into 'value_buffer'.
+template<typename Output_, typename Value_, typename Index_, class Transform_>
+TransformedValue<Value_, Output_, Transform_>* copy_transformed_values(
+    const Transform_& transform,
+    const Value_* const input,
+    const Index_ number,
+    Value_* const value_buffer,
+    Output_* const buffer,
+    const Output_ shift
+) {
+    if constexpr(is_identity_transform<Transform_>) {
+        tatami::copy_n(input, number, value_buffer);
+        return value_buffer;
+    } else {
+        transform_values(transform, input, number, buffer, shift);
+        return buffer;
+    }
+}
+
+// Buffer for the transformed values, which is only allocated for non-identity transformations.
+template<typename Output_, class Transform_, typename Index_>
+Output_* transform_buffer(Workspace* const workspace, const int thread, const Index_ size, std::vector<Output_>& fallback) {
+    if constexpr(is_identity_transform<Transform_>) {
+        return NULL;
+    } else {
+        return workspace_buffer(workspace, thread, WORKSPACE_TRANSFORMED, size, fallback);
+    }
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
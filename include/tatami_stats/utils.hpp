@@ -6,6 +6,8 @@
 #include <cstddef>
 #include <type_traits>
 #include <optional>
+#include <cmath>
+#include <limits>
 
 #include "sanisizer/sanisizer.hpp"
 #include "tatami/tatami.hpp"
@@ -16,8 +18,26 @@ namespace tatami_stats {
 template<typename Input_>
 using I = std::remove_cv_t<std::remove_reference_t<Input_> >;
 
+// Branch-free count so that the loop can be vectorized, which makes it cheap enough to run on every vector.
+template<typename Value_, typename Index_>
+bool has_nan(const Value_* const ptr, const Index_ num) {
+    if constexpr(!std::numeric_limits<Value_>::has_quiet_NaN) {
+        return false;
+    } else {
+        Index_ num_nan = 0;
+        for (Index_ i = 0; i < num; ++i) {
+            num_nan += std::isnan(ptr[i]);
+        }
+        return num_nan > 0;
+    }
+}
+
 template<typename Value_, typename Index_>
 Index_ shift_nans(Value_* const ptr, const Index_ num) {
+    // Most vectors don't have any NaNs, in which case we can skip the compaction.
+    if (!has_nan(ptr, num)) {
+        return num;
+    }
     return quickstats::skip_values(
         num, // conversion of Index_ to a std::size_t is safe due to tatami's guarantees. 
         ptr,
@@ -48,6 +68,69 @@ auto nanable_ifelse_with_value(bool skip_nan, If_ iffun, Else_ elsefun) {
     return elsefun();
 }
 
+// Checks whether the requested quantile of a sparse vector lies within its block of zeros.
+// This only requires the number of negative and positive values, allowing us to skip the copy and selection.
+// We assume that quantiles are computed by interpolating between the floor and ceiling of '(n - 1) * prob'.
+template<typename Value_, typename Index_>
+bool sparse_quantile_is_zero(const Value_* const value, const Index_ num_nonzero, const Index_ num_all, const double prob, const bool skip_nan) {
+    // Only worth an extra pass when zeros are the majority; otherwise, we just fall back to the usual selection.
+    // This is always safe as a 'false' return value just means that the caller computes the quantile in full.
+    if (num_nonzero >= num_all - num_nonzero) {
+        return false;
+    }
+
+    Index_ num_negative = 0, num_positive = 0, num_nan = 0;
+    nanable_ifelse<Value_>(
+        skip_nan,
+        [&]() -> void {
+            for (Index_ i = 0; i < num_nonzero; ++i) {
+                const auto val = value[i];
+                num_negative += (val < 0);
+                num_positive += (val > 0);
+                num_nan += std::isnan(val);
+            }
+        },
+        [&]() -> void {
+            for (Index_ i = 0; i < num_nonzero; ++i) {
+                const auto val = value[i];
+                num_negative += (val < 0);
+                num_positive += (val > 0);
+            }
+        }
+    );
+
+    const Index_ num_used = num_all - num_nan;
+    if (num_used == 0) {
+        return false;
+    }
+
+    const double position = static_cast<double>(num_used - 1) * prob;
+    return static_cast<double>(num_negative) <= std::floor(position) && std::ceil(position) < static_cast<double>(num_used - num_positive);
+}
+
+// Pointers to the first entry of each group in an interleaved array with 'num_groups' consecutive entries per row/column,
+// such that the value for group 'g' and row/column 'd' is at 'ptrs[g][d * num_groups]'.
+template<typename Output_>
+std::vector<Output_*> interleaved_pointers(Output_* const base, const std::size_t num_groups) {
+    auto ptrs = sanisizer::create<std::vector<Output_*> >(num_groups);
+    for (std::size_t g = 0; g < num_groups; ++g) {
+        ptrs[g] = base + g;
+    }
+    return ptrs;
+}
+
+// Fills the 'num' entries of one group in an array with 'step' consecutive entries per row/column, see interleaved_pointers().
+template<typename Output_, typename Index_>
+void fill_strided(Output_* const ptr, const Index_ num, const std::size_t step, const Output_ value) {
+    if (step == 1) {
+        std::fill_n(ptr, num, value);
+        return;
+    }
+    for (Index_ d = 0; d < num; ++d) {
+        ptr[static_cast<std::size_t>(d) * step] = value;
+    }
+}
+
 }
 
 #endif
@@ -16,6 +16,7 @@
 #include "rss.hpp"
 #include "skip_nan/rss.hpp"
 #include "utils.hpp"
+#include "transform.hpp"
 
 /**
  * @file variance.hpp
@@ -40,9 +41,68 @@ struct VarianceOptions {
     /**
      * Number of threads to use when computing variances across a `tatami::Matrix`.
      * See `tatami::parallelize()` for more details on the parallelization mechanism.
+     * On the direct path, the other dimension may also be split across threads if there are fewer rows/columns than threads, see `split_other`.
      */
     int num_threads = 1;
 
+    /**
+     * Whether to balance the workload across threads based on the number of structural non-zero elements in each row/column.
+     * This is only used for sparse matrices when `num_threads > 1`, see `partition_by_cost()` for details.
+     */
+    bool balance_nonzeros = false;
+
+    /**
+     * Executor to use for running the threads, see @ref common_options_executor.
+     */
+    Executor* executor = NULL;
+
+    /**
+     * Tracer to record the time spent and the work done in each phase, see @ref common_options_tracer.
+     */
+    Tracer* tracer = NULL;
+
+    /**
+     * Maximum memory usage in bytes, see @ref common_options_max_memory_bytes.
+     */
+    std::optional<std::size_t> max_memory_bytes;
+
+    /**
+     * Strategy for choosing between the direct and running paths, see `PlanStrategy` for details.
+     */
+    PlanStrategy strategy = PlanStrategy::PREFERRED;
+
+    /**
+     * Whether the running path should give the same results for any `num_threads`, see `RssOptions::deterministic` for details.
+     */
+    bool deterministic = false;
+
+    /**
+     * Whether to split the other dimension across threads on the direct path, see `RssOptions::split_other` for details.
+     */
+    bool split_other = false;
+
+    /**
+     * Whether the running path should accumulate shifted sums instead of using Welford's algorithm, see `shifted_rss.hpp` for details.
+     * This avoids a division for each element, at the cost of two more arrays of length equal to the number of rows/columns in each thread.
+     */
+    bool shifted_sums = false;
+
+    /**
+     * Number of vectors to fetch ahead of the computation in each thread, see `PrefetchExtractor` for details.
+     * If zero, vectors are extracted on demand.
+     */
+    std::size_t prefetch = 0;
+
+    /**
+     * Workspace to reuse buffers across calls, see @ref common_options_workspace.
+     */
+    Workspace* workspace = NULL;
+
+    /**
+     * Allocator for the per-thread partial results, see @ref common_options_allocator.
+     */
+    Allocator* allocator = NULL;
+
     /**
      * Placeholder value to use for the mean when the extent of the relevant dimension is zero.
      * This is NaN if supported by `Output_`, otherwise zero.
@@ -94,23 +154,60 @@ struct VarianceBuffers {
  */
 template<typename Value_, typename Index_, typename Output_>
 void variance(bool row, const tatami::Matrix<Value_, Index_>& mat, VarianceBuffers<Output_>& output, const VarianceOptions<Output_>& opt) {
+    variance(row, mat, output, IdentityTransform(), opt);
+}
+
+/**
+ * Compute sample variances of transformed values for each element of a chosen dimension of a `tatami::Matrix`.
+ * This is equivalent to calling the other `variance()` overloads on a matrix where `transform` is applied to each value,
+ * but the transformation is performed inside the kernels to avoid a separate pass over each extracted row/column.
+ *
+ * @tparam Value_ Numeric type of the input data.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the variance for each row.
+ * If false, the variance is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param[out] output Buffers to output arrays.
+ * On output, this will contain the row/column means and variances of the transformed values.
+ * @param transform Transformation to apply to each matrix value.
+ * If `VarianceOptions::skip_nan = true`, NaNs are skipped after the transformation.
+ * @param opt Further options.
+ */
+template<typename Value_, typename Index_, typename Output_, class Transform_>
+void variance(bool row, const tatami::Matrix<Value_, Index_>& mat, VarianceBuffers<Output_>& output, const Transform_& transform, const VarianceOptions<Output_>& opt) {
     const auto dim = (row ? mat.nrow() : mat.ncol());
     const auto otherdim = (row ? mat.ncol() : mat.nrow());
 
-    nanable_ifelse<Value_>(
+    nanable_ifelse<TransformedValue<Value_, Output_, Transform_> >(
         opt.skip_nan,
 
         [&]() -> void {
             skip_nan::RssBuffers<Output_, Index_> tmp;
             tmp.mean = output.mean;
             tmp.rss = output.variance;
-            auto count = tatami::create_container_of_Index_size<std::vector<Index_> >(row ? mat.nrow() : mat.ncol());
-            tmp.count = count.data();
+            std::vector<Index_> cholder;
+            reserve_workspace(opt.workspace, 1);
+            const auto count = workspace_buffer(opt.workspace, 0, WORKSPACE_CALLER, dim, cholder);
+            tmp.count = count;
 
             skip_nan::RssOptions ropt;
             ropt.num_threads = opt.num_threads;
+            ropt.balance_nonzeros = opt.balance_nonzeros;
+            ropt.executor = opt.executor;
+            ropt.tracer = opt.tracer;
+            ropt.max_memory_bytes = opt.max_memory_bytes;
+            ropt.strategy = opt.strategy;
+            ropt.deterministic = opt.deterministic;
+            ropt.split_other = opt.split_other;
+            ropt.shifted_sums = opt.shifted_sums;
+            ropt.prefetch = opt.prefetch;
+            ropt.workspace = opt.workspace;
+            ropt.allocator = opt.allocator;
             ropt.mean_placeholder = opt.mean_placeholder;
-            skip_nan::rss(row, mat, tmp, ropt);
+            skip_nan::rss(row, mat, tmp, transform, ropt);
 
             AUVEH_NODEP
             for (Index_ i = 0; i < dim; ++i) {
@@ -129,8 +226,19 @@ void variance(bool row, const tatami::Matrix<Value_, Index_>& mat, VarianceBuffe
 
             RssOptions ropt;
             ropt.num_threads = opt.num_threads;
+            ropt.balance_nonzeros = opt.balance_nonzeros;
+            ropt.executor = opt.executor;
+            ropt.tracer = opt.tracer;
+            ropt.max_memory_bytes = opt.max_memory_bytes;
+            ropt.strategy = opt.strategy;
+            ropt.deterministic = opt.deterministic;
+            ropt.split_other = opt.split_other;
+            ropt.shifted_sums = opt.shifted_sums;
+            ropt.prefetch = opt.prefetch;
+            ropt.workspace = opt.workspace;
+            ropt.allocator = opt.allocator;
             ropt.mean_placeholder = opt.mean_placeholder;
-            rss(row, mat, tmp, ropt);
+            rss(row, mat, tmp, transform, ropt);
 
             if (otherdim <= 1) {
                 std::fill_n(output.variance, dim, opt.variance_placeholder);
@@ -201,6 +309,45 @@ VarianceResult<Output_> variance(bool row, const tatami::Matrix<Value_, Index_>&
     return output;
 }
 
+/**
+ * Overload of `variance()` that allocates memory for the output arrays, for transformed values.
+ *
+ * @tparam Output_ Floating-point type of the output data.
+ * @tparam Value_ Numeric type of the input data.
+ * @tparam Index_ Integer type of the row/column indices.
+ * @tparam Transform_ Functor that accepts a `Value_` and returns a transformed value that is convertible to `Output_`, see `Transform` for details.
+ *
+ * @param row Whether to compute the variance for each row.
+ * If false, the variance is computed for each column instead.
+ * @param mat Instance of a `tatami::Matrix`.
+ * @param transform Transformation to apply to each matrix value.
+ * @param opt Further options.
+ *
+ * @return The mean and variance of the transformed values in each row/column.
+ */
+template<typename Output_ = double, typename Value_, typename Index_, class Transform_>
+VarianceResult<Output_> variance(bool row, const tatami::Matrix<Value_, Index_>& mat, const Transform_& transform, const VarianceOptions<Output_>& opt) {
+    VarianceResult<Output_> output;
+    const auto dim = (row ? mat.nrow() : mat.ncol());
+    tatami::resize_container_to_Index_size(output.mean, dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+    tatami::resize_container_to_Index_size(output.variance, dim
+#ifdef TATAMI_STATS_TEST_DIRTY
+        , -1
+#endif
+    );
+
+    VarianceBuffers<Output_> buffers;
+    buffers.mean = output.mean.data();
+    buffers.variance = output.variance.data();
+
+    variance(row, mat, buffers, transform, opt);
+    return output;
+}
+
 }
 
 #endif
@@ -0,0 +1,262 @@
+#ifndef TATAMI_STATS_WORKSPACE_HPP
+#define TATAMI_STATS_WORKSPACE_HPP
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <utility>
+#include <typeindex>
+#include <typeinfo>
+#include <algorithm>
+#include <cstddef>
+
+#include "tatami/tatami.hpp"
+#include "sanisizer/sanisizer.hpp"
+
+#include "utils.hpp"
+#include "allocator.hpp"
+
+/**
+ * @file workspace.hpp
+ *
+ * @brief Reuse per-thread buffers across calls.
+ */
+
+namespace tatami_stats {
+
+/**
+ * @brief Per-thread buffers that are reused across calls.
+ *
+ * Each **tatami_stats** function allocates temporary buffers in each thread, e.g., to extract values from the matrix or to store per-thread partial results.
+ * For applications that repeatedly compute statistics on small-to-medium matrices, the cost of these allocations can be significant.
+ * If a `Workspace` is supplied via the `workspace` field of the relevant options structure (e.g., `SumOptions::workspace`),
+ * these buffers are instead stored in the `Workspace` and reused in subsequent calls.
+ * Buffers only ever grow, so once the largest matrix has been processed, repeated calls do not allocate any further memory for these buffers.
+ * Note that the `tatami::Matrix` itself may still allocate memory when creating its extractors.
+ *
+ * A single `Workspace` can be used across calls to different functions, possibly with different numbers of threads.
+ * However, it should not be used by concurrent calls, as each thread's buffers would be shared between those calls.
+ */
+class Workspace {
+public:
+    /**
+     * @param allocator Allocator for the buffers, see `Allocator` for details.
+     * If NULL, an `AlignedAllocator` is used with default arguments.
+     * If not NULL, this should outlive the `Workspace`.
+     * Note that this replaces the `allocator` field of the options when a `Workspace` is supplied.
+     */
+    Workspace(Allocator* const allocator = NULL) : my_allocator(allocator) {}
+
+    /**
+     * Ensure that the workspace has storage for at least `num_threads` threads.
+     * This is automatically called by each function before starting its threads, so users do not need to call it themselves.
+     * It is not thread-safe.
+     *
+     * @param num_threads Number of threads.
+     */
+    void reserve(const int num_threads) {
+        if (num_threads > 0 && static_cast<std::size_t>(num_threads) > my_threads.size()) {
+            my_threads.resize(num_threads);
+        }
+    }
+
+    /**
+     * @return Number of threads for which storage is available.
+     */
+    int num_threads() const {
+        return my_threads.size();
+    }
+
+    /**
+     * Obtain an object that persists across calls for a thread.
+     * This can be safely called concurrently for different `thread`.
+     *
+     * @tparam Type_ Default-constructible type of the object.
+     *
+     * @param thread Thread index, less than `num_threads()`.
+     * @param slot Identifier for the object within the thread.
+     * Objects of different types can use the same `slot` without conflict.
+     *
+     * @return Reference to the object for `thread`, `slot` and `Type_`.
+     * This is default-constructed on the first request and returned as-is in subsequent requests.
+     */
+    template<class Type_>
+    Type_& get(const int thread, const std::size_t slot) {
+        auto& store = my_threads[thread];
+        auto& entry = store.objects[std::make_pair(slot, std::type_index(typeid(Type_)))];
+        if (!entry) {
+            entry.reset(new Holder<Type_>);
+            ++store.allocations;
+        }
+        return static_cast<Holder<Type_>*>(entry.get())->object;
+    }
+
+    /**
+     * Obtain a buffer that persists across calls for a thread.
+     * This can be safely called concurrently for different `thread`.
+     *
+     * @tparam Type_ Type of the buffer elements.
+     * This should be trivially constructible and destructible, e.g., an arithmetic type.
+     *
+     * @param thread Thread index, less than `num_threads()`.
+     * @param slot Identifier for the buffer within the thread.
+     * Buffers of different types can use the same `slot` without conflict.
+     * @param size Minimum number of elements in the buffer.
+     *
+     * @return Pointer to an array of at least `size` elements.
+     * The contents of this array are unspecified and may contain values from a previous call.
+     * The array is only reallocated if `size` is greater than any previously requested size for this `thread`, `slot` and `Type_`.
+     * Reallocation is performed by the calling thread, so that the new memory is first touched by the thread that uses it.
+     */
+    template<typename Type_>
+    Type_* buffer(const int thread, const std::size_t slot, const std::size_t size) {
+        auto& arr = get<AllocatedArray<Type_> >(thread, slot);
+        if (arr.size() < size) {
+            arr = AllocatedArray<Type_>(my_allocator, size);
+            ++(my_threads[thread].allocations);
+        }
+        return arr.data();
+    }
+
+    /**
+     * @return Total number of times that an object or buffer was created or grown, across all threads.
+     * This should not increase in steady-state usage, i.e., when calls are repeated on matrices of the same or smaller size.
+     */
+    std::size_t num_allocations() const {
+        std::size_t total = 0;
+        for (const auto& store : my_threads) {
+            total += store.allocations;
+        }
+        return total;
+    }
+
+    /**
+     * Release all buffers and objects.
+     */
+    void clear() {
+        my_threads.clear();
+    }
+
+private:
+    struct Base {
+        virtual ~Base() = default;
+    };
+
+    template<class Type_>
+    struct Holder final : public Base {
+        Type_ object;
+    };
+
+    struct ThreadStore {
+        std::map<std::pair<std::size_t, std::type_index>, std::unique_ptr<Base> > objects;
+        std::size_t allocations = 0;
+    };
+
+    Allocator* my_allocator;
+    std::vector<ThreadStore> my_threads;
+};
+
+/**
+ * @cond
+ */
+// Slots for the buffers used by the functions in this library.
+constexpr std::size_t WORKSPACE_VALUES = 0;
+constexpr std::size_t WORKSPACE_INDICES = 1;
+constexpr std::size_t WORKSPACE_NONZEROS = 2;
+constexpr std::size_t WORKSPACE_TRANSFORMED = 3;
+constexpr std::size_t WORKSPACE_SHIFTED = 4; // shifted sums use 'WORKSPACE_SHIFTED' and 'WORKSPACE_SHIFTED + 1', see shifted_rss.hpp.
+constexpr std::size_t WORKSPACE_PARTIAL = 6; // partial results use 'WORKSPACE_PARTIAL + i' for the i-th partial array.
+constexpr std::size_t WORKSPACE_GROUPS = 20; // per-group scratch arrays use 'WORKSPACE_GROUPS + i' for the i-th array, e.g., the current means in group_rss().
+constexpr std::size_t WORKSPACE_CALLER = 100; // for buffers used outside of the threads, which are always stored in thread 0.
+
+inline void reserve_workspace(Workspace* const workspace, const int num_threads) {
+    if (workspace) {
+        workspace->reserve(num_threads);
+    }
+}
+
+// Returns a pointer to an array of at least 'size' elements, either from the workspace or from the fallback vector if no workspace is available.
+// Contents are unspecified, so callers should initialize the array if necessary.
+template<typename Type_, typename Index_>
+Type_* workspace_buffer(Workspace* const workspace, const int thread, const std::size_t slot, const Index_ size, std::vector<Type_>& fallback) {
+    if (workspace) {
+        return workspace->buffer<Type_>(thread, slot, tatami::cast_Index_to_container_size<std::vector<Type_> >(size));
+    } else {
+        tatami::resize_container_to_Index_size(fallback, size);
+        return fallback.data();
+    }
+}
+
+template<class Type_>
+Type_& workspace_object(Workspace* const workspace, const int thread, const std::size_t slot, Type_& fallback) {
+    if (workspace) {
+        return workspace->get<Type_>(thread, slot);
+    } else {
+        return fallback;
+    }
+}
+
+// Zero-initialized per-thread partial results that are retained until the merge.
+// Each thread has 'num_arrays' arrays, e.g., one per group, which are stored contiguously in a single allocation.
+// Each array is padded to a multiple of 64 bytes so that all arrays have the same alignment as the allocation.
+template<typename Type_>
+class PartialBuffers {
+public:
+    PartialBuffers(Workspace* const workspace, const std::size_t slot, const int num_threads, Allocator* const allocator, const std::size_t num_arrays = 1) :
+        my_workspace(workspace),
+        my_slot(slot),
+        my_allocator(allocator),
+        my_num_arrays(num_arrays),
+        my_pointers(sanisizer::product<I<decltype(my_pointers.size())> >(num_threads, num_arrays))
+    {
+        if (!workspace) {
+            my_holders.resize(sanisizer::cast<I<decltype(my_holders.size())> >(num_threads));
+        }
+    }
+
+    template<typename Index_>
+    Type_** acquire(const int thread, const Index_ size) {
+        std::size_t stride = size; // cast to size_t is safe due to the tatami contract.
+        constexpr std::size_t line = 64;
+        if (my_num_arrays > 1 && line % sizeof(Type_) == 0) {
+            constexpr std::size_t per_line = line / sizeof(Type_);
+            stride = sanisizer::sum<std::size_t>(stride, per_line - 1) / per_line * per_line;
+        }
+        const auto total = sanisizer::product<std::size_t>(stride, my_num_arrays);
+
+        Type_* ptr;
+        if (my_workspace) {
+            ptr = my_workspace->buffer<Type_>(thread, my_slot, total);
+        } else {
+            auto& holder = my_holders[thread];
+            holder = AllocatedArray<Type_>(my_allocator, total);
+            ptr = holder.data();
+        }
+        std::fill_n(ptr, total, 0); // zeroing in the owning thread to ensure that it's the first to touch the memory.
+
+        const auto output = my_pointers.data() + static_cast<std::size_t>(thread) * my_num_arrays;
+        for (std::size_t a = 0; a < my_num_arrays; ++a) {
+            output[a] = ptr + a * stride;
+        }
+        return output;
+    }
+
+    Type_* const* get(const int thread) const {
+        return my_pointers.data() + static_cast<std::size_t>(thread) * my_num_arrays;
+    }
+
+private:
+    Workspace* my_workspace;
+    std::size_t my_slot;
+    Allocator* my_allocator;
+    std::size_t my_num_arrays;
+    std::vector<Type_*> my_pointers;
+    std::vector<AllocatedArray<Type_> > my_holders;
+};
+/**
+ * @endcond
+ */
+
+}
+
+#endif
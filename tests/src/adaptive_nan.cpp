@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <cmath>
+#include <tuple>
+
+#include "tatami_stats/sum.hpp"
+#include "tatami_stats/median.hpp"
+#include "tatami_stats/quantile.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+TEST(AdaptiveNan, HasNan) {
+    std::vector<double> values { 1, 2, 3, 4, 5 };
+    EXPECT_FALSE(tatami_stats::has_nan(values.data(), 5));
+    EXPECT_EQ(tatami_stats::shift_nans(values.data(), 5), 5);
+    EXPECT_EQ(values, std::vector<double>({ 1, 2, 3, 4, 5 }));
+
+    values[3] = std::numeric_limits<double>::quiet_NaN();
+    EXPECT_TRUE(tatami_stats::has_nan(values.data(), 5));
+    EXPECT_FALSE(tatami_stats::has_nan(values.data(), 3));
+    EXPECT_EQ(tatami_stats::shift_nans(values.data(), 5), 4);
+    EXPECT_EQ(values[3], 5);
+
+    std::vector<int> integers { 1, 2, 3 };
+    EXPECT_FALSE(tatami_stats::has_nan(integers.data(), 3));
+    EXPECT_FALSE(tatami_stats::has_nan(integers.data(), 0));
+}
+
+class AdaptiveNanTest : public ::testing::TestWithParam<std::tuple<bool, int> > {
+protected:
+    inline static std::size_t NR = 57, NC = 91;
+    inline static std::vector<double> simulated;
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+
+    // Only some rows and columns contain NaNs, so both the NaN-free and NaN-aware paths are used within the same call.
+    static void SetUpTestSuite() {
+        simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.3;
+            opt.seed = 10203040;
+            return opt;
+        }());
+        for (std::size_t r = 0; r < NR; r += 5) {
+            simulated[r * NC + (r * 3) % NC] = std::numeric_limits<double>::quiet_NaN();
+        }
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, simulated));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+
+    static std::vector<double> extract_without_nans(bool row, std::size_t i) {
+        std::vector<double> output;
+        const auto len = (row ? NC : NR);
+        for (std::size_t j = 0; j < len; ++j) {
+            const auto val = (row ? simulated[i * NC + j] : simulated[j * NC + i]);
+            if (!std::isnan(val)) {
+                output.push_back(val);
+            }
+        }
+        return output;
+    }
+
+    // NaN-free vectors should give the same results as 'skip_nan = false',
+    // while vectors with NaNs should give the same results as a vector with the NaNs removed.
+    template<class Function_>
+    static void check(bool row, const std::vector<double>& noskip, const std::vector<double>& skipped, Function_ fun) {
+        const auto dim = (row ? NR : NC);
+        ASSERT_EQ(noskip.size(), dim);
+        ASSERT_EQ(skipped.size(), dim);
+        for (std::size_t i = 0; i < dim; ++i) {
+            auto cleaned = extract_without_nans(row, i);
+            if (cleaned.size() == (row ? NC : NR)) {
+                EXPECT_EQ(noskip[i], skipped[i]);
+            } else {
+                const int num_cleaned = cleaned.size();
+                tatami::DenseRowMatrix<double, int> submat(1, num_cleaned, std::move(cleaned));
+                EXPECT_FLOAT_EQ(fun(submat), skipped[i]);
+            }
+        }
+    }
+};
+
+TEST_P(AdaptiveNanTest, Sum) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        tatami_stats::SumOptions opt;
+        opt.num_threads = nthreads;
+        opt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        auto noskip = tatami_stats::sum(row, *mat, opt);
+        opt.skip_nan = true;
+        auto skipped = tatami_stats::sum(row, *mat, opt);
+        check(row, noskip, skipped, [](const tatami::NumericMatrix& submat) -> double { return tatami_stats::sum(true, submat, {})[0]; });
+    }
+}
+
+TEST_P(AdaptiveNanTest, Median) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        tatami_stats::MedianOptions opt;
+        opt.num_threads = nthreads;
+        auto noskip = tatami_stats::median(row, *mat, opt);
+        opt.skip_nan = true;
+        auto skipped = tatami_stats::median(row, *mat, opt);
+        check(row, noskip, skipped, [](const tatami::NumericMatrix& submat) -> double { return tatami_stats::median(true, submat, {})[0]; });
+    }
+}
+
+TEST_P(AdaptiveNanTest, Quantile) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+
+    for (double prob : { 0.2, 0.9 }) {
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            tatami_stats::QuantileOptions opt;
+            opt.num_threads = nthreads;
+            auto noskip = tatami_stats::quantile(row, *mat, prob, opt);
+            opt.skip_nan = true;
+            auto skipped = tatami_stats::quantile(row, *mat, prob, opt);
+            check(row, noskip, skipped, [&](const tatami::NumericMatrix& submat) -> double { return tatami_stats::quantile(true, submat, prob, {})[0]; });
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AdaptiveNan,
+    AdaptiveNanTest,
+    ::testing::Combine(
+        ::testing::Values(true, false), // row or column
+        ::testing::Values(1, 3) // number of threads
+    )
+);
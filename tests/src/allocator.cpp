@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "tatami_stats/allocator.hpp"
+#include "tatami_stats/workspace.hpp"
+#include "tatami_stats/sum.hpp"
+#include "tatami_stats/group_sum.hpp"
+#include "tatami_stats/group_rss.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+TEST(AlignedAllocator, Basic) {
+    tatami_stats::AlignedAllocator alloc;
+    EXPECT_EQ(alloc.alignment(), 64);
+    EXPECT_FALSE(alloc.huge_pages());
+
+    auto ptr = alloc.allocate(100);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % 64, 0);
+    alloc.deallocate(ptr, 100);
+
+    // Alignment is never less than that of the fundamental types.
+    tatami_stats::AlignedAllocator small(1);
+    EXPECT_EQ(small.alignment(), alignof(std::max_align_t));
+}
+
+TEST(AlignedAllocator, HugePages) {
+    tatami_stats::AlignedAllocator alloc(64, true);
+    EXPECT_TRUE(alloc.huge_pages());
+
+    constexpr auto hsize = tatami_stats::AlignedAllocator::huge_page_size;
+    auto ptr = alloc.allocate(hsize);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % hsize, 0);
+    alloc.deallocate(ptr, hsize);
+
+    // Small buffers don't get huge pages.
+    auto sptr = alloc.allocate(100);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(sptr) % 64, 0);
+    alloc.deallocate(sptr, 100);
+}
+
+class AllocatorTest : public ::testing::Test {
+protected:
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, sparse_column;
+    inline static std::size_t NR = 77, NC = 134;
+
+    static void SetUpTestSuite() {
+        auto vec = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.2;
+            opt.seed = 6543210;
+            return opt;
+        }());
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(vec)));
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+};
+
+TEST_F(AllocatorTest, Custom) {
+    std::vector<int> groups(NC);
+    for (std::size_t c = 0; c < NC; ++c) {
+        groups[c] = c % 5;
+    }
+
+    for (auto mat : { dense_row.get(), sparse_column.get() }) {
+        tatami_stats::SumOptions sopt;
+        sopt.num_threads = 3;
+        sopt.strategy = tatami_stats::PlanStrategy::RUNNING;
+        auto sref = tatami_stats::sum(true, *mat, sopt);
+
+        tatami_stats::GroupSumOptions gsopt;
+        gsopt.num_threads = 3;
+        auto gsref = tatami_stats::group_sum<double>(true, *mat, groups.data(), 5, gsopt);
+
+        tatami_stats::GroupRssOptions gropt;
+        gropt.num_threads = 3;
+        auto grref = tatami_stats::group_rss<double>(true, *mat, groups.data(), 5, gropt);
+
+        CountingAllocator alloc;
+        sopt.allocator = &alloc;
+        gsopt.allocator = &alloc;
+        gropt.allocator = &alloc;
+
+        compare_double_vectors(sref, tatami_stats::sum(true, *mat, sopt));
+        auto gsres = tatami_stats::group_sum<double>(true, *mat, groups.data(), 5, gsopt);
+        compare_double_vectors_of_vectors(gsref, gsres);
+        auto grres = tatami_stats::group_rss<double>(true, *mat, groups.data(), 5, gropt);
+        compare_double_vectors_of_vectors(grref.mean, grres.mean);
+        compare_double_vectors_of_vectors(grref.rss, grres.rss);
+
+        EXPECT_GT(alloc.allocations, 0); // from the partial buffers in the forced running calculation for sum().
+        EXPECT_EQ(alloc.allocations, alloc.deallocations);
+    }
+}
+
+TEST_F(AllocatorTest, Workspace) {
+    CountingAllocator alloc;
+
+    {
+        tatami_stats::Workspace work(&alloc);
+        tatami_stats::SumOptions sopt;
+        sopt.num_threads = 3;
+        auto ref = tatami_stats::sum(true, *sparse_column, sopt);
+
+        sopt.workspace = &work;
+        compare_double_vectors(ref, tatami_stats::sum(true, *sparse_column, sopt));
+        EXPECT_GT(alloc.allocations, 0);
+
+        // Re-using the buffers.
+        int current = alloc.allocations;
+        compare_double_vectors(ref, tatami_stats::sum(true, *sparse_column, sopt));
+        EXPECT_EQ(alloc.allocations, current);
+        EXPECT_EQ(alloc.deallocations, 0);
+    }
+
+    EXPECT_EQ(alloc.allocations, alloc.deallocations);
+}
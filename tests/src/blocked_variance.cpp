@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "tatami_stats/blocked_variance.hpp"
+#include "tatami_stats/group_variance.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+class BlockedVarianceTest : public ::testing::TestWithParam<std::tuple<bool, int, tatami_stats::BlockWeightPolicy, tatami_stats::PlanStrategy> > {
+protected:
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+    inline static std::size_t NR = 97, NC = 131;
+
+    static void SetUpTestSuite() {
+        auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.2;
+            opt.seed = 9182734;
+            return opt;
+        }());
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+
+    static tatami_stats::BlockedVarianceResult<double> reference(
+        bool row,
+        const std::vector<int>& blocks,
+        int nblocks,
+        tatami_stats::BlockWeightPolicy policy,
+        double cap
+    ) {
+        std::vector<double> sizes(nblocks);
+        for (auto b : blocks) {
+            ++sizes[b];
+        }
+
+        auto res = tatami_stats::group_variance(row, *dense_row, blocks.data(), nblocks, tatami_stats::GroupVarianceOptions<double>());
+        const std::size_t dim = (row ? NR : NC);
+        tatami_stats::BlockedVarianceResult<double> output;
+        output.mean.resize(dim);
+        output.variance.resize(dim);
+
+        for (std::size_t d = 0; d < dim; ++d) {
+            double msum = 0, mtotal = 0, vsum = 0, vtotal = 0;
+            for (int b = 0; b < nblocks; ++b) {
+                double weight = 1;
+                if (policy == tatami_stats::BlockWeightPolicy::SIZE) {
+                    weight = sizes[b];
+                } else if (policy == tatami_stats::BlockWeightPolicy::CAPPED_SIZE) {
+                    weight = std::min(sizes[b], cap);
+                }
+                if (sizes[b] >= 1) {
+                    msum += weight * res.mean[b][d];
+                    mtotal += weight;
+                }
+                if (sizes[b] >= 2) {
+                    vsum += weight * res.variance[b][d];
+                    vtotal += weight;
+                }
+            }
+            output.mean[d] = msum / mtotal;
+            output.variance[d] = vsum / vtotal;
+        }
+
+        return output;
+    }
+};
+
+TEST_P(BlockedVarianceTest, Basic) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+
+    // Including an empty block and a block with a single observation.
+    const int nblocks = 6;
+    std::vector<int> blocks(row ? NC : NR);
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        blocks[i] = (i * 3) % 4;
+    }
+    blocks[blocks.size() / 2] = 5;
+
+    tatami_stats::BlockedVarianceOptions<double> opt;
+    opt.num_threads = nthreads;
+    opt.weight_policy = std::get<2>(param);
+    opt.size_cap = 30;
+    opt.strategy = std::get<3>(param);
+
+    auto expected = reference(row, blocks, nblocks, opt.weight_policy, opt.size_cap);
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        auto res = tatami_stats::blocked_variance(row, *mat, blocks.data(), nblocks, opt);
+        compare_double_vectors(expected.mean, res.mean);
+        compare_double_vectors(expected.variance, res.variance);
+    }
+
+    // Same results from matrices that can yield unsorted indices.
+    std::shared_ptr<tatami::NumericMatrix> unsorted_row(new tatami_test::ReversedIndicesWrapper<double, int>(sparse_row));
+    auto ures = tatami_stats::blocked_variance(row, *unsorted_row, blocks.data(), nblocks, opt);
+    compare_double_vectors(expected.mean, ures.mean);
+    compare_double_vectors(expected.variance, ures.variance);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    BlockedVariance,
+    BlockedVarianceTest,
+    ::testing::Combine(
+        ::testing::Values(true, false), // row or column
+        ::testing::Values(1, 3, 8), // number of threads, where 8 exceeds the number of non-empty blocks so that they are split across threads in the running path.
+        ::testing::Values(
+            tatami_stats::BlockWeightPolicy::EQUAL,
+            tatami_stats::BlockWeightPolicy::SIZE,
+            tatami_stats::BlockWeightPolicy::CAPPED_SIZE
+        ),
+        ::testing::Values(tatami_stats::PlanStrategy::DIRECT, tatami_stats::PlanStrategy::RUNNING)
+    )
+);
+
+TEST(BlockedVariance, Placeholders) {
+    std::vector<double> vals { 1, 2, 3, 4, 5, 6 };
+    tatami::DenseRowMatrix<double, int> mat(2, 3, vals);
+    std::vector<int> blocks { 0, 1, 1 };
+
+    tatami_stats::BlockedVarianceOptions<double> opt;
+    opt.variance_placeholder = -1;
+    for (auto strategy : { tatami_stats::PlanStrategy::DIRECT, tatami_stats::PlanStrategy::RUNNING }) {
+        opt.strategy = strategy;
+
+        // Only the second block contributes to the variance.
+        auto res = tatami_stats::blocked_variance(true, mat, blocks.data(), 2, opt);
+        EXPECT_EQ(res.mean, std::vector<double>({ 1.75, 4.75 }));
+        EXPECT_EQ(res.variance, std::vector<double>({ 0.5, 0.5 }));
+
+        // No block contributes to the variance.
+        std::vector<int> singletons { 0, 1, 2 };
+        res = tatami_stats::blocked_variance(true, mat, singletons.data(), 3, opt);
+        EXPECT_EQ(res.mean, std::vector<double>({ 2, 5 }));
+        EXPECT_EQ(res.variance, std::vector<double>({ -1, -1 }));
+    }
+
+    // No blocks at all.
+    tatami::DenseRowMatrix<double, int> empty(5, 0, std::vector<double>());
+    opt.mean_placeholder = -2;
+    for (auto strategy : { tatami_stats::PlanStrategy::DIRECT, tatami_stats::PlanStrategy::RUNNING }) {
+        opt.strategy = strategy;
+        auto res = tatami_stats::blocked_variance(true, empty, static_cast<int*>(NULL), 0, opt);
+        EXPECT_EQ(res.mean, std::vector<double>(5, -2));
+        EXPECT_EQ(res.variance, std::vector<double>(5, -1));
+    }
+}
@@ -0,0 +1,262 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <memory>
+#include <optional>
+#include <limits>
+
+#include "tatami_stats/sum.hpp"
+#include "tatami_stats/rss.hpp"
+#include "tatami_stats/skip_nan/rss.hpp"
+#include "tatami_stats/skip_nan/group_rss.hpp"
+#include "tatami_stats/variance.hpp"
+#include "tatami_stats/group_rss.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+class DeterministicTest : public ::testing::Test {
+protected:
+    // Many vectors in the iteration dimension, so that there are many leaves that don't divide evenly across threads.
+    inline static std::size_t NR = 1987, NC = 37;
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+
+    static void SetUpTestSuite() {
+        auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.1;
+            opt.lower = -1e6;
+            opt.upper = 1e6;
+            opt.seed = 6172839;
+            return opt;
+        }());
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+
+    // Running path over the rows, so the target dimension is the columns.
+    template<class Options_>
+    static std::vector<Options_> all_options() {
+        std::vector<Options_> output;
+        for (int nthreads : { 1, 2, 3, 7 }) {
+            Options_ opt;
+            opt.num_threads = nthreads;
+            opt.strategy = tatami_stats::PlanStrategy::RUNNING;
+            opt.deterministic = true;
+            output.push_back(opt);
+            opt.balance_nonzeros = true;
+            output.push_back(opt);
+        }
+        return output;
+    }
+};
+
+class DeterministicNanTest : public DeterministicTest, public ::testing::WithParamInterface<bool> {};
+
+TEST_P(DeterministicNanTest, Sum) {
+    const bool skip_nan = GetParam();
+    auto ref = tatami_stats::sum(false, *dense_column, [&]{
+        tatami_stats::SumOptions opt;
+        opt.skip_nan = skip_nan;
+        return opt;
+    }());
+
+    tatami_stats::ThreadPoolExecutor pool(2);
+    for (auto mat : { dense_row.get(), sparse_row.get() }) {
+        std::vector<double> first;
+        for (auto opt : all_options<tatami_stats::SumOptions>()) {
+            opt.skip_nan = skip_nan;
+            auto res = tatami_stats::sum(false, *mat, opt);
+            compare_double_vectors(ref, res);
+            if (first.empty()) {
+                first = res;
+            } else {
+                EXPECT_EQ(first, res);
+            }
+
+            opt.executor = &pool;
+            EXPECT_EQ(first, tatami_stats::sum(false, *mat, opt));
+        }
+    }
+}
+
+TEST_P(DeterministicNanTest, Variance) {
+    const bool skip_nan = GetParam();
+    auto ref = tatami_stats::variance(false, *dense_column, [&]{
+        tatami_stats::VarianceOptions opt;
+        opt.skip_nan = skip_nan;
+        return opt;
+    }());
+
+    tatami_stats::ThreadPoolExecutor pool(2);
+    for (auto mat : { dense_row.get(), sparse_row.get() }) {
+        std::optional<tatami_stats::VarianceResult<double> > first;
+        for (auto opt : all_options<tatami_stats::VarianceOptions<double> >()) {
+            opt.skip_nan = skip_nan;
+            auto res = tatami_stats::variance(false, *mat, opt);
+            compare_double_vectors(ref.mean, res.mean);
+            compare_double_vectors(ref.variance, res.variance);
+            if (!first.has_value()) {
+                first = res;
+            } else {
+                EXPECT_EQ(first->mean, res.mean);
+                EXPECT_EQ(first->variance, res.variance);
+            }
+
+            opt.executor = &pool;
+            auto eres = tatami_stats::variance(false, *mat, opt);
+            EXPECT_EQ(first->mean, eres.mean);
+            EXPECT_EQ(first->variance, eres.variance);
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Deterministic,
+    DeterministicNanTest,
+    ::testing::Values(false, true) // whether to skip NaNs.
+);
+
+TEST_F(DeterministicTest, Rss) {
+    // Checking the RSS directly, as the variance with skip_nan = true uses the skip_nan::rss() path.
+    auto ref = tatami_stats::rss(false, *dense_column, {});
+    for (auto mat : { dense_row.get(), sparse_row.get() }) {
+        std::optional<tatami_stats::RssResult<double> > first;
+        for (const auto& opt : all_options<tatami_stats::RssOptions<double> >()) {
+            auto res = tatami_stats::rss(false, *mat, opt);
+            compare_double_vectors(ref.mean, res.mean);
+            compare_double_vectors(ref.rss, res.rss);
+            if (!first.has_value()) {
+                first = res;
+            } else {
+                EXPECT_EQ(first->mean, res.mean);
+                EXPECT_EQ(first->rss, res.rss);
+            }
+        }
+    }
+}
+
+TEST(Deterministic, SkipNanRss) {
+    // Injecting NaNs into some columns, including a column that is all-NaN in some blocks.
+    const std::size_t NR = 1234, NC = 23;
+    auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+        tatami_test::SimulateVectorOptions opt;
+        opt.density = 0.2;
+        opt.seed = 9182736;
+        return opt;
+    }());
+    for (std::size_t r = 0; r < NR; ++r) {
+        for (std::size_t c = 0; c < NC; c += 3) {
+            if ((r + c) % 7 == 0 || (c == 3 && r < 600)) {
+                simulated[r * NC + c] = std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+    }
+    tatami::DenseRowMatrix<double, int> dense(NR, NC, std::move(simulated));
+    auto sparse = tatami::convert_to_compressed_sparse<double, int>(dense, true, {});
+    auto ref = tatami_stats::skip_nan::rss<double, int>(false, *tatami::convert_to_dense<double, int>(dense, false, {}), {});
+
+    for (auto mat : { static_cast<const tatami::NumericMatrix*>(&dense), static_cast<const tatami::NumericMatrix*>(sparse.get()) }) {
+        std::optional<tatami_stats::skip_nan::RssResult<double, int> > first;
+        for (int nthreads : { 1, 2, 3, 7 }) {
+            tatami_stats::skip_nan::RssOptions opt;
+            opt.num_threads = nthreads;
+            opt.strategy = tatami_stats::PlanStrategy::RUNNING;
+            opt.deterministic = true;
+            auto res = tatami_stats::skip_nan::rss<double, int>(false, *mat, opt);
+            compare_double_vectors(ref.mean, res.mean);
+            compare_double_vectors(ref.rss, res.rss);
+            EXPECT_EQ(ref.count, res.count);
+            if (!first.has_value()) {
+                first = res;
+            } else {
+                EXPECT_EQ(first->mean, res.mean);
+                EXPECT_EQ(first->rss, res.rss);
+            }
+        }
+    }
+}
+
+TEST_F(DeterministicTest, GroupRss) {
+    // Including an empty group.
+    std::vector<int> groups(NR);
+    for (std::size_t r = 0; r < NR; ++r) {
+        groups[r] = (r * 7) % 5;
+        groups[r] += (groups[r] >= 2);
+    }
+
+    auto ref = tatami_stats::group_rss<double>(false, *dense_column, groups.data(), 6, {});
+    for (auto mat : { dense_row.get(), sparse_row.get() }) {
+        std::optional<tatami_stats::GroupRssResult<double> > first;
+        for (const auto& opt : all_options<tatami_stats::GroupRssOptions<double> >()) {
+            auto res = tatami_stats::group_rss<double>(false, *mat, groups.data(), 6, opt);
+            compare_double_vectors_of_vectors(ref.mean, res.mean);
+            compare_double_vectors_of_vectors(ref.rss, res.rss);
+            if (!first.has_value()) {
+                first = res;
+            } else {
+                for (int g = 0; g < 6; ++g) {
+                    if (g != 2) { // skipping the empty group as its mean is NaN.
+                        EXPECT_EQ(first->mean[g], res.mean[g]);
+                    }
+                    EXPECT_EQ(first->rss[g], res.rss[g]);
+                }
+            }
+        }
+    }
+}
+
+TEST(Deterministic, SkipNanGroupRss) {
+    const std::size_t NR = 1234, NC = 23;
+    auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+        tatami_test::SimulateVectorOptions opt;
+        opt.density = 0.2;
+        opt.seed = 6172839;
+        return opt;
+    }());
+    for (std::size_t r = 0; r < NR; ++r) {
+        for (std::size_t c = 0; c < NC; c += 3) {
+            if ((r + c) % 7 == 0 || (c == 3 && r < 600)) {
+                simulated[r * NC + c] = std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+    }
+    tatami::DenseRowMatrix<double, int> dense(NR, NC, std::move(simulated));
+    auto sparse = tatami::convert_to_compressed_sparse<double, int>(dense, true, {});
+
+    std::vector<int> groups(NR);
+    for (std::size_t r = 0; r < NR; ++r) {
+        groups[r] = (r * 7) % 4;
+    }
+    auto ref = tatami_stats::skip_nan::group_rss<double, int>(false, *tatami::convert_to_dense<double, int>(dense, false, {}), groups.data(), 4, {});
+
+    for (auto mat : { static_cast<const tatami::NumericMatrix*>(&dense), static_cast<const tatami::NumericMatrix*>(sparse.get()) }) {
+        std::optional<tatami_stats::skip_nan::GroupRssResult<double, int> > first;
+        for (int nthreads : { 1, 2, 3, 7 }) {
+            tatami_stats::skip_nan::GroupRssOptions opt;
+            opt.num_threads = nthreads;
+            opt.strategy = tatami_stats::PlanStrategy::RUNNING;
+            opt.deterministic = true;
+            auto res = tatami_stats::skip_nan::group_rss<double, int>(false, *mat, groups.data(), 4, opt);
+            compare_double_vectors_of_vectors(ref.mean, res.mean);
+            compare_double_vectors_of_vectors(ref.rss, res.rss);
+            EXPECT_EQ(ref.count, res.count);
+            if (!first.has_value()) {
+                first = res;
+            } else {
+                EXPECT_EQ(first->mean, res.mean);
+                EXPECT_EQ(first->rss, res.rss);
+            }
+        }
+    }
+}
+
+TEST(Deterministic, Empty) {
+    tatami::DenseRowMatrix<double, int> empty(0, 5, std::vector<double>());
+    tatami_stats::SumOptions opt;
+    opt.strategy = tatami_stats::PlanStrategy::RUNNING;
+    opt.deterministic = true;
+    opt.num_threads = 3;
+    EXPECT_EQ(tatami_stats::sum(false, empty, opt), std::vector<double>(5));
+}
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <random>
+#include <stdexcept>
+#include <atomic>
+
+#include "tatami_stats/executor.hpp"
+#include "tatami_stats/sum.hpp"
+#include "tatami_stats/variance.hpp"
+#include "tatami_stats/median.hpp"
+#include "tatami_stats/range.hpp"
+#include "tatami_stats/group_rss.hpp"
+#include "tatami_stats/skip_nan/group_rss.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+TEST(Executor, ThreadPool) {
+    tatami_stats::ThreadPoolExecutor pool(3);
+    EXPECT_EQ(pool.num_threads(), 3);
+
+    // Running it multiple times to check that the threads are reused properly.
+    for (int it = 0; it < 10; ++it) {
+        std::vector<int> visited(20);
+        pool.run(20, [&](int w) -> void {
+            ++visited[w];
+        });
+        EXPECT_EQ(visited, std::vector<int>(20, 1));
+    }
+
+    // No-op for zero workers.
+    pool.run(0, [&](int) -> void {
+        throw std::runtime_error("should not be called");
+    });
+}
+
+TEST(Executor, ThreadPoolNested) {
+    tatami_stats::ThreadPoolExecutor pool(2);
+    std::atomic<int> counter(0);
+    pool.run(4, [&](int) -> void {
+        pool.run(5, [&](int) -> void {
+            ++counter;
+        });
+    });
+    EXPECT_EQ(counter.load(), 20);
+}
+
+TEST(Executor, ThreadPoolError) {
+    tatami_stats::ThreadPoolExecutor pool(2);
+    std::atomic<int> counter(0);
+    EXPECT_ANY_THROW({
+        pool.run(10, [&](int w) -> void {
+            ++counter;
+            if (w == 5) {
+                throw std::runtime_error("foo");
+            }
+        });
+    });
+    EXPECT_EQ(counter.load(), 10); // all workers still run.
+
+    // Pool is still usable after an error.
+    std::vector<int> visited(5);
+    pool.run(5, [&](int w) -> void {
+        ++visited[w];
+    });
+    EXPECT_EQ(visited, std::vector<int>(5, 1));
+}
+
+TEST(Executor, Callback) {
+    // Mimicking a user-provided pool that just runs the tasks at the end.
+    std::vector<std::function<void()> > pending;
+    tatami_stats::CallbackExecutor exec([&](std::function<void()> task) -> void {
+        pending.push_back(std::move(task));
+    });
+
+    std::vector<int> visited(7);
+    exec.run(7, [&](int w) -> void {
+        ++visited[w];
+    });
+    EXPECT_EQ(visited, std::vector<int>(7, 1));
+
+    // Stale tasks don't do anything.
+    EXPECT_EQ(pending.size(), 6);
+    for (auto& p : pending) {
+        p();
+    }
+    EXPECT_EQ(visited, std::vector<int>(7, 1));
+
+    // Now trying with a real thread pool.
+    tatami_stats::ThreadPoolExecutor pool(3);
+    tatami_stats::CallbackExecutor wrapped([&](std::function<void()> task) -> void {
+        pool.run(1, [task](int) -> void { task(); });
+    });
+    std::vector<int> revisited(7);
+    wrapped.run(7, [&](int w) -> void {
+        ++revisited[w];
+    });
+    EXPECT_EQ(revisited, std::vector<int>(7, 1));
+}
+
+class ExecutorMatrixTest : public ::testing::Test {
+protected:
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+    inline static std::size_t NR = 88, NC = 142;
+
+    static void SetUpTestSuite() {
+        auto vec = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.2;
+            opt.seed = 919191;
+            return opt;
+        }());
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(vec)));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+
+    inline static tatami_stats::ThreadPoolExecutor pool{3};
+};
+
+TEST_F(ExecutorMatrixTest, Sum) {
+    for (int r = 0; r < 2; ++r) {
+        const bool row = (r == 0);
+        auto ref = tatami_stats::sum(row, *dense_row, {});
+
+        tatami_stats::SumOptions sopt;
+        sopt.num_threads = 4;
+        sopt.executor = &pool;
+        compare_double_vectors(ref, tatami_stats::sum(row, *dense_row, sopt));
+        compare_double_vectors(ref, tatami_stats::sum(row, *dense_column, sopt));
+        compare_double_vectors(ref, tatami_stats::sum(row, *sparse_row, sopt));
+        compare_double_vectors(ref, tatami_stats::sum(row, *sparse_column, sopt));
+
+        sopt.balance_nonzeros = true;
+        compare_double_vectors(ref, tatami_stats::sum(row, *sparse_row, sopt));
+        compare_double_vectors(ref, tatami_stats::sum(row, *sparse_column, sopt));
+    }
+}
+
+TEST_F(ExecutorMatrixTest, Variance) {
+    for (int r = 0; r < 2; ++r) {
+        const bool row = (r == 0);
+        auto ref = tatami_stats::variance(row, *dense_row, {});
+
+        tatami_stats::VarianceOptions vopt;
+        vopt.num_threads = 4;
+        vopt.executor = &pool;
+        for (int n = 0; n < 2; ++n) {
+            vopt.skip_nan = (n == 1);
+            auto res_dense = tatami_stats::variance(row, *dense_column, vopt);
+            compare_double_vectors(ref.mean, res_dense.mean);
+            compare_double_vectors(ref.variance, res_dense.variance);
+            auto res_sparse = tatami_stats::variance(row, *sparse_column, vopt);
+            compare_double_vectors(ref.mean, res_sparse.mean);
+            compare_double_vectors(ref.variance, res_sparse.variance);
+        }
+    }
+}
+
+TEST_F(ExecutorMatrixTest, Range) {
+    for (int r = 0; r < 2; ++r) {
+        const bool row = (r == 0);
+        auto ref = tatami_stats::range(row, *dense_row, {});
+
+        tatami_stats::RangeOptions ropt;
+        ropt.num_threads = 4;
+        ropt.executor = &pool;
+        auto res = tatami_stats::range(row, *sparse_column, ropt);
+        compare_double_vectors(ref.minimum, res.minimum);
+        compare_double_vectors(ref.maximum, res.maximum);
+    }
+}
+
+TEST_F(ExecutorMatrixTest, Median) {
+    auto ref = tatami_stats::median(true, *dense_row, {});
+
+    tatami_stats::MedianOptions mopt;
+    mopt.num_threads = 4;
+    mopt.executor = &pool;
+    compare_double_vectors(ref, tatami_stats::median(true, *sparse_row, mopt));
+    compare_double_vectors(ref, tatami_stats::median(true, *sparse_column, mopt));
+
+    mopt.work_stealing = true;
+    compare_double_vectors(ref, tatami_stats::median(true, *dense_row, mopt));
+    compare_double_vectors(ref, tatami_stats::median(true, *dense_column, mopt));
+}
+
+TEST_F(ExecutorMatrixTest, GroupRss) {
+    std::vector<int> groups(NC);
+    for (std::size_t c = 0; c < NC; ++c) {
+        groups[c] = c % 5;
+    }
+    auto ref = tatami_stats::group_rss<double>(true, *dense_row, groups.data(), 5, {});
+
+    tatami_stats::GroupRssOptions gopt;
+    gopt.num_threads = 4;
+    gopt.executor = &pool;
+    auto res = tatami_stats::group_rss<double>(true, *sparse_column, groups.data(), 5, gopt);
+    compare_double_vectors_of_vectors(ref.mean, res.mean);
+    compare_double_vectors_of_vectors(ref.rss, res.rss);
+
+    tatami_stats::skip_nan::GroupRssOptions nopt;
+    nopt.num_threads = 4;
+    nopt.executor = &pool;
+    auto nres = tatami_stats::skip_nan::group_rss<double, int>(true, *dense_column, groups.data(), 5, nopt);
+    compare_double_vectors_of_vectors(ref.mean, nres.mean);
+    compare_double_vectors_of_vectors(ref.rss, nres.rss);
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include "tatami_stats/group_count.hpp"
+#include "tatami_stats/count.hpp"
+#include "tatami_test/tatami_test.hpp"
+
+class GroupCountTest : public ::testing::TestWithParam<std::tuple<bool, int> > {
+protected:
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+    inline static std::size_t NR = 83, NC = 147;
+
+    static void SetUpTestSuite() {
+        auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.2;
+            opt.lower = -2;
+            opt.upper = 3;
+            opt.seed = 71829346;
+            return opt;
+        }());
+
+        // Sprinkling in some NaNs to check that they're passed to the condition.
+        for (std::size_t i = 0; i < simulated.size(); i += 23) {
+            simulated[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+
+    template<class Condition_>
+    static std::vector<std::vector<int> > reference(bool row, const std::vector<int>& grouping, int ngroup, Condition_ condition) {
+        std::vector<std::vector<int> > subsets(ngroup);
+        for (std::size_t i = 0; i < grouping.size(); ++i) {
+            subsets[grouping[i]].push_back(i);
+        }
+
+        std::vector<std::vector<int> > expected(ngroup);
+        for (int g = 0; g < ngroup; ++g) {
+            std::shared_ptr<tatami::NumericMatrix> sub;
+            if (row) {
+                sub = tatami::make_DelayedSubset<1>(dense_row, subsets[g]);
+            } else {
+                sub = tatami::make_DelayedSubset<0>(dense_row, subsets[g]);
+            }
+            expected[g] = tatami_stats::count<int>(row, *sub, condition, {});
+        }
+        return expected;
+    }
+};
+
+TEST_P(GroupCountTest, Condition) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+
+    const int ngroup = (row ? 4 : 6);
+    std::vector<int> grouping(row ? NC : NR);
+    for (std::size_t i = 0; i < grouping.size(); ++i) {
+        grouping[i] = (i * 7) % ngroup;
+    }
+
+    tatami_stats::GroupCountOptions opt;
+    opt.num_threads = nthreads;
+
+    // Condition that doesn't count zeros.
+    {
+        auto cond = [](double x) -> bool { return x > 0; };
+        auto expected = reference(row, grouping, ngroup, cond);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            EXPECT_EQ(expected, tatami_stats::group_count<int>(row, *mat, grouping.data(), ngroup, cond, opt));
+        }
+    }
+
+    // Condition that does count zeros.
+    {
+        auto cond = [](double x) -> bool { return x < 1; };
+        auto expected = reference(row, grouping, ngroup, cond);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            EXPECT_EQ(expected, tatami_stats::group_count<int>(row, *mat, grouping.data(), ngroup, cond, opt));
+        }
+    }
+
+    // Condition that handles NaNs.
+    {
+        auto cond = [](double x) -> bool { return std::isnan(x); };
+        auto expected = reference(row, grouping, ngroup, cond);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            EXPECT_EQ(expected, tatami_stats::group_count<int>(row, *mat, grouping.data(), ngroup, cond, opt));
+        }
+    }
+
+    // Same results from matrices that can yield unsorted indices.
+    {
+        auto cond = [](double x) -> bool { return x <= 0; };
+        auto expected = reference(row, grouping, ngroup, cond);
+        std::shared_ptr<tatami::NumericMatrix> unsorted_row(new tatami_test::ReversedIndicesWrapper<double, int>(sparse_row));
+        EXPECT_EQ(expected, tatami_stats::group_count<int>(row, *unsorted_row, grouping.data(), ngroup, cond, opt));
+        std::shared_ptr<tatami::NumericMatrix> unsorted_column(new tatami_test::ReversedIndicesWrapper<double, int>(sparse_column));
+        EXPECT_EQ(expected, tatami_stats::group_count<int>(row, *unsorted_column, grouping.data(), ngroup, cond, opt));
+    }
+}
+
+TEST_P(GroupCountTest, NonZero) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+
+    const int ngroup = 5;
+    std::vector<int> grouping(row ? NC : NR);
+    for (std::size_t i = 0; i < grouping.size(); ++i) {
+        grouping[i] = i % ngroup;
+    }
+
+    tatami_stats::GroupCountOptions opt;
+    opt.num_threads = nthreads;
+
+    auto expected = reference(row, grouping, ngroup, [](double x) -> bool { return x != 0; });
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        EXPECT_EQ(expected, tatami_stats::group_count_nonzero<int>(row, *mat, grouping.data(), ngroup, opt));
+    }
+
+    // Checking the in-place overload.
+    std::vector<std::vector<int> > output(ngroup, std::vector<int>(row ? NR : NC));
+    std::vector<int*> ptrs;
+    for (auto& o : output) {
+        ptrs.push_back(o.data());
+    }
+    tatami_stats::group_count_nonzero(row, *sparse_row, grouping.data(), ngroup, ptrs, opt);
+    EXPECT_EQ(expected, output);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    GroupCount,
+    GroupCountTest,
+    ::testing::Combine(
+        ::testing::Values(true, false), // row or column
+        ::testing::Values(1, 3) // number of threads
+    )
+);
+
+TEST(GroupCount, Empty) {
+    tatami::DenseRowMatrix<double, int> empty(0, 10, std::vector<double>());
+    std::vector<int> grouping(10);
+    auto res = tatami_stats::group_count_nonzero<int>(true, empty, grouping.data(), 1, {});
+    ASSERT_EQ(res.size(), 1);
+    EXPECT_TRUE(res[0].empty());
+
+    auto res2 = tatami_stats::group_count<int>(false, empty, static_cast<int*>(NULL), 2, [](double x) -> bool { return x == 0; }, {});
+    ASSERT_EQ(res2.size(), 2);
+    EXPECT_EQ(res2[0], std::vector<int>(10));
+    EXPECT_EQ(res2[1], std::vector<int>(10));
+}
@@ -6,6 +6,8 @@
 #include "tatami_stats/group_median.hpp"
 #include "tatami_test/tatami_test.hpp"
 
+#include "utils.h"
+
 TEST(GroupMedian, RowSimple) {
     size_t NR = 99, NC = 155;
 
@@ -232,6 +234,60 @@ TEST(GroupMedian, ColumnSkipNan) {
     EXPECT_EQ(expected, tatami_stats::group_median(false, *sparse_column, rgroups.data(), ngroup, mopt));
 }
 
+TEST(GroupMedian, SparseMostlyZero) {
+    // Checking the shortcut for medians among the structural zeros against a reference calculation.
+    // Each group occupies a contiguous block of columns, so that the number of non-zero elements in each group cycles through all possible values.
+    std::mt19937_64 rng(5647382);
+    const int ngroup = 3;
+    for (std::size_t group_size : { 20, 21 }) {
+        const std::size_t NR = 70, NC = ngroup * group_size;
+        std::vector<int> groups(NC);
+        for (std::size_t c = 0; c < NC; ++c) {
+            groups[c] = c / group_size;
+        }
+
+        for (bool with_nan : { false, true }) {
+            const auto vec = simulate_variable_nonzeros(NR * ngroup, group_size, with_nan, rng);
+            tatami::DenseRowMatrix<double, int> dense_row(NR, NC, vec);
+            auto sparse_row = tatami::convert_to_compressed_sparse<double, int>(dense_row, true, {});
+            auto sparse_column = tatami::convert_to_compressed_sparse<double, int>(dense_row, false, {});
+
+            // Same values in column-major order, so that each column of 'tdense' is a row of 'dense_row'.
+            tatami::DenseColumnMatrix<double, int> tdense(NC, NR, vec);
+            auto tsparse_row = tatami::convert_to_compressed_sparse<double, int>(tdense, true, {});
+            auto tsparse_column = tatami::convert_to_compressed_sparse<double, int>(tdense, false, {});
+
+            for (bool skip_nan : { false, true }) {
+                if (with_nan && !skip_nan) {
+                    continue;
+                }
+
+                std::vector<std::vector<double> > expected(ngroup, std::vector<double>(NR));
+                for (std::size_t r = 0; r < NR; ++r) {
+                    for (int g = 0; g < ngroup; ++g) {
+                        auto start = vec.begin() + r * NC + g * group_size;
+                        expected[g][r] = reference_quantile(std::vector<double>(start, start + group_size), 0.5, skip_nan);
+                    }
+                }
+
+                tatami_stats::GroupMedianOptions mopt;
+                mopt.skip_nan = skip_nan;
+                for (int nthreads : { 1, 3 }) {
+                    mopt.num_threads = nthreads;
+                    for (auto mat : { sparse_row.get(), sparse_column.get() }) {
+                        auto observed = tatami_stats::group_median(true, *mat, groups.data(), ngroup, mopt);
+                        compare_double_vectors_of_vectors(expected, observed);
+                    }
+                    for (auto mat : { tsparse_row.get(), tsparse_column.get() }) {
+                        auto observed = tatami_stats::group_median(false, *mat, groups.data(), ngroup, mopt);
+                        compare_double_vectors_of_vectors(expected, observed);
+                    }
+                }
+            }
+        }
+    }
+}
+
 TEST(GroupMedian, EdgeCases) {
     tatami_stats::GroupMedianOptions vopt;
     vopt.skip_nan = true;
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <tuple>
+
+#include "tatami_stats/group_sum.hpp"
+#include "tatami_stats/group_rss.hpp"
+#include "tatami_stats/group_variance.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+class GroupOrderedTest : public ::testing::TestWithParam<std::tuple<bool, int, bool> > {
+protected:
+    // Enough vectors along the other dimension to span several blocks of shifted sums for each group.
+    inline static std::size_t NR = 83, NC = 401;
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+    inline static std::shared_ptr<tatami::NumericMatrix> nan_dense_row, nan_sparse_column;
+
+    static void SetUpTestSuite() {
+        auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.25;
+            opt.seed = 5647382;
+            return opt;
+        }());
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, simulated));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+
+        for (std::size_t i = 0; i < simulated.size(); i += 13) {
+            simulated[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+        nan_dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+        nan_sparse_column = tatami::convert_to_compressed_sparse<double, int>(*nan_dense_row, false, {});
+    }
+
+    // Interleaved groups, with the last group being empty.
+    static std::vector<int> create_groups(std::size_t n, std::size_t num_groups) {
+        std::vector<int> groups(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            groups[i] = (i * 3) % (num_groups - 1);
+        }
+        return groups;
+    }
+};
+
+TEST_P(GroupOrderedTest, Sum) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+    const std::size_t num_groups = 5;
+    auto groups = create_groups(row ? NC : NR, num_groups);
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        tatami_stats::GroupSumOptions opt;
+        opt.strategy = tatami_stats::PlanStrategy::RUNNING;
+        auto ref = tatami_stats::group_sum(row, *mat, groups.data(), num_groups, opt);
+        opt.num_threads = nthreads;
+        opt.group_ordered = true;
+        compare_double_vectors_of_vectors(ref, tatami_stats::group_sum(row, *mat, groups.data(), num_groups, opt));
+
+        auto interleaved = tatami_stats::group_sum_interleaved(row, *mat, groups.data(), num_groups, opt);
+        for (std::size_t g = 0; g < num_groups; ++g) {
+            for (std::size_t d = 0, end = ref[g].size(); d < end; ++d) {
+                EXPECT_FLOAT_EQ(ref[g][d], interleaved[d * num_groups + g]);
+            }
+        }
+    }
+
+    for (auto mat : { nan_dense_row.get(), nan_sparse_column.get() }) {
+        tatami_stats::GroupSumOptions opt;
+        opt.skip_nan = true;
+        opt.strategy = tatami_stats::PlanStrategy::RUNNING;
+        auto ref = tatami_stats::group_sum(row, *mat, groups.data(), num_groups, opt);
+        opt.num_threads = nthreads;
+        opt.group_ordered = true;
+        compare_double_vectors_of_vectors(ref, tatami_stats::group_sum(row, *mat, groups.data(), num_groups, opt));
+    }
+}
+
+TEST_P(GroupOrderedTest, Rss) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+    const bool shifted = std::get<2>(param);
+    const std::size_t num_groups = 4;
+    auto groups = create_groups(row ? NC : NR, num_groups);
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        tatami_stats::GroupRssOptions<double> opt;
+        opt.strategy = tatami_stats::PlanStrategy::RUNNING;
+        opt.shifted_sums = shifted;
+        opt.mean_placeholder = -1;
+        auto ref = tatami_stats::group_rss<double>(row, *mat, groups.data(), num_groups, opt);
+        opt.num_threads = nthreads;
+        opt.group_ordered = true;
+        auto ordered = tatami_stats::group_rss<double>(row, *mat, groups.data(), num_groups, opt);
+        compare_double_vectors_of_vectors(ref.mean, ordered.mean);
+        compare_double_vectors_of_vectors(ref.rss, ordered.rss);
+        EXPECT_EQ(ordered.mean.back().front(), -1);
+        EXPECT_EQ(ordered.rss.back().front(), 0);
+
+        tatami_stats::GroupVarianceOptions<double> vopt;
+        vopt.strategy = tatami_stats::PlanStrategy::RUNNING;
+        vopt.shifted_sums = shifted;
+        vopt.mean_placeholder = -1;
+        vopt.variance_placeholder = -1;
+        auto vref = tatami_stats::group_variance(row, *mat, groups.data(), num_groups, vopt);
+        vopt.num_threads = nthreads;
+        vopt.group_ordered = true;
+        auto vordered = tatami_stats::group_variance(row, *mat, groups.data(), num_groups, vopt);
+        compare_double_vectors_of_vectors(vref.mean, vordered.mean);
+        compare_double_vectors_of_vectors(vref.variance, vordered.variance);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    GroupOrdered,
+    GroupOrderedTest,
+    ::testing::Combine(
+        ::testing::Values(true, false), // row or column
+        ::testing::Values(1, 3), // number of threads
+        ::testing::Values(false, true) // shifted sums
+    )
+);
+
+TEST(GroupOrdered, Plan) {
+    tatami::DenseRowMatrix<double, int> mat(100, 50, std::vector<double>(5000));
+
+    // No per-thread partial results are needed.
+    tatami_stats::GroupSumOptions sopt;
+    sopt.num_threads = 4;
+    sopt.strategy = tatami_stats::PlanStrategy::RUNNING;
+    const auto sref = tatami_stats::plan(true, mat, 10, sopt);
+    sopt.group_ordered = true;
+    EXPECT_LT(tatami_stats::plan(true, mat, 10, sopt).memory, sref.memory);
+
+    tatami_stats::GroupRssOptions<double> ropt;
+    ropt.num_threads = 4;
+    ropt.strategy = tatami_stats::PlanStrategy::RUNNING;
+    const auto rref = tatami_stats::plan(true, mat, 10, ropt);
+    ropt.group_ordered = true;
+    EXPECT_LT(tatami_stats::plan(true, mat, 10, ropt).memory, rref.memory);
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <limits>
+
+#include "tatami_stats/group_range.hpp"
+#include "tatami_stats/range.hpp"
+#include "tatami_test/tatami_test.hpp"
+
+class GroupRangeTest : public ::testing::TestWithParam<std::tuple<std::pair<double, double>, bool, int> > {
+protected:
+    static std::vector<int> generate_groups(const bool interleaved, const int num_groups, const std::size_t length) {
+        std::vector<int> groups(length);
+        if (interleaved) {
+            for (std::size_t i = 0; i < length; ++i) {
+                groups[i] = i % num_groups;
+            }
+        } else {
+            // Contiguous blocks, so that each thread of the running path only sees some of the groups.
+            for (std::size_t i = 0; i < length; ++i) {
+                groups[i] = (i * num_groups) / length;
+            }
+        }
+        return groups;
+    }
+
+    static tatami_stats::GroupRangeResult<double> reference(bool row, const std::shared_ptr<tatami::NumericMatrix>& mat, const std::vector<int>& groups, int num_groups) {
+        std::vector<std::vector<int> > subsets(num_groups);
+        for (std::size_t i = 0; i < groups.size(); ++i) {
+            subsets[groups[i]].push_back(i);
+        }
+
+        tatami_stats::GroupRangeResult<double> expected;
+        expected.minimum.resize(num_groups);
+        expected.maximum.resize(num_groups);
+        const std::size_t dim = (row ? mat->nrow() : mat->ncol());
+        for (int g = 0; g < num_groups; ++g) {
+            if (subsets[g].empty()) {
+                expected.minimum[g].resize(dim, std::numeric_limits<double>::infinity());
+                expected.maximum[g].resize(dim, -std::numeric_limits<double>::infinity());
+                continue;
+            }
+
+            std::shared_ptr<tatami::NumericMatrix> sub;
+            if (row) {
+                sub = tatami::make_DelayedSubset<1>(mat, subsets[g]);
+            } else {
+                sub = tatami::make_DelayedSubset<0>(mat, subsets[g]);
+            }
+            auto res = tatami_stats::range(row, *sub, {});
+            expected.minimum[g] = std::move(res.minimum);
+            expected.maximum[g] = std::move(res.maximum);
+        }
+
+        return expected;
+    }
+};
+
+TEST_P(GroupRangeTest, Basic) {
+    auto param = GetParam();
+    auto limits = std::get<0>(param);
+    const bool interleaved = std::get<1>(param);
+    const int nthreads = std::get<2>(param);
+
+    std::size_t NR = 67, NC = 121;
+    auto simulated = tatami_test::simulate_vector<double>(NR * NC, [&]{
+        tatami_test::SimulateVectorOptions opt;
+        opt.density = 0.15;
+        opt.lower = limits.first;
+        opt.upper = limits.second;
+        opt.seed = 9182734 + limits.first * 100 + limits.second * 10 + interleaved;
+        return opt;
+    }());
+
+    auto dense_row = std::shared_ptr<tatami::NumericMatrix>(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+    auto dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+    auto sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+    auto sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+
+    tatami_stats::GroupRangeOptions opt;
+    opt.num_threads = nthreads;
+
+    // Adding an extra empty group to check that the placeholders are used.
+    const int ngroup = 5;
+    for (int r = 0; r < 2; ++r) {
+        const bool row = (r == 0);
+        auto groups = generate_groups(interleaved, ngroup, row ? NC : NR);
+        auto expected = reference(row, dense_row, groups, ngroup + 1);
+
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            auto res = tatami_stats::group_range(row, *mat, groups.data(), ngroup + 1, opt);
+            EXPECT_EQ(expected.minimum, res.minimum);
+            EXPECT_EQ(expected.maximum, res.maximum);
+        }
+
+        // Same results from matrices that can yield unsorted indices.
+        std::shared_ptr<tatami::NumericMatrix> unsorted_row(new tatami_test::ReversedIndicesWrapper<double, int>(sparse_row));
+        auto ures = tatami_stats::group_range(row, *unsorted_row, groups.data(), ngroup + 1, opt);
+        EXPECT_EQ(expected.minimum, ures.minimum);
+        EXPECT_EQ(expected.maximum, ures.maximum);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    GroupRange,
+    GroupRangeTest,
+    ::testing::Combine(
+        ::testing::Values(
+            std::make_pair(0.1, 1.0), // all positive
+            std::make_pair(-2.0, -1.0), // all negative
+            std::make_pair(-1.0, 1.0) // mixed
+        ),
+        ::testing::Values(false, true), // interleaved groups
+        ::testing::Values(1, 3) // number of threads
+    )
+);
+
+TEST(GroupRange, Empty) {
+    tatami::DenseRowMatrix<double, int> empty(5, 0, std::vector<double>());
+    tatami_stats::GroupRangeOptions opt;
+    opt.minimum_placeholder = 100;
+    opt.maximum_placeholder = -100;
+
+    auto res = tatami_stats::group_range(true, empty, static_cast<int*>(NULL), 2, opt);
+    ASSERT_EQ(res.minimum.size(), 2);
+    for (int g = 0; g < 2; ++g) {
+        EXPECT_EQ(res.minimum[g], std::vector<double>(5, 100));
+        EXPECT_EQ(res.maximum[g], std::vector<double>(5, -100));
+    }
+
+    opt.strategy = tatami_stats::PlanStrategy::RUNNING;
+    res = tatami_stats::group_range(true, empty, static_cast<int*>(NULL), 2, opt);
+    for (int g = 0; g < 2; ++g) {
+        EXPECT_EQ(res.minimum[g], std::vector<double>(5, 100));
+        EXPECT_EQ(res.maximum[g], std::vector<double>(5, -100));
+    }
+}
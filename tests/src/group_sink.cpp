@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <tuple>
+
+#include "tatami_stats/group_sum.hpp"
+#include "tatami_stats/group_rss.hpp"
+#include "tatami_stats/group_variance.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+// Collects the tiles into full-length vectors, checking that they arrive in order.
+class CollectingSink final : public tatami_stats::GroupSink<double, int> {
+public:
+    CollectingSink(std::size_t num_groups, int dim) : collected(num_groups, std::vector<double>(dim)) {}
+
+    std::vector<std::vector<double> > collected;
+    int position = 0;
+    int num_tiles = 0;
+
+    void write(int start, int length, const std::vector<double*>& values) {
+        EXPECT_EQ(start, position);
+        EXPECT_GT(length, 0);
+        EXPECT_EQ(values.size(), collected.size());
+        for (std::size_t g = 0; g < collected.size(); ++g) {
+            std::copy_n(values[g], length, collected[g].begin() + start);
+        }
+        position += length;
+        ++num_tiles;
+    }
+};
+
+class GroupSinkTest : public ::testing::TestWithParam<std::tuple<bool, int, std::size_t> > {
+protected:
+    inline static std::size_t NR = 73, NC = 91, NGROUPS = 4;
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+
+    static void SetUpTestSuite() {
+        auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.2;
+            opt.seed = 8172635;
+            return opt;
+        }());
+        for (std::size_t i = 0; i < simulated.size(); i += 11) {
+            simulated[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+
+    static std::vector<int> create_groups(std::size_t n) {
+        std::vector<int> groups(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            groups[i] = (i * 3) % NGROUPS;
+        }
+        return groups;
+    }
+
+    static std::vector<int> create_group_size(const std::vector<int>& groups) {
+        std::vector<int> group_size(NGROUPS);
+        for (auto g : groups) {
+            ++group_size[g];
+        }
+        return group_size;
+    }
+
+    static int expected_tiles(int dim, std::size_t tile_size) {
+        if (tile_size == 0) {
+            return (dim > 0);
+        }
+        return (dim + tile_size - 1) / tile_size;
+    }
+};
+
+TEST_P(GroupSinkTest, Sum) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    tatami_stats::GroupSumOptions opt;
+    opt.num_threads = std::get<1>(param);
+    opt.tile_size = std::get<2>(param);
+    opt.skip_nan = true;
+
+    const int dim = (row ? NR : NC);
+    auto groups = create_groups(row ? NC : NR);
+    auto ref = tatami_stats::group_sum<double>(row, *dense_row, groups.data(), NGROUPS, opt);
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        CollectingSink sink(NGROUPS, dim);
+        tatami_stats::group_sum(row, *mat, groups.data(), NGROUPS, sink, opt);
+        EXPECT_EQ(sink.position, dim);
+        EXPECT_EQ(sink.num_tiles, expected_tiles(dim, opt.tile_size));
+        compare_double_vectors_of_vectors(ref, sink.collected);
+    }
+}
+
+TEST_P(GroupSinkTest, Rss) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    tatami_stats::GroupRssOptions<double> opt;
+    opt.num_threads = std::get<1>(param);
+    opt.tile_size = std::get<2>(param);
+
+    const int dim = (row ? NR : NC);
+    auto groups = create_groups(row ? NC : NR);
+    auto ref = tatami_stats::group_rss<double>(row, *dense_row, groups.data(), NGROUPS, opt);
+    auto group_size = create_group_size(groups);
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        CollectingSink mean(NGROUPS, dim), rss(NGROUPS, dim);
+        tatami_stats::GroupRssSinks<double, int> sinks;
+        sinks.mean = &mean;
+        sinks.rss = &rss;
+        tatami_stats::group_rss(row, *mat, groups.data(), NGROUPS, group_size.data(), sinks, opt);
+        compare_double_vectors_of_vectors(ref.mean, mean.collected);
+        compare_double_vectors_of_vectors(ref.rss, rss.collected);
+
+        // Skipping one of the sinks.
+        CollectingSink rss_only(NGROUPS, dim);
+        sinks.mean = NULL;
+        sinks.rss = &rss_only;
+        tatami_stats::group_rss(row, *mat, groups.data(), NGROUPS, group_size.data(), sinks, opt);
+        compare_double_vectors_of_vectors(ref.rss, rss_only.collected);
+    }
+}
+
+TEST_P(GroupSinkTest, Variance) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int dim = (row ? NR : NC);
+    auto groups = create_groups(row ? NC : NR);
+    auto group_size = create_group_size(groups);
+
+    for (bool skip_nan : { false, true }) {
+        tatami_stats::GroupVarianceOptions<double> opt;
+        opt.num_threads = std::get<1>(param);
+        opt.tile_size = std::get<2>(param);
+        opt.skip_nan = skip_nan;
+        auto ref = tatami_stats::group_variance<double>(row, *dense_row, groups.data(), NGROUPS, opt);
+
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            CollectingSink mean(NGROUPS, dim), variance(NGROUPS, dim);
+            tatami_stats::GroupVarianceSinks<double, int> sinks;
+            sinks.mean = &mean;
+            sinks.variance = &variance;
+            tatami_stats::group_variance(row, *mat, groups.data(), NGROUPS, group_size.data(), sinks, opt);
+            compare_double_vectors_of_vectors(ref.mean, mean.collected);
+            compare_double_vectors_of_vectors(ref.variance, variance.collected);
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    GroupSink,
+    GroupSinkTest,
+    ::testing::Combine(
+        ::testing::Values(true, false), // row or column
+        ::testing::Values(1, 3), // number of threads
+        ::testing::Values(0, 1, 7, 1000) // tile size
+    )
+);
+
+TEST(GroupSink, MemoryLimit) {
+    tatami::DenseRowMatrix<double, int> mat(50, 20, std::vector<double>(1000, 1));
+    std::vector<int> groups(20);
+    for (int c = 0; c < 20; ++c) {
+        groups[c] = c % 2;
+    }
+
+    // Half of the limit is used for the tiles, so each tile should have 400 / (2 * 8) = 25 rows.
+    tatami_stats::GroupSumOptions opt;
+    opt.max_memory_bytes = 800;
+    CollectingSink sink(2, 50);
+    tatami_stats::group_sum(true, mat, groups.data(), 2, sink, opt);
+    EXPECT_EQ(sink.num_tiles, 2);
+    for (const auto& sums : sink.collected) {
+        EXPECT_EQ(sums, std::vector<double>(50, 10));
+    }
+}
+
+TEST(GroupSink, Empty) {
+    tatami::DenseRowMatrix<double, int> empty(0, 5, std::vector<double>());
+    std::vector<int> groups(5);
+    CollectingSink sink(1, 0);
+    tatami_stats::group_sum(true, empty, groups.data(), 1, sink, tatami_stats::GroupSumOptions());
+    EXPECT_EQ(sink.num_tiles, 0);
+}
+
+TEST(GroupSink, ChooseTileSize) {
+    // Requested sizes are capped at the dimension extent.
+    EXPECT_EQ(tatami_stats::choose_tile_size<double>(100, 3, 2, 7, {}), 7);
+    EXPECT_EQ(tatami_stats::choose_tile_size<double>(100, 3, 2, 1000, {}), 100);
+
+    // Otherwise, half of the limit is used for the tile buffers.
+    EXPECT_EQ(tatami_stats::choose_tile_size<double>(100, 3, 2, 0, 960), 10);
+    EXPECT_EQ(tatami_stats::choose_tile_size<double>(100, 3, 2, 0, 0), 1);
+    EXPECT_EQ(tatami_stats::choose_tile_size<double>(100, 3, 2, 0, {}), 100);
+}
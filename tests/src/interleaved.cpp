@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <tuple>
+
+#include "tatami_stats/group_sum.hpp"
+#include "tatami_stats/group_rss.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+template<typename Output_>
+static std::vector<std::vector<Output_> > deinterleave(const std::vector<Output_>& values, std::size_t num_groups) {
+    std::vector<std::vector<Output_> > output(num_groups);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        output[i % num_groups].push_back(values[i]);
+    }
+    return output;
+}
+
+class InterleavedTest : public ::testing::TestWithParam<std::tuple<bool, int, tatami_stats::PlanStrategy> > {
+protected:
+    inline static std::size_t NR = 97, NC = 131;
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+
+    static void SetUpTestSuite() {
+        auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.2;
+            opt.seed = 192837465;
+            return opt;
+        }());
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+
+    static std::vector<int> create_groups(std::size_t n, std::size_t num_groups) {
+        std::vector<int> groups(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            groups[i] = (i * 5) % num_groups;
+        }
+        return groups;
+    }
+};
+
+TEST_P(InterleavedTest, Sum) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+    const auto strategy = std::get<2>(param);
+
+    for (std::size_t num_groups : { 1, 3, 10 }) {
+        auto groups = create_groups(row ? NC : NR, num_groups);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            tatami_stats::GroupSumOptions opt;
+            opt.strategy = strategy;
+            auto ref = tatami_stats::group_sum(row, *mat, groups.data(), num_groups, opt);
+            opt.num_threads = nthreads;
+            auto interleaved = tatami_stats::group_sum_interleaved(row, *mat, groups.data(), num_groups, opt);
+            EXPECT_EQ(interleaved.size(), (row ? NR : NC) * num_groups);
+            compare_double_vectors_of_vectors(ref, deinterleave(interleaved, num_groups));
+        }
+    }
+}
+
+TEST_P(InterleavedTest, Rss) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+    const auto strategy = std::get<2>(param);
+
+    // Including a group with no members, to check that it is handled by the running path's stripping of empty groups.
+    for (std::size_t num_groups : { 1, 3, 11 }) {
+        auto groups = create_groups(row ? NC : NR, num_groups - (num_groups > 1));
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            for (int mode = 0; mode < 4; ++mode) {
+                tatami_stats::GroupRssOptions<double> opt;
+                opt.strategy = strategy;
+                opt.mean_placeholder = 0;
+                opt.shifted_sums = (mode == 1);
+                opt.deterministic = (mode == 2);
+                opt.group_ordered = (mode == 3);
+                auto ref = tatami_stats::group_rss<double>(row, *mat, groups.data(), num_groups, opt);
+                opt.num_threads = nthreads;
+                auto interleaved = tatami_stats::group_rss_interleaved<double>(row, *mat, groups.data(), num_groups, opt);
+                compare_double_vectors_of_vectors(ref.mean, deinterleave(interleaved.mean, num_groups));
+                compare_double_vectors_of_vectors(ref.rss, deinterleave(interleaved.rss, num_groups));
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Interleaved,
+    InterleavedTest,
+    ::testing::Combine(
+        ::testing::Values(true, false), // row or column
+        ::testing::Values(1, 3), // number of threads
+        ::testing::Values(tatami_stats::PlanStrategy::DIRECT, tatami_stats::PlanStrategy::RUNNING)
+    )
+);
+
+TEST(Interleaved, Empty) {
+    tatami::DenseRowMatrix<double, int> mat(0, 10, std::vector<double>());
+    std::vector<int> groups(10);
+    EXPECT_TRUE(tatami_stats::group_sum_interleaved(true, mat, groups.data(), 1, {}).empty());
+    EXPECT_TRUE(tatami_stats::group_sum_interleaved(true, mat, groups.data(), 0, {}).empty());
+    auto res = tatami_stats::group_rss_interleaved<double>(true, mat, groups.data(), 1, {});
+    EXPECT_TRUE(res.mean.empty());
+    EXPECT_TRUE(res.rss.empty());
+}
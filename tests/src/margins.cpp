@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include "tatami_stats/margins.hpp"
+#include "tatami_stats/sum.hpp"
+#include "tatami_stats/variance.hpp"
+#include "tatami_stats/count.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+class MarginsTest : public ::testing::TestWithParam<std::tuple<int, bool> > {
+protected:
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+    inline static std::size_t NR = 97, NC = 133;
+
+    static void SetUpTestSuite() {
+        auto vec = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.15;
+            opt.lower = -2;
+            opt.upper = 5;
+            opt.seed = 48172635;
+            return opt;
+        }());
+
+        // Adding some NaNs to check the skip_nan paths.
+        for (std::size_t i = 0; i < vec.size(); i += 17) {
+            vec[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(vec)));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+
+    static void compare(const tatami_stats::MarginStatistics<double, int>& expected, const tatami_stats::MarginStatistics<double, int>& observed) {
+        compare_double_vectors(expected.sum, observed.sum);
+        EXPECT_EQ(expected.count, observed.count);
+        compare_double_vectors(expected.mean, observed.mean);
+        compare_double_vectors(expected.variance, observed.variance);
+    }
+};
+
+TEST_P(MarginsTest, Basic) {
+    auto param = GetParam();
+    const int nthreads = std::get<0>(param);
+    const bool skip_nan = std::get<1>(param);
+
+    tatami_stats::MarginsResult<double, int> ref;
+    for (int r = 0; r < 2; ++r) {
+        const bool row = (r == 0);
+        auto& current = (row ? ref.row : ref.column);
+
+        tatami_stats::SumOptions sopt;
+        sopt.skip_nan = skip_nan;
+        current.sum = tatami_stats::sum(row, *dense_row, sopt);
+
+        tatami_stats::VarianceOptions vopt;
+        vopt.skip_nan = skip_nan;
+        auto vres = tatami_stats::variance(row, *dense_row, vopt);
+        current.mean = std::move(vres.mean);
+        current.variance = std::move(vres.variance);
+
+        current.count = tatami_stats::count<int>(row, *dense_row, [&](double x) -> bool { return x != 0 && !(skip_nan && std::isnan(x)); }, {});
+    }
+
+    tatami_stats::MarginsOptions mopt;
+    mopt.skip_nan = skip_nan;
+    mopt.num_threads = nthreads;
+    mopt.compute_count = true;
+    mopt.compute_mean = true;
+    mopt.compute_variance = true;
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        auto res = tatami_stats::margins(*mat, mopt);
+        if (skip_nan) {
+            compare(ref.row, res.row);
+            compare(ref.column, res.column);
+        } else {
+            // Only the counts are well-defined in the presence of NaNs.
+            EXPECT_EQ(ref.row.count, res.row.count);
+            EXPECT_EQ(ref.column.count, res.column.count);
+        }
+    }
+}
+
+TEST_P(MarginsTest, NoNan) {
+    auto param = GetParam();
+    const int nthreads = std::get<0>(param);
+    const bool skip_nan = std::get<1>(param);
+
+    auto vec = tatami_test::simulate_vector<double>(NR * NC, []{
+        tatami_test::SimulateVectorOptions opt;
+        opt.density = 0.2;
+        opt.seed = 9182736;
+        return opt;
+    }());
+    auto dense = std::shared_ptr<tatami::NumericMatrix>(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(vec)));
+    auto sparse = tatami::convert_to_compressed_sparse<double, int>(*dense, false, {});
+
+    tatami_stats::MarginsResult<double, int> ref;
+    for (int r = 0; r < 2; ++r) {
+        const bool row = (r == 0);
+        auto& current = (row ? ref.row : ref.column);
+        current.sum = tatami_stats::sum(row, *dense, {});
+        auto vres = tatami_stats::variance(row, *dense, {});
+        current.mean = std::move(vres.mean);
+        current.variance = std::move(vres.variance);
+        current.count = tatami_stats::count<int>(row, *dense, [](double x) -> bool { return x != 0; }, {});
+    }
+
+    tatami_stats::MarginsOptions mopt;
+    mopt.skip_nan = skip_nan;
+    mopt.num_threads = nthreads;
+    mopt.compute_count = true;
+    mopt.compute_mean = true;
+    mopt.compute_variance = true;
+
+    for (auto mat : { dense.get(), sparse.get() }) {
+        auto res = tatami_stats::margins(*mat, mopt);
+        compare(ref.row, res.row);
+        compare(ref.column, res.column);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Margins,
+    MarginsTest,
+    ::testing::Combine(
+        ::testing::Values(1, 3), // number of threads
+        ::testing::Values(false, true) // skip NaNs
+    )
+);
+
+TEST(Margins, Partial) {
+    std::size_t NR = 45, NC = 72;
+    auto vec = tatami_test::simulate_vector<double>(NR * NC, []{
+        tatami_test::SimulateVectorOptions opt;
+        opt.density = 0.3;
+        opt.seed = 1726354;
+        return opt;
+    }());
+    tatami::DenseColumnMatrix<double, int> mat(NR, NC, std::move(vec));
+
+    // Only computing the column sums and the row variances, which would usually require two passes.
+    std::vector<double> colsums(NC), rowvars(NR);
+    tatami_stats::MarginBuffers<double, int> rbuffers, cbuffers;
+    rbuffers.variance = rowvars.data();
+    cbuffers.sum = colsums.data();
+
+    tatami_stats::MarginsOptions mopt;
+    mopt.num_threads = 2;
+    tatami_stats::margins(mat, rbuffers, cbuffers, mopt);
+    compare_double_vectors(colsums, tatami_stats::sum(false, mat, {}));
+    compare_double_vectors(rowvars, tatami_stats::variance(true, mat, {}).variance);
+
+    // Checking that unrequested statistics are left empty.
+    auto res = tatami_stats::margins(mat, {});
+    compare_double_vectors(res.column.sum, colsums);
+    EXPECT_TRUE(res.column.count.empty());
+    EXPECT_TRUE(res.row.mean.empty());
+    EXPECT_TRUE(res.row.variance.empty());
+}
+
+TEST(Margins, Empty) {
+    tatami_stats::MarginsOptions mopt;
+    mopt.compute_count = true;
+    mopt.compute_mean = true;
+    mopt.compute_variance = true;
+
+    tatami::DenseRowMatrix<double, int> empty_cols(10, 0, std::vector<double>());
+    auto res = tatami_stats::margins(empty_cols, mopt);
+    EXPECT_EQ(res.row.sum, std::vector<double>(10));
+    EXPECT_EQ(res.row.count, std::vector<int>(10));
+    EXPECT_TRUE(is_all_nan(res.row.mean));
+    EXPECT_TRUE(is_all_nan(res.row.variance));
+    EXPECT_TRUE(res.column.sum.empty());
+
+    tatami::DenseRowMatrix<double, int> empty_rows(0, 10, std::vector<double>());
+    res = tatami_stats::margins(empty_rows, mopt);
+    EXPECT_TRUE(res.row.sum.empty());
+    EXPECT_EQ(res.column.sum, std::vector<double>(10));
+    EXPECT_EQ(res.column.count, std::vector<int>(10));
+    EXPECT_TRUE(is_all_nan(res.column.mean));
+    EXPECT_TRUE(is_all_nan(res.column.variance));
+}
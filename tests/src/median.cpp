@@ -41,6 +41,75 @@ TEST(Median, DirectSparseNaN) {
     EXPECT_EQ(direct_medians(vec.data(), vsize, 9, true), 0.5);
 }
 
+TEST(Median, SparseZeroShortcut) {
+    std::vector<double> vec { 2, -1, 5, 3 };
+    int vsize = vec.size();
+    EXPECT_FALSE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 4, 0.5, false)); // no zeros at all.
+    EXPECT_FALSE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 6, 0.5, false)); // median is (0 + 2) / 2.
+    EXPECT_TRUE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 9, 0.5, false));
+    EXPECT_TRUE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 10, 0.5, false));
+    EXPECT_EQ(direct_medians(vec.data(), vsize, 9, false), 0);
+
+    // No shortcut unless the zeros are the majority, even if the median is zero.
+    EXPECT_FALSE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 7, 0.5, false));
+    EXPECT_FALSE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 8, 0.5, false));
+    EXPECT_EQ(direct_medians(vec.data(), vsize, 7, false), 0);
+
+    // Quantiles at the edges are determined by the non-zero values.
+    EXPECT_FALSE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 100, 0.0, false));
+    EXPECT_FALSE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 100, 1.0, false));
+    EXPECT_TRUE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 100, 0.1, false));
+    EXPECT_TRUE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 100, 0.9, false));
+
+    // NaNs are removed from the total number of values.
+    vec.push_back(std::numeric_limits<double>::quiet_NaN());
+    vec.push_back(std::numeric_limits<double>::quiet_NaN());
+    vsize = vec.size();
+    EXPECT_FALSE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 8, 0.5, true));
+    EXPECT_TRUE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 13, 0.5, true));
+    EXPECT_FALSE(tatami_stats::sparse_quantile_is_zero(vec.data(), vsize, 6, 0.5, true));
+}
+
+TEST(Median, SparseMostlyZero) {
+    // Checking the shortcut for medians among the structural zeros against a reference calculation.
+    std::mt19937_64 rng(192837);
+    for (std::size_t NC : { 24, 25 }) {
+        const std::size_t NR = 150;
+        for (bool with_nan : { false, true }) {
+            const auto vec = simulate_variable_nonzeros(NR, NC, with_nan, rng);
+            tatami::DenseRowMatrix<double, int> dense_row(NR, NC, vec);
+            auto sparse_row = tatami::convert_to_compressed_sparse<double, int>(dense_row, true, {});
+            auto sparse_column = tatami::convert_to_compressed_sparse<double, int>(dense_row, false, {});
+
+            // Same values in column-major order, so that each column of 'tdense' is a row of 'dense_row'.
+            tatami::DenseColumnMatrix<double, int> tdense(NC, NR, vec);
+            auto tsparse_row = tatami::convert_to_compressed_sparse<double, int>(tdense, true, {});
+            auto tsparse_column = tatami::convert_to_compressed_sparse<double, int>(tdense, false, {});
+
+            for (bool skip_nan : { false, true }) {
+                if (with_nan && !skip_nan) {
+                    continue;
+                }
+
+                std::vector<double> expected(NR);
+                for (std::size_t r = 0; r < NR; ++r) {
+                    expected[r] = reference_quantile(std::vector<double>(vec.begin() + r * NC, vec.begin() + (r + 1) * NC), 0.5, skip_nan);
+                }
+
+                tatami_stats::MedianOptions mopt;
+                mopt.skip_nan = skip_nan;
+                for (int nthreads : { 1, 3 }) {
+                    mopt.num_threads = nthreads;
+                    compare_double_vectors(expected, tatami_stats::median(true, *sparse_row, mopt));
+                    compare_double_vectors(expected, tatami_stats::median(true, *sparse_column, mopt));
+                    compare_double_vectors(expected, tatami_stats::median(false, *tsparse_row, mopt));
+                    compare_double_vectors(expected, tatami_stats::median(false, *tsparse_column, mopt));
+                }
+            }
+        }
+    }
+}
+
 /***************************************/
 
 class MedianTest : public ::testing::TestWithParam<std::tuple<std::pair<size_t, size_t>, int> > {};
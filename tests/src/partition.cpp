@@ -0,0 +1,307 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <random>
+
+#include "tatami_stats/partition.hpp"
+#include "tatami_stats/count.hpp"
+#include "tatami_stats/sum.hpp"
+#include "tatami_stats/variance.hpp"
+#include "tatami_stats/median.hpp"
+#include "tatami_stats/quantile.hpp"
+#include "tatami_stats/group_median.hpp"
+#include "tatami_stats/group_sum.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+TEST(Partition, ByCost) {
+    // Equal costs give equal chunks.
+    {
+        std::vector<int> cost(12);
+        auto bounds = tatami_stats::partition_by_cost(12, cost.data(), 3);
+        std::vector<int> expected { 0, 4, 8, 12 };
+        EXPECT_EQ(bounds, expected);
+    }
+
+    // Heavy vectors at the end get their own chunks.
+    {
+        std::vector<int> cost { 0, 0, 0, 0, 0, 0, 0, 0, 50, 50 };
+        auto bounds = tatami_stats::partition_by_cost(10, cost.data(), 3);
+        std::vector<int> expected { 0, 9, 10 };
+        EXPECT_EQ(bounds, expected);
+    }
+
+    {
+        std::vector<int> cost { 10, 10, 10, 0, 0, 0, 0, 0, 0, 0 };
+        auto bounds = tatami_stats::partition_by_cost(10, cost.data(), 2);
+        std::vector<int> expected { 0, 2, 10 };
+        EXPECT_EQ(bounds, expected);
+    }
+
+    // More threads than vectors.
+    {
+        std::vector<double> cost { 1, 2 };
+        auto bounds = tatami_stats::partition_by_cost(2, cost.data(), 5);
+        std::vector<int> expected { 0, 1, 2 };
+        EXPECT_EQ(bounds, expected);
+    }
+
+    // Edge cases.
+    {
+        std::vector<int> cost(5);
+        auto bounds = tatami_stats::partition_by_cost(5, cost.data(), 1);
+        std::vector<int> expected { 0, 5 };
+        EXPECT_EQ(bounds, expected);
+
+        bounds = tatami_stats::partition_by_cost(0, cost.data(), 3);
+        expected.resize(1);
+        EXPECT_EQ(bounds, expected);
+    }
+}
+
+TEST(Partition, ByCostRandom) {
+    std::mt19937_64 rng(1000);
+    for (int it = 0; it < 20; ++it) {
+        const int num = rng() % 100 + 1;
+        std::vector<int> cost(num);
+        for (auto& c : cost) {
+            c = rng() % 20;
+        }
+        const int nthreads = rng() % 8 + 1;
+
+        auto bounds = tatami_stats::partition_by_cost(num, cost.data(), nthreads);
+        ASSERT_GE(bounds.size(), 2);
+        EXPECT_LE(bounds.size(), static_cast<std::size_t>(nthreads + 1));
+        EXPECT_EQ(bounds.front(), 0);
+        EXPECT_EQ(bounds.back(), num);
+        for (std::size_t b = 1; b < bounds.size(); ++b) {
+            EXPECT_LT(bounds[b - 1], bounds[b]);
+        }
+    }
+}
+
+TEST(Partition, ByBoundaries) {
+    std::vector<int> bounds { 0, 3, 4, 10 };
+    std::vector<int> chunk(10, -1);
+    auto nused = tatami_stats::parallelize_by_boundaries([&](int c, int s, int l) -> void {
+        for (int i = s; i < s + l; ++i) {
+            chunk[i] = c;
+        }
+    }, bounds);
+    EXPECT_EQ(nused, 3);
+
+    std::vector<int> expected { 0, 0, 0, 1, 2, 2, 2, 2, 2, 2 };
+    EXPECT_EQ(chunk, expected);
+}
+
+TEST(Partition, WorkStealingQueue) {
+    std::vector<int> bounds { 0, 2, 5, 6, 10, 11, 15, 20 };
+
+    // Single worker just processes all chunks in order.
+    {
+        tatami_stats::WorkStealingQueue<int> queue(bounds, 1);
+        EXPECT_EQ(queue.num_workers(), 1);
+        int s, l;
+        std::vector<int> starts;
+        while (queue.next(0, s, l)) {
+            starts.push_back(s);
+            EXPECT_EQ(s + l, bounds[starts.size()]);
+        }
+        bounds.pop_back();
+        EXPECT_EQ(starts, bounds);
+        bounds.push_back(20);
+    }
+
+    // First worker steals from the back of the second worker.
+    {
+        tatami_stats::WorkStealingQueue<int> queue(bounds, 2);
+        EXPECT_EQ(queue.num_workers(), 2);
+        int s, l;
+        std::vector<int> starts;
+        while (queue.next(0, s, l)) {
+            starts.push_back(s);
+        }
+        std::vector<int> expected { 0, 2, 5, 15, 11, 10, 6 };
+        EXPECT_EQ(starts, expected);
+        EXPECT_FALSE(queue.next(1, s, l));
+    }
+
+    // Capped at the number of chunks.
+    {
+        tatami_stats::WorkStealingQueue<int> queue(bounds, 10);
+        EXPECT_EQ(queue.num_workers(), 7);
+    }
+
+    // Every vector is claimed exactly once by concurrent workers.
+    {
+        std::vector<int> many_bounds { 0 };
+        for (int i = 1; i <= 1000; ++i) {
+            many_bounds.push_back(i * 3);
+        }
+        tatami_stats::WorkStealingQueue<int> queue(many_bounds, 4);
+        std::vector<int> claimed(3000);
+        tatami::parallelize([&](int, int start, int length) -> void {
+            for (int w = start; w < start + length; ++w) {
+                int s, l;
+                while (queue.next(w, s, l)) {
+                    for (int i = s; i < s + l; ++i) {
+                        ++claimed[i];
+                    }
+                }
+            }
+        }, queue.num_workers(), queue.num_workers());
+        EXPECT_EQ(claimed, std::vector<int>(3000, 1));
+    }
+}
+
+class PartitionMatrixTest : public ::testing::Test {
+protected:
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+    inline static std::size_t NR = 97, NC = 123;
+
+    static void SetUpTestSuite() {
+        auto vec = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.5;
+            opt.seed = 1239123;
+            return opt;
+        }());
+
+        // Skewing the number of non-zeros so that the balanced partitions differ from the equal ones.
+        std::mt19937_64 rng(NR * NC);
+        inject_variable_zeros(NR, NC, vec, rng);
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(vec)));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+};
+
+TEST_F(PartitionMatrixTest, CountNonzeros) {
+    auto dense_count = tatami_stats::count_structural_nonzeros(true, *dense_row, 1);
+    EXPECT_EQ(dense_count, std::vector<int>(NR, NC));
+
+    auto ref_row = tatami_stats::count<int>(true, *dense_row, [](double x) -> bool { return x != 0; }, {});
+    EXPECT_EQ(ref_row, tatami_stats::count_structural_nonzeros(true, *sparse_row, 1));
+    EXPECT_EQ(ref_row, tatami_stats::count_structural_nonzeros(true, *sparse_row, 3));
+
+    auto ref_col = tatami_stats::count<int>(false, *dense_row, [](double x) -> bool { return x != 0; }, {});
+    EXPECT_EQ(ref_col, tatami_stats::count_structural_nonzeros(false, *sparse_column, 1));
+    EXPECT_EQ(ref_col, tatami_stats::count_structural_nonzeros(false, *sparse_column, 3));
+}
+
+TEST_F(PartitionMatrixTest, Sum) {
+    for (int r = 0; r < 2; ++r) {
+        const bool row = (r == 0);
+        auto ref = tatami_stats::sum(row, *dense_row, {});
+
+        tatami_stats::SumOptions sopt;
+        sopt.num_threads = 3;
+        sopt.balance_nonzeros = true;
+        compare_double_vectors(ref, tatami_stats::sum(row, *dense_row, sopt));
+        compare_double_vectors(ref, tatami_stats::sum(row, *sparse_row, sopt));
+        compare_double_vectors(ref, tatami_stats::sum(row, *sparse_column, sopt));
+
+        sopt.skip_nan = true;
+        compare_double_vectors(ref, tatami_stats::sum(row, *sparse_row, sopt));
+        compare_double_vectors(ref, tatami_stats::sum(row, *sparse_column, sopt));
+    }
+}
+
+TEST_F(PartitionMatrixTest, Variance) {
+    for (int r = 0; r < 2; ++r) {
+        const bool row = (r == 0);
+        auto ref = tatami_stats::variance(row, *dense_row, {});
+
+        tatami_stats::VarianceOptions vopt;
+        vopt.num_threads = 3;
+        vopt.balance_nonzeros = true;
+        for (int n = 0; n < 2; ++n) {
+            vopt.skip_nan = (n == 1);
+
+            auto res_row = tatami_stats::variance(row, *sparse_row, vopt);
+            compare_double_vectors(ref.mean, res_row.mean);
+            compare_double_vectors(ref.variance, res_row.variance);
+
+            auto res_col = tatami_stats::variance(row, *sparse_column, vopt);
+            compare_double_vectors(ref.mean, res_col.mean);
+            compare_double_vectors(ref.variance, res_col.variance);
+        }
+    }
+}
+
+TEST_F(PartitionMatrixTest, Median) {
+    for (int r = 0; r < 2; ++r) {
+        const bool row = (r == 0);
+        auto ref = tatami_stats::median(row, *dense_row, {});
+
+        tatami_stats::MedianOptions mopt;
+        mopt.num_threads = 3;
+        mopt.balance_nonzeros = true;
+        compare_double_vectors(ref, tatami_stats::median(row, *sparse_row, mopt));
+        compare_double_vectors(ref, tatami_stats::median(row, *sparse_column, mopt));
+
+        mopt.work_stealing = true;
+        compare_double_vectors(ref, tatami_stats::median(row, *dense_row, mopt));
+        compare_double_vectors(ref, tatami_stats::median(row, *dense_column, mopt));
+        compare_double_vectors(ref, tatami_stats::median(row, *sparse_row, mopt));
+        compare_double_vectors(ref, tatami_stats::median(row, *sparse_column, mopt));
+
+        mopt.work_stealing_chunk_size = 7;
+        compare_double_vectors(ref, tatami_stats::median(row, *sparse_row, mopt));
+        mopt.work_stealing_chunk_size = 1000;
+        compare_double_vectors(ref, tatami_stats::median(row, *sparse_row, mopt));
+    }
+}
+
+TEST_F(PartitionMatrixTest, Quantile) {
+    for (int r = 0; r < 2; ++r) {
+        const bool row = (r == 0);
+        auto ref = tatami_stats::quantile(row, *dense_row, 0.8, {});
+
+        tatami_stats::QuantileOptions qopt;
+        qopt.num_threads = 3;
+        qopt.work_stealing = true;
+        qopt.work_stealing_chunk_size = 5;
+        compare_double_vectors(ref, tatami_stats::quantile(row, *dense_row, 0.8, qopt));
+        compare_double_vectors(ref, tatami_stats::quantile(row, *sparse_column, 0.8, qopt));
+
+        qopt.skip_nan = true;
+        compare_double_vectors(ref, tatami_stats::quantile(row, *dense_column, 0.8, qopt));
+        compare_double_vectors(ref, tatami_stats::quantile(row, *sparse_row, 0.8, qopt));
+    }
+}
+
+TEST_F(PartitionMatrixTest, GroupMedian) {
+    std::vector<int> groups(NC);
+    for (std::size_t c = 0; c < NC; ++c) {
+        groups[c] = c % 3;
+    }
+    auto ref = tatami_stats::group_median(true, *dense_row, groups.data(), 3, {});
+
+    tatami_stats::GroupMedianOptions gopt;
+    gopt.num_threads = 3;
+    gopt.work_stealing = true;
+    compare_double_vectors_of_vectors(ref, tatami_stats::group_median(true, *dense_column, groups.data(), 3, gopt));
+    compare_double_vectors_of_vectors(ref, tatami_stats::group_median(true, *sparse_row, groups.data(), 3, gopt));
+    compare_double_vectors_of_vectors(ref, tatami_stats::group_median(true, *sparse_column, groups.data(), 3, gopt));
+
+    gopt.work_stealing = false;
+    gopt.balance_nonzeros = true;
+    compare_double_vectors_of_vectors(ref, tatami_stats::group_median(true, *sparse_row, groups.data(), 3, gopt));
+}
+
+TEST_F(PartitionMatrixTest, GroupSum) {
+    std::vector<int> groups(NC);
+    for (std::size_t c = 0; c < NC; ++c) {
+        groups[c] = c % 4;
+    }
+    auto ref = tatami_stats::group_sum(true, *dense_row, groups.data(), 4, {});
+
+    tatami_stats::GroupSumOptions gopt;
+    gopt.num_threads = 3;
+    gopt.balance_nonzeros = true;
+    compare_double_vectors_of_vectors(ref, tatami_stats::group_sum(true, *sparse_row, groups.data(), 4, gopt));
+    compare_double_vectors_of_vectors(ref, tatami_stats::group_sum(true, *sparse_column, groups.data(), 4, gopt));
+}
@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "tatami_stats/plan.hpp"
+#include "tatami_stats/sum.hpp"
+#include "tatami_stats/variance.hpp"
+#include "tatami_stats/group_rss.hpp"
+#include "tatami_stats/skip_nan/group_rss.hpp"
+#include "tatami_stats/trace.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+class PlanTest : public ::testing::Test {
+protected:
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, sparse_column;
+    inline static std::size_t NR = 50, NC = 152;
+
+    static void SetUpTestSuite() {
+        auto vec = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.2;
+            opt.seed = 1234567;
+            return opt;
+        }());
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(vec)));
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+};
+
+TEST_F(PlanTest, Unlimited) {
+    tatami_stats::SumOptions sopt;
+    sopt.num_threads = 3;
+
+    auto direct = tatami_stats::plan(true, *dense_row, sopt);
+    EXPECT_FALSE(direct.running);
+    EXPECT_EQ(direct.num_threads, 3);
+    EXPECT_EQ(direct.memory, 3 * NC * sizeof(double));
+    EXPECT_TRUE(direct.feasible);
+
+    auto running = tatami_stats::plan(false, *dense_row, sopt);
+    EXPECT_TRUE(running.running);
+    EXPECT_EQ(running.num_threads, 3);
+    EXPECT_EQ(running.memory, 3 * NC * sizeof(double) + 2 * NC * sizeof(double));
+
+    // Memory usage doesn't include partials for a single thread.
+    sopt.num_threads = 1;
+    auto single = tatami_stats::plan(false, *dense_row, sopt);
+    EXPECT_TRUE(single.running);
+    EXPECT_EQ(single.num_threads, 1);
+    EXPECT_EQ(single.memory, NC * sizeof(double));
+}
+
+TEST_F(PlanTest, Budget) {
+    tatami_stats::SumOptions sopt;
+    sopt.num_threads = 4;
+    auto ref = tatami_stats::sum(false, *dense_row, sopt);
+    auto full = tatami_stats::plan(false, *dense_row, sopt);
+
+    // Reducing the number of threads.
+    sopt.max_memory_bytes = full.memory - 1;
+    auto fewer = tatami_stats::plan(false, *dense_row, sopt);
+    EXPECT_TRUE(fewer.running);
+    EXPECT_EQ(fewer.num_threads, 3);
+    EXPECT_LE(fewer.memory, *(sopt.max_memory_bytes));
+    EXPECT_TRUE(fewer.feasible);
+    compare_double_vectors(ref, tatami_stats::sum(false, *dense_row, sopt));
+
+    // Switching to the direct path, which needs less memory as it doesn't need to hold all columns.
+    sopt.max_memory_bytes = NR * sizeof(double) * 2;
+    auto switched = tatami_stats::plan(false, *dense_row, sopt);
+    EXPECT_FALSE(switched.running);
+    EXPECT_EQ(switched.num_threads, 2);
+    EXPECT_EQ(switched.memory, *(sopt.max_memory_bytes));
+    EXPECT_TRUE(switched.feasible);
+    compare_double_vectors(ref, tatami_stats::sum(false, *dense_row, sopt));
+
+    // Impossible budget falls back to the lowest usage.
+    sopt.max_memory_bytes = 0;
+    auto lowest = tatami_stats::plan(false, *dense_row, sopt);
+    EXPECT_FALSE(lowest.running);
+    EXPECT_EQ(lowest.num_threads, 1);
+    EXPECT_EQ(lowest.memory, NR * sizeof(double));
+    EXPECT_FALSE(lowest.feasible);
+    compare_double_vectors(ref, tatami_stats::sum(false, *dense_row, sopt));
+
+    // Checking that the tracer reports the planned path.
+    tatami_stats::Tracer tracer;
+    sopt.tracer = &tracer;
+    tatami_stats::sum(false, *dense_row, sopt);
+    ASSERT_EQ(tracer.paths().size(), 1);
+    EXPECT_FALSE(tracer.paths()[0].running);
+}
+
+TEST_F(PlanTest, Extras) {
+    tatami_stats::SumOptions sopt;
+    sopt.num_threads = 3;
+    auto ref = tatami_stats::sum(false, *dense_row, sopt);
+
+    // Prefetching rings are included in the memory usage of both paths.
+    sopt.prefetch = 2;
+    auto direct = tatami_stats::plan(true, *dense_row, sopt);
+    EXPECT_FALSE(direct.running);
+    EXPECT_EQ(direct.memory, 3 * NC * sizeof(double) + 3 * 3 * NC * sizeof(double));
+    auto running = tatami_stats::plan(false, *dense_row, sopt);
+    EXPECT_TRUE(running.running);
+    EXPECT_EQ(running.memory, 3 * NC * sizeof(double) + 2 * NC * sizeof(double) + 3 * 3 * NC * sizeof(double));
+    sopt.prefetch = 0;
+
+    // Buffers for the transformed values are included in the direct path.
+    auto transformed = tatami_stats::plan(true, *dense_row, tatami_stats::make_transform([](double x) -> double { return x * 2; }), sopt);
+    EXPECT_EQ(transformed.memory, 3 * NC * (sizeof(double) + sizeof(double)));
+    EXPECT_EQ(tatami_stats::plan(true, *dense_row, tatami_stats::IdentityTransform(), sopt).memory, 3 * NC * sizeof(double));
+
+    // Partial results for the deterministic reduction replace the usual per-thread partial results,
+    // and the estimate is an upper bound on what is actually allocated.
+    sopt.deterministic = true;
+    auto deterministic = tatami_stats::plan(false, *dense_row, sopt);
+    EXPECT_TRUE(deterministic.running);
+    const std::size_t buffers = 3 * NC * sizeof(double);
+    EXPECT_EQ(deterministic.memory, buffers + 3 * tatami_stats::deterministic_nodes_per_thread(NR, 3) * NC * sizeof(double));
+
+    tatami_stats::Tracer tracer;
+    sopt.tracer = &tracer;
+    compare_double_vectors(ref, tatami_stats::sum(false, *dense_row, sopt));
+    std::size_t allocated = 0;
+    for (const auto& event : tracer.events()) {
+        allocated += event.bytes;
+    }
+    EXPECT_GT(allocated, 0);
+    EXPECT_LE(allocated, deterministic.memory - buffers);
+}
+
+TEST_F(PlanTest, Grouped) {
+    std::vector<int> groups(NC);
+    for (std::size_t c = 0; c < NC; ++c) {
+        groups[c] = c % 6;
+    }
+
+    tatami_stats::GroupRssOptions gopt;
+    gopt.num_threads = 3;
+    auto ref = tatami_stats::group_rss<double>(true, *sparse_column, groups.data(), 6, gopt);
+
+    auto full = tatami_stats::plan(true, *sparse_column, 6, gopt);
+    EXPECT_TRUE(full.running);
+    EXPECT_EQ(full.num_threads, 3);
+
+    gopt.max_memory_bytes = full.memory / 2;
+    auto reduced = tatami_stats::plan(true, *sparse_column, 6, gopt);
+    EXPECT_LE(reduced.memory, *(gopt.max_memory_bytes));
+    EXPECT_TRUE(reduced.num_threads < 3 || !reduced.running);
+
+    auto res = tatami_stats::group_rss<double>(true, *sparse_column, groups.data(), 6, gopt);
+    compare_double_vectors_of_vectors(ref.mean, res.mean);
+    compare_double_vectors_of_vectors(ref.rss, res.rss);
+
+    tatami_stats::skip_nan::GroupRssOptions nopt;
+    nopt.num_threads = 3;
+    auto nfull = tatami_stats::skip_nan::plan<int>(true, *sparse_column, 6, nopt);
+    EXPECT_TRUE(nfull.running);
+    EXPECT_GT(nfull.memory, full.memory); // as we need to store the counts.
+
+    nopt.max_memory_bytes = 0;
+    auto nres = tatami_stats::skip_nan::group_rss<double, int>(true, *sparse_column, groups.data(), 6, nopt);
+    compare_double_vectors_of_vectors(ref.mean, nres.mean);
+    compare_double_vectors_of_vectors(ref.rss, nres.rss);
+}
+
+TEST_F(PlanTest, Variance) {
+    tatami_stats::VarianceOptions vopt;
+    vopt.num_threads = 3;
+    auto ref = tatami_stats::variance(true, *sparse_column, vopt);
+
+    vopt.max_memory_bytes = 0;
+    auto res = tatami_stats::variance(true, *sparse_column, vopt);
+    compare_double_vectors(ref.mean, res.mean);
+    compare_double_vectors(ref.variance, res.variance);
+}
+
+TEST_F(PlanTest, Strategy) {
+    tatami_stats::SumOptions sopt;
+    sopt.num_threads = 3;
+    auto ref = tatami_stats::sum(false, *dense_row, sopt);
+
+    sopt.strategy = tatami_stats::PlanStrategy::DIRECT;
+    auto direct = tatami_stats::plan(false, *dense_row, sopt);
+    EXPECT_FALSE(direct.running);
+    EXPECT_EQ(direct.num_threads, 3);
+    compare_double_vectors(ref, tatami_stats::sum(false, *dense_row, sopt));
+
+    sopt.strategy = tatami_stats::PlanStrategy::RUNNING;
+    auto running = tatami_stats::plan(true, *dense_row, sopt);
+    EXPECT_TRUE(running.running);
+    EXPECT_EQ(running.num_threads, 3);
+    compare_double_vectors(tatami_stats::sum(true, *dense_row, {}), tatami_stats::sum(true, *dense_row, sopt));
+
+    // Tiny problems only use a single thread.
+    sopt.strategy = tatami_stats::PlanStrategy::COST;
+    auto costed = tatami_stats::plan(false, *dense_row, sopt);
+    EXPECT_EQ(costed.num_threads, 1);
+    compare_double_vectors(ref, tatami_stats::sum(false, *dense_row, sopt));
+
+    // Memory budget is still respected.
+    sopt.max_memory_bytes = 0;
+    auto budgeted = tatami_stats::plan(false, *dense_row, sopt);
+    EXPECT_FALSE(budgeted.running);
+    EXPECT_EQ(budgeted.num_threads, 1);
+}
+
+TEST(ChooseByCost, Shape) {
+    // Very wide matrix where we want the row statistics. Running calculations would need a fetch for every column,
+    // so it's cheaper to use the direct path even though rows are not the preferred dimension.
+    tatami::DenseColumnMatrix<double, int> wide(5, 100000, std::vector<double>(500000));
+    auto wplan = tatami_stats::choose_by_cost(true, wide, 4, false);
+    EXPECT_FALSE(wplan.running);
+    EXPECT_EQ(wplan.num_threads, 4);
+
+    // Preferred dimension is used when the shape is square.
+    tatami::DenseColumnMatrix<double, int> square(1000, 1000, std::vector<double>(1000000));
+    auto splan = tatami_stats::choose_by_cost(true, square, 4, false);
+    EXPECT_TRUE(splan.running);
+    EXPECT_EQ(splan.num_threads, 4);
+    splan = tatami_stats::choose_by_cost(false, square, 4, false);
+    EXPECT_FALSE(splan.running);
+
+    // Tiny problems use fewer threads, but more are used with an executor as the startup is cheaper.
+    tatami::DenseColumnMatrix<double, int> small(100, 100, std::vector<double>(10000));
+    auto tplan = tatami_stats::choose_by_cost(false, small, 4, false);
+    EXPECT_EQ(tplan.num_threads, 1);
+    auto eplan = tatami_stats::choose_by_cost(false, small, 4, true);
+    EXPECT_GT(eplan.num_threads, 1);
+}
@@ -0,0 +1,301 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+
+#include "tatami_stats/prefetch.hpp"
+#include "tatami_stats/sum.hpp"
+#include "tatami_stats/variance.hpp"
+#include "tatami_stats/median.hpp"
+#include "tatami_stats/range.hpp"
+#include "tatami_stats/group_sum.hpp"
+#include "tatami_stats/group_variance.hpp"
+#include "tatami_stats/blocked_variance.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+class PrefetchTest : public ::testing::TestWithParam<std::tuple<bool, int, tatami_stats::PlanStrategy> > {
+protected:
+    inline static std::size_t NR = 83, NC = 121;
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+
+    static void SetUpTestSuite() {
+        auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.2;
+            opt.seed = 7162534;
+            return opt;
+        }());
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+
+    static std::vector<int> create_groups(std::size_t n) {
+        std::vector<int> groups(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            groups[i] = (i * 7) % 3;
+        }
+        return groups;
+    }
+};
+
+TEST_P(PrefetchTest, Running) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+    const auto strategy = std::get<2>(param);
+    auto groups = create_groups(row ? NC : NR);
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        auto ref_sum = tatami_stats::sum(row, *mat, {});
+        auto ref_var = tatami_stats::variance(row, *mat, {});
+        auto ref_range = tatami_stats::range(row, *mat, {});
+        auto ref_gsum = tatami_stats::group_sum(row, *mat, groups.data(), 3, {});
+        auto ref_gvar = tatami_stats::group_variance(row, *mat, groups.data(), 3, {});
+        auto ref_bvar = tatami_stats::blocked_variance(row, *mat, groups.data(), 3, {});
+
+        for (std::size_t prefetch : { 1, 3, 1000 }) {
+            tatami_stats::SumOptions sopt;
+            sopt.num_threads = nthreads;
+            sopt.strategy = strategy;
+            sopt.prefetch = prefetch;
+            compare_double_vectors(ref_sum, tatami_stats::sum(row, *mat, sopt));
+
+            tatami_stats::VarianceOptions<double> vopt;
+            vopt.num_threads = nthreads;
+            vopt.strategy = strategy;
+            vopt.prefetch = prefetch;
+            auto var = tatami_stats::variance(row, *mat, vopt);
+            compare_double_vectors(ref_var.mean, var.mean);
+            compare_double_vectors(ref_var.variance, var.variance);
+
+            tatami_stats::RangeOptions<double> ropt;
+            ropt.num_threads = nthreads;
+            ropt.strategy = strategy;
+            ropt.prefetch = prefetch;
+            auto range = tatami_stats::range(row, *mat, ropt);
+            EXPECT_EQ(ref_range.minimum, range.minimum);
+            EXPECT_EQ(ref_range.maximum, range.maximum);
+
+            tatami_stats::GroupSumOptions gsopt;
+            gsopt.num_threads = nthreads;
+            gsopt.strategy = strategy;
+            gsopt.prefetch = prefetch;
+            compare_double_vectors_of_vectors(ref_gsum, tatami_stats::group_sum(row, *mat, groups.data(), 3, gsopt));
+
+            tatami_stats::GroupVarianceOptions<double> gvopt;
+            gvopt.num_threads = nthreads;
+            gvopt.strategy = strategy;
+            gvopt.prefetch = prefetch;
+            auto gvar = tatami_stats::group_variance(row, *mat, groups.data(), 3, gvopt);
+            compare_double_vectors_of_vectors(ref_gvar.mean, gvar.mean);
+            compare_double_vectors_of_vectors(ref_gvar.variance, gvar.variance);
+
+            tatami_stats::BlockedVarianceOptions<double> bopt;
+            bopt.num_threads = nthreads;
+            bopt.strategy = strategy;
+            bopt.prefetch = prefetch;
+            auto bvar = tatami_stats::blocked_variance(row, *mat, groups.data(), 3, bopt);
+            compare_double_vectors(ref_bvar.mean, bvar.mean);
+            compare_double_vectors(ref_bvar.variance, bvar.variance);
+        }
+    }
+}
+
+TEST_P(PrefetchTest, Median) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        auto ref = tatami_stats::median(row, *mat, {});
+        for (bool work_stealing : { false, true }) {
+            tatami_stats::MedianOptions opt;
+            opt.num_threads = nthreads;
+            opt.work_stealing = work_stealing;
+            opt.prefetch = 2;
+            compare_double_vectors(ref, tatami_stats::median(row, *mat, opt));
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Prefetch,
+    PrefetchTest,
+    ::testing::Combine(
+        ::testing::Values(true, false), // row or column
+        ::testing::Values(1, 3), // number of threads
+        ::testing::Values(tatami_stats::PlanStrategy::DIRECT, tatami_stats::PlanStrategy::RUNNING)
+    )
+);
+
+// Mock extractors to check the edge cases of the ring buffer.
+struct InternalDenseExtractor {
+    InternalDenseExtractor(int extent, int fail_at) : contents(extent), fail_at(fail_at) {}
+    std::vector<double> contents;
+    int counter = 0;
+    int fail_at;
+
+    const double* fetch(double*) {
+        if (counter == fail_at) {
+            throw std::runtime_error("failed to fetch");
+        }
+        std::fill(contents.begin(), contents.end(), counter);
+        ++counter;
+        return contents.data(); // not the supplied buffer, so it must be copied.
+    }
+};
+
+struct InternalSparseExtractor {
+    std::vector<double> values{ 0 };
+    std::vector<int> indices{ 0 };
+    int counter = 0;
+
+    tatami::SparseRange<double, int> fetch(double*, int*) {
+        values[0] = counter;
+        indices[0] = counter;
+        tatami::SparseRange<double, int> output;
+        output.number = 1;
+        output.value = values.data();
+        output.index = (counter % 2 ? NULL : indices.data());
+        ++counter;
+        return output;
+    }
+};
+
+TEST(PrefetchExtractor, Internal) {
+    for (std::size_t depth : { 0, 1, 2, 5, 100 }) {
+        tatami_stats::PrefetchExtractor<false, double, int, std::unique_ptr<InternalDenseExtractor> > ext(std::make_unique<InternalDenseExtractor>(5, -1), 5, 20, depth);
+        std::vector<double> buffer(5);
+        for (int i = 0; i < 20; ++i) {
+            auto ptr = ext.fetch(buffer.data());
+            EXPECT_EQ(std::vector<double>(ptr, ptr + 5), std::vector<double>(5, i));
+        }
+    }
+
+    for (std::size_t depth : { 0, 1, 3 }) {
+        tatami_stats::PrefetchExtractor<true, double, int, std::unique_ptr<InternalSparseExtractor> > ext(std::make_unique<InternalSparseExtractor>(), 10, 10, depth);
+        std::vector<double> vbuffer(10);
+        std::vector<int> ibuffer(10);
+        for (int i = 0; i < 10; ++i) {
+            auto range = ext.fetch(vbuffer.data(), ibuffer.data());
+            EXPECT_EQ(range.number, 1);
+            EXPECT_EQ(range.value[0], i);
+            if (i % 2 == 0) {
+                EXPECT_EQ(range.index[0], i);
+            } else {
+                EXPECT_TRUE(range.index == NULL);
+            }
+        }
+    }
+}
+
+TEST(PrefetchExtractor, Error) {
+    tatami_stats::PrefetchExtractor<false, double, int, std::unique_ptr<InternalDenseExtractor> > ext(std::make_unique<InternalDenseExtractor>(3, 4), 3, 10, 2);
+    std::vector<double> buffer(3);
+    for (int i = 0; i < 4; ++i) {
+        auto ptr = ext.fetch(buffer.data());
+        EXPECT_EQ(ptr[0], i);
+    }
+    EXPECT_ANY_THROW(ext.fetch(buffer.data()));
+}
+
+TEST(PrefetchExtractor, EarlyExit) {
+    // Destroying the extractor before all vectors have been fetched should not hang.
+    for (int consumed : { 0, 1, 5 }) {
+        tatami_stats::PrefetchExtractor<false, double, int, std::unique_ptr<InternalDenseExtractor> > ext(std::make_unique<InternalDenseExtractor>(3, -1), 3, 1000, 4);
+        std::vector<double> buffer(3);
+        for (int i = 0; i < consumed; ++i) {
+            EXPECT_EQ(ext.fetch(buffer.data())[0], i);
+        }
+    }
+}
+
+TEST(PrefetchExtractor, Executor) {
+    const auto check = [](tatami_stats::Executor* exec, std::size_t depth) -> void {
+        tatami_stats::PrefetchExtractor<false, double, int, std::unique_ptr<InternalDenseExtractor> > ext(std::make_unique<InternalDenseExtractor>(5, -1), 5, 20, depth, exec);
+        std::vector<double> buffer(5);
+        for (int i = 0; i < 20; ++i) {
+            auto ptr = ext.fetch(buffer.data());
+            EXPECT_EQ(std::vector<double>(ptr, ptr + 5), std::vector<double>(5, i));
+        }
+    };
+
+    tatami_stats::ThreadPoolExecutor pool(2);
+    for (std::size_t depth : { 1, 2, 5, 100 }) {
+        check(&pool, depth);
+    }
+
+    // Tasks that run within submit() should not deadlock.
+    tatami_stats::CallbackExecutor immediate([](std::function<void()> task) -> void { task(); });
+    for (std::size_t depth : { 1, 2, 5, 100 }) {
+        check(&immediate, depth);
+    }
+
+    // Tasks that never run before the extractor is destroyed, in which case the caller fetches everything itself.
+    std::vector<std::function<void()> > pending;
+    tatami_stats::CallbackExecutor deferred([&](std::function<void()> task) -> void { pending.push_back(std::move(task)); });
+    for (std::size_t depth : { 1, 2, 5 }) {
+        check(&deferred, depth);
+    }
+    EXPECT_FALSE(pending.empty());
+    for (auto& p : pending) {
+        p(); // stale tasks don't do anything.
+    }
+
+    // Executors that don't support submit() disable prefetching.
+    struct SerialExecutor final : public tatami_stats::Executor {
+        void run(int num_workers, const std::function<void(int)>& fun) override {
+            for (int w = 0; w < num_workers; ++w) {
+                fun(w);
+            }
+        }
+    };
+    SerialExecutor serial;
+    check(&serial, 3);
+}
+
+TEST(PrefetchExtractor, ExecutorError) {
+    tatami_stats::ThreadPoolExecutor pool(1);
+    tatami_stats::PrefetchExtractor<false, double, int, std::unique_ptr<InternalDenseExtractor> > ext(std::make_unique<InternalDenseExtractor>(3, 4), 3, 10, 2, &pool);
+    std::vector<double> buffer(3);
+    for (int i = 0; i < 4; ++i) {
+        auto ptr = ext.fetch(buffer.data());
+        EXPECT_EQ(ptr[0], i);
+    }
+    EXPECT_ANY_THROW(ext.fetch(buffer.data()));
+}
+
+TEST_P(PrefetchTest, Executor) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+    const auto strategy = std::get<2>(param);
+
+    // More threads in the pool than workers, so that some I/O tasks actually run in the pool.
+    tatami_stats::ThreadPoolExecutor pool(nthreads * 2);
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        auto ref_sum = tatami_stats::sum(row, *mat, {});
+        auto ref_var = tatami_stats::variance(row, *mat, {});
+
+        tatami_stats::SumOptions sopt;
+        sopt.num_threads = nthreads;
+        sopt.strategy = strategy;
+        sopt.prefetch = 3;
+        sopt.executor = &pool;
+        compare_double_vectors(ref_sum, tatami_stats::sum(row, *mat, sopt));
+
+        tatami_stats::VarianceOptions<double> vopt;
+        vopt.num_threads = nthreads;
+        vopt.strategy = strategy;
+        vopt.prefetch = 3;
+        vopt.executor = &pool;
+        auto var = tatami_stats::variance(row, *mat, vopt);
+        compare_double_vectors(ref_var.mean, var.mean);
+        compare_double_vectors(ref_var.variance, var.variance);
+    }
+}
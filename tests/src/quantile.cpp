@@ -353,3 +353,45 @@ TEST(Quantile, NewType) {
     EXPECT_EQ(tatami_stats::quantile(false, *sparse_row, 0.5, opt), cexpected);
     EXPECT_EQ(tatami_stats::quantile(false, *sparse_column, 0.5, opt), cexpected);
 }
+
+TEST(Quantile, SparseMostlyZero) {
+    // Checking the shortcut for quantiles among the structural zeros against a reference calculation.
+    std::mt19937_64 rng(918273);
+    for (std::size_t NC : { 24, 25 }) {
+        const std::size_t NR = 150;
+        for (bool with_nan : { false, true }) {
+            const auto vec = simulate_variable_nonzeros(NR, NC, with_nan, rng);
+            tatami::DenseRowMatrix<double, int> dense_row(NR, NC, vec);
+            auto sparse_row = tatami::convert_to_compressed_sparse<double, int>(dense_row, true, {});
+            auto sparse_column = tatami::convert_to_compressed_sparse<double, int>(dense_row, false, {});
+
+            // Same values in column-major order, so that each column of 'tdense' is a row of 'dense_row'.
+            tatami::DenseColumnMatrix<double, int> tdense(NC, NR, vec);
+            auto tsparse_row = tatami::convert_to_compressed_sparse<double, int>(tdense, true, {});
+            auto tsparse_column = tatami::convert_to_compressed_sparse<double, int>(tdense, false, {});
+
+            for (bool skip_nan : { false, true }) {
+                if (with_nan && !skip_nan) {
+                    continue;
+                }
+
+                for (double prob : { 0.0, 0.1, 0.5, 0.77, 1.0 }) {
+                    std::vector<double> expected(NR);
+                    for (std::size_t r = 0; r < NR; ++r) {
+                        expected[r] = reference_quantile(std::vector<double>(vec.begin() + r * NC, vec.begin() + (r + 1) * NC), prob, skip_nan);
+                    }
+
+                    tatami_stats::QuantileOptions qopt;
+                    qopt.skip_nan = skip_nan;
+                    for (int nthreads : { 1, 3 }) {
+                        qopt.num_threads = nthreads;
+                        compare_double_vectors(expected, tatami_stats::quantile(true, *sparse_row, prob, qopt));
+                        compare_double_vectors(expected, tatami_stats::quantile(true, *sparse_column, prob, qopt));
+                        compare_double_vectors(expected, tatami_stats::quantile(false, *tsparse_row, prob, qopt));
+                        compare_double_vectors(expected, tatami_stats::quantile(false, *tsparse_column, prob, qopt));
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include "tatami_stats/reduce.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+struct SumOfSquaresPolicy {
+    double init() const {
+        return 0;
+    }
+
+    void update(double& state, double x) const {
+        state += x * x;
+    }
+
+    void add_zeros(double&, int) const {}
+
+    void merge(double& left, const double& right) const {
+        left += right;
+    }
+
+    double finalize(const double& state, int) const {
+        return state;
+    }
+};
+
+// Using a state with multiple members, a non-trivial contribution from the zeros and a finalization step.
+struct LogSumExpPolicy {
+    struct State {
+        double max;
+        double sum;
+    };
+
+    State init() const {
+        return State{ -std::numeric_limits<double>::infinity(), 0 };
+    }
+
+    static void add(State& state, double x, double weight) {
+        if (x > state.max) {
+            state.sum = state.sum * std::exp(state.max - x) + weight;
+            state.max = x;
+        } else {
+            state.sum += weight * std::exp(x - state.max);
+        }
+    }
+
+    void update(State& state, double x) const {
+        add(state, x, 1);
+    }
+
+    void add_zeros(State& state, int k) const {
+        add(state, 0, k);
+    }
+
+    void merge(State& left, const State& right) const {
+        if (right.sum > 0) {
+            add(left, right.max, right.sum);
+        }
+    }
+
+    double finalize(const State& state, int) const {
+        return state.max + std::log(state.sum);
+    }
+};
+
+// Using the number of values in the finalization.
+struct NegativeProportionPolicy {
+    int init() const {
+        return 0;
+    }
+
+    void update(int& state, double x) const {
+        state += (x < 0);
+    }
+
+    void add_zeros(int&, int) const {}
+
+    void merge(int& left, const int& right) const {
+        left += right;
+    }
+
+    double finalize(const int& state, int n) const {
+        return static_cast<double>(state) / n;
+    }
+};
+
+class ReduceTest : public ::testing::TestWithParam<std::tuple<bool, int, tatami_stats::PlanStrategy> > {
+protected:
+    inline static std::size_t NR = 77, NC = 139;
+    inline static std::vector<double> simulated;
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+
+    static void SetUpTestSuite() {
+        simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.15;
+            opt.lower = -3;
+            opt.upper = 2;
+            opt.seed = 29837465;
+            return opt;
+        }());
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, simulated));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+
+    // Naive reference that calls update() on every value, including the zeros.
+    template<class Policy_>
+    static std::vector<double> reference(bool row, const Policy_& policy) {
+        const std::size_t dim = (row ? NR : NC), otherdim = (row ? NC : NR);
+        std::vector<double> output(dim);
+        for (std::size_t d = 0; d < dim; ++d) {
+            auto state = policy.init();
+            for (std::size_t o = 0; o < otherdim; ++o) {
+                policy.update(state, row ? simulated[d * NC + o] : simulated[o * NC + d]);
+            }
+            output[d] = policy.finalize(state, otherdim);
+        }
+        return output;
+    }
+};
+
+TEST_P(ReduceTest, Policies) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    tatami_stats::ReduceOptions opt;
+    opt.num_threads = std::get<1>(param);
+    opt.strategy = std::get<2>(param);
+
+    {
+        SumOfSquaresPolicy policy;
+        auto expected = reference(row, policy);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare_double_vectors(expected, tatami_stats::reduce(row, *mat, policy, opt));
+        }
+    }
+
+    {
+        LogSumExpPolicy policy;
+        auto expected = reference(row, policy);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare_double_vectors(expected, tatami_stats::reduce(row, *mat, policy, opt));
+        }
+    }
+
+    {
+        NegativeProportionPolicy policy;
+        auto expected = reference(row, policy);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare_double_vectors(expected, tatami_stats::reduce(row, *mat, policy, opt));
+        }
+    }
+}
+
+TEST_P(ReduceTest, Workspace) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    tatami_stats::Workspace work;
+    tatami_stats::ReduceOptions opt;
+    opt.num_threads = std::get<1>(param);
+    opt.strategy = std::get<2>(param);
+    opt.workspace = &work;
+
+    LogSumExpPolicy policy;
+    auto expected = reference(row, policy);
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        std::vector<double> output(row ? NR : NC);
+        tatami_stats::reduce(row, *mat, output.data(), policy, opt);
+        compare_double_vectors(expected, output);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Reduce,
+    ReduceTest,
+    ::testing::Combine(
+        ::testing::Values(true, false), // row or column
+        ::testing::Values(1, 3), // number of threads
+        ::testing::Values(tatami_stats::PlanStrategy::DIRECT, tatami_stats::PlanStrategy::RUNNING)
+    )
+);
+
+TEST(Reduce, Empty) {
+    tatami::DenseRowMatrix<double, int> empty(5, 0, std::vector<double>());
+    tatami_stats::ReduceOptions opt;
+    for (auto strategy : { tatami_stats::PlanStrategy::DIRECT, tatami_stats::PlanStrategy::RUNNING }) {
+        opt.strategy = strategy;
+        EXPECT_EQ(tatami_stats::reduce(true, empty, SumOfSquaresPolicy(), opt), std::vector<double>(5));
+        EXPECT_TRUE(tatami_stats::reduce(false, empty, SumOfSquaresPolicy(), opt).empty());
+    }
+}
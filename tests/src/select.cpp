@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+#include "tatami_stats/select.hpp"
+#include "tatami_stats/median.hpp"
+#include "tatami_stats/quantile.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+class ParallelSelectTest : public ::testing::TestWithParam<std::tuple<int, std::size_t> > {};
+
+TEST_P(ParallelSelectTest, Basic) {
+    auto param = GetParam();
+    const int nthreads = std::get<0>(param);
+    const std::size_t sample_size = std::get<1>(param);
+    tatami_stats::ThreadPoolExecutor pool(nthreads);
+
+    for (std::size_t n : { 1, 2, 11, 1000, 54321 }) {
+        auto simulated = tatami_test::simulate_vector<double>(n, [&]{
+            tatami_test::SimulateVectorOptions opt;
+            opt.seed = 1234 + n;
+            return opt;
+        }());
+
+        // Also checking that ties and sorted inputs are handled correctly.
+        auto tied = simulated;
+        for (auto& x : tied) {
+            x = std::round(x * 2);
+        }
+        auto sorted = simulated;
+        std::sort(sorted.begin(), sorted.end());
+
+        for (const auto& values : { simulated, tied, sorted }) {
+            for (double prob : { 0.0, 0.01, 0.3, 0.5, 0.77, 1.0 }) {
+                const double expected = reference_quantile(values, prob, false);
+                auto copy = values;
+                EXPECT_FLOAT_EQ(tatami_stats::parallel_select_quantile<double>(copy.data(), n, 0, prob, nthreads, NULL, sample_size), expected);
+                copy = values;
+                EXPECT_FLOAT_EQ(tatami_stats::parallel_select_quantile<double>(copy.data(), n, 0, prob, nthreads, &pool, sample_size), expected);
+            }
+        }
+    }
+
+    EXPECT_TRUE(std::isnan(tatami_stats::parallel_select_quantile<double>(static_cast<double*>(NULL), 0, 0, 0.5, nthreads, NULL, sample_size)));
+}
+
+TEST_P(ParallelSelectTest, ImplicitZeros) {
+    auto param = GetParam();
+    const int nthreads = std::get<0>(param);
+    const std::size_t sample_size = std::get<1>(param);
+    tatami_stats::ThreadPoolExecutor pool(nthreads);
+
+    for (std::size_t n : { 0, 1, 11, 1000, 54321 }) {
+        auto simulated = tatami_test::simulate_vector<double>(n, [&]{
+            tatami_test::SimulateVectorOptions opt;
+            opt.seed = 4321 + n;
+            return opt;
+        }());
+
+        // Zeros may lie below, within or above the non-zero values.
+        auto positive = simulated;
+        for (auto& x : positive) {
+            x = std::abs(x) + 1;
+        }
+        auto negative = positive;
+        for (auto& x : negative) {
+            x = -x;
+        }
+
+        for (std::size_t num_zeros : { static_cast<std::size_t>(1), n / 3 + 1, 2 * n + 1 }) {
+            for (const auto& values : { simulated, positive, negative }) {
+                auto full = values;
+                full.resize(n + num_zeros);
+                for (double prob : { 0.0, 0.01, 0.3, 0.5, 0.77, 1.0 }) {
+                    const double expected = reference_quantile(full, prob, false);
+                    auto copy = values;
+                    EXPECT_FLOAT_EQ(tatami_stats::parallel_select_quantile<double>(copy.data(), n, num_zeros, prob, nthreads, NULL, sample_size), expected);
+                    copy = values;
+                    EXPECT_FLOAT_EQ(tatami_stats::parallel_select_quantile<double>(copy.data(), n, num_zeros, prob, nthreads, &pool, sample_size), expected);
+                }
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ParallelSelect,
+    ParallelSelectTest,
+    ::testing::Combine(
+        ::testing::Values(1, 3, 8), // number of threads
+        ::testing::Values(tatami_stats::PARALLEL_SELECT_SAMPLE_SIZE, 100, 5) // sample size, where small samples are more likely to miss the target.
+    )
+);
+
+TEST(ParallelSelect, Misses) {
+    // Constructing a vector where the regularly spaced sample is not representative, so the pivots do not bracket the target.
+    std::vector<double> values(1000, 1);
+    for (std::size_t i = 0; i < values.size(); i += 10) {
+        values[i] = 0;
+    }
+    const double expected = reference_quantile(values, 0.5, false);
+    EXPECT_EQ(expected, 1);
+    EXPECT_EQ(tatami_stats::parallel_select_quantile<double>(values.data(), values.size(), 0, 0.5, 4, NULL, 100), expected);
+}
+
+// Tall and skinny matrix with long columns, so that the parallel selection is used.
+class ParallelSelectMatrixTest : public ::testing::TestWithParam<bool> {
+protected:
+    inline static std::size_t NR = tatami_stats::PARALLEL_SELECT_MIN_SIZE + 17, NC = 2;
+    inline static std::shared_ptr<tatami::NumericMatrix> dense, sparse, nan_dense, nan_sparse;
+
+    static void SetUpTestSuite() {
+        auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.3;
+            opt.seed = 81726354;
+            return opt;
+        }());
+        dense.reset(new tatami::DenseColumnMatrix<double, int>(NR, NC, simulated));
+        sparse = tatami::convert_to_compressed_sparse<double, int>(*dense, false, {});
+
+        for (std::size_t i = 0; i < simulated.size(); i += 7) {
+            simulated[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+        nan_dense.reset(new tatami::DenseColumnMatrix<double, int>(NR, NC, std::move(simulated)));
+        nan_sparse = tatami::convert_to_compressed_sparse<double, int>(*nan_dense, false, {});
+    }
+};
+
+TEST_P(ParallelSelectMatrixTest, Basic) {
+    const bool use_executor = GetParam();
+    tatami_stats::ThreadPoolExecutor pool(4);
+
+    for (auto mat : { dense.get(), sparse.get() }) {
+        auto ref_med = tatami_stats::median(false, *mat, {});
+        tatami_stats::MedianOptions mopt;
+        mopt.num_threads = 4;
+        mopt.executor = (use_executor ? &pool : NULL);
+        compare_double_vectors(ref_med, tatami_stats::median(false, *mat, mopt));
+
+        auto ref_quant = tatami_stats::quantile(false, *mat, 0.8, {});
+        tatami_stats::QuantileOptions qopt;
+        qopt.num_threads = 4;
+        qopt.executor = (use_executor ? &pool : NULL);
+        compare_double_vectors(ref_quant, tatami_stats::quantile(false, *mat, 0.8, qopt));
+    }
+
+    for (auto mat : { nan_dense.get(), nan_sparse.get() }) {
+        tatami_stats::MedianOptions mopt;
+        mopt.skip_nan = true;
+        auto ref_med = tatami_stats::median(false, *mat, mopt);
+        mopt.num_threads = 4;
+        mopt.executor = (use_executor ? &pool : NULL);
+        compare_double_vectors(ref_med, tatami_stats::median(false, *mat, mopt));
+
+        tatami_stats::QuantileOptions qopt;
+        qopt.skip_nan = true;
+        auto ref_quant = tatami_stats::quantile(false, *mat, 0.1, qopt);
+        qopt.num_threads = 4;
+        qopt.executor = (use_executor ? &pool : NULL);
+        compare_double_vectors(ref_quant, tatami_stats::quantile(false, *mat, 0.1, qopt));
+    }
+}
+
+TEST_P(ParallelSelectMatrixTest, Error) {
+    tatami_stats::QuantileOptions qopt;
+    qopt.num_threads = 4;
+    EXPECT_ANY_THROW(tatami_stats::quantile(false, *dense, 1.5, qopt));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ParallelSelect,
+    ParallelSelectMatrixTest,
+    ::testing::Values(false, true) // whether to use an executor.
+);
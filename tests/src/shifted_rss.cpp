@@ -0,0 +1,239 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <tuple>
+#include <cmath>
+
+#include "tatami_stats/shifted_rss.hpp"
+#include "tatami_stats/rss.hpp"
+#include "tatami_stats/skip_nan/rss.hpp"
+#include "tatami_stats/group_rss.hpp"
+#include "tatami_stats/variance.hpp"
+#include "tatami_stats/group_variance.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+TEST(ShiftedRss, Fold) {
+    std::vector<double> values { 5.5, 2.1, 8.2, 3.3, 4.4, 9.0, 1.2 };
+    double mean = values[0], rss = 0, sum = 0, sum_squares = 0;
+    std::size_t folded = 0;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        const double delta = values[i] - mean;
+        sum += delta;
+        sum_squares += delta * delta;
+        if (i == 2 || i + 1 == values.size()) { // folding at uneven intervals.
+            tatami_stats::shifted_rss_fold<double>(mean, rss, sum, sum_squares, folded, i + 1 - folded);
+            EXPECT_EQ(sum, 0);
+            EXPECT_EQ(sum_squares, 0);
+            folded = i + 1;
+        }
+    }
+
+    double ref_mean = 0, ref_rss = 0;
+    for (auto v : values) {
+        ref_mean += v;
+    }
+    ref_mean /= values.size();
+    for (auto v : values) {
+        ref_rss += (v - ref_mean) * (v - ref_mean);
+    }
+    EXPECT_FLOAT_EQ(mean, ref_mean);
+    EXPECT_FLOAT_EQ(rss, ref_rss);
+
+    // Structural zeros are added implicitly.
+    mean = 2;
+    rss = 0;
+    sum = (2 - 2) + (6 - 2);
+    sum_squares = 16;
+    tatami_stats::shifted_rss_fold_with_zeros<double>(mean, rss, sum, sum_squares, 0, 4, 2); // i.e., 2, 6, 0, 0.
+    EXPECT_FLOAT_EQ(mean, 2);
+    EXPECT_FLOAT_EQ(rss, 0 + 16 + 4 + 4);
+}
+
+class ShiftedRssTest : public ::testing::TestWithParam<std::tuple<bool, int, bool> > {
+protected:
+    // Enough vectors along the other dimension to span several blocks.
+    inline static std::size_t NR = 57, NC = 301;
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+    inline static std::shared_ptr<tatami::NumericMatrix> nan_dense_row, nan_dense_column, nan_sparse_row, nan_sparse_column;
+
+    static void SetUpTestSuite() {
+        auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.3;
+            opt.lower = 100;
+            opt.upper = 105;
+            opt.seed = 17263544;
+            return opt;
+        }());
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, simulated));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+
+        for (std::size_t i = 0; i < simulated.size(); i += 11) {
+            simulated[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+        nan_dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+        nan_dense_column = tatami::convert_to_dense<double, int>(*nan_dense_row, false, {});
+        nan_sparse_row = tatami::convert_to_compressed_sparse<double, int>(*nan_dense_row, true, {});
+        nan_sparse_column = tatami::convert_to_compressed_sparse<double, int>(*nan_dense_row, false, {});
+    }
+
+    static std::vector<int> create_groups(std::size_t n) {
+        std::vector<int> groups(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            groups[i] = (i * 7) % 3;
+        }
+        return groups;
+    }
+};
+
+TEST_P(ShiftedRssTest, Basic) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+    const bool deterministic = std::get<2>(param);
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        tatami_stats::RssOptions<double> ropt;
+        ropt.strategy = tatami_stats::PlanStrategy::RUNNING;
+        auto ref = tatami_stats::rss(row, *mat, ropt);
+        ropt.num_threads = nthreads;
+        ropt.deterministic = deterministic;
+        ropt.shifted_sums = true;
+        auto shifted = tatami_stats::rss(row, *mat, ropt);
+        compare_double_vectors(ref.mean, shifted.mean);
+        compare_double_vectors(ref.rss, shifted.rss);
+
+        tatami_stats::VarianceOptions<double> vopt;
+        vopt.strategy = tatami_stats::PlanStrategy::RUNNING;
+        auto ref_var = tatami_stats::variance(row, *mat, vopt);
+        vopt.num_threads = nthreads;
+        vopt.deterministic = deterministic;
+        vopt.shifted_sums = true;
+        auto var = tatami_stats::variance(row, *mat, vopt);
+        compare_double_vectors(ref_var.mean, var.mean);
+        compare_double_vectors(ref_var.variance, var.variance);
+
+        auto groups = create_groups(row ? NC : NR);
+        tatami_stats::GroupVarianceOptions<double> gopt;
+        gopt.strategy = tatami_stats::PlanStrategy::RUNNING;
+        auto ref_gvar = tatami_stats::group_variance(row, *mat, groups.data(), 3, gopt);
+        gopt.num_threads = nthreads;
+        gopt.deterministic = deterministic;
+        gopt.shifted_sums = true;
+        auto gvar = tatami_stats::group_variance(row, *mat, groups.data(), 3, gopt);
+        compare_double_vectors_of_vectors(ref_gvar.mean, gvar.mean);
+        compare_double_vectors_of_vectors(ref_gvar.variance, gvar.variance);
+    }
+}
+
+TEST_P(ShiftedRssTest, SkipNan) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+    const bool deterministic = std::get<2>(param);
+
+    for (auto mat : { nan_dense_row.get(), nan_dense_column.get(), nan_sparse_row.get(), nan_sparse_column.get() }) {
+        tatami_stats::skip_nan::RssOptions<double> ropt;
+        ropt.strategy = tatami_stats::PlanStrategy::RUNNING;
+        auto ref = tatami_stats::skip_nan::rss<double, int>(row, *mat, ropt);
+        ropt.num_threads = nthreads;
+        ropt.deterministic = deterministic;
+        ropt.shifted_sums = true;
+        auto shifted = tatami_stats::skip_nan::rss<double, int>(row, *mat, ropt);
+        compare_double_vectors(ref.mean, shifted.mean);
+        compare_double_vectors(ref.rss, shifted.rss);
+        EXPECT_EQ(ref.count, shifted.count);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ShiftedRss,
+    ShiftedRssTest,
+    ::testing::Combine(
+        ::testing::Values(true, false), // row or column
+        ::testing::Values(1, 3), // number of threads
+        ::testing::Values(false, true) // deterministic
+    )
+);
+
+TEST(ShiftedRss, Accuracy) {
+    // Large offset with a small spread, which is problematic for the naive sum-of-squares formula.
+    // The first row also has a trend, to check that the error is still reasonable when the mean drifts.
+    std::size_t NR = 5, NC = 10000;
+    std::vector<double> values(NR * NC);
+    for (std::size_t r = 0; r < NR; ++r) {
+        for (std::size_t c = 0; c < NC; ++c) {
+            values[r * NC + c] = 1e8 + static_cast<double>((c * 7919) % NC) / NC + (r == 0 ? static_cast<double>(c) / NC : 0);
+        }
+    }
+    tatami::DenseColumnMatrix<double, int> mat(NR, NC, [&]{
+        std::vector<double> transposed(NR * NC);
+        for (std::size_t r = 0; r < NR; ++r) {
+            for (std::size_t c = 0; c < NC; ++c) {
+                transposed[c * NR + r] = values[r * NC + c];
+            }
+        }
+        return transposed;
+    }());
+
+    tatami_stats::RssOptions<double> ropt;
+    ropt.strategy = tatami_stats::PlanStrategy::RUNNING;
+    ropt.shifted_sums = true;
+    auto shifted = tatami_stats::rss(true, mat, ropt);
+
+    for (std::size_t r = 0; r < NR; ++r) {
+        long double mean = 0;
+        for (std::size_t c = 0; c < NC; ++c) {
+            mean += values[r * NC + c];
+        }
+        mean /= NC;
+        long double rss = 0;
+        for (std::size_t c = 0; c < NC; ++c) {
+            const long double delta = values[r * NC + c] - mean;
+            rss += delta * delta;
+        }
+        EXPECT_LT(std::abs(shifted.mean[r] - static_cast<double>(mean)), 1e-6);
+        EXPECT_LT(std::abs(shifted.rss[r] / static_cast<double>(rss) - 1), 1e-6);
+    }
+}
+
+TEST(ShiftedRss, SparseAccuracy) {
+    // Same as above, but the first column is all-NaN so that none of the first extracted values can be used as the shift.
+    // This checks that the shift is taken from the first non-zero, non-NaN value of each row in the sparse path.
+    std::size_t NR = 5, NC = 10000;
+    std::vector<double> values(NR * NC);
+    for (std::size_t r = 0; r < NR; ++r) {
+        values[r * NC] = std::numeric_limits<double>::quiet_NaN();
+        for (std::size_t c = 1; c < NC; ++c) {
+            values[r * NC + c] = 1e8 + static_cast<double>((c * 7919) % NC) / NC;
+        }
+    }
+    tatami::DenseRowMatrix<double, int> dense(NR, NC, values);
+    auto sparse = tatami::convert_to_compressed_sparse<double, int>(dense, false, {});
+
+    tatami_stats::skip_nan::RssOptions<double> ropt;
+    ropt.strategy = tatami_stats::PlanStrategy::RUNNING;
+    ropt.shifted_sums = true;
+    auto shifted = tatami_stats::skip_nan::rss<double, int>(true, *sparse, ropt);
+
+    for (std::size_t r = 0; r < NR; ++r) {
+        long double mean = 0;
+        for (std::size_t c = 1; c < NC; ++c) {
+            mean += values[r * NC + c];
+        }
+        mean /= NC - 1;
+        long double rss = 0;
+        for (std::size_t c = 1; c < NC; ++c) {
+            const long double delta = values[r * NC + c] - mean;
+            rss += delta * delta;
+        }
+        EXPECT_EQ(shifted.count[r], static_cast<int>(NC - 1));
+        EXPECT_LT(std::abs(shifted.mean[r] - static_cast<double>(mean)), 1e-6);
+        EXPECT_LT(std::abs(shifted.rss[r] / static_cast<double>(rss) - 1), 1e-6);
+    }
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <limits>
+
+#include "tatami_stats/skip_nan/group_range.hpp"
+#include "tatami_stats/skip_nan/range.hpp"
+#include "tatami_test/tatami_test.hpp"
+
+#include "utils.h"
+
+class SkipNanGroupRangeTest : public ::testing::TestWithParam<std::tuple<std::pair<double, double>, SkipNanSimulationType, bool, int> > {
+protected:
+    static std::vector<int> generate_groups(const bool interleaved, const int num_groups, const std::size_t length) {
+        std::vector<int> groups(length);
+        if (interleaved) {
+            for (std::size_t i = 0; i < length; ++i) {
+                groups[i] = i % num_groups;
+            }
+        } else {
+            for (std::size_t i = 0; i < length; ++i) {
+                groups[i] = (i * num_groups) / length;
+            }
+        }
+        return groups;
+    }
+
+    static tatami_stats::skip_nan::GroupRangeResult<double, int> reference(
+        bool row,
+        const std::shared_ptr<tatami::NumericMatrix>& mat,
+        const std::vector<int>& groups,
+        int num_groups
+    ) {
+        std::vector<std::vector<int> > subsets(num_groups);
+        for (std::size_t i = 0; i < groups.size(); ++i) {
+            subsets[groups[i]].push_back(i);
+        }
+
+        tatami_stats::skip_nan::GroupRangeResult<double, int> expected;
+        expected.minimum.resize(num_groups);
+        expected.maximum.resize(num_groups);
+        expected.count.resize(num_groups);
+        const std::size_t dim = (row ? mat->nrow() : mat->ncol());
+        for (int g = 0; g < num_groups; ++g) {
+            if (subsets[g].empty()) {
+                expected.minimum[g].resize(dim, std::numeric_limits<double>::infinity());
+                expected.maximum[g].resize(dim, -std::numeric_limits<double>::infinity());
+                expected.count[g].resize(dim);
+                continue;
+            }
+
+            std::shared_ptr<tatami::NumericMatrix> sub;
+            if (row) {
+                sub = tatami::make_DelayedSubset<1>(mat, subsets[g]);
+            } else {
+                sub = tatami::make_DelayedSubset<0>(mat, subsets[g]);
+            }
+            auto res = tatami_stats::skip_nan::range(row, *sub, {});
+            expected.minimum[g] = std::move(res.minimum);
+            expected.maximum[g] = std::move(res.maximum);
+            expected.count[g] = std::move(res.count);
+        }
+
+        return expected;
+    }
+};
+
+TEST_P(SkipNanGroupRangeTest, Basic) {
+    auto param = GetParam();
+    auto limits = std::get<0>(param);
+    auto nan_type = std::get<1>(param);
+    const bool interleaved = std::get<2>(param);
+    const int nthreads = std::get<3>(param);
+
+    std::size_t NR = 71, NC = 113;
+    unsigned long long seed = 2837461 + limits.first * 1000 + limits.second * 100 + static_cast<int>(nan_type) * 10 + interleaved;
+    auto simulated = tatami_test::simulate_vector<double>(NR * NC, [&]{
+        tatami_test::SimulateVectorOptions opt;
+        opt.density = 0.2;
+        opt.lower = limits.first;
+        opt.upper = limits.second;
+        opt.seed = seed;
+        return opt;
+    }());
+    inject_nans_by_row(simulated, NR, NC, nan_type, seed + 13);
+
+    auto dense_row = std::shared_ptr<tatami::NumericMatrix>(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+    auto dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+    auto sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+    auto sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+
+    tatami_stats::skip_nan::GroupRangeOptions opt;
+    opt.num_threads = nthreads;
+
+    // Adding an extra empty group to check that the placeholders are used.
+    const int ngroup = 4;
+    for (int r = 0; r < 2; ++r) {
+        const bool row = (r == 0);
+        auto groups = generate_groups(interleaved, ngroup, row ? NC : NR);
+        auto expected = reference(row, dense_row, groups, ngroup + 1);
+
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            auto res = tatami_stats::skip_nan::group_range(row, *mat, groups.data(), ngroup + 1, opt);
+            EXPECT_EQ(expected.minimum, res.minimum);
+            EXPECT_EQ(expected.maximum, res.maximum);
+            EXPECT_EQ(expected.count, res.count);
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    SkipNanGroupRange,
+    SkipNanGroupRangeTest,
+    ::testing::Combine(
+        ::testing::Values(
+            std::make_pair(0.1, 1.0), // all positive
+            std::make_pair(-2.0, -1.0), // all negative
+            std::make_pair(-1.0, 1.0) // mixed
+        ),
+        ::testing::Values(NONE, RANDOM, BLOCK),
+        ::testing::Values(false, true), // interleaved groups
+        ::testing::Values(1, 3) // number of threads
+    )
+);
+
+TEST(SkipNanGroupRange, AllNan) {
+    std::size_t NR = 20, NC = 30;
+    std::vector<double> simulated(NR * NC, std::numeric_limits<double>::quiet_NaN());
+    auto dense_row = std::shared_ptr<tatami::NumericMatrix>(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+    auto sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+
+    std::vector<int> groups(NC);
+    for (std::size_t c = 0; c < NC; ++c) {
+        groups[c] = c % 3;
+    }
+
+    tatami_stats::skip_nan::GroupRangeOptions opt;
+    opt.minimum_placeholder = 100;
+    opt.maximum_placeholder = -100;
+    for (auto mat : { dense_row.get(), sparse_column.get() }) {
+        for (int nthreads = 1; nthreads <= 3; nthreads += 2) {
+            opt.num_threads = nthreads;
+            auto res = tatami_stats::skip_nan::group_range(true, *mat, groups.data(), 3, opt);
+            for (int g = 0; g < 3; ++g) {
+                EXPECT_EQ(res.minimum[g], std::vector<double>(NR, 100));
+                EXPECT_EQ(res.maximum[g], std::vector<double>(NR, -100));
+                EXPECT_EQ(res.count[g], std::vector<int>(NR));
+            }
+        }
+    }
+}
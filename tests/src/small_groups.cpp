@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+
+#include "tatami_stats/small_groups.hpp"
+#include "tatami_stats/group_sum.hpp"
+#include "tatami_stats/group_rss.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+TEST(SmallGroups, Dispatch) {
+    for (std::size_t n = 1; n <= tatami_stats::SMALL_GROUPS_MAX; ++n) {
+        std::size_t observed = 0;
+        EXPECT_TRUE(tatami_stats::dispatch_small_groups(n, [&](auto ngroups) -> void {
+            observed = decltype(ngroups)::value;
+        }));
+        EXPECT_EQ(observed, n);
+    }
+
+    bool called = false;
+    EXPECT_FALSE(tatami_stats::dispatch_small_groups(tatami_stats::SMALL_GROUPS_MAX + 1, [&](auto) -> void { called = true; }));
+    EXPECT_FALSE(tatami_stats::dispatch_small_groups(0, [&](auto) -> void { called = true; }));
+    EXPECT_FALSE(called);
+}
+
+TEST(SmallGroups, Kernels) {
+    std::vector<double> values { 1.5, std::numeric_limits<double>::quiet_NaN(), -2, 4, 0.5, 3 };
+    std::vector<int> groups { 0, 2, 1, 0, 2, 2 };
+    const auto get_group = [&](int j) -> std::size_t { return groups[j]; };
+
+    std::array<double, 3> sums{};
+    tatami_stats::small_group_sums(sums, values.data(), static_cast<int>(values.size()), get_group, true);
+    EXPECT_EQ(sums[0], 5.5);
+    EXPECT_EQ(sums[1], -2);
+    EXPECT_EQ(sums[2], 3.5);
+
+    // NaNs only affect their own group if they are not skipped.
+    sums.fill(0);
+    tatami_stats::small_group_sums(sums, values.data(), static_cast<int>(values.size()), get_group, false);
+    EXPECT_EQ(sums[0], 5.5);
+    EXPECT_EQ(sums[1], -2);
+    EXPECT_TRUE(std::isnan(sums[2]));
+
+    std::array<int, 3> counts{};
+    tatami_stats::small_group_counts(counts, static_cast<int>(values.size()), get_group);
+    EXPECT_EQ(counts[0], 2);
+    EXPECT_EQ(counts[1], 1);
+    EXPECT_EQ(counts[2], 3);
+
+    std::array<double, 2> rss{};
+    std::array<double, 2> means { 2.75, -2 };
+    tatami_stats::small_group_squared_deviations(rss, means, values.data(), 4, [&](int j) -> std::size_t { return (j == 1 ? 1 : groups[j]); });
+    EXPECT_FLOAT_EQ(rss[0], 1.25 * 1.25 * 2);
+    EXPECT_TRUE(std::isnan(rss[1]));
+}
+
+TEST(SmallGroups, Mask) {
+    // Masked values must be exactly zero, even for non-finite inputs.
+    EXPECT_EQ(tatami_stats::small_group_mask(true, 2.5), 2.5);
+    EXPECT_EQ(tatami_stats::small_group_mask(false, 2.5), 0);
+    EXPECT_EQ(tatami_stats::small_group_mask(false, std::numeric_limits<double>::quiet_NaN()), 0);
+    EXPECT_EQ(tatami_stats::small_group_mask(false, -std::numeric_limits<double>::infinity()), 0);
+    EXPECT_TRUE(std::isnan(tatami_stats::small_group_mask(true, std::numeric_limits<double>::quiet_NaN())));
+    EXPECT_EQ(tatami_stats::small_group_mask(true, 1.5f), 1.5f);
+    EXPECT_EQ(tatami_stats::small_group_mask(false, std::numeric_limits<float>::infinity()), 0);
+    EXPECT_EQ(tatami_stats::small_group_mask(true, 7), 7);
+    EXPECT_EQ(tatami_stats::small_group_mask(false, 7), 0);
+}
+
+class SmallGroupsTest : public ::testing::TestWithParam<std::tuple<bool, int> > {
+protected:
+    inline static std::size_t NR = 67, NC = 143;
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+    inline static std::shared_ptr<tatami::NumericMatrix> nan_dense_row, nan_sparse_column;
+
+    static void SetUpTestSuite() {
+        auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.2;
+            opt.seed = 3344556;
+            return opt;
+        }());
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, simulated));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+
+        for (std::size_t i = 0; i < simulated.size(); i += 7) {
+            simulated[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+        nan_dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+        nan_sparse_column = tatami::convert_to_compressed_sparse<double, int>(*nan_dense_row, false, {});
+    }
+
+    // The last group is empty if there is more than one group.
+    static std::vector<int> create_groups(std::size_t n, std::size_t num_groups) {
+        std::vector<int> groups(n);
+        const std::size_t used = (num_groups > 1 ? num_groups - 1 : 1);
+        for (std::size_t i = 0; i < n; ++i) {
+            groups[i] = (i * 7) % used;
+        }
+        return groups;
+    }
+};
+
+TEST_P(SmallGroupsTest, Sum) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+
+    // Going past SMALL_GROUPS_MAX to check the generic kernel as well.
+    for (std::size_t num_groups = 1; num_groups <= tatami_stats::SMALL_GROUPS_MAX + 1; ++num_groups) {
+        auto groups = create_groups(row ? NC : NR, num_groups);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            tatami_stats::GroupSumOptions opt;
+            opt.strategy = tatami_stats::PlanStrategy::RUNNING;
+            auto ref = tatami_stats::group_sum(row, *mat, groups.data(), num_groups, opt);
+            opt.strategy = tatami_stats::PlanStrategy::DIRECT;
+            opt.num_threads = nthreads;
+            compare_double_vectors_of_vectors(ref, tatami_stats::group_sum(row, *mat, groups.data(), num_groups, opt));
+        }
+
+        for (auto mat : { nan_dense_row.get(), nan_sparse_column.get() }) {
+            tatami_stats::GroupSumOptions opt;
+            opt.skip_nan = true;
+            opt.strategy = tatami_stats::PlanStrategy::RUNNING;
+            auto ref = tatami_stats::group_sum(row, *mat, groups.data(), num_groups, opt);
+            opt.strategy = tatami_stats::PlanStrategy::DIRECT;
+            opt.num_threads = nthreads;
+            compare_double_vectors_of_vectors(ref, tatami_stats::group_sum(row, *mat, groups.data(), num_groups, opt));
+        }
+    }
+}
+
+TEST_P(SmallGroupsTest, Rss) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+
+    for (std::size_t num_groups = 1; num_groups <= tatami_stats::SMALL_GROUPS_MAX + 1; ++num_groups) {
+        auto groups = create_groups(row ? NC : NR, num_groups);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            tatami_stats::GroupRssOptions<double> opt;
+            opt.strategy = tatami_stats::PlanStrategy::RUNNING;
+            opt.mean_placeholder = 0;
+            auto ref = tatami_stats::group_rss<double>(row, *mat, groups.data(), num_groups, opt);
+            opt.strategy = tatami_stats::PlanStrategy::DIRECT;
+            opt.num_threads = nthreads;
+            auto direct = tatami_stats::group_rss<double>(row, *mat, groups.data(), num_groups, opt);
+            compare_double_vectors_of_vectors(ref.mean, direct.mean);
+            compare_double_vectors_of_vectors(ref.rss, direct.rss);
+
+            auto interleaved = tatami_stats::group_rss_interleaved<double>(row, *mat, groups.data(), num_groups, opt);
+            for (std::size_t g = 0; g < num_groups; ++g) {
+                for (std::size_t d = 0, end = ref.mean[g].size(); d < end; ++d) {
+                    EXPECT_FLOAT_EQ(ref.mean[g][d], interleaved.mean[d * num_groups + g]);
+                    EXPECT_FLOAT_EQ(ref.rss[g][d], interleaved.rss[d * num_groups + g]);
+                }
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    SmallGroups,
+    SmallGroupsTest,
+    ::testing::Combine(
+        ::testing::Values(true, false), // row or column
+        ::testing::Values(1, 3) // number of threads
+    )
+);
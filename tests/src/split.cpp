@@ -0,0 +1,278 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <tuple>
+#include <algorithm>
+#include <cmath>
+
+#include "tatami_stats/partition.hpp"
+#include "tatami_stats/sum.hpp"
+#include "tatami_stats/variance.hpp"
+#include "tatami_stats/range.hpp"
+#include "tatami_stats/count.hpp"
+#include "tatami_stats/skip_nan/range.hpp"
+#include "tatami_stats/skip_nan/rss.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+TEST(SplitBoundaries, Basic) {
+    // No splitting if there are enough vectors in the target dimension, or only one thread.
+    EXPECT_TRUE(tatami_stats::split_boundaries<int>(8, 100000, 8).empty());
+    EXPECT_TRUE(tatami_stats::split_boundaries<int>(3, 100000, 1).empty());
+
+    // No splitting if the blocks would be too small.
+    EXPECT_TRUE(tatami_stats::split_boundaries<int>(3, 1500, 8).empty());
+
+    auto boundaries = tatami_stats::split_boundaries<int>(3, 100000, 8);
+    ASSERT_EQ(boundaries.size(), 9);
+    EXPECT_EQ(boundaries.front(), 0);
+    EXPECT_EQ(boundaries.back(), 100000);
+
+    // Capped by the minimum block size.
+    boundaries = tatami_stats::split_boundaries<int>(3, 5000, 8);
+    ASSERT_EQ(boundaries.size(), 5);
+    EXPECT_EQ(boundaries.back(), 5000);
+}
+
+// Tall and skinny matrix, so that there are fewer columns than threads.
+class SplitTest : public ::testing::TestWithParam<std::tuple<bool, int> > {
+protected:
+    inline static std::size_t NR = 10007, NC = 5;
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+    inline static std::shared_ptr<tatami::NumericMatrix> nan_dense_row, nan_dense_column, nan_sparse_row, nan_sparse_column;
+
+    static void SetUpTestSuite() {
+        auto simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.1;
+            opt.lower = 1;
+            opt.upper = 5;
+            opt.seed = 9876123;
+            return opt;
+        }());
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, simulated));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+
+        // Column 1 has NaNs in its first half, so some blocks have no observations; column 3 is all NaN.
+        for (std::size_t r = 0; r < NR; ++r) {
+            if (r < NR / 2) {
+                simulated[r * NC + 1] = std::numeric_limits<double>::quiet_NaN();
+            }
+            simulated[r * NC + 3] = std::numeric_limits<double>::quiet_NaN();
+            if (r % 13 == 0) {
+                simulated[r * NC + 4] = std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+        nan_dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(simulated)));
+        nan_dense_column = tatami::convert_to_dense<double, int>(*nan_dense_row, false, {});
+        nan_sparse_row = tatami::convert_to_compressed_sparse<double, int>(*nan_dense_row, true, {});
+        nan_sparse_column = tatami::convert_to_compressed_sparse<double, int>(*nan_dense_row, false, {});
+    }
+};
+
+TEST_P(SplitTest, Basic) {
+    auto param = GetParam();
+    const bool use_executor = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+    tatami_stats::ThreadPoolExecutor pool(nthreads);
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        tatami_stats::SumOptions sopt;
+        sopt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        sopt.split_other = true;
+        auto ref_sum = tatami_stats::sum(false, *mat, sopt);
+        sopt.num_threads = nthreads;
+        sopt.executor = (use_executor ? &pool : NULL);
+        compare_double_vectors(ref_sum, tatami_stats::sum(false, *mat, sopt));
+
+        tatami_stats::VarianceOptions<double> vopt;
+        vopt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        vopt.split_other = true;
+        auto ref_var = tatami_stats::variance(false, *mat, vopt);
+        vopt.num_threads = nthreads;
+        vopt.executor = (use_executor ? &pool : NULL);
+        auto var = tatami_stats::variance(false, *mat, vopt);
+        compare_double_vectors(ref_var.mean, var.mean);
+        compare_double_vectors(ref_var.variance, var.variance);
+
+        tatami_stats::RangeOptions<double> ropt;
+        ropt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        auto ref_range = tatami_stats::range(false, *mat, ropt);
+        ropt.num_threads = nthreads;
+        ropt.executor = (use_executor ? &pool : NULL);
+        auto range = tatami_stats::range(false, *mat, ropt);
+        EXPECT_EQ(ref_range.minimum, range.minimum);
+        EXPECT_EQ(ref_range.maximum, range.maximum);
+
+        tatami_stats::CountOptions copt;
+        copt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        const auto condition = [](double x) -> bool { return x < 2; }; // includes the structural zeros.
+        auto ref_count = tatami_stats::count<int>(false, *mat, condition, copt);
+        copt.num_threads = nthreads;
+        copt.executor = (use_executor ? &pool : NULL);
+        EXPECT_EQ(ref_count, tatami_stats::count<int>(false, *mat, condition, copt));
+    }
+}
+
+TEST_P(SplitTest, SkipNan) {
+    auto param = GetParam();
+    const bool use_executor = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+    tatami_stats::ThreadPoolExecutor pool(nthreads);
+
+    for (auto mat : { nan_dense_row.get(), nan_dense_column.get(), nan_sparse_row.get(), nan_sparse_column.get() }) {
+        tatami_stats::SumOptions sopt;
+        sopt.skip_nan = true;
+        sopt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        sopt.split_other = true;
+        auto ref_sum = tatami_stats::sum(false, *mat, sopt);
+        sopt.num_threads = nthreads;
+        sopt.executor = (use_executor ? &pool : NULL);
+        compare_double_vectors(ref_sum, tatami_stats::sum(false, *mat, sopt));
+
+        tatami_stats::skip_nan::RssOptions vopt;
+        vopt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        vopt.split_other = true;
+        auto ref_rss = tatami_stats::skip_nan::rss<double, int>(false, *mat, vopt);
+        EXPECT_TRUE(std::isnan(ref_rss.mean[3]));
+        vopt.num_threads = nthreads;
+        vopt.executor = (use_executor ? &pool : NULL);
+        auto rss = tatami_stats::skip_nan::rss<double, int>(false, *mat, vopt);
+        compare_double_vectors(ref_rss.mean, rss.mean);
+        compare_double_vectors(ref_rss.rss, rss.rss);
+        EXPECT_EQ(ref_rss.count, rss.count);
+
+        // Using a placeholder that isn't the identity for min/max, to check that empty blocks are ignored.
+        tatami_stats::skip_nan::RangeOptions<double> ropt;
+        ropt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        ropt.minimum_placeholder = 0;
+        ropt.maximum_placeholder = 0;
+        auto ref_range = tatami_stats::skip_nan::range(false, *mat, ropt);
+        EXPECT_EQ(ref_range.minimum[3], 0);
+        ropt.num_threads = nthreads;
+        ropt.executor = (use_executor ? &pool : NULL);
+        auto range = tatami_stats::skip_nan::range(false, *mat, ropt);
+        EXPECT_EQ(ref_range.minimum, range.minimum);
+        EXPECT_EQ(ref_range.maximum, range.maximum);
+        EXPECT_EQ(ref_range.count, range.count);
+    }
+}
+
+TEST_P(SplitTest, Default) {
+    auto param = GetParam();
+    const bool use_executor = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+    tatami_stats::ThreadPoolExecutor pool(nthreads);
+
+    // No splitting of floating-point results unless requested, so the results should be exactly the same as with a single thread.
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        tatami_stats::SumOptions sopt;
+        sopt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        auto ref_sum = tatami_stats::sum(false, *mat, sopt);
+        sopt.num_threads = nthreads;
+        sopt.executor = (use_executor ? &pool : NULL);
+        EXPECT_EQ(ref_sum, tatami_stats::sum(false, *mat, sopt));
+
+        tatami_stats::VarianceOptions<double> vopt;
+        vopt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        auto ref_var = tatami_stats::variance(false, *mat, vopt);
+        vopt.num_threads = nthreads;
+        vopt.executor = (use_executor ? &pool : NULL);
+        auto var = tatami_stats::variance(false, *mat, vopt);
+        EXPECT_EQ(ref_var.mean, var.mean);
+        EXPECT_EQ(ref_var.variance, var.variance);
+    }
+}
+
+TEST_P(SplitTest, Deterministic) {
+    auto param = GetParam();
+    const bool use_executor = std::get<0>(param);
+    const int nthreads = std::get<1>(param);
+    tatami_stats::ThreadPoolExecutor pool(nthreads);
+
+    // No splitting in deterministic mode, even if requested, so the results should be exactly the same as with a single thread.
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        tatami_stats::SumOptions sopt;
+        sopt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        sopt.deterministic = true;
+        sopt.split_other = true;
+        auto ref_sum = tatami_stats::sum(false, *mat, sopt);
+        sopt.num_threads = nthreads;
+        sopt.executor = (use_executor ? &pool : NULL);
+        EXPECT_EQ(ref_sum, tatami_stats::sum(false, *mat, sopt));
+
+        tatami_stats::VarianceOptions<double> vopt;
+        vopt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        vopt.deterministic = true;
+        vopt.split_other = true;
+        auto ref_var = tatami_stats::variance(false, *mat, vopt);
+        vopt.num_threads = nthreads;
+        vopt.executor = (use_executor ? &pool : NULL);
+        auto var = tatami_stats::variance(false, *mat, vopt);
+        EXPECT_EQ(ref_var.mean, var.mean);
+        EXPECT_EQ(ref_var.variance, var.variance);
+    }
+
+    for (auto mat : { nan_dense_row.get(), nan_dense_column.get(), nan_sparse_row.get(), nan_sparse_column.get() }) {
+        tatami_stats::skip_nan::RssOptions vopt;
+        vopt.strategy = tatami_stats::PlanStrategy::DIRECT;
+        vopt.deterministic = true;
+        vopt.split_other = true;
+        auto ref_rss = tatami_stats::skip_nan::rss<double, int>(false, *mat, vopt);
+        vopt.num_threads = nthreads;
+        vopt.executor = (use_executor ? &pool : NULL);
+        auto rss = tatami_stats::skip_nan::rss<double, int>(false, *mat, vopt);
+        for (std::size_t c = 0; c < NC; ++c) {
+            if (std::isnan(ref_rss.mean[c])) { // all-NaN columns get a NaN placeholder.
+                EXPECT_TRUE(std::isnan(rss.mean[c]));
+            } else {
+                EXPECT_EQ(ref_rss.mean[c], rss.mean[c]);
+                EXPECT_EQ(ref_rss.rss[c], rss.rss[c]);
+            }
+        }
+        EXPECT_EQ(ref_rss.count, rss.count);
+    }
+}
+
+TEST_P(SplitTest, Plan) {
+    auto param = GetParam();
+    const int nthreads = std::get<1>(param);
+    const std::size_t num_blocks = (static_cast<std::size_t>(nthreads) <= NC ? 0 : std::min(static_cast<std::size_t>(nthreads), NR / tatami_stats::SPLIT_MIN_BLOCK_SIZE));
+
+    // Partial sums for each block are included in the memory usage.
+    tatami_stats::SumOptions sopt;
+    sopt.strategy = tatami_stats::PlanStrategy::DIRECT;
+    sopt.num_threads = nthreads;
+    auto unsplit = tatami_stats::plan(false, *dense_column, sopt);
+    EXPECT_FALSE(unsplit.running);
+    EXPECT_EQ(unsplit.memory, nthreads * NR * sizeof(double));
+
+    sopt.split_other = true;
+    auto split = tatami_stats::plan(false, *dense_column, sopt);
+    EXPECT_FALSE(split.running);
+    EXPECT_EQ(split.memory, nthreads * NR * sizeof(double) + num_blocks * NC * sizeof(double));
+
+    sopt.deterministic = true;
+    auto det = tatami_stats::plan(false, *dense_column, sopt);
+    EXPECT_EQ(det.memory, nthreads * NR * sizeof(double));
+
+    tatami_stats::RangeOptions<double> ropt;
+    ropt.strategy = tatami_stats::PlanStrategy::DIRECT;
+    ropt.num_threads = nthreads;
+    auto rsplit = tatami_stats::plan(false, *dense_column, ropt);
+    EXPECT_EQ(rsplit.memory, nthreads * NR * sizeof(double) + num_blocks * NC * 2 * sizeof(double));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Split,
+    SplitTest,
+    ::testing::Combine(
+        ::testing::Values(false, true), // whether to use an executor.
+        ::testing::Values(2, 6, 11) // number of threads
+    )
+);
@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <numeric>
+
+#include "tatami_stats/trace.hpp"
+#include "tatami_stats/executor.hpp"
+#include "tatami_stats/partition.hpp"
+#include "tatami_stats/sum.hpp"
+#include "tatami_stats/median.hpp"
+#include "tatami_stats/group_rss.hpp"
+#include "tatami_stats/skip_nan/rss.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+class TraceTest : public ::testing::Test {
+protected:
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, sparse_column;
+    inline static std::size_t NR = 77, NC = 123;
+
+    static void SetUpTestSuite() {
+        auto vec = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.2;
+            opt.seed = 727272;
+            return opt;
+        }());
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(vec)));
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+
+    static std::size_t count_phase(const tatami_stats::Tracer& tracer, const std::string& phase) {
+        std::size_t count = 0;
+        for (const auto& ev : tracer.events()) {
+            count += (phase == ev.phase);
+        }
+        return count;
+    }
+};
+
+TEST_F(TraceTest, Direct) {
+    tatami_stats::Tracer tracer;
+    tatami_stats::SumOptions sopt;
+    sopt.num_threads = 3;
+    sopt.tracer = &tracer;
+    auto res = tatami_stats::sum(true, *dense_row, sopt);
+    compare_double_vectors(res, tatami_stats::sum(true, *dense_row, {}));
+
+    ASSERT_EQ(tracer.paths().size(), 1);
+    EXPECT_EQ(std::string(tracer.paths()[0].kernel), "sum");
+    EXPECT_FALSE(tracer.paths()[0].running);
+    EXPECT_FALSE(tracer.paths()[0].sparse);
+    EXPECT_FALSE(tracer.paths()[0].skip_nan);
+
+    EXPECT_EQ(count_phase(tracer, "compute"), 3);
+    EXPECT_EQ(count_phase(tracer, "merge"), 0);
+    std::size_t total_vectors = 0;
+    for (const auto& ev : tracer.events()) {
+        EXPECT_GE(ev.duration, ev.extraction);
+        EXPECT_EQ(ev.nonzeros, 0); // dense, so no non-zeros are reported.
+        EXPECT_EQ(ev.bytes, 0);
+        total_vectors += ev.vectors;
+    }
+    EXPECT_EQ(total_vectors, NR);
+
+    tracer.clear();
+    EXPECT_TRUE(tracer.events().empty());
+    EXPECT_TRUE(tracer.paths().empty());
+}
+
+TEST_F(TraceTest, Running) {
+    std::vector<int> groups(NC);
+    for (std::size_t c = 0; c < NC; ++c) {
+        groups[c] = c % 4;
+    }
+
+    tatami_stats::Tracer tracer;
+    tatami_stats::GroupRssOptions gopt;
+    gopt.num_threads = 3;
+    gopt.tracer = &tracer;
+    auto res = tatami_stats::group_rss<double>(true, *sparse_column, groups.data(), 4, gopt);
+    auto ref = tatami_stats::group_rss<double>(true, *dense_row, groups.data(), 4, {});
+    compare_double_vectors_of_vectors(ref.mean, res.mean);
+    compare_double_vectors_of_vectors(ref.rss, res.rss);
+
+    ASSERT_EQ(tracer.paths().size(), 1);
+    EXPECT_EQ(std::string(tracer.paths()[0].kernel), "group_rss");
+    EXPECT_TRUE(tracer.paths()[0].running);
+    EXPECT_TRUE(tracer.paths()[0].sparse);
+
+    EXPECT_EQ(count_phase(tracer, "compute"), 3);
+    EXPECT_EQ(count_phase(tracer, "merge"), 1);
+
+    std::size_t total_vectors = 0, total_nonzeros = 0, total_bytes = 0;
+    for (const auto& ev : tracer.events()) {
+        EXPECT_EQ(std::string(ev.kernel), "group_rss");
+        total_vectors += ev.vectors;
+        total_nonzeros += ev.nonzeros;
+        total_bytes += ev.bytes;
+    }
+    EXPECT_EQ(total_vectors, NC);
+
+    auto nnz = tatami_stats::count_structural_nonzeros(false, *sparse_column, 1);
+    EXPECT_EQ(total_nonzeros, std::accumulate(nnz.begin(), nnz.end(), static_cast<std::size_t>(0)));
+
+    // Means for all threads, RSS for all but the first.
+    EXPECT_EQ(total_bytes, (3 + 2) * 4 * NR * sizeof(double));
+
+    // Also works with the executor's merge.
+    tatami_stats::ThreadPoolExecutor pool(2);
+    tracer.clear();
+    gopt.executor = &pool;
+    tatami_stats::group_rss<double>(true, *sparse_column, groups.data(), 4, gopt);
+    EXPECT_EQ(count_phase(tracer, "compute"), 3);
+    EXPECT_EQ(count_phase(tracer, "merge"), 3);
+}
+
+TEST_F(TraceTest, Others) {
+    tatami_stats::Tracer tracer;
+
+    tatami_stats::skip_nan::RssOptions ropt;
+    ropt.tracer = &tracer;
+    tatami_stats::skip_nan::rss<double, int>(false, *sparse_column, ropt);
+
+    tatami_stats::MedianOptions mopt;
+    mopt.num_threads = 2;
+    mopt.work_stealing = true;
+    mopt.tracer = &tracer;
+    tatami_stats::median(true, *sparse_column, mopt);
+
+    ASSERT_EQ(tracer.paths().size(), 2);
+    EXPECT_EQ(std::string(tracer.paths()[0].kernel), "skip_nan::rss");
+    EXPECT_FALSE(tracer.paths()[0].running);
+    EXPECT_TRUE(tracer.paths()[0].skip_nan);
+    EXPECT_EQ(std::string(tracer.paths()[1].kernel), "median");
+
+    std::size_t median_vectors = 0;
+    for (const auto& ev : tracer.events()) {
+        if (std::string(ev.kernel) == "median") {
+            median_vectors += ev.vectors;
+        }
+    }
+    EXPECT_EQ(median_vectors, NR);
+}
+
+TEST_F(TraceTest, ChromeTrace) {
+    tatami_stats::Tracer tracer;
+    tatami_stats::SumOptions sopt;
+    sopt.num_threads = 2;
+    sopt.tracer = &tracer;
+    tatami_stats::sum(false, *dense_row, sopt);
+
+    std::stringstream ss;
+    tatami_stats::write_chrome_trace(tracer, ss);
+    const auto json = ss.str();
+    EXPECT_EQ(json.rfind("{\"traceEvents\":[", 0), 0);
+    EXPECT_EQ(json.substr(json.size() - 2), "]}");
+    EXPECT_NE(json.find("\"name\":\"sum\",\"ph\":\"i\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"sum:compute\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"sum:merge\""), std::string::npos);
+    EXPECT_NE(json.find("\"running\":true"), std::string::npos);
+
+    // Empty tracer is still valid.
+    tatami_stats::Tracer empty;
+    std::stringstream ss2;
+    tatami_stats::write_chrome_trace(empty, ss2);
+    EXPECT_EQ(ss2.str(), "{\"traceEvents\":[]}");
+}
@@ -0,0 +1,408 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cmath>
+
+#include "tatami_stats/transform.hpp"
+#include "tatami_stats/sum.hpp"
+#include "tatami_stats/variance.hpp"
+#include "tatami_stats/median.hpp"
+#include "tatami_stats/quantile.hpp"
+#include "tatami_stats/range.hpp"
+#include "tatami_stats/group_sum.hpp"
+#include "tatami_stats/group_rss.hpp"
+#include "tatami_stats/group_variance.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+class TransformTest : public ::testing::TestWithParam<std::tuple<bool, int, tatami_stats::PlanStrategy> > {
+protected:
+    inline static std::size_t NR = 89, NC = 123;
+    inline static std::vector<double> simulated;
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+
+    static void SetUpTestSuite() {
+        simulated = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.2;
+            opt.lower = -2;
+            opt.upper = 5;
+            opt.seed = 81726354;
+            return opt;
+        }());
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, simulated));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+
+    // Reference matrix containing the transformed values.
+    template<class Function_>
+    static std::shared_ptr<tatami::NumericMatrix> transformed(Function_ fun) {
+        auto copy = simulated;
+        for (auto& x : copy) {
+            x = fun(x);
+        }
+        return std::shared_ptr<tatami::NumericMatrix>(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(copy)));
+    }
+};
+
+TEST_P(TransformTest, Sum) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    tatami_stats::SumOptions opt;
+    opt.num_threads = std::get<1>(param);
+    opt.strategy = std::get<2>(param);
+
+    // Transformation that preserves zeros.
+    {
+        auto trans = tatami_stats::make_transform<true>([](double x) -> double { return x * 2.5; });
+        auto ref = transformed(trans.function);
+        auto expected = tatami_stats::sum(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare_double_vectors(expected, tatami_stats::sum(row, *mat, trans, opt));
+        }
+    }
+
+    // Transformation that doesn't preserve zeros, given as a bare lambda.
+    {
+        auto trans = [](double x) -> double { return std::exp(x / 2); };
+        auto ref = transformed(trans);
+        auto expected = tatami_stats::sum(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare_double_vectors(expected, tatami_stats::sum(row, *mat, trans, opt));
+        }
+    }
+
+    // Transformations that introduce NaNs.
+    opt.skip_nan = true;
+    {
+        auto trans = tatami_stats::make_transform<true>([](double x) -> double { return std::sqrt(x); });
+        auto ref = transformed(trans.function);
+        auto expected = tatami_stats::sum(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare_double_vectors(expected, tatami_stats::sum(row, *mat, trans, opt));
+        }
+    }
+    {
+        auto trans = tatami_stats::make_transform([](double x) -> double { return std::sqrt(x + 1); });
+        auto ref = transformed(trans.function);
+        auto expected = tatami_stats::sum(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare_double_vectors(expected, tatami_stats::sum(row, *mat, trans, opt));
+        }
+    }
+}
+
+TEST_P(TransformTest, Variance) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    tatami_stats::VarianceOptions<double> opt;
+    opt.num_threads = std::get<1>(param);
+    opt.strategy = std::get<2>(param);
+
+    auto compare = [](const tatami_stats::VarianceResult<double>& expected, const tatami_stats::VarianceResult<double>& observed) -> void {
+        compare_double_vectors(expected.mean, observed.mean);
+        compare_double_vectors(expected.variance, observed.variance);
+    };
+
+    {
+        auto trans = tatami_stats::make_transform<true>([](double x) -> double { return std::log1p(std::abs(x) / 0.7); });
+        auto ref = transformed(trans.function);
+        auto expected = tatami_stats::variance(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare(expected, tatami_stats::variance(row, *mat, trans, opt));
+        }
+    }
+
+    {
+        auto trans = [](double x) -> double { return x * x - 3; };
+        auto ref = transformed(trans);
+        auto expected = tatami_stats::variance(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare(expected, tatami_stats::variance(row, *mat, trans, opt));
+        }
+    }
+
+    opt.skip_nan = true;
+    {
+        auto trans = tatami_stats::make_transform<true>([](double x) -> double { return std::sqrt(x); });
+        auto ref = transformed(trans.function);
+        auto expected = tatami_stats::variance(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare(expected, tatami_stats::variance(row, *mat, trans, opt));
+        }
+    }
+    {
+        auto trans = [](double x) -> double { return std::sqrt(x + 1); };
+        auto ref = transformed(trans);
+        auto expected = tatami_stats::variance(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare(expected, tatami_stats::variance(row, *mat, trans, opt));
+        }
+    }
+}
+
+TEST_P(TransformTest, Median) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    tatami_stats::MedianOptions opt;
+    opt.num_threads = std::get<1>(param);
+
+    // Non-monotonic transformation that doesn't preserve zeros, which reorders the structural zeros relative to the non-zero values.
+    {
+        auto trans = [](double x) -> double { return x * x - 3; };
+        auto ref = transformed(trans);
+        auto expected = tatami_stats::median(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare_double_vectors(expected, tatami_stats::median(row, *mat, trans, opt));
+        }
+    }
+    {
+        auto trans = tatami_stats::make_transform<true>([](double x) -> double { return -x * 2.5; });
+        auto ref = transformed(trans.function);
+        auto expected = tatami_stats::median(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare_double_vectors(expected, tatami_stats::median(row, *mat, trans, opt));
+        }
+    }
+
+    opt.skip_nan = true;
+    {
+        auto trans = [](double x) -> double { return std::sqrt(x + 1); };
+        auto ref = transformed(trans);
+        auto expected = tatami_stats::median(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare_double_vectors(expected, tatami_stats::median(row, *mat, trans, opt));
+        }
+    }
+}
+
+TEST_P(TransformTest, Quantile) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    tatami_stats::QuantileOptions opt;
+    opt.num_threads = std::get<1>(param);
+
+    for (double prob : { 0.0, 0.3, 0.5, 0.95 }) {
+        opt.skip_nan = false;
+        {
+            auto trans = [](double x) -> double { return x * x - 3; };
+            auto ref = transformed(trans);
+            auto expected = tatami_stats::quantile(row, *ref, prob, opt);
+            for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+                compare_double_vectors(expected, tatami_stats::quantile(row, *mat, prob, trans, opt));
+            }
+        }
+
+        opt.skip_nan = true;
+        {
+            auto trans = tatami_stats::make_transform<true>([](double x) -> double { return std::sqrt(x); });
+            auto ref = transformed(trans.function);
+            auto expected = tatami_stats::quantile(row, *ref, prob, opt);
+            for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+                compare_double_vectors(expected, tatami_stats::quantile(row, *mat, prob, trans, opt));
+            }
+        }
+    }
+}
+
+TEST_P(TransformTest, Range) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    tatami_stats::RangeOptions<double> opt;
+    opt.num_threads = std::get<1>(param);
+    opt.strategy = std::get<2>(param);
+
+    auto compare = [](const tatami_stats::RangeResult<double>& expected, const tatami_stats::RangeResult<double>& observed) -> void {
+        compare_double_vectors(expected.minimum, observed.minimum);
+        compare_double_vectors(expected.maximum, observed.maximum);
+    };
+
+    {
+        auto trans = [](double x) -> double { return x * x - 3; };
+        auto ref = transformed(trans);
+        auto expected = tatami_stats::range(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare(expected, tatami_stats::range(row, *mat, trans, opt));
+        }
+    }
+    {
+        auto trans = tatami_stats::make_transform<true>([](double x) -> double { return -x * 2.5; });
+        auto ref = transformed(trans.function);
+        auto expected = tatami_stats::range(row, *ref, opt);
+        for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+            compare(expected, tatami_stats::range(row, *mat, trans, opt));
+        }
+    }
+}
+
+TEST_P(TransformTest, GroupSum) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    tatami_stats::GroupSumOptions opt;
+    opt.num_threads = std::get<1>(param);
+    opt.strategy = std::get<2>(param);
+
+    const std::size_t otherdim = (row ? NC : NR);
+    for (std::size_t ngroups : { 3, 11 }) {
+        std::vector<int> group(otherdim);
+        for (std::size_t i = 0; i < otherdim; ++i) {
+            group[i] = (i * 7) % ngroups;
+        }
+
+        for (bool ordered : { false, true }) {
+            opt.group_ordered = ordered;
+
+            opt.skip_nan = false;
+            {
+                auto trans = [](double x) -> double { return std::exp(x / 2); };
+                auto ref = transformed(trans);
+                auto expected = tatami_stats::group_sum(row, *ref, group.data(), ngroups, opt);
+                auto expected_interleaved = tatami_stats::group_sum_interleaved(row, *ref, group.data(), ngroups, opt);
+                for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+                    auto observed = tatami_stats::group_sum(row, *mat, group.data(), ngroups, trans, opt);
+                    for (std::size_t g = 0; g < ngroups; ++g) {
+                        compare_double_vectors(expected[g], observed[g]);
+                    }
+                    compare_double_vectors(expected_interleaved, tatami_stats::group_sum_interleaved(row, *mat, group.data(), ngroups, trans, opt));
+                }
+            }
+
+            opt.skip_nan = true;
+            {
+                auto trans = [](double x) -> double { return std::sqrt(x + 1); };
+                auto ref = transformed(trans);
+                auto expected = tatami_stats::group_sum(row, *ref, group.data(), ngroups, opt);
+                for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+                    auto observed = tatami_stats::group_sum(row, *mat, group.data(), ngroups, trans, opt);
+                    for (std::size_t g = 0; g < ngroups; ++g) {
+                        compare_double_vectors(expected[g], observed[g]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_P(TransformTest, GroupRss) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    tatami_stats::GroupRssOptions opt;
+    opt.num_threads = std::get<1>(param);
+    opt.strategy = std::get<2>(param);
+
+    const std::size_t otherdim = (row ? NC : NR);
+    for (std::size_t ngroups : { 3, 11 }) {
+        std::vector<int> group(otherdim);
+        for (std::size_t i = 0; i < otherdim; ++i) {
+            group[i] = (i * 7) % ngroups;
+        }
+
+        for (int mode = 0; mode < 4; ++mode) {
+            opt.group_ordered = (mode == 1);
+            opt.shifted_sums = (mode == 2);
+            opt.deterministic = (mode == 3);
+
+            auto trans = [](double x) -> double { return x * x - 3; };
+            auto ref = transformed(trans);
+            auto expected = tatami_stats::group_rss(row, *ref, group.data(), ngroups, opt);
+            auto expected_interleaved = tatami_stats::group_rss_interleaved(row, *ref, group.data(), ngroups, opt);
+            for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+                auto observed = tatami_stats::group_rss(row, *mat, group.data(), ngroups, trans, opt);
+                for (std::size_t g = 0; g < ngroups; ++g) {
+                    compare_double_vectors(expected.mean[g], observed.mean[g]);
+                    compare_double_vectors(expected.rss[g], observed.rss[g]);
+                }
+                auto observed_interleaved = tatami_stats::group_rss_interleaved(row, *mat, group.data(), ngroups, trans, opt);
+                compare_double_vectors(expected_interleaved.mean, observed_interleaved.mean);
+                compare_double_vectors(expected_interleaved.rss, observed_interleaved.rss);
+            }
+        }
+    }
+}
+
+TEST_P(TransformTest, GroupVariance) {
+    auto param = GetParam();
+    const bool row = std::get<0>(param);
+    tatami_stats::GroupVarianceOptions opt;
+    opt.num_threads = std::get<1>(param);
+    opt.strategy = std::get<2>(param);
+
+    const std::size_t otherdim = (row ? NC : NR);
+    for (std::size_t ngroups : { 3, 11 }) {
+        std::vector<int> group(otherdim);
+        for (std::size_t i = 0; i < otherdim; ++i) {
+            group[i] = (i * 7) % ngroups;
+        }
+
+        for (bool skip_nan : { false, true }) {
+            opt.skip_nan = skip_nan;
+            auto trans = [&](double x) -> double { return (skip_nan ? std::sqrt(x + 1) : std::exp(x / 2)); };
+            auto ref = transformed(trans);
+            auto expected = tatami_stats::group_variance(row, *ref, group.data(), ngroups, opt);
+            for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+                auto observed = tatami_stats::group_variance(row, *mat, group.data(), ngroups, trans, opt);
+                for (std::size_t g = 0; g < ngroups; ++g) {
+                    compare_double_vectors(expected.mean[g], observed.mean[g]);
+
+                    // Groups with constant values have zero variance, which may be computed as a tiny non-zero value after merging across threads.
+                    ASSERT_EQ(expected.variance[g].size(), observed.variance[g].size());
+                    for (std::size_t i = 0; i < expected.variance[g].size(); ++i) {
+                        const double left = expected.variance[g][i], right = observed.variance[g][i];
+                        if (std::isnan(left)) {
+                            EXPECT_TRUE(std::isnan(right));
+                        } else {
+                            EXPECT_NEAR(left, right, 1e-8 * std::max(1.0, std::abs(left)));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Transform,
+    TransformTest,
+    ::testing::Combine(
+        ::testing::Values(true, false), // row or column
+        ::testing::Values(1, 3), // number of threads
+        ::testing::Values(tatami_stats::PlanStrategy::DIRECT, tatami_stats::PlanStrategy::RUNNING)
+    )
+);
+
+TEST(Transform, Integer) {
+    // Transformed values are stored as the output type, not the integer matrix type.
+    std::vector<int> counts { 0, 1, 5, 0, 0, 3, 10, 0, 2, 7, 0, 0 };
+    tatami::DenseRowMatrix<int, int> dense(3, 4, counts);
+    auto sparse = tatami::convert_to_compressed_sparse<int, int>(dense, true, {});
+
+    auto trans = tatami_stats::make_transform<true>([](int x) -> double { return std::log1p(x / 2.0); });
+    std::vector<double> expected(3);
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            expected[r] += trans(counts[r * 4 + c]);
+        }
+    }
+
+    tatami_stats::SumOptions opt;
+    for (auto strategy : { tatami_stats::PlanStrategy::DIRECT, tatami_stats::PlanStrategy::RUNNING }) {
+        opt.strategy = strategy;
+        compare_double_vectors(expected, tatami_stats::sum(true, dense, trans, opt));
+        compare_double_vectors(expected, tatami_stats::sum(true, *sparse, trans, opt));
+    }
+}
+
+TEST(Transform, Empty) {
+    tatami::DenseRowMatrix<double, int> empty(5, 0, std::vector<double>());
+    auto trans = [](double x) -> double { return x + 1; };
+
+    auto res = tatami_stats::sum(true, empty, trans, {});
+    EXPECT_EQ(res, std::vector<double>(5));
+
+    auto vres = tatami_stats::variance(true, empty, trans, {});
+    EXPECT_TRUE(is_all_nan(vres.mean));
+    EXPECT_TRUE(is_all_nan(vres.variance));
+}
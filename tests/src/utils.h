@@ -2,6 +2,14 @@
 #define UTILS_H
 
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <limits>
+#include <atomic>
+#include <cstddef>
+
+#include "tatami_stats/allocator.hpp"
 
 template<class L_, class R_>
 void compare_double_vectors(const L_& left, const R_& right) {
@@ -24,6 +32,25 @@ void compare_double_vectors_of_vectors(const L_& left, const R_& right) {
     }
 }
 
+// Allocator that counts the number of calls, to check that buffers are allocated through the Allocator interface and reused by a Workspace.
+class CountingAllocator final : public tatami_stats::Allocator {
+public:
+    void* allocate(std::size_t bytes) override {
+        ++allocations;
+        return my_base.allocate(bytes);
+    }
+
+    void deallocate(void* ptr, std::size_t bytes) override {
+        ++deallocations;
+        my_base.deallocate(ptr, bytes);
+    }
+
+    std::atomic<int> allocations = 0, deallocations = 0;
+
+private:
+    tatami_stats::AlignedAllocator my_base;
+};
+
 template<class V_>
 bool is_all_nan(const V_& v) {
     for (auto x : v) {
@@ -47,4 +74,44 @@ void inject_variable_zeros(std::size_t primary, std::size_t secondary, std::vect
     }
 }
 
+template<typename Rng_>
+std::vector<double> simulate_variable_nonzeros(std::size_t primary, std::size_t secondary, bool with_nan, Rng_& rng) {
+    // The number of non-zero elements in each primary dimension element cycles from 0 to 'secondary',
+    // so that most elements are mostly zero and some lie exactly at the boundary where half of the values are zero.
+    // This is intended to check the shortcuts for sparse medians and quantiles against a reference calculation.
+    std::vector<double> vec(primary * secondary);
+    std::uniform_real_distribution<double> unif(1, 10);
+    for (std::size_t p = 0; p < primary; ++p) {
+        auto vStart = vec.begin() + p * secondary;
+        const std::size_t num_nonzero = p % (secondary + 1);
+        for (std::size_t s = 0; s < num_nonzero; ++s) {
+            const double val = unif(rng);
+            if (with_nan && val < 3) {
+                vStart[s] = std::numeric_limits<double>::quiet_NaN();
+            } else {
+                vStart[s] = (val < 5 ? -val : val); // mixing positive and negative values.
+            }
+        }
+        std::shuffle(vStart, vStart + secondary, rng);
+    }
+    return vec;
+}
+
+inline double reference_quantile(std::vector<double> values, double prob, bool skip_nan) {
+    if (skip_nan) {
+        values.erase(std::remove_if(values.begin(), values.end(), [](double x) -> bool { return std::isnan(x); }), values.end());
+    }
+    if (values.empty()) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    std::sort(values.begin(), values.end());
+    const double position = static_cast<double>(values.size() - 1) * prob;
+    const std::size_t lower = std::floor(position);
+    const double remainder = position - lower;
+    if (remainder == 0) {
+        return values[lower];
+    }
+    return values[lower] + (values[lower + 1] - values[lower]) * remainder;
+}
+
 #endif
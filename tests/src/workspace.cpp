@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include "tatami_stats/workspace.hpp"
+#include "tatami_stats/sum.hpp"
+#include "tatami_stats/variance.hpp"
+#include "tatami_stats/median.hpp"
+#include "tatami_stats/group_sum.hpp"
+#include "tatami_stats/group_rss.hpp"
+#include "tatami_stats/group_variance.hpp"
+#include "tatami_test/tatami_test.hpp"
+#include "utils.h"
+
+TEST(Workspace, Basic) {
+    tatami_stats::Workspace work;
+    EXPECT_EQ(work.num_threads(), 0);
+    work.reserve(2);
+    EXPECT_EQ(work.num_threads(), 2);
+    work.reserve(1);
+    EXPECT_EQ(work.num_threads(), 2);
+
+    auto dptr = work.buffer<double>(0, 0, 10);
+    dptr[5] = 1.5;
+    auto iptr = work.buffer<int>(0, 0, 10);
+    EXPECT_NE(static_cast<void*>(dptr), static_cast<void*>(iptr)); // different types don't conflict.
+    EXPECT_NE(dptr, work.buffer<double>(1, 0, 10)); // different threads don't conflict.
+    EXPECT_EQ(work.num_allocations(), 6); // creation of the buffer and its growth.
+
+    // Smaller requests re-use the existing buffer.
+    EXPECT_EQ(work.buffer<double>(0, 0, 5), dptr);
+    EXPECT_EQ(dptr[5], 1.5);
+    EXPECT_EQ(work.num_allocations(), 6);
+
+    work.buffer<double>(0, 0, 20);
+    EXPECT_EQ(work.num_allocations(), 7);
+
+    auto& obj = work.get<std::vector<char> >(1, 5);
+    obj.push_back('a');
+    EXPECT_EQ(work.get<std::vector<char> >(1, 5).size(), 1);
+
+    work.clear();
+    EXPECT_EQ(work.num_threads(), 0);
+    EXPECT_EQ(work.num_allocations(), 0);
+}
+
+class WorkspaceTest : public ::testing::TestWithParam<int> {
+protected:
+    inline static std::shared_ptr<tatami::NumericMatrix> dense_row, dense_column, sparse_row, sparse_column;
+    inline static std::size_t NR = 83, NC = 119;
+
+    static void SetUpTestSuite() {
+        auto vec = tatami_test::simulate_vector<double>(NR * NC, []{
+            tatami_test::SimulateVectorOptions opt;
+            opt.density = 0.2;
+            opt.seed = 918273;
+            return opt;
+        }());
+
+        // Adding some NaNs to check the skip_nan paths.
+        for (std::size_t i = 0; i < vec.size(); i += 13) {
+            vec[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+
+        dense_row.reset(new tatami::DenseRowMatrix<double, int>(NR, NC, std::move(vec)));
+        dense_column = tatami::convert_to_dense<double, int>(*dense_row, false, {});
+        sparse_row = tatami::convert_to_compressed_sparse<double, int>(*dense_row, true, {});
+        sparse_column = tatami::convert_to_compressed_sparse<double, int>(*dense_row, false, {});
+    }
+};
+
+TEST_P(WorkspaceTest, Reuse) {
+    const int nthreads = GetParam();
+    tatami_stats::Workspace work;
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        for (bool row : { true, false }) {
+            tatami_stats::SumOptions sopt;
+            sopt.skip_nan = true;
+            sopt.num_threads = nthreads;
+            auto sref = tatami_stats::sum(row, *mat, sopt);
+
+            tatami_stats::VarianceOptions vopt;
+            vopt.num_threads = nthreads;
+            auto vref = tatami_stats::variance(row, *mat, vopt);
+            vopt.skip_nan = true;
+            auto vnref = tatami_stats::variance(row, *mat, vopt);
+
+            tatami_stats::MedianOptions mopt;
+            mopt.skip_nan = true;
+            mopt.num_threads = nthreads;
+            auto mref = tatami_stats::median(row, *mat, mopt);
+
+            sopt.workspace = &work;
+            vopt.workspace = &work;
+            mopt.workspace = &work;
+
+            // Repeated calls should give the same results, even when the buffers contain values from previous calls.
+            std::size_t last_allocations = 0;
+            for (int it = 0; it < 3; ++it) {
+                compare_double_vectors(sref, tatami_stats::sum(row, *mat, sopt));
+
+                vopt.skip_nan = false;
+                auto vres = tatami_stats::variance(row, *mat, vopt);
+                compare_double_vectors(vref.mean, vres.mean);
+                compare_double_vectors(vref.variance, vres.variance);
+
+                vopt.skip_nan = true;
+                auto vnres = tatami_stats::variance(row, *mat, vopt);
+                compare_double_vectors(vnref.mean, vnres.mean);
+                compare_double_vectors(vnref.variance, vnres.variance);
+
+                compare_double_vectors(mref, tatami_stats::median(row, *mat, mopt));
+
+                if (it > 0) {
+                    EXPECT_EQ(work.num_allocations(), last_allocations);
+                }
+                last_allocations = work.num_allocations();
+            }
+        }
+    }
+
+    EXPECT_EQ(work.num_threads(), nthreads);
+}
+
+TEST_P(WorkspaceTest, Allocations) {
+    const int nthreads = GetParam();
+
+    // Checks that a repeated call gives the same results without making any further allocations through the workspace's Allocator.
+    // The first call is compared against a reference computed without a workspace.
+    const auto check_repeat = [&](auto call, auto compare) -> void {
+        CountingAllocator alloc;
+        tatami_stats::Workspace work(&alloc);
+        auto ref = call(static_cast<tatami_stats::Workspace*>(NULL));
+        auto first = call(&work);
+        compare(ref, first);
+        const int current = alloc.allocations;
+        auto second = call(&work);
+        compare(ref, second);
+        EXPECT_EQ(alloc.allocations, current);
+        EXPECT_EQ(alloc.deallocations, 0);
+    };
+
+    const auto compare_vectors = [](const auto& left, const auto& right) -> void {
+        compare_double_vectors(left, right);
+    };
+    const auto compare_nested = [](const auto& left, const auto& right) -> void {
+        compare_double_vectors_of_vectors(left, right);
+    };
+
+    for (auto mat : { dense_row.get(), dense_column.get(), sparse_row.get(), sparse_column.get() }) {
+        for (bool row : { true, false }) {
+            for (auto strategy : { tatami_stats::PlanStrategy::DIRECT, tatami_stats::PlanStrategy::RUNNING }) {
+                check_repeat([&](tatami_stats::Workspace* work) -> auto {
+                    tatami_stats::SumOptions opt;
+                    opt.skip_nan = true;
+                    opt.num_threads = nthreads;
+                    opt.strategy = strategy;
+                    opt.workspace = work;
+                    return tatami_stats::sum(row, *mat, opt);
+                }, compare_vectors);
+
+                for (bool skip_nan : { false, true }) {
+                    check_repeat([&](tatami_stats::Workspace* work) -> auto {
+                        tatami_stats::VarianceOptions opt;
+                        opt.skip_nan = skip_nan;
+                        opt.num_threads = nthreads;
+                        opt.strategy = strategy;
+                        opt.workspace = work;
+                        return tatami_stats::variance(row, *mat, opt).variance;
+                    }, compare_vectors);
+                }
+
+                const std::size_t otherdim = (row ? NC : NR);
+                for (std::size_t ngroups : { 3, 11 }) {
+                    std::vector<int> group(otherdim);
+                    for (std::size_t i = 0; i < otherdim; ++i) {
+                        group[i] = (i * 7) % ngroups;
+                    }
+
+                    for (bool ordered : { false, true }) {
+                        check_repeat([&](tatami_stats::Workspace* work) -> auto {
+                            tatami_stats::GroupSumOptions opt;
+                            opt.skip_nan = true;
+                            opt.num_threads = nthreads;
+                            opt.strategy = strategy;
+                            opt.group_ordered = ordered;
+                            opt.workspace = work;
+                            return tatami_stats::group_sum(row, *mat, group.data(), ngroups, opt);
+                        }, compare_nested);
+
+                        check_repeat([&](tatami_stats::Workspace* work) -> auto {
+                            tatami_stats::GroupSumOptions opt;
+                            opt.skip_nan = true;
+                            opt.num_threads = nthreads;
+                            opt.strategy = strategy;
+                            opt.group_ordered = ordered;
+                            opt.workspace = work;
+                            return tatami_stats::group_sum_interleaved(row, *mat, group.data(), ngroups, opt);
+                        }, compare_vectors);
+
+                        for (bool shifted : { false, true }) {
+                            check_repeat([&](tatami_stats::Workspace* work) -> auto {
+                                tatami_stats::GroupVarianceOptions opt;
+                                opt.num_threads = nthreads;
+                                opt.strategy = strategy;
+                                opt.group_ordered = ordered;
+                                opt.shifted_sums = shifted;
+                                opt.workspace = work;
+                                return tatami_stats::group_variance(row, *mat, group.data(), ngroups, opt).variance;
+                            }, compare_nested);
+
+                            check_repeat([&](tatami_stats::Workspace* work) -> auto {
+                                tatami_stats::GroupRssOptions opt;
+                                opt.num_threads = nthreads;
+                                opt.strategy = strategy;
+                                opt.group_ordered = ordered;
+                                opt.shifted_sums = shifted;
+                                opt.workspace = work;
+                                return tatami_stats::group_rss_interleaved(row, *mat, group.data(), ngroups, opt).rss;
+                            }, compare_vectors);
+                        }
+                    }
+
+                    for (bool deterministic : { false, true }) {
+                        check_repeat([&](tatami_stats::Workspace* work) -> auto {
+                            tatami_stats::GroupVarianceOptions opt;
+                            opt.skip_nan = true;
+                            opt.num_threads = nthreads;
+                            opt.strategy = strategy;
+                            opt.deterministic = deterministic;
+                            opt.workspace = work;
+                            return tatami_stats::group_variance(row, *mat, group.data(), ngroups, opt).variance;
+                        }, compare_nested);
+                    }
+                }
+            }
+
+            check_repeat([&](tatami_stats::Workspace* work) -> auto {
+                tatami_stats::MedianOptions opt;
+                opt.skip_nan = true;
+                opt.num_threads = nthreads;
+                opt.workspace = work;
+                return tatami_stats::median(row, *mat, opt);
+            }, compare_vectors);
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Workspace,
+    WorkspaceTest,
+    ::testing::Values(1, 3) // number of threads
+);